@@ -30,6 +30,7 @@
 #include "py/objlist.h"
 #include "py/runtime.h"
 #include "py/smallint.h"
+#include "py/gc.h"
 
 #if MICROPY_PY_UTIMEQ
 
@@ -134,6 +135,7 @@ STATIC mp_obj_t mod_utimeq_heappush(size_t n_args, const mp_obj_t *args) {
     heap->items[l].callback = args[2];
     heap->items[l].args = args[3];
     heap_siftdown(heap, 0, heap->len);
+    gc_write_barrier(heap);
     heap->len++;
     return mp_const_none;
 }
@@ -160,6 +162,8 @@ STATIC mp_obj_t mod_utimeq_heappop(mp_obj_t heap_in, mp_obj_t list_ref) {
     if (heap->len) {
         heap_siftup(heap, 0);
     }
+    gc_write_barrier(heap);
+    gc_write_barrier(ret->items);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_utimeq_heappop_obj, mod_utimeq_heappop);
@@ -33,12 +33,38 @@
 #include "py/mpstate.h"
 #include "py/gc.h"
 
-#if MICROPY_EMIT_NATIVE || (MICROPY_PY_FFI && MICROPY_FORCE_PLAT_ALLOC_EXEC)
-
 #if defined(__OpenBSD__) || defined(__MACH__)
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+
+extern long heap_size;
+extern long heap_max;
+
+// Memory for a new area of the GC heap, which grows this way until it's
+// heap_max bytes in all (counting the first area, of heap_size bytes).  The
+// areas are never freed.
+void *mp_unix_alloc_heap(size_t size) {
+    static size_t heap_total = 0;
+    if (heap_total == 0) {
+        heap_total = heap_size;
+    }
+    if (heap_max < 0 || size > (size_t)heap_max || heap_total > (size_t)heap_max - size) {
+        return NULL;
+    }
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return NULL;
+    }
+    heap_total += size;
+    return ptr;
+}
+
+#endif // MICROPY_GC_SPLIT_HEAP_AUTO
+
+#if MICROPY_EMIT_NATIVE || (MICROPY_PY_FFI && MICROPY_FORCE_PLAT_ALLOC_EXEC)
+
 // The memory allocated here is not on the GC heap (and it may contain pointers
 // that need to be GC'd) so we must somehow trace this memory.  We do it by
 // keeping a linked list of all mmap'd regions, and tracing them explicitly.
@@ -59,6 +59,11 @@ STATIC uint emit_opt = MP_EMIT_OPT_NONE;
 // Heap size of GC heap (if enabled)
 // Make it larger on a 64 bit machine, because pointers are larger.
 long heap_size = 1024*1024 * (sizeof(mp_uint_t) / 4);
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+// Size that the GC heap may grow to, by adding more areas when it's full.
+// It doesn't grow unless this is set with -X heapmax.
+long heap_max = 0;
+#endif
 #endif
 
 STATIC void stderr_print_strn(void *env, const char *str, size_t len) {
@@ -320,6 +325,11 @@ STATIC int usage(char **argv) {
 "  heapsize=<n>[w][K|M] -- set the heap size for the GC (default %ld)\n"
 , heap_size);
     impl_opts_cnt++;
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+    printf(
+"  heapmax=<n>[w][K|M] -- let the heap grow to this size when it's full (default: no growth)\n");
+    impl_opts_cnt++;
+#endif
 #endif
 
     if (impl_opts_cnt == 0) {
@@ -329,6 +339,40 @@ STATIC int usage(char **argv) {
     return 1;
 }
 
+#if MICROPY_ENABLE_GC
+// Parse a heap size given as <n>[w][K|M], returning -1 if it's invalid
+STATIC long parse_heap_size(const char *str) {
+    char *end;
+    long size = strtol(str, &end, 0);
+    // Don't bring unneeded libc dependencies like tolower()
+    // If there's 'w' immediately after number, adjust it for
+    // target word size. Note that it should be *before* size
+    // suffix like K or M, to avoid confusion with kilowords,
+    // etc. the size is still in bytes, just can be adjusted
+    // for word size (taking 32bit as baseline).
+    bool word_adjust = false;
+    if ((*end | 0x20) == 'w') {
+        word_adjust = true;
+        end++;
+    }
+    if ((*end | 0x20) == 'k') {
+        size *= 1024;
+    } else if ((*end | 0x20) == 'm') {
+        size *= 1024 * 1024;
+    } else {
+        // Compensate for ++ below
+        --end;
+    }
+    if (*++end != 0 || size < 0) {
+        return -1;
+    }
+    if (word_adjust) {
+        size = size * BYTES_PER_WORD / 4;
+    }
+    return size;
+}
+#endif
+
 // Process options which set interpreter init options
 STATIC void pre_process_options(int argc, char **argv) {
     for (int a = 1; a < argc; a++) {
@@ -348,37 +392,18 @@ STATIC void pre_process_options(int argc, char **argv) {
                     emit_opt = MP_EMIT_OPT_VIPER;
 #if MICROPY_ENABLE_GC
                 } else if (strncmp(argv[a + 1], "heapsize=", sizeof("heapsize=") - 1) == 0) {
-                    char *end;
-                    heap_size = strtol(argv[a + 1] + sizeof("heapsize=") - 1, &end, 0);
-                    // Don't bring unneeded libc dependencies like tolower()
-                    // If there's 'w' immediately after number, adjust it for
-                    // target word size. Note that it should be *before* size
-                    // suffix like K or M, to avoid confusion with kilowords,
-                    // etc. the size is still in bytes, just can be adjusted
-                    // for word size (taking 32bit as baseline).
-                    bool word_adjust = false;
-                    if ((*end | 0x20) == 'w') {
-                        word_adjust = true;
-                        end++;
-                    }
-                    if ((*end | 0x20) == 'k') {
-                        heap_size *= 1024;
-                    } else if ((*end | 0x20) == 'm') {
-                        heap_size *= 1024 * 1024;
-                    } else {
-                        // Compensate for ++ below
-                        --end;
-                    }
-                    if (*++end != 0) {
-                        goto invalid_arg;
-                    }
-                    if (word_adjust) {
-                        heap_size = heap_size * BYTES_PER_WORD / 4;
-                    }
+                    heap_size = parse_heap_size(argv[a + 1] + sizeof("heapsize=") - 1);
                     // If requested size too small, we'll crash anyway
                     if (heap_size < 700) {
                         goto invalid_arg;
                     }
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+                } else if (strncmp(argv[a + 1], "heapmax=", sizeof("heapmax=") - 1) == 0) {
+                    heap_max = parse_heap_size(argv[a + 1] + sizeof("heapmax=") - 1);
+                    if (heap_max < 0) {
+                        goto invalid_arg;
+                    }
+#endif
 #endif
                 } else {
 invalid_arg:
@@ -440,6 +465,11 @@ MP_NOINLINE int main_(int argc, char **argv) {
 #if MICROPY_ENABLE_GC
     char *heap = malloc(heap_size);
     gc_init(heap, heap + heap_size);
+    #if MICROPY_GC_PARALLEL_MARK
+    // mark with a thread for each CPU
+    long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    gc_parallel_set_markers(n_cpus > 1 ? n_cpus : 1);
+    #endif
 #endif
 
     #if MICROPY_ENABLE_PYSTACK
@@ -48,6 +48,20 @@
 #define MICROPY_COMP_RETURN_IF_EXPR (1)
 #define MICROPY_ENABLE_GC           (1)
 #define MICROPY_ENABLE_FINALISER    (1)
+// Grow the heap with mmap'd areas when it's full (see -X heapmax)
+#if !MICROPY_GC_INCREMENTAL && !MICROPY_GC_GENERATIONAL
+#define MICROPY_GC_SPLIT_HEAP       (1)
+#define MICROPY_GC_SPLIT_HEAP_AUTO  (1)
+#endif
+// Let temporary objects be bump-allocated in micropython.region()
+#if !MICROPY_GC_INCREMENTAL && !MICROPY_GC_GENERATIONAL
+#define MICROPY_GC_REGIONS          (1)
+#endif
+// Mark big heaps with a thread for each CPU (see gc.markers())
+#if MICROPY_PY_THREAD && !MICROPY_GC_INCREMENTAL && !MICROPY_GC_GENERATIONAL
+#define MICROPY_GC_PARALLEL_MARK    (1)
+#define MICROPY_ALLOC_GC_STACK_SIZE (1024)
+#endif
 #define MICROPY_STACK_CHECK         (1)
 #define MICROPY_MALLOC_USES_ALLOCATED_SIZE (1)
 #define MICROPY_MEM_STATS           (1)
@@ -70,10 +84,24 @@
 #ifndef MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (1)
 #endif
+#define MICROPY_OPT_MAP_LOOKUP_CACHE (1)
+#define MICROPY_MAP_COMPACT (1)
+#define MICROPY_OPT_STABLE_SORT (1)
+#define MICROPY_OPT_FIND_SUBBYTES (1)
+#define MICROPY_OPT_STR_BUILDER (1)
+#define MICROPY_OPT_ATTR_INLINE_CACHE (1)
+#define MICROPY_OPT_CLASS_LOOKUP_CACHE (1)
+#define MICROPY_OPT_LOAD_GLOBAL_CACHE (1)
+#define MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS (1)
+#define MICROPY_OPT_BYTECODE_QUICKENING (1)
+#define MICROPY_OPT_FOR_ITER_INLINE (1)
+#define MICROPY_OPT_GC_ATB_WORDS (1)
+#define MICROPY_QSTR_HASH_INDEX     (1)
 #define MICROPY_CAN_OVERRIDE_BUILTINS (1)
 #define MICROPY_PY_FUNCTION_ATTRS   (1)
 #define MICROPY_PY_DESCRIPTORS      (1)
 #define MICROPY_PY_BUILTINS_STR_UNICODE (1)
+#define MICROPY_PY_BUILTINS_STR_UNICODE_INDEX (1)
 #define MICROPY_PY_BUILTINS_STR_CENTER (1)
 #define MICROPY_PY_BUILTINS_STR_PARTITION (1)
 #define MICROPY_PY_BUILTINS_STR_SPLITLINES (1)
@@ -85,6 +113,8 @@
 #define MICROPY_PY_BUILTINS_POW3    (1)
 #define MICROPY_PY_BUILTINS_ROUND_INT    (1)
 #define MICROPY_PY_MICROPYTHON_MEM_INFO (1)
+#define MICROPY_PY_MICROPYTHON_HEAP_DUMP (1)
+#define MICROPY_PY_MICROPYTHON_STRBUILDER (1)
 #define MICROPY_PY_ALL_SPECIAL_METHODS (1)
 #define MICROPY_PY_REVERSE_SPECIAL_METHODS (1)
 #define MICROPY_PY_ARRAY_SLICE_ASSIGN (1)
@@ -258,6 +288,8 @@ void mp_unix_free_exec(void *ptr, size_t size);
 void mp_unix_mark_exec(void);
 #define MP_PLAT_ALLOC_EXEC(min_size, ptr, size) mp_unix_alloc_exec(min_size, ptr, size)
 #define MP_PLAT_FREE_EXEC(ptr, size) mp_unix_free_exec(ptr, size)
+void *mp_unix_alloc_heap(size_t size);
+#define MP_PLAT_ALLOC_HEAP(size) mp_unix_alloc_heap(size)
 #ifndef MICROPY_FORCE_PLAT_ALLOC_EXEC
 // Use MP_PLAT_ALLOC_EXEC for any executable memory allocation, including for FFI
 // (overriding libffi own implementation)
@@ -29,6 +29,8 @@
 
 #define MICROPY_VFS                    (1)
 #define MICROPY_PY_UOS_VFS             (1)
+// before the defaults, which turn on GC options that can't be used with it
+#define MICROPY_GC_INCREMENTAL         (1)
 
 #include <mpconfigport.h>
 
@@ -43,6 +45,9 @@
 #define MICROPY_PY_BUILTINS_HELP       (1)
 #define MICROPY_PY_BUILTINS_HELP_MODULES (1)
 #define MICROPY_PY_SYS_GETSIZEOF       (1)
+#define MICROPY_GC_FREE_LISTS          (1)
+#define MICROPY_PY_MICROPYTHON_PROFILE (1)
+#define MICROPY_PY_UTRACEMALLOC        (1)
 #define MICROPY_PY_MATH_FACTORIAL      (1)
 #define MICROPY_PY_URANDOM_EXTRA_FUNCS (1)
 #define MICROPY_PY_IO_BUFFEREDWRITER (1)
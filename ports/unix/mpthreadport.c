@@ -36,6 +36,7 @@
 
 #include <signal.h>
 #include <sched.h>
+#include <unistd.h>
 
 // this structure forms a linked list, one node per active thread
 typedef struct _thread_t {
@@ -228,4 +229,83 @@ void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex) {
     // TODO check return value
 }
 
+#if MICROPY_GC_PARALLEL_MARK
+
+// The threads that mark the heap in a collection, started when first needed.
+// gc_marker_gen is incremented to start them on a mark.
+STATIC pthread_mutex_t gc_marker_mutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC pthread_cond_t gc_marker_start_cond = PTHREAD_COND_INITIALIZER;
+STATIC pthread_cond_t gc_marker_done_cond = PTHREAD_COND_INITIALIZER;
+STATIC size_t gc_marker_count;
+STATIC size_t gc_marker_gen;
+STATIC size_t gc_marker_n;
+STATIC size_t gc_marker_running;
+STATIC void (*gc_marker_worker)(size_t, size_t);
+
+STATIC void *gc_marker_thread(void *arg) {
+    size_t id = (uintptr_t)arg;
+    size_t gen = 0;
+    pthread_mutex_lock(&gc_marker_mutex);
+    for (;;) {
+        while (gen == gc_marker_gen) {
+            pthread_cond_wait(&gc_marker_start_cond, &gc_marker_mutex);
+        }
+        gen = gc_marker_gen;
+        if (id < gc_marker_n) {
+            void (*worker)(size_t, size_t) = gc_marker_worker;
+            size_t n = gc_marker_n;
+            pthread_mutex_unlock(&gc_marker_mutex);
+            worker(id, n);
+            pthread_mutex_lock(&gc_marker_mutex);
+            if (--gc_marker_running == 0) {
+                pthread_cond_signal(&gc_marker_done_cond);
+            }
+        }
+    }
+    return NULL;
+}
+
+size_t mp_thread_gc_parallel(void (*worker)(size_t id, size_t n), size_t max_n) {
+    pthread_mutex_lock(&gc_marker_mutex);
+    while (gc_marker_count < max_n) {
+        // the markers don't run Python code, so they don't take any signals
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &old);
+        pthread_t id;
+        int ret = pthread_create(&id, NULL, gc_marker_thread, (void*)(uintptr_t)gc_marker_count);
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        if (ret != 0) {
+            break;
+        }
+        pthread_detach(id);
+        gc_marker_count++;
+    }
+    size_t n = MIN(max_n, gc_marker_count);
+    if (n > 0) {
+        gc_marker_worker = worker;
+        gc_marker_n = n;
+        gc_marker_running = n;
+        gc_marker_gen++;
+        pthread_cond_broadcast(&gc_marker_start_cond);
+        while (gc_marker_running > 0) {
+            pthread_cond_wait(&gc_marker_done_cond, &gc_marker_mutex);
+        }
+    }
+    pthread_mutex_unlock(&gc_marker_mutex);
+    return n;
+}
+
+void mp_thread_gc_parallel_idle(size_t n_waits) {
+    // let the other markers run, and if there's still nothing to do after a
+    // while then sleep, so as not to take CPU time they could use
+    if (n_waits < 64) {
+        sched_yield();
+    } else {
+        usleep(50);
+    }
+}
+
+#endif // MICROPY_GC_PARALLEL_MARK
+
 #endif // MICROPY_PY_THREAD
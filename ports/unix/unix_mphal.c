@@ -81,6 +81,50 @@ void mp_hal_set_interrupt_char(char c) {
     }
 }
 
+#if MICROPY_PY_MICROPYTHON_PROFILE
+
+#include "py/profile.h"
+
+// SIGPROF is delivered to whichever thread is using the CPU, so with threads
+// more than one handler can run at once; only one of them takes a sample
+STATIC volatile int prof_busy;
+
+STATIC void sigprof_handler(int signum) {
+    (void)signum;
+    if (__sync_lock_test_and_set(&prof_busy, 1) == 0) {
+        mp_prof_sample();
+        __sync_lock_release(&prof_busy);
+    }
+}
+
+void mp_hal_profile_timer_start(mp_uint_t interval_us) {
+    struct sigaction sa;
+    sa.sa_flags = SA_RESTART;
+    sa.sa_handler = sigprof_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, NULL);
+    struct itimerval it;
+    it.it_interval.tv_sec = interval_us / 1000000;
+    it.it_interval.tv_usec = interval_us % 1000000;
+    it.it_value = it.it_interval;
+    setitimer(ITIMER_PROF, &it, NULL);
+}
+
+void mp_hal_profile_timer_stop(void) {
+    struct itimerval it;
+    memset(&it, 0, sizeof(it));
+    setitimer(ITIMER_PROF, &it, NULL);
+    // ignore rather than use the default action, which would kill the process
+    // if a signal is still pending
+    struct sigaction sa;
+    sa.sa_flags = 0;
+    sa.sa_handler = SIG_IGN;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, NULL);
+}
+
+#endif
+
 #if MICROPY_USE_READLINE == 1
 
 #include <termios.h>
@@ -117,6 +117,7 @@ void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw
 
     #if MICROPY_STACKLESS
     code_state->prev = NULL;
+    code_state->prev_kind = 0;
     #endif
 
     // get params
@@ -284,6 +285,62 @@ continue2:;
     dump_args(code_state->state, n_state);
 }
 
+// Find the name, source file and line number of the instruction at ip, which
+// must point into the given bytecode, using the line-number mapping in its
+// code info.  This does not allocate so it can be used from a signal handler.
+// If source_line is NULL then only the names are looked up and ip is ignored.
+void mp_bytecode_get_source_info(const byte *bytecode, const byte *ip,
+    qstr *block_name, qstr *source_file, size_t *source_line) {
+    const byte *ci = bytecode;
+    ci = mp_decode_uint_skip(ci); // skip n_state
+    ci = mp_decode_uint_skip(ci); // skip n_exc_stack
+    ci++; // skip scope_params
+    ci++; // skip n_pos_args
+    ci++; // skip n_kwonly_args
+    ci++; // skip n_def_pos_args
+    size_t bc = ip - ci;
+    size_t code_info_size = mp_decode_uint_value(ci);
+    ci = mp_decode_uint_skip(ci); // skip code_info_size
+    bc -= code_info_size;
+    #if MICROPY_PERSISTENT_CODE
+    *block_name = ci[0] | (ci[1] << 8);
+    *source_file = ci[2] | (ci[3] << 8);
+    ci += 4;
+    #else
+    *block_name = mp_decode_uint_value(ci);
+    ci = mp_decode_uint_skip(ci);
+    *source_file = mp_decode_uint_value(ci);
+    ci = mp_decode_uint_skip(ci);
+    #endif
+    if (source_line == NULL) {
+        return;
+    }
+    size_t line = 1;
+    size_t c;
+    while ((c = *ci)) {
+        size_t b, l;
+        if ((c & 0x80) == 0) {
+            // 0b0LLBBBBB encoding
+            b = c & 0x1f;
+            l = c >> 5;
+            ci += 1;
+        } else {
+            // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
+            b = c & 0xf;
+            l = ((c << 4) & 0x700) | ci[1];
+            ci += 2;
+        }
+        if (bc >= b) {
+            bc -= b;
+            line += l;
+        } else {
+            // found source line corresponding to bytecode offset
+            break;
+        }
+    }
+    *source_line = line;
+}
+
 #if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE
 
 // The following table encodes the number of bytes that a specific opcode
@@ -315,15 +372,15 @@ STATIC const byte opcode_format_table[64] = {
     OC4(B, B, V, V), // 0x20-0x23
     OC4(Q, Q, Q, B), // 0x24-0x27
     OC4(V, V, Q, Q), // 0x28-0x2b
-    OC4(U, U, U, U), // 0x2c-0x2f
+    OC4(B, B, B, U), // 0x2c-0x2f
     OC4(B, B, B, B), // 0x30-0x33
     OC4(B, O, O, O), // 0x34-0x37
     OC4(O, O, U, U), // 0x38-0x3b
     OC4(U, O, B, O), // 0x3c-0x3f
     OC4(O, B, B, O), // 0x40-0x43
     OC4(B, B, O, B), // 0x44-0x47
-    OC4(U, U, U, U), // 0x48-0x4b
-    OC4(U, U, U, U), // 0x4c-0x4f
+    OC4(B, B, B, B), // 0x48-0x4b
+    OC4(B, B, U, U), // 0x4c-0x4f
     OC4(V, V, U, V), // 0x50-0x53
     OC4(B, U, V, V), // 0x54-0x57
     OC4(V, V, V, B), // 0x58-0x5b
@@ -401,6 +458,12 @@ uint mp_opcode_format(const byte *ip, size_t *opcode_size) {
             || *ip == MP_BC_MAKE_CLOSURE
             || *ip == MP_BC_MAKE_CLOSURE_DEFARGS
         );
+        if ((*ip >= MP_BC_BINARY_OP_FAST_FAST && *ip <= MP_BC_BINARY_OP_FAST_SMALL_INT_STORE)
+            || (*ip >= MP_BC_BINARY_OP_FAST_FAST_SMALL_INT && *ip <= MP_BC_BINARY_OP_FAST_SMALL_INT_STORE_SMALL_INT)) {
+            extra_byte = 3;
+        } else if (*ip >= MP_BC_BINARY_OP && *ip <= MP_BC_BINARY_OP_FLOAT) {
+            extra_byte = 1;
+        }
         ip += 1;
         if (f == MP_OPCODE_VAR_UINT) {
             while ((*ip++ & 0x80) != 0) {
@@ -82,6 +82,15 @@ typedef struct _mp_code_state_t {
     mp_obj_dict_t *old_globals;
     #if MICROPY_STACKLESS
     struct _mp_code_state_t *prev;
+    // bit 0 is set if this frame runs __init__ for an in-line constructor call
+    // bit 1 is set if this frame is a generator resumed in-line by FOR_ITER
+    // (these aren't kept in the low bits of prev because then the GC wouldn't
+    // see prev as a pointer to a heap-allocated frame)
+    mp_uint_t prev_kind;
+    #endif
+    #if MICROPY_TRACK_FRAMES
+    // the frame that was running when this one was entered, for the profiler and tracemalloc
+    struct _mp_code_state_t *prev_state;
     #endif
     // Variable-length
     mp_obj_t state[0];
@@ -95,7 +104,14 @@ const byte *mp_decode_uint_skip(const byte *ptr);
 
 mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp_obj_t inject_exc);
 mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t func, size_t n_args, size_t n_kw, const mp_obj_t *args);
+#if MICROPY_STACKLESS
+mp_code_state_t *mp_obj_fun_prepare_codestate_self(mp_obj_t func, mp_obj_t self, size_t n_args, size_t n_kw, const mp_obj_t *args);
+mp_code_state_t *mp_obj_closure_prepare_codestate(mp_obj_t self_in, mp_obj_t self_arg, size_t n_args, size_t n_kw, const mp_obj_t *args);
+mp_code_state_t *mp_obj_bound_meth_prepare_codestate(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
+#endif
 void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw, const mp_obj_t *args);
+void mp_bytecode_get_source_info(const byte *bytecode, const byte *ip,
+    qstr *block_name, qstr *source_file, size_t *source_line);
 void mp_bytecode_print(const void *descr, const byte *code, mp_uint_t len, const mp_uint_t *const_table);
 void mp_bytecode_print2(const byte *code, size_t len, const mp_uint_t *const_table);
 const byte *mp_bytecode_print_str(const byte *ip);
@@ -59,6 +59,11 @@
 #define MP_BC_DELETE_NAME        (0x2a) // qstr
 #define MP_BC_DELETE_GLOBAL      (0x2b) // qstr
 
+// Superinstructions quickened for small int operands, see below
+#define MP_BC_BINARY_OP_FAST_FAST_SMALL_INT      (0x2c) // byte op, byte local, byte local
+#define MP_BC_BINARY_OP_FAST_SMALL_INT_SMALL_INT (0x2d) // byte op, byte local, byte small int + 16
+#define MP_BC_BINARY_OP_FAST_SMALL_INT_STORE_SMALL_INT (0x2e) // byte op, byte local, byte small int + 16
+
 #define MP_BC_DUP_TOP            (0x30)
 #define MP_BC_DUP_TOP_TWO        (0x31)
 #define MP_BC_POP_TOP            (0x32)
@@ -82,6 +87,21 @@
 #define MP_BC_UNWIND_JUMP        (0x46) // rel byte code offset, 16-bit signed, in excess; then a byte
 #define MP_BC_GET_ITER_STACK     (0x47)
 
+// Superinstructions, only emitted with MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS.
+// The locals are 0-15 and the small int is encoded as in LOAD_CONST_SMALL_INT_MULTI.
+#define MP_BC_BINARY_OP_FAST_FAST           (0x48) // byte op, byte local, byte local
+#define MP_BC_BINARY_OP_FAST_SMALL_INT      (0x49) // byte op, byte local, byte small int + 16
+#define MP_BC_BINARY_OP_FAST_SMALL_INT_STORE (0x4a) // byte op, byte local, byte small int + 16
+
+// Quickenable binary op, only emitted with MICROPY_OPT_BYTECODE_QUICKENING.
+// The VM rewrites it to a specialised opcode depending on the operand types
+// it sees, and back again if the types change.  The op byte holds the operator
+// in its low 6 bits and the number of times the site was de-specialised in
+// its top 2 bits.
+#define MP_BC_BINARY_OP            (0x4b) // byte op
+#define MP_BC_BINARY_OP_SMALL_INT  (0x4c) // byte op
+#define MP_BC_BINARY_OP_FLOAT      (0x4d) // byte op
+
 #define MP_BC_BUILD_TUPLE        (0x50) // uint
 #define MP_BC_BUILD_LIST         (0x51) // uint
 #define MP_BC_BUILD_MAP          (0x53) // uint
@@ -34,6 +34,7 @@
 #include "py/smallint.h"
 #include "py/objint.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 // Helpers to work with binary-encoded data
 
@@ -327,6 +328,7 @@ void mp_binary_set_val_array(char typecode, void *p, mp_uint_t index, mp_obj_t v
         // Extension to CPython: array of objects
         case 'O':
             ((mp_obj_t*)p)[index] = val_in;
+            gc_write_barrier(p);
             break;
         default:
             #if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_NONE
@@ -33,12 +33,22 @@
 #include "py/mpstate.h"
 #include "py/emit.h"
 #include "py/bc0.h"
+#include "py/gc.h"
 
 #if MICROPY_ENABLE_COMPILER
 
 #define BYTES_FOR_INT ((BYTES_PER_WORD * 8 + 6) / 7)
 #define DUMMY_DATA_SIZE (BYTES_FOR_INT)
 
+#if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+// An instruction that may be fused with the ones following it
+typedef struct _emit_bc_fuse_t {
+    size_t start;
+    size_t end;
+    byte code[4];
+} emit_bc_fuse_t;
+#endif
+
 struct _emit_t {
     // Accessed as mp_obj_t, so must be aligned as such, and we rely on the
     // memory allocator returning a suitably aligned pointer.
@@ -70,6 +80,13 @@ struct _emit_t {
     uint16_t ct_cur_raw_code;
     #endif
     mp_uint_t *const_table;
+
+    #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+    // The last instructions emitted since the last label or line number
+    // change; only those that can start a superinstruction are recorded
+    emit_bc_fuse_t fuse[2];
+    size_t fuse_len;
+    #endif
 };
 
 emit_t *emit_bc_new(void) {
@@ -229,6 +246,7 @@ STATIC void emit_write_bytecode_byte_uint(emit_t *emit, byte b, mp_uint_t val) {
 STATIC void emit_write_bytecode_byte_const(emit_t *emit, byte b, mp_uint_t n, mp_uint_t c) {
     if (emit->pass == MP_PASS_EMIT) {
         emit->const_table[n] = c;
+        gc_write_barrier(emit->const_table);
     }
     emit_write_bytecode_byte_uint(emit, b, n);
 }
@@ -259,6 +277,7 @@ STATIC void emit_write_bytecode_byte_obj(emit_t *emit, byte b, mp_obj_t obj) {
     // Verify thar c is already uint-aligned
     assert(c == MP_ALIGN(c, sizeof(mp_obj_t)));
     *c = obj;
+    gc_write_barrier(c);
     #endif
 }
 
@@ -275,6 +294,7 @@ STATIC void emit_write_bytecode_byte_raw_code(emit_t *emit, byte b, mp_raw_code_
     // Verify thar c is already uint-aligned
     assert(c == MP_ALIGN(c, sizeof(void*)));
     *c = rc;
+    gc_write_barrier(c);
     #endif
 }
 
@@ -306,6 +326,56 @@ STATIC void emit_write_bytecode_byte_signed_label(emit_t *emit, byte b1, mp_uint
     c[2] = bytecode_offset >> 8;
 }
 
+#if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+// Record the instruction that was just emitted starting at the given offset
+STATIC void emit_bc_fuse_push(emit_t *emit, size_t start, byte b0, byte b1, byte b2, byte b3) {
+    if (emit->fuse_len == MP_ARRAY_SIZE(emit->fuse)) {
+        emit->fuse[0] = emit->fuse[1];
+        emit->fuse_len -= 1;
+    }
+    emit_bc_fuse_t *f = &emit->fuse[emit->fuse_len++];
+    f->start = start;
+    f->end = emit->bytecode_offset;
+    f->code[0] = b0;
+    f->code[1] = b1;
+    f->code[2] = b2;
+    f->code[3] = b3;
+}
+
+// Get the last n recorded instructions if they are the last n instructions
+// emitted, with nothing in between.  Returns NULL if they aren't.
+STATIC emit_bc_fuse_t *emit_bc_fuse_get(emit_t *emit, size_t n) {
+    if (emit->fuse_len < n) {
+        return NULL;
+    }
+    emit_bc_fuse_t *f = &emit->fuse[emit->fuse_len - n];
+    for (size_t i = 1; i < n; ++i) {
+        if (f[i - 1].end != f[i].start) {
+            return NULL;
+        }
+    }
+    if (f[n - 1].end != emit->bytecode_offset) {
+        return NULL;
+    }
+    return f;
+}
+
+// Replace the last n instructions (as returned by emit_bc_fuse_get) with a
+// 4-byte superinstruction.  All passes make the same decision so the code
+// size and label offsets are consistent between them.
+STATIC void emit_bc_fuse_replace(emit_t *emit, size_t n, byte b0, byte b1, byte b2, byte b3) {
+    size_t start = emit->fuse[emit->fuse_len - n].start;
+    emit->fuse_len -= n;
+    emit->bytecode_offset = start;
+    byte *c = emit_get_cur_to_write_bytecode(emit, 4);
+    c[0] = b0;
+    c[1] = b1;
+    c[2] = b2;
+    c[3] = b3;
+    emit_bc_fuse_push(emit, start, b0, b1, b2, b3);
+}
+#endif
+
 void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit->pass = pass;
     emit->stack_size = 0;
@@ -321,6 +391,9 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     #endif
     emit->bytecode_offset = 0;
     emit->code_info_offset = 0;
+    #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+    emit->fuse_len = 0;
+    #endif
 
     // Write local state size and exception stack size.
     {
@@ -485,6 +558,10 @@ void mp_emit_bc_set_source_line(emit_t *emit, mp_uint_t source_line) {
         emit_write_code_info_bytes_lines(emit, bytes_to_skip, lines_to_skip);
         emit->last_source_line_offset = emit->bytecode_offset;
         emit->last_source_line = source_line;
+        #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+        // don't fuse instructions across the start of a line
+        emit->fuse_len = 0;
+        #endif
     }
 #else
     (void)emit;
@@ -498,6 +575,10 @@ void mp_emit_bc_label_assign(emit_t *emit, mp_uint_t l) {
         return;
     }
     assert(l < emit->max_num_labels);
+    #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+    // a jump can land here so previous instructions can't be fused with later ones
+    emit->fuse_len = 0;
+    #endif
     if (emit->pass < MP_PASS_EMIT) {
         // assign label offset
         assert(emit->label_offsets[l] == (mp_uint_t)-1);
@@ -540,6 +621,9 @@ void mp_emit_bc_load_const_small_int(emit_t *emit, mp_int_t arg) {
     emit_bc_pre(emit, 1);
     if (-16 <= arg && arg <= 47) {
         emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_SMALL_INT_MULTI + 16 + arg);
+        #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+        emit_bc_fuse_push(emit, emit->bytecode_offset - 1, MP_BC_LOAD_CONST_SMALL_INT_MULTI + 16 + arg, 0, 0, 0);
+        #endif
     } else {
         emit_write_bytecode_byte_int(emit, MP_BC_LOAD_CONST_SMALL_INT, arg);
     }
@@ -567,6 +651,9 @@ void mp_emit_bc_load_local(emit_t *emit, qstr qst, mp_uint_t local_num, int kind
     emit_bc_pre(emit, 1);
     if (kind == MP_EMIT_IDOP_LOCAL_FAST && local_num <= 15) {
         emit_write_bytecode_byte(emit, MP_BC_LOAD_FAST_MULTI + local_num);
+        #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+        emit_bc_fuse_push(emit, emit->bytecode_offset - 1, MP_BC_LOAD_FAST_MULTI + local_num, 0, 0, 0);
+        #endif
     } else {
         emit_write_bytecode_byte_uint(emit, MP_BC_LOAD_FAST_N + kind, local_num);
     }
@@ -629,6 +716,16 @@ void mp_emit_bc_store_local(emit_t *emit, qstr qst, mp_uint_t local_num, int kin
     MP_STATIC_ASSERT(MP_BC_STORE_FAST_N + MP_EMIT_IDOP_LOCAL_DEREF == MP_BC_STORE_DEREF);
     (void)qst;
     emit_bc_pre(emit, -1);
+    #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+    if (kind == MP_EMIT_IDOP_LOCAL_FAST) {
+        // LOAD_FAST a; LOAD_CONST_SMALL_INT k; BINARY_OP op; STORE_FAST a
+        emit_bc_fuse_t *f = emit_bc_fuse_get(emit, 1);
+        if (f != NULL && f->code[0] == MP_BC_BINARY_OP_FAST_SMALL_INT && f->code[2] == local_num) {
+            emit_bc_fuse_replace(emit, 1, MP_BC_BINARY_OP_FAST_SMALL_INT_STORE, f->code[1], f->code[2], f->code[3]);
+            return;
+        }
+    }
+    #endif
     if (kind == MP_EMIT_IDOP_LOCAL_FAST && local_num <= 15) {
         emit_write_bytecode_byte(emit, MP_BC_STORE_FAST_MULTI + local_num);
     } else {
@@ -790,7 +887,30 @@ void mp_emit_bc_binary_op(emit_t *emit, mp_binary_op_t op) {
         op = MP_BINARY_OP_IS;
     }
     emit_bc_pre(emit, -1);
+    #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+    // LOAD_FAST a; LOAD_FAST b; BINARY_OP op
+    // LOAD_FAST a; LOAD_CONST_SMALL_INT k; BINARY_OP op
+    emit_bc_fuse_t *f = emit_bc_fuse_get(emit, 2);
+    if (f != NULL && f[0].code[0] >= MP_BC_LOAD_FAST_MULTI && f[0].code[0] < MP_BC_LOAD_FAST_MULTI + 16) {
+        byte lhs = f[0].code[0] - MP_BC_LOAD_FAST_MULTI;
+        byte rhs = f[1].code[0];
+        if (rhs >= MP_BC_LOAD_FAST_MULTI && rhs < MP_BC_LOAD_FAST_MULTI + 16) {
+            emit_bc_fuse_replace(emit, 2, MP_BC_BINARY_OP_FAST_FAST, op, lhs, rhs - MP_BC_LOAD_FAST_MULTI);
+            goto emitted;
+        } else if (rhs >= MP_BC_LOAD_CONST_SMALL_INT_MULTI && rhs < MP_BC_LOAD_CONST_SMALL_INT_MULTI + 64) {
+            emit_bc_fuse_replace(emit, 2, MP_BC_BINARY_OP_FAST_SMALL_INT, op, lhs, rhs - MP_BC_LOAD_CONST_SMALL_INT_MULTI);
+            goto emitted;
+        }
+    }
+    #endif
+    #if MICROPY_OPT_BYTECODE_QUICKENING
+    emit_write_bytecode_byte_byte(emit, MP_BC_BINARY_OP, op);
+    #else
     emit_write_bytecode_byte(emit, MP_BC_BINARY_OP_MULTI + op);
+    #endif
+    #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+emitted:
+    #endif
     if (invert) {
         emit_bc_pre(emit, 0);
         emit_write_bytecode_byte(emit, MP_BC_UNARY_OP_MULTI + MP_UNARY_OP_NOT);
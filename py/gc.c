@@ -30,9 +30,26 @@
 
 #include "py/gc.h"
 #include "py/runtime.h"
+#include "py/bc.h"
 
 #if MICROPY_ENABLE_GC
 
+#if MICROPY_GC_INCREMENTAL && MICROPY_GC_GENERATIONAL
+#error "MICROPY_GC_INCREMENTAL and MICROPY_GC_GENERATIONAL can't both be enabled"
+#endif
+
+#if MICROPY_GC_PARALLEL_MARK && (!MICROPY_PY_THREAD || MICROPY_GC_INCREMENTAL || MICROPY_GC_GENERATIONAL)
+#error "MICROPY_GC_PARALLEL_MARK needs MICROPY_PY_THREAD and can't be used with MICROPY_GC_INCREMENTAL or MICROPY_GC_GENERATIONAL"
+#endif
+
+#if MICROPY_GC_SPLIT_HEAP && (MICROPY_GC_INCREMENTAL || MICROPY_GC_GENERATIONAL)
+#error "MICROPY_GC_SPLIT_HEAP can't be used with MICROPY_GC_INCREMENTAL or MICROPY_GC_GENERATIONAL"
+#endif
+
+#if MICROPY_GC_REGIONS && (MICROPY_GC_INCREMENTAL || MICROPY_GC_GENERATIONAL)
+#error "MICROPY_GC_REGIONS can't be used with MICROPY_GC_INCREMENTAL or MICROPY_GC_GENERATIONAL"
+#endif
+
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
 #define DEBUG_printf DEBUG_printf
@@ -74,16 +91,51 @@
 #define ATB_3_IS_FREE(a) (((a) & ATB_MASK_3) == 0)
 
 #define BLOCK_SHIFT(block) (2 * ((block) & (BLOCKS_PER_ATB - 1)))
-#define ATB_GET_KIND(block) ((MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
-#define ATB_ANY_TO_FREE(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
-#define ATB_FREE_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
-#define ATB_FREE_TO_TAIL(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
-#define ATB_HEAD_TO_MARK(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
-#define ATB_MARK_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
-
-#define BLOCK_FROM_PTR(ptr) (((byte*)(ptr) - MP_STATE_MEM(gc_pool_start)) / BYTES_PER_BLOCK)
-#define PTR_FROM_BLOCK(block) (((block) * BYTES_PER_BLOCK + (uintptr_t)MP_STATE_MEM(gc_pool_start)))
+// Blocks are numbered from the start of the pool of the area that they are
+// in, and each area has its own tables.
+#define ATB_GET_KIND(area, block) (((area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
+#define ATB_ANY_TO_FREE(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
+#define ATB_FREE_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
+#define ATB_FREE_TO_TAIL(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
+#define ATB_HEAD_TO_MARK(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
+#define ATB_MARK_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
+#if MICROPY_GC_PARALLEL_MARK
+// Mark a block when other threads may be marking others in the same ATB byte,
+// returning true if it was an unmarked head before
+#define ATB_HEAD_TO_MARK_ATOMIC(area, block) (((__atomic_fetch_or(&(area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB], AT_MARK << BLOCK_SHIFT(block), __ATOMIC_RELAXED) >> BLOCK_SHIFT(block)) & 3) == AT_HEAD)
+#endif
+
+#define BLOCK_FROM_PTR(area, ptr) (((byte*)(ptr) - (area)->gc_pool_start) / BYTES_PER_BLOCK)
+#define PTR_FROM_BLOCK(area, block) (((block) * BYTES_PER_BLOCK + (uintptr_t)(area)->gc_pool_start))
 #define ATB_FROM_BLOCK(bl) ((bl) / BLOCKS_PER_ATB)
+#define AREA_BLOCKS(area) ((area)->gc_alloc_table_byte_len * BLOCKS_PER_ATB)
+
+// The first area, and the one after the given area, or NULL if it's the last.
+// Without MICROPY_GC_SPLIT_HEAP there is only the first.
+#define FIRST_AREA() (&MP_STATE_MEM(area))
+#if MICROPY_GC_SPLIT_HEAP
+#define NEXT_AREA(area) ((area)->next)
+#else
+#define NEXT_AREA(area) (NULL)
+#endif
+
+// The ATB is also looked at a unit of several bytes at a time, to skip over
+// blocks that are all free, or none of which are, and to sweep blocks that
+// are all left alone or just unmarked.  Whole units are only used where they
+// don't need to know the order of the blocks in them.
+#if MICROPY_OPT_GC_ATB_WORDS
+typedef mp_uint_t atb_word_t;
+#else
+typedef byte atb_word_t;
+#endif
+#define BLOCKS_PER_ATB_WORD (BLOCKS_PER_ATB * sizeof(atb_word_t))
+#define ATB_WORD(area, block) (((atb_word_t*)(area)->gc_alloc_table_start)[(block) / BLOCKS_PER_ATB_WORD])
+#define ATB_WORD_LOW_BITS ((atb_word_t)-1 / 3)
+// the low bit of the entry of each block in w that is free, or an unmarked
+// head, or a marked head
+#define ATB_WORD_FREE(w) (~((w) | ((w) >> 1)) & ATB_WORD_LOW_BITS)
+#define ATB_WORD_HEAD(w) ((w) & ~((w) >> 1) & ATB_WORD_LOW_BITS)
+#define ATB_WORD_MARK(w) ((w) & ((w) >> 1) & ATB_WORD_LOW_BITS)
 
 #if MICROPY_ENABLE_FINALISER
 // FTB = finaliser table byte
@@ -91,9 +143,57 @@
 
 #define BLOCKS_PER_FTB (8)
 
-#define FTB_GET(block) ((MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
-#define FTB_SET(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
-#define FTB_CLEAR(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#define FTB_GET(area, block) (((area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
+#define FTB_SET(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
+#define FTB_CLEAR(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#endif
+
+#if MICROPY_GC_DIRTY_TABLE
+// DTB = dirty table byte
+// if set, then the corresponding block was stored to or allocated during the
+// mark phase of an incremental collection, and must be scanned again to finish
+// it; or it is an old block that was stored to or allocated outside the
+// nursery, and must be scanned by the next minor collection; or it was
+// stored to or allocated outside a region while one was active, and must be
+// scanned when it ends
+
+#define BLOCKS_PER_DTB (8)
+
+#define DTB_SET(area, block) do { (area)->gc_dirty_table_start[(block) / BLOCKS_PER_DTB] |= (1 << ((block) & 7)); } while (0)
+#define DTB_BYTE_LEN(area) (((area)->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_DTB - 1) / BLOCKS_PER_DTB)
+#endif
+
+#if MICROPY_PY_UTRACEMALLOC
+// STB = site table entry, 16 bits for each block
+// for a head block that was allocated while tracemalloc is tracing, this is 1
+// plus the index in MP_STATE_VM(trace_sites) of the site that allocated it,
+// otherwise it is 0
+
+#define STB_GET(area, block) ((area)->gc_site_table_start[(block)])
+#define STB_SET(area, block, site) do { (area)->gc_site_table_start[(block)] = (site); } while (0)
+#endif
+
+// whether marked blocks are left in the ATB between calls to gc_collect()
+#define GC_KEEPS_MARKS (MICROPY_GC_INCREMENTAL || MICROPY_GC_GENERATIONAL)
+
+#if MICROPY_GC_GENERATIONAL
+// The nursery is the blocks from gc_nursery_block to the end of the heap.
+// In it, unmarked heads are young objects and marked heads are old ones that
+// survived a collection, so a minor collection only needs to mark and sweep
+// the young objects.  Old objects elsewhere are left alone by it.
+#define BLOCK_IN_NURSERY(block) ((block) >= MP_STATE_MEM(gc_nursery_block))
+#define BLOCK_IS_MARKABLE(block) (!MP_STATE_MEM(gc_minor) || BLOCK_IN_NURSERY(block))
+#else
+#define BLOCK_IS_MARKABLE(block) (1)
+#endif
+
+#if MICROPY_GC_INCREMENTAL
+// values for gc_inc_finishing, saying how gc_collect() should treat the marks
+// of an incremental collection that is in its mark phase
+enum {
+    GC_INC_FINISH_NONE, // discard them and do a full collection
+    GC_INC_FINISH_LAZY, // finish marking, then sweep in slices
+};
 #endif
 
 #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
@@ -105,48 +205,107 @@
 #endif
 
 // TODO waste less memory; currently requires that all entries in alloc_table have a corresponding block in pool
-void gc_init(void *start, void *end) {
+STATIC void gc_setup_area(mp_state_mem_area_t *area, void *start, void *end) {
     // align end pointer on block boundary
     end = (void*)((uintptr_t)end & (~(BYTES_PER_BLOCK - 1)));
+    // and the ATB, at the start, for reading it a word at a time
+    start = (void*)(((uintptr_t)start + sizeof(atb_word_t) - 1) & (~(sizeof(atb_word_t) - 1)));
     DEBUG_printf("Initializing GC heap: %p..%p = " UINT_FMT " bytes\n", start, end, (byte*)end - (byte*)start);
 
-    // calculate parameters for GC (T=total, A=alloc table, F=finaliser table, P=pool; all in bytes):
-    // T = A + F + P
+    // calculate parameters for GC (T=total, A=alloc table, S=site table, F=finaliser table, D=dirty table, P=pool; all in bytes):
+    // T = A + S + F + D + P
+    //     S = A * BLOCKS_PER_ATB * 2
     //     F = A * BLOCKS_PER_ATB / BLOCKS_PER_FTB
+    //     D = A * BLOCKS_PER_ATB / BLOCKS_PER_DTB
     //     P = A * BLOCKS_PER_ATB * BYTES_PER_BLOCK
-    // => T = A * (1 + BLOCKS_PER_ATB / BLOCKS_PER_FTB + BLOCKS_PER_ATB * BYTES_PER_BLOCK)
+    // => T = A * (1 + BLOCKS_PER_ATB * (2 + 1 / BLOCKS_PER_FTB + 1 / BLOCKS_PER_DTB + BYTES_PER_BLOCK))
     size_t total_byte_len = (byte*)end - (byte*)start;
+    // bits per block in the tables other than the ATB
+    size_t table_bits = 0;
+#if MICROPY_PY_UTRACEMALLOC
+    table_bits += BITS_PER_BYTE * sizeof(uint16_t);
+    // leave room to align the STB after the ATB
+    total_byte_len -= sizeof(uint16_t);
+#endif
 #if MICROPY_ENABLE_FINALISER
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
-#else
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len / (1 + BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
+    table_bits += BITS_PER_BYTE / BLOCKS_PER_FTB;
 #endif
+#if MICROPY_GC_DIRTY_TABLE
+    table_bits += BITS_PER_BYTE / BLOCKS_PER_DTB;
+#endif
+    area->gc_alloc_table_byte_len = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BLOCKS_PER_ATB * (table_bits + BITS_PER_BYTE * BYTES_PER_BLOCK));
 
-    MP_STATE_MEM(gc_alloc_table_start) = (byte*)start;
+    area->gc_alloc_table_start = (byte*)start;
+    byte *tables_end = area->gc_alloc_table_start + area->gc_alloc_table_byte_len;
 
-#if MICROPY_ENABLE_FINALISER
-    size_t gc_finaliser_table_byte_len = (MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
-    MP_STATE_MEM(gc_finaliser_table_start) = MP_STATE_MEM(gc_alloc_table_start) + MP_STATE_MEM(gc_alloc_table_byte_len);
+#if MICROPY_PY_UTRACEMALLOC
+    area->gc_site_table_start = (uint16_t*)(((uintptr_t)tables_end + sizeof(uint16_t) - 1) & ~(sizeof(uint16_t) - 1));
+    tables_end = (byte*)(area->gc_site_table_start + AREA_BLOCKS(area));
 #endif
 
-    size_t gc_pool_block_len = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
-    MP_STATE_MEM(gc_pool_start) = (byte*)end - gc_pool_block_len * BYTES_PER_BLOCK;
-    MP_STATE_MEM(gc_pool_end) = end;
-
 #if MICROPY_ENABLE_FINALISER
-    assert(MP_STATE_MEM(gc_pool_start) >= MP_STATE_MEM(gc_finaliser_table_start) + gc_finaliser_table_byte_len);
+    size_t gc_finaliser_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
+    area->gc_finaliser_table_start = tables_end;
+    tables_end += gc_finaliser_table_byte_len;
+#endif
+
+#if MICROPY_GC_DIRTY_TABLE
+    size_t gc_dirty_table_byte_len = DTB_BYTE_LEN(area);
+    area->gc_dirty_table_start = tables_end;
+    tables_end += gc_dirty_table_byte_len;
 #endif
 
+    size_t gc_pool_block_len = AREA_BLOCKS(area);
+    area->gc_pool_start = (byte*)end - gc_pool_block_len * BYTES_PER_BLOCK;
+    area->gc_pool_end = end;
+
+    assert(area->gc_pool_start >= tables_end);
+    (void)tables_end;
+
     // clear ATBs
-    memset(MP_STATE_MEM(gc_alloc_table_start), 0, MP_STATE_MEM(gc_alloc_table_byte_len));
+    memset(area->gc_alloc_table_start, 0, area->gc_alloc_table_byte_len);
+
+#if MICROPY_PY_UTRACEMALLOC
+    // clear STBs
+    memset(area->gc_site_table_start, 0, AREA_BLOCKS(area) * sizeof(uint16_t));
+#endif
 
 #if MICROPY_ENABLE_FINALISER
     // clear FTBs
-    memset(MP_STATE_MEM(gc_finaliser_table_start), 0, gc_finaliser_table_byte_len);
+    memset(area->gc_finaliser_table_start, 0, gc_finaliser_table_byte_len);
+#endif
+
+#if MICROPY_GC_DIRTY_TABLE
+    // clear DTBs
+    memset(area->gc_dirty_table_start, 0, gc_dirty_table_byte_len);
 #endif
 
     // set last free ATB index to start of heap
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    area->gc_last_free_atb_index = 0;
+
+    #if MICROPY_GC_SPLIT_HEAP
+    area->next = NULL;
+    #endif
+
+    DEBUG_printf("GC layout:\n");
+    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_alloc_table_start, area->gc_alloc_table_byte_len, area->gc_alloc_table_byte_len * BLOCKS_PER_ATB);
+#if MICROPY_PY_UTRACEMALLOC
+    DEBUG_printf("  site table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_site_table_start, AREA_BLOCKS(area) * sizeof(uint16_t), AREA_BLOCKS(area));
+#endif
+#if MICROPY_ENABLE_FINALISER
+    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_finaliser_table_start, gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
+#endif
+#if MICROPY_GC_DIRTY_TABLE
+    DEBUG_printf("  dirty table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_dirty_table_start, gc_dirty_table_byte_len, gc_dirty_table_byte_len * BLOCKS_PER_DTB);
+#endif
+    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_pool_start, gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+}
+
+void gc_init(void *start, void *end) {
+    gc_setup_area(&MP_STATE_MEM(area), start, end);
+    #if GC_KEEPS_MARKS
+    size_t gc_pool_block_len = AREA_BLOCKS(&MP_STATE_MEM(area));
+    #endif
 
     // unlock the GC
     MP_STATE_MEM(gc_lock_depth) = 0;
@@ -160,17 +319,82 @@ void gc_init(void *start, void *end) {
     MP_STATE_MEM(gc_alloc_amount) = 0;
     #endif
 
+    MP_STATE_MEM(gc_used_blocks) = 0;
+
+    MP_STATE_MEM(gc_sp) = 0;
+    MP_STATE_MEM(gc_rescan_block) = SIZE_MAX;
+    #if MICROPY_GC_SPLIT_HEAP
+    MP_STATE_MEM(gc_rescan_area) = &MP_STATE_MEM(area);
+    MP_STATE_MEM(gc_lowest_pool_start) = MP_STATE_MEM(area).gc_pool_start;
+    MP_STATE_MEM(gc_highest_pool_end) = MP_STATE_MEM(area).gc_pool_end;
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    // the first incremental collection starts when 3/4 of the heap is used
+    MP_STATE_MEM(gc_phase) = GC_PHASE_IDLE;
+    MP_STATE_MEM(gc_inc_finishing) = GC_INC_FINISH_NONE;
+    MP_STATE_MEM(gc_inc_budget) = MICROPY_GC_INCREMENTAL_BUDGET;
+    MP_STATE_MEM(gc_inc_countdown) = gc_pool_block_len - gc_pool_block_len / 4;
+    MP_STATE_MEM(gc_inc_slices) = 0;
+    MP_STATE_MEM(gc_inc_last_slices) = 0;
+    #endif
+
+    #if MICROPY_GC_FREE_LISTS
+    // the heap is one long run of free blocks, which is found by searching
+    memset(MP_STATE_MEM(gc_free_list), 0, sizeof(MP_STATE_MEM(gc_free_list)));
+    memset(MP_STATE_MEM(gc_free_list_tail), 0, sizeof(MP_STATE_MEM(gc_free_list_tail)));
+    MP_STATE_MEM(gc_free_list_mask) = 0;
+    #endif
+
+    #if MICROPY_GC_GENERATIONAL
+    // the nursery starts on an ATB boundary so that no chain crosses into it
+    size_t atb_len = MP_STATE_MEM(area).gc_alloc_table_byte_len;
+    MP_STATE_MEM(gc_nursery_block) = (atb_len - atb_len / MICROPY_GC_NURSERY_FRACTION) * BLOCKS_PER_ATB;
+    MP_STATE_MEM(gc_nursery_free_block) = MP_STATE_MEM(gc_nursery_block);
+    MP_STATE_MEM(gc_nursery_n_free) = gc_pool_block_len - MP_STATE_MEM(gc_nursery_block);
+    MP_STATE_MEM(gc_nursery_n_alloc) = 0;
+    MP_STATE_MEM(gc_minor) = 0;
+    #endif
+
+    #if MICROPY_GC_PARALLEL_MARK
+    // only mark with more threads if the port asks for them
+    MP_STATE_MEM(gc_markers) = 1;
+    mp_thread_mutex_init(&MP_STATE_MEM(gc_par_mutex));
+    #endif
+
     #if MICROPY_PY_THREAD
     mp_thread_mutex_init(&MP_STATE_MEM(gc_mutex));
     #endif
+}
 
-    DEBUG_printf("GC layout:\n");
-    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_alloc_table_start), MP_STATE_MEM(gc_alloc_table_byte_len), MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-#if MICROPY_ENABLE_FINALISER
-    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_finaliser_table_start), gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
-#endif
-    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_pool_start), gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+#if MICROPY_GC_SPLIT_HEAP
+void gc_add(void *start, void *end) {
+    // the state of the new area is kept at the start of it
+    start = (void*)(((uintptr_t)start + sizeof(mp_uint_t) - 1) & (~(sizeof(mp_uint_t) - 1)));
+    mp_state_mem_area_t *area = (mp_state_mem_area_t*)start;
+    gc_setup_area(area, area + 1, end);
+    if (area->gc_alloc_table_byte_len == 0) {
+        // too small to hold any blocks
+        return;
+    }
+
+    // put it at the end of the list of areas, whose blocks are free and so
+    // are found by searching like those of the first one were
+    GC_ENTER();
+    mp_state_mem_area_t *prev = &MP_STATE_MEM(area);
+    while (prev->next != NULL) {
+        prev = prev->next;
+    }
+    prev->next = area;
+    if (area->gc_pool_start < MP_STATE_MEM(gc_lowest_pool_start)) {
+        MP_STATE_MEM(gc_lowest_pool_start) = area->gc_pool_start;
+    }
+    if (area->gc_pool_end > MP_STATE_MEM(gc_highest_pool_end)) {
+        MP_STATE_MEM(gc_highest_pool_end) = area->gc_pool_end;
+    }
+    GC_EXIT();
 }
+#endif
 
 void gc_lock(void) {
     GC_ENTER();
@@ -188,12 +412,32 @@ bool gc_is_locked(void) {
     return MP_STATE_MEM(gc_lock_depth) != 0;
 }
 
-// ptr should be of type void*
-#define VERIFY_PTR(ptr) ( \
-        ((uintptr_t)(ptr) & (BYTES_PER_BLOCK - 1)) == 0      /* must be aligned on a block */ \
-        && ptr >= (void*)MP_STATE_MEM(gc_pool_start)     /* must be above start of pool */ \
-        && ptr < (void*)MP_STATE_MEM(gc_pool_end)        /* must be below end of pool */ \
-    )
+// Returns the area whose pool ptr points to a block of, or NULL if it isn't
+// a pointer to the start of a heap block.  The given area, if any, is looked
+// at first.
+static inline mp_state_mem_area_t *gc_get_ptr_area_near(const void *ptr, mp_state_mem_area_t *near) {
+    if (((uintptr_t)(ptr) & (BYTES_PER_BLOCK - 1)) != 0) { // must be aligned on a block
+        return NULL;
+    }
+    #if MICROPY_GC_SPLIT_HEAP
+    if (near != NULL && (const byte*)ptr >= near->gc_pool_start && (const byte*)ptr < near->gc_pool_end) {
+        return near;
+    }
+    if ((const byte*)ptr < MP_STATE_MEM(gc_lowest_pool_start) || (const byte*)ptr >= MP_STATE_MEM(gc_highest_pool_end)) {
+        return NULL;
+    }
+    #else
+    (void)near;
+    #endif
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        if ((const byte*)ptr >= area->gc_pool_start && (const byte*)ptr < area->gc_pool_end) {
+            return area;
+        }
+    }
+    return NULL;
+}
+
+#define gc_get_ptr_area(ptr) gc_get_ptr_area_near(ptr, NULL)
 
 #ifndef TRACE_MARK
 #if DEBUG_PRINT
@@ -203,32 +447,159 @@ bool gc_is_locked(void) {
 #endif
 #endif
 
-// Take the given block as the topmost block on the stack. Check all it's
-// children: mark the unmarked child blocks and put those newly marked
-// blocks on the stack. When all children have been checked, pop off the
-// topmost block on the stack and repeat with that one.
-STATIC void gc_mark_subtree(size_t block) {
-    // Start with the block passed in the argument.
-    size_t sp = 0;
+// Each entry on the gc stack is a block, and with more than one area, the
+// area that it's in
+#if MICROPY_GC_SPLIT_HEAP
+#define STACK_AREA_SET(sp, area) (MP_STATE_MEM(gc_area_stack)[sp] = (area))
+#define STACK_AREA(sp) (MP_STATE_MEM(gc_area_stack)[sp])
+#else
+#define STACK_AREA_SET(sp, area) (void)(area)
+#define STACK_AREA(sp) FIRST_AREA()
+#endif
+
+static inline void gc_mark_push(mp_state_mem_area_t *area, size_t block) {
+    if (MP_STATE_MEM(gc_sp) < MICROPY_ALLOC_GC_STACK_SIZE) {
+        STACK_AREA_SET(MP_STATE_MEM(gc_sp), area);
+        MP_STATE_MEM(gc_stack)[MP_STATE_MEM(gc_sp)++] = block;
+    } else {
+        MP_STATE_MEM(gc_stack_overflow) = 1;
+    }
+}
+
+static inline void gc_mark_reset(void) {
+    MP_STATE_MEM(gc_sp) = 0;
+    MP_STATE_MEM(gc_stack_overflow) = 0;
+    MP_STATE_MEM(gc_rescan_block) = SIZE_MAX;
+    #if MICROPY_GC_SPLIT_HEAP
+    MP_STATE_MEM(gc_rescan_area) = FIRST_AREA();
+    #endif
+}
+
+// Take the topmost block off the gc stack. Check all it's children: mark the
+// unmarked child blocks and put those newly marked blocks on the stack. Repeat
+// until the stack is empty.  If rescan is true and the stack overflowed, then
+// also look through the heap for blocks which have been marked but whose
+// children may not have been, and check those too.  Stops once budget blocks
+// have been checked, checking a long chain of blocks in pieces if needed, and
+// returns true if everything has been checked.
+STATIC bool gc_mark_drain(size_t budget, bool rescan) {
+    size_t sp = MP_STATE_MEM(gc_sp);
     for (;;) {
+        if (budget == 0) {
+            MP_STATE_MEM(gc_sp) = sp;
+            return false;
+        }
+
+        // Are there any blocks on the stack?
+        if (sp == 0) {
+            if (!rescan) {
+                break;
+            }
+
+            // No, so continue (or start) scanning the heap for marked blocks
+            // if the stack overflowed; 16 blocks looked at costs 1 of budget
+            #if MICROPY_GC_SPLIT_HEAP
+            mp_state_mem_area_t *area = MP_STATE_MEM(gc_rescan_area);
+            #else
+            mp_state_mem_area_t *area = FIRST_AREA();
+            #endif
+            size_t max_block = AREA_BLOCKS(area);
+            size_t block = MP_STATE_MEM(gc_rescan_block);
+            if (block >= max_block) {
+                #if MICROPY_GC_SPLIT_HEAP
+                if (block != SIZE_MAX && area->next != NULL) {
+                    // go on to scan the next area
+                    area = area->next;
+                    MP_STATE_MEM(gc_rescan_area) = area;
+                    max_block = AREA_BLOCKS(area);
+                    block = 0;
+                } else
+                #endif
+                {
+                    if (!MP_STATE_MEM(gc_stack_overflow)) {
+                        break; // No overflow, we're done.
+                    }
+                    MP_STATE_MEM(gc_stack_overflow) = 0;
+                    block = 0;
+                    #if MICROPY_GC_SPLIT_HEAP
+                    area = FIRST_AREA();
+                    MP_STATE_MEM(gc_rescan_area) = area;
+                    max_block = AREA_BLOCKS(area);
+                    #endif
+                    #if MICROPY_GC_GENERATIONAL
+                    if (MP_STATE_MEM(gc_minor)) {
+                        block = MP_STATE_MEM(gc_nursery_block);
+                    }
+                    #endif
+                }
+            }
+            size_t start = block;
+            size_t end = max_block;
+            if (budget < (max_block - block) / 16) {
+                end = block + budget * 16;
+            }
+            while (block < end && ATB_GET_KIND(area, block) != AT_MARK) {
+                block++;
+            }
+            budget -= (block - start) / 16;
+            if (block == end) {
+                MP_STATE_MEM(gc_rescan_block) = block;
+                if (block < max_block) {
+                    MP_STATE_MEM(gc_sp) = 0;
+                    return false;
+                }
+                continue;
+            }
+            MP_STATE_MEM(gc_rescan_block) = block + 1;
+            STACK_AREA_SET(sp, area);
+            MP_STATE_MEM(gc_stack)[sp++] = block;
+        }
+
+        // pop the next block off the stack
+        size_t block = MP_STATE_MEM(gc_stack)[--sp];
+        mp_state_mem_area_t *area = STACK_AREA(sp);
+
+        #if MICROPY_GC_INCREMENTAL
+        // Between the slices of an incremental collection the block may have
+        // been freed, and a tail block is the part of a chain left to check.
+        size_t kind = ATB_GET_KIND(area, block);
+        if (kind != AT_MARK && kind != AT_TAIL) {
+            continue;
+        }
+        #endif
+
         // work out number of consecutive blocks in the chain starting with this one
         size_t n_blocks = 0;
         do {
             n_blocks += 1;
-        } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+        } while (n_blocks < budget && ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
+        budget -= n_blocks;
+
+        #if MICROPY_GC_INCREMENTAL
+        if (budget == 0 && ATB_GET_KIND(area, block + n_blocks) == AT_TAIL) {
+            // check the rest of the chain once the children found so far are done
+            if (sp < MICROPY_ALLOC_GC_STACK_SIZE) {
+                MP_STATE_MEM(gc_stack)[sp++] = block + n_blocks;
+            } else {
+                MP_STATE_MEM(gc_stack_overflow) = 1;
+            }
+        }
+        #endif
 
         // check this block's children
-        void **ptrs = (void**)PTR_FROM_BLOCK(block);
+        void **ptrs = (void**)PTR_FROM_BLOCK(area, block);
         for (size_t i = n_blocks * BYTES_PER_BLOCK / sizeof(void*); i > 0; i--, ptrs++) {
             void *ptr = *ptrs;
-            if (VERIFY_PTR(ptr)) {
+            mp_state_mem_area_t *ptr_area = gc_get_ptr_area_near(ptr, area);
+            if (ptr_area != NULL) {
                 // Mark and push this pointer
-                size_t childblock = BLOCK_FROM_PTR(ptr);
-                if (ATB_GET_KIND(childblock) == AT_HEAD) {
+                size_t childblock = BLOCK_FROM_PTR(ptr_area, ptr);
+                if (ATB_GET_KIND(ptr_area, childblock) == AT_HEAD && BLOCK_IS_MARKABLE(childblock)) {
                     // an unmarked head, mark it, and push it on gc stack
                     TRACE_MARK(childblock, ptr);
-                    ATB_HEAD_TO_MARK(childblock);
+                    ATB_HEAD_TO_MARK(ptr_area, childblock);
                     if (sp < MICROPY_ALLOC_GC_STACK_SIZE) {
+                        STACK_AREA_SET(sp, ptr_area);
                         MP_STATE_MEM(gc_stack)[sp++] = childblock;
                     } else {
                         MP_STATE_MEM(gc_stack_overflow) = 1;
@@ -236,203 +607,1615 @@ STATIC void gc_mark_subtree(size_t block) {
                 }
             }
         }
+    }
 
-        // Are there any blocks on the stack?
-        if (sp == 0) {
-            break; // No, stack is empty, we're done.
+    MP_STATE_MEM(gc_sp) = 0;
+    return true;
+}
+
+#if MICROPY_GC_PARALLEL_MARK
+
+// A collection can be marked by several threads at once.  Each marker has a
+// stack of its own, and when that is full, or when other markers are waiting
+// for work and there is none on the gc stack, it moves half of it to the gc
+// stack, which markers with nothing to do take blocks from.  Blocks are
+// marked atomically so that only one marker checks the children of each.  If
+// the gc stack overflows, the markers share out the rescan of the heap.
+
+// Blocks on the stack of a marker; a chunk of the heap to rescan fits in it
+#define GC_PAR_STACK_SIZE (256)
+#define GC_PAR_RESCAN_BLOCKS (GC_PAR_STACK_SIZE)
+
+// A long chain is checked this many blocks at a time, so that other markers
+// can take the rest of it
+#define GC_PAR_CHAIN_BLOCKS (16)
+
+// A heap with fewer blocks than this is marked quicker by one thread than
+// the markers can be started
+#define GC_PAR_MIN_BLOCKS (65536)
+
+typedef struct _gc_par_stack_t {
+    size_t sp;
+    MICROPY_GC_STACK_ENTRY_TYPE block[GC_PAR_STACK_SIZE];
+    #if MICROPY_GC_SPLIT_HEAP
+    mp_state_mem_area_t *area[GC_PAR_STACK_SIZE];
+    #endif
+} gc_par_stack_t;
+
+#if MICROPY_GC_SPLIT_HEAP
+#define PAR_STACK_AREA_SET(st, sp, a) ((st)->area[sp] = (a))
+#define PAR_STACK_AREA(st, sp) ((st)->area[sp])
+#else
+#define PAR_STACK_AREA_SET(st, sp, a) (void)(a)
+#define PAR_STACK_AREA(st, sp) FIRST_AREA()
+#endif
+
+#define GC_PAR_LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define GC_PAR_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+
+STATIC bool gc_par_use_markers(void) {
+    if (MP_STATE_MEM(gc_markers) == 1) {
+        return false;
+    }
+    size_t n_blocks = 0;
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        n_blocks += AREA_BLOCKS(area);
+    }
+    return n_blocks >= GC_PAR_MIN_BLOCKS;
+}
+
+// When the markers are used the roots are only marked and pushed on the gc
+// stack, to be shared out between them once they all are
+#define GC_DRAIN_ROOTS (!gc_par_use_markers())
+
+// Move the oldest half of a marker's stack to the gc stack, as much as fits
+STATIC void gc_par_share(gc_par_stack_t *st) {
+    mp_thread_mutex_lock(&MP_STATE_MEM(gc_par_mutex), 1);
+    size_t sp = MP_STATE_MEM(gc_sp);
+    size_t n = st->sp / 2;
+    if (n > MICROPY_ALLOC_GC_STACK_SIZE - sp) {
+        n = MICROPY_ALLOC_GC_STACK_SIZE - sp;
+    }
+    for (size_t i = 0; i < n; i++) {
+        STACK_AREA_SET(sp, PAR_STACK_AREA(st, i));
+        MP_STATE_MEM(gc_stack)[sp++] = st->block[i];
+    }
+    GC_PAR_STORE(MP_STATE_MEM(gc_sp), sp);
+    mp_thread_mutex_unlock(&MP_STATE_MEM(gc_par_mutex));
+
+    st->sp -= n;
+    memmove(st->block, st->block + n, st->sp * sizeof(st->block[0]));
+    #if MICROPY_GC_SPLIT_HEAP
+    memmove(st->area, st->area + n, st->sp * sizeof(st->area[0]));
+    #endif
+}
+
+static inline void gc_par_push(gc_par_stack_t *st, mp_state_mem_area_t *area, size_t block) {
+    if (st->sp == GC_PAR_STACK_SIZE) {
+        gc_par_share(st);
+        if (st->sp == GC_PAR_STACK_SIZE) {
+            // the gc stack is full too, so leave the block to the rescan
+            GC_PAR_STORE(MP_STATE_MEM(gc_stack_overflow), 1);
+            return;
+        }
+    }
+    PAR_STACK_AREA_SET(st, st->sp, area);
+    st->block[st->sp++] = block;
+}
+
+// Take the next chunk of the heap to rescan, if a rescan is going on and
+// isn't finished.  The gc_par_mutex must be held.
+STATIC bool gc_par_rescan_next(mp_state_mem_area_t **area_out, size_t *block_out, size_t *end_out) {
+    size_t block = MP_STATE_MEM(gc_rescan_block);
+    if (block == SIZE_MAX) {
+        return false;
+    }
+    #if MICROPY_GC_SPLIT_HEAP
+    mp_state_mem_area_t *area = MP_STATE_MEM(gc_rescan_area);
+    #else
+    mp_state_mem_area_t *area = FIRST_AREA();
+    #endif
+    while (block >= AREA_BLOCKS(area)) {
+        area = NEXT_AREA(area);
+        if (area == NULL) {
+            GC_PAR_STORE(MP_STATE_MEM(gc_rescan_block), SIZE_MAX);
+            return false;
+        }
+        block = 0;
+    }
+    size_t end = MIN(block + GC_PAR_RESCAN_BLOCKS, AREA_BLOCKS(area));
+    #if MICROPY_GC_SPLIT_HEAP
+    MP_STATE_MEM(gc_rescan_area) = area;
+    #endif
+    MP_STATE_MEM(gc_rescan_block) = end;
+    *area_out = area;
+    *block_out = block;
+    *end_out = end;
+    return true;
+}
+
+// Fill an empty marker stack with blocks whose children need checking,
+// waiting until there are some.  Returns false once all the markers are
+// waiting, when the marking is done.
+STATIC bool gc_par_take(gc_par_stack_t *st, size_t n_markers) {
+    mp_thread_mutex_t *mutex = &MP_STATE_MEM(gc_par_mutex);
+    mp_thread_mutex_lock(mutex, 1);
+    for (;;) {
+        // take a fair share of the blocks on the gc stack
+        size_t sp = MP_STATE_MEM(gc_sp);
+        if (sp > 0) {
+            size_t n = MIN((sp + n_markers - 1) / n_markers, GC_PAR_STACK_SIZE);
+            for (size_t i = 0; i < n; i++) {
+                --sp;
+                PAR_STACK_AREA_SET(st, i, STACK_AREA(sp));
+                st->block[i] = MP_STATE_MEM(gc_stack)[sp];
+            }
+            st->sp = n;
+            GC_PAR_STORE(MP_STATE_MEM(gc_sp), sp);
+            mp_thread_mutex_unlock(mutex);
+            return true;
+        }
+
+        // or look through a chunk of the heap for marked blocks
+        mp_state_mem_area_t *area;
+        size_t block, end;
+        if (gc_par_rescan_next(&area, &block, &end)) {
+            mp_thread_mutex_unlock(mutex);
+            for (; block < end; block++) {
+                if (ATB_GET_KIND(area, block) == AT_MARK) {
+                    PAR_STACK_AREA_SET(st, st->sp, area);
+                    st->block[st->sp++] = block;
+                }
+            }
+            if (st->sp > 0) {
+                return true;
+            }
+            mp_thread_mutex_lock(mutex, 1);
+            continue;
+        }
+
+        if (++MP_STATE_MEM(gc_par_idle) == n_markers) {
+            // no marker has anything left to do
+            if (!MP_STATE_MEM(gc_stack_overflow)) {
+                GC_PAR_STORE(MP_STATE_MEM(gc_par_done), true);
+                mp_thread_mutex_unlock(mutex);
+                return false;
+            }
+            // but some marked blocks didn't fit on a stack, so rescan the heap
+            MP_STATE_MEM(gc_stack_overflow) = 0;
+            #if MICROPY_GC_SPLIT_HEAP
+            MP_STATE_MEM(gc_rescan_area) = FIRST_AREA();
+            #endif
+            GC_PAR_STORE(MP_STATE_MEM(gc_rescan_block), 0);
+            --MP_STATE_MEM(gc_par_idle);
+            continue;
+        }
+
+        // wait for another marker to share some work
+        mp_thread_mutex_unlock(mutex);
+        for (size_t n_waits = 0; !GC_PAR_LOAD(MP_STATE_MEM(gc_par_done))
+             && GC_PAR_LOAD(MP_STATE_MEM(gc_sp)) == 0
+             && GC_PAR_LOAD(MP_STATE_MEM(gc_rescan_block)) == SIZE_MAX; n_waits++) {
+            mp_thread_gc_parallel_idle(n_waits);
+        }
+        mp_thread_mutex_lock(mutex, 1);
+        if (MP_STATE_MEM(gc_par_done)) {
+            mp_thread_mutex_unlock(mutex);
+            return false;
+        }
+        --MP_STATE_MEM(gc_par_idle);
+    }
+}
+
+// The work of one marker, which runs on a thread of its own
+STATIC void gc_par_mark(size_t id, size_t n_markers) {
+    (void)id;
+    gc_par_stack_t st;
+    st.sp = 0;
+    while (st.sp > 0 || gc_par_take(&st, n_markers)) {
+        // pop the next block off the stack; it may be part way along a chain
+        size_t sp = --st.sp;
+        size_t block = st.block[sp];
+        mp_state_mem_area_t *area = PAR_STACK_AREA(&st, sp);
+
+        size_t n_blocks = 0;
+        do {
+            n_blocks += 1;
+        } while (n_blocks < GC_PAR_CHAIN_BLOCKS && ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
+        if (n_blocks == GC_PAR_CHAIN_BLOCKS && ATB_GET_KIND(area, block + n_blocks) == AT_TAIL) {
+            // check the rest of the chain once the children found here are done
+            gc_par_push(&st, area, block + n_blocks);
+        }
+
+        // check the children, marking and pushing those not marked yet
+        void **ptrs = (void**)PTR_FROM_BLOCK(area, block);
+        for (size_t i = n_blocks * BYTES_PER_BLOCK / sizeof(void*); i > 0; i--, ptrs++) {
+            void *ptr = *ptrs;
+            mp_state_mem_area_t *ptr_area = gc_get_ptr_area_near(ptr, area);
+            if (ptr_area != NULL) {
+                size_t childblock = BLOCK_FROM_PTR(ptr_area, ptr);
+                if (ATB_GET_KIND(ptr_area, childblock) == AT_HEAD && ATB_HEAD_TO_MARK_ATOMIC(ptr_area, childblock)) {
+                    TRACE_MARK(childblock, ptr);
+                    gc_par_push(&st, ptr_area, childblock);
+                }
+            }
+        }
+
+        // keep the waiting markers busy
+        if (st.sp > 1 && GC_PAR_LOAD(MP_STATE_MEM(gc_par_idle)) > 0 && GC_PAR_LOAD(MP_STATE_MEM(gc_sp)) == 0) {
+            gc_par_share(&st);
+        }
+    }
+}
+
+// Check the children of the blocks on the gc stack, and all their children
+// in turn, with all the markers if the heap is big enough.
+STATIC void gc_par_drain(void) {
+    if (gc_par_use_markers()) {
+        MP_STATE_MEM(gc_par_idle) = 0;
+        MP_STATE_MEM(gc_par_done) = false;
+        MP_STATE_MEM(gc_rescan_block) = SIZE_MAX;
+        if (mp_thread_gc_parallel(gc_par_mark, MP_STATE_MEM(gc_markers)) > 0) {
+            return;
+        }
+    }
+    gc_mark_drain(SIZE_MAX, true);
+}
+
+void gc_parallel_set_markers(size_t n) {
+    GC_ENTER();
+    MP_STATE_MEM(gc_markers) = MAX(1, MIN(n, MICROPY_GC_PARALLEL_MARK_MAX_MARKERS));
+    GC_EXIT();
+}
+
+#else
+
+#define GC_DRAIN_ROOTS (true)
+
+#endif // MICROPY_GC_PARALLEL_MARK
+
+#if MICROPY_GC_INCREMENTAL
+
+// If the block containing ptr (which may point into the middle of it) is
+// marked, then record that it must be checked again to finish the marking.
+STATIC void gc_inc_dirty(const void *ptr) {
+    mp_state_mem_area_t *area = FIRST_AREA();
+    if ((const byte*)ptr >= area->gc_pool_start && (const byte*)ptr < area->gc_pool_end) {
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        while (ATB_GET_KIND(area, block) == AT_TAIL) {
+            block -= 1;
+        }
+        if (ATB_GET_KIND(area, block) == AT_MARK) {
+            DTB_SET(area, block);
+        }
+    }
+}
+
+// Check again all the blocks recorded in the dirty table, and clear it.
+STATIC void gc_inc_mark_dirty(void) {
+    mp_state_mem_area_t *area = FIRST_AREA();
+    byte *dtb = area->gc_dirty_table_start;
+    size_t dtb_len = DTB_BYTE_LEN(area);
+    for (size_t i = 0; i < dtb_len; i++) {
+        byte d = dtb[i];
+        if (d == 0) {
+            continue;
+        }
+        dtb[i] = 0;
+        for (size_t block = i * BLOCKS_PER_DTB; d != 0; d >>= 1, block++) {
+            if (d & 1) {
+                size_t kind = ATB_GET_KIND(area, block);
+                if (kind == AT_HEAD) {
+                    // allocated during the mark phase and not reached since
+                    ATB_HEAD_TO_MARK(area, block);
+                    kind = AT_MARK;
+                }
+                if (kind == AT_MARK) {
+                    gc_mark_push(area, block);
+                }
+            }
+        }
+        gc_mark_drain(SIZE_MAX, false);
+    }
+}
+
+// Stop an incremental collection part way through by unmarking all blocks.
+STATIC void gc_inc_abort(void) {
+    mp_state_mem_area_t *area = FIRST_AREA();
+    byte *atb = area->gc_alloc_table_start;
+    size_t i = 0;
+    for (; i + sizeof(atb_word_t) <= area->gc_alloc_table_byte_len; i += sizeof(atb_word_t)) {
+        // turn each MARK (0b11) in this word into a HEAD (0b01)
+        atb_word_t w = ATB_WORD(area, i * BLOCKS_PER_ATB);
+        ATB_WORD(area, i * BLOCKS_PER_ATB) = w & ~(ATB_WORD_MARK(w) << 1);
+    }
+    for (; i < area->gc_alloc_table_byte_len; i++) {
+        atb[i] &= ~((atb[i] << 1) & atb[i] & 0xaa);
+    }
+    memset(area->gc_dirty_table_start, 0, DTB_BYTE_LEN(area));
+    gc_mark_reset();
+    MP_STATE_MEM(gc_phase) = GC_PHASE_IDLE;
+    MP_STATE_MEM(gc_inc_slices) = 0;
+}
+
+#endif // MICROPY_GC_INCREMENTAL
+
+#if MICROPY_GC_GENERATIONAL
+
+// Returns the head of the chain containing the block that ptr points into, or
+// SIZE_MAX if it isn't in an allocated chain.
+STATIC size_t gc_gen_head(const void *ptr) {
+    mp_state_mem_area_t *area = FIRST_AREA();
+    if ((const byte*)ptr < area->gc_pool_start || (const byte*)ptr >= area->gc_pool_end) {
+        return SIZE_MAX;
+    }
+    size_t block = BLOCK_FROM_PTR(area, ptr);
+    while (ATB_GET_KIND(area, block) == AT_TAIL) {
+        block -= 1;
+    }
+    if (ATB_GET_KIND(area, block) == AT_FREE) {
+        return SIZE_MAX;
+    }
+    return block;
+}
+
+// Called for each root pointer.  What it points to may be stored to without a
+// write barrier (eg an object that is being filled in), so the next minor
+// collection must check it, and if it's old then so must this one.
+STATIC void gc_gen_root(const void *ptr) {
+    mp_state_mem_area_t *area = FIRST_AREA();
+    size_t block = gc_gen_head(ptr);
+    if (block != SIZE_MAX) {
+        DTB_SET(area, block);
+        if (MP_STATE_MEM(gc_minor) && (!BLOCK_IN_NURSERY(block) || ATB_GET_KIND(area, block) == AT_MARK)) {
+            gc_mark_push(area, block);
+            gc_mark_drain(SIZE_MAX, false);
+        }
+    }
+}
+
+// Check the children of the old blocks recorded in the dirty table, as roots
+// of a minor collection, and clear it.
+STATIC void gc_gen_mark_dirty(void) {
+    mp_state_mem_area_t *area = FIRST_AREA();
+    byte *dtb = area->gc_dirty_table_start;
+    for (size_t i = 0, dtb_len = DTB_BYTE_LEN(area); i < dtb_len; i++) {
+        byte d = dtb[i];
+        if (d == 0) {
+            continue;
+        }
+        dtb[i] = 0;
+        for (size_t block = i * BLOCKS_PER_DTB; d != 0; d >>= 1, block++) {
+            if (d & 1) {
+                size_t head = gc_gen_head((void*)PTR_FROM_BLOCK(area, block));
+                if (head == SIZE_MAX || (BLOCK_IN_NURSERY(head) && ATB_GET_KIND(area, head) == AT_HEAD)) {
+                    // freed, or a young block which is only live if it's reached
+                    continue;
+                }
+                // the stack is empty here, so this can't overflow
+                gc_mark_push(area, head);
+                gc_mark_drain(SIZE_MAX, false);
+            }
+        }
+    }
+}
+
+// Mark (if stick is true) or unmark all the heads in the nursery.  Returns
+// the number of free blocks in it.
+STATIC size_t gc_gen_stick(bool stick) {
+    byte *atb = MP_STATE_MEM(area).gc_alloc_table_start;
+    size_t n_free = 0;
+    for (size_t i = MP_STATE_MEM(gc_nursery_block) / BLOCKS_PER_ATB; i < MP_STATE_MEM(area).gc_alloc_table_byte_len; i++) {
+        byte a = atb[i];
+        if (stick) {
+            // turn each HEAD (0b01) into a MARK (0b11)
+            atb[i] = a | ((a & 0x55) << 1);
+            for (int j = 0; j < BLOCKS_PER_ATB; j++, a >>= 2) {
+                n_free += (a & 3) == AT_FREE;
+            }
+        } else {
+            // turn each MARK (0b11) into a HEAD (0b01)
+            atb[i] = a & ~((a << 1) & a & 0xaa);
+        }
+    }
+    return n_free;
+}
+
+// Whether small objects should be allocated in the nursery: not if it's
+// mostly full of old objects, in which case they are allocated outside it
+// until a full collection frees some of those.
+STATIC bool gc_gen_use_nursery(void) {
+    size_t n_nursery = AREA_BLOCKS(FIRST_AREA()) - MP_STATE_MEM(gc_nursery_block);
+    return MP_STATE_MEM(gc_nursery_n_free) > n_nursery / 4;
+}
+
+#endif // MICROPY_GC_GENERATIONAL
+
+#if MICROPY_GC_FREE_LISTS
+
+// the free lists only hold runs of blocks of an area before this one; the
+// lists are shared by all the areas
+#if MICROPY_GC_GENERATIONAL
+#define FREE_LIST_END_BLOCK(area) (MP_STATE_MEM(gc_nursery_block))
+#else
+#define FREE_LIST_END_BLOCK(area) (AREA_BLOCKS(area))
+#endif
+
+// the index of the list of runs longer than MICROPY_GC_FREE_LIST_MAX_BLOCKS
+#define FREE_LIST_LONG (MICROPY_GC_FREE_LIST_MAX_BLOCKS)
+
+// A run of free blocks on a free list, stored in its first block.  Only the
+// runs on the last list need their length.
+typedef struct _gc_free_run_t {
+    struct _gc_free_run_t *next;
+    size_t n_blocks;
+} gc_free_run_t;
+
+#define FREE_LIST(k) (((gc_free_run_t**)MP_STATE_MEM(gc_free_list))[k])
+#define FREE_LIST_TAIL(k) (((gc_free_run_t**)MP_STATE_MEM(gc_free_list_tail))[k])
+
+#if MICROPY_GC_FREE_LIST_MAX_BLOCKS > 31
+#error "MICROPY_GC_FREE_LIST_MAX_BLOCKS can be at most 31"
+#endif
+
+// Put the run of n free blocks starting at the given block on its list.
+STATIC void gc_free_list_push(mp_state_mem_area_t *area, size_t block, size_t n) {
+    gc_free_run_t *run = (gc_free_run_t*)PTR_FROM_BLOCK(area, block);
+    size_t k = n > MICROPY_GC_FREE_LIST_MAX_BLOCKS ? FREE_LIST_LONG : n - 1;
+    if (FREE_LIST(k) == NULL) {
+        FREE_LIST_TAIL(k) = run;
+    }
+    run->next = FREE_LIST(k);
+    run->n_blocks = n;
+    FREE_LIST(k) = run;
+    MP_STATE_MEM(gc_free_list_mask) |= (uint32_t)1 << k;
+    if (n > MP_STATE_MEM(gc_free_list_max_run)) {
+        MP_STATE_MEM(gc_free_list_max_run) = n;
+    }
+}
+
+// Empty the free lists, so that gc_free_list_add can make them again from the
+// runs of free blocks that a sweep leaves, starting with the first block.
+STATIC void gc_free_list_begin(void) {
+    for (size_t k = 0; k <= FREE_LIST_LONG; k++) {
+        FREE_LIST(k) = NULL;
+    }
+    MP_STATE_MEM(gc_free_list_mask) = 0;
+    MP_STATE_MEM(gc_free_list_block) = 0;
+    MP_STATE_MEM(gc_free_list_max_run) = 0;
+}
+
+// The first block of a run on a free list, and its area, or SIZE_MAX if it
+// isn't a block that a run can start at.  Blocks are also allocated by
+// searching the ATB, and by gc_realloc, so a run may have been used since it
+// was put on its list, and then the next pointer that led to this one may be
+// anything.
+STATIC size_t gc_free_run_block(const gc_free_run_t *run, mp_state_mem_area_t **area_out) {
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        uintptr_t offset = (uintptr_t)run - (uintptr_t)area->gc_pool_start;
+        if (offset / BYTES_PER_BLOCK < FREE_LIST_END_BLOCK(area)) {
+            if (offset % BYTES_PER_BLOCK != 0) {
+                break;
+            }
+            *area_out = area;
+            return offset / BYTES_PER_BLOCK;
+        }
+    }
+    return SIZE_MAX;
+}
+
+// Put the run of n free blocks starting at the given block at the end of its
+// list, so that each list is in address order and the heap is still filled
+// from the bottom up.  The last run may have been allocated since it was put
+// there, by an incremental sweep letting gc_alloc run in between, in which
+// case the new one goes at the start instead.
+STATIC void gc_free_list_append(mp_state_mem_area_t *area, size_t block, size_t n) {
+    gc_free_run_t *run = (gc_free_run_t*)PTR_FROM_BLOCK(area, block);
+    size_t k = n > MICROPY_GC_FREE_LIST_MAX_BLOCKS ? FREE_LIST_LONG : n - 1;
+    gc_free_run_t *last = FREE_LIST_TAIL(k);
+    if (FREE_LIST(k) != NULL) {
+        mp_state_mem_area_t *last_area = area;
+        size_t last_block = gc_free_run_block(last, &last_area);
+        if (last_block == SIZE_MAX || ATB_GET_KIND(last_area, last_block) != AT_FREE) {
+            gc_free_list_push(area, block, n);
+            return;
+        }
+    }
+    run->next = NULL;
+    run->n_blocks = n;
+    if (FREE_LIST(k) == NULL) {
+        FREE_LIST(k) = run;
+    } else {
+        last->next = run;
+    }
+    FREE_LIST_TAIL(k) = run;
+    MP_STATE_MEM(gc_free_list_mask) |= (uint32_t)1 << k;
+    if (n > MP_STATE_MEM(gc_free_list_max_run)) {
+        MP_STATE_MEM(gc_free_list_max_run) = n;
+    }
+}
+
+// Add the runs of free blocks of the area from where the lists have been made
+// up to, to the given block, which must have been swept.  A run that reaches
+// it may go on past it, so it is left for next time unless the block is the
+// end.
+STATIC void gc_free_list_add(mp_state_mem_area_t *area, size_t end) {
+    size_t last_block = FREE_LIST_END_BLOCK(area);
+    if (end > last_block) {
+        end = last_block;
+    }
+    size_t block = MP_STATE_MEM(gc_free_list_block);
+    size_t n = 0;
+    for (; block < end; block++) {
+        if (block % BLOCKS_PER_ATB_WORD == 0 && block + BLOCKS_PER_ATB_WORD <= end && ATB_WORD(area, block) == 0) {
+            // skip over a word of free blocks at once
+            n += BLOCKS_PER_ATB_WORD;
+            block += BLOCKS_PER_ATB_WORD - 1;
+        } else if (ATB_GET_KIND(area, block) == AT_FREE) {
+            n += 1;
+        } else if (n > 0) {
+            gc_free_list_append(area, block - n, n);
+            n = 0;
+        }
+    }
+    if (n > 0 && end == last_block) {
+        gc_free_list_append(area, block - n, n);
+        n = 0;
+    }
+    MP_STATE_MEM(gc_free_list_block) = block - n;
+}
+
+#if !MICROPY_GC_INCREMENTAL
+// Make the free lists again from the whole heap, once it has been swept.
+STATIC void gc_free_list_rebuild(void) {
+    gc_free_list_begin();
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        MP_STATE_MEM(gc_free_list_block) = 0;
+        gc_free_list_add(area, FREE_LIST_END_BLOCK(area));
+    }
+}
+#endif
+
+// Whether the n blocks of the area from the given one are all free.
+STATIC bool gc_free_blocks_are_free(mp_state_mem_area_t *area, size_t block, size_t n) {
+    if (n > FREE_LIST_END_BLOCK(area) - block) {
+        return false;
+    }
+    for (size_t end = block + n; block < end; block++) {
+        if (ATB_GET_KIND(area, block) != AT_FREE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Remove the first n blocks of the run of n_run blocks at *link, in the given
+// area, from its list, putting what's left of it, whose first block must be
+// free, back on the right list.
+STATIC void gc_free_list_split(mp_state_mem_area_t *area, gc_free_run_t **link, size_t n, size_t n_run) {
+    gc_free_run_t *run = *link;
+    *link = run->next;
+    if (n_run == n) {
+        return;
+    }
+    size_t n_left = n_run - n;
+    gc_free_run_t *rest = (gc_free_run_t*)((byte*)run + n * BYTES_PER_BLOCK);
+    if (n_left > MICROPY_GC_FREE_LIST_MAX_BLOCKS) {
+        // leave the rest in the same place on the list of long runs
+        rest->next = *link;
+        rest->n_blocks = n_left;
+        *link = rest;
+        if (FREE_LIST_TAIL(FREE_LIST_LONG) == run) {
+            FREE_LIST_TAIL(FREE_LIST_LONG) = rest;
+        }
+    } else {
+        gc_free_list_push(area, BLOCK_FROM_PTR(area, rest), n_left);
+    }
+}
+
+// Take a run of n_blocks free blocks from the free lists and return its first
+// block and its area, or SIZE_MAX if there are none.  A run of exactly that length is used
+// if there is one, otherwise the lowest run that is long enough, like the
+// search of the ATB does, to keep the free space together.  The length of a
+// run is only trusted once its blocks are found to be free, along with the
+// first one of what will be left of it.  If a run turns out not to be free
+// then its next pointer can't be trusted either, so the rest of its list is
+// dropped.  A run that was used without going through the lists and then
+// freed again can be on a list twice, so the walk of the list of long runs is
+// bounded by how many of them fit in the heap, in case it has a loop.
+STATIC size_t gc_free_list_take(size_t n_blocks, mp_state_mem_area_t **area_out) {
+    for (;;) {
+        size_t k = FREE_LIST_LONG;
+        if (n_blocks <= MICROPY_GC_FREE_LIST_MAX_BLOCKS) {
+            if (FREE_LIST(n_blocks - 1) != NULL) {
+                // a run of exactly the right length, which needs no splitting
+                k = n_blocks - 1;
+            } else {
+                // otherwise the lowest of the heads of the lists of longer runs
+                uint32_t mask = MP_STATE_MEM(gc_free_list_mask) & ~((uint32_t)1 << FREE_LIST_LONG);
+                for (size_t j = n_blocks; (mask >> j) != 0; j++) {
+                    if (!((mask >> j) & 1)) {
+                        continue;
+                    }
+                    if (FREE_LIST(j) == NULL) {
+                        MP_STATE_MEM(gc_free_list_mask) &= ~((uint32_t)1 << j);
+                    } else if (FREE_LIST(k) == NULL || FREE_LIST(j) < FREE_LIST(k)) {
+                        k = j;
+                    }
+                }
+            }
+        }
+
+        gc_free_run_t **link = &FREE_LIST(k);
+        mp_state_mem_area_t *area = FIRST_AREA();
+        size_t block = SIZE_MAX;
+        size_t n_run = k + 1;
+        if (k == FREE_LIST_LONG) {
+            // the first run on the list of long runs that is long enough
+            size_t limit = 0;
+            for (mp_state_mem_area_t *a = FIRST_AREA(); a != NULL; a = NEXT_AREA(a)) {
+                limit += FREE_LIST_END_BLOCK(a) / (MICROPY_GC_FREE_LIST_MAX_BLOCKS + 1);
+            }
+            for (; *link != NULL; link = &(*link)->next) {
+                block = gc_free_run_block(*link, &area);
+                if (block == SIZE_MAX || ATB_GET_KIND(area, block) != AT_FREE || limit-- == 0) {
+                    block = SIZE_MAX;
+                    break;
+                }
+                n_run = (*link)->n_blocks;
+                if (n_run >= n_blocks) {
+                    break;
+                }
+            }
+        } else if (*link != NULL) {
+            block = gc_free_run_block(*link, &area);
+        }
+        if (*link == NULL) {
+            return SIZE_MAX;
+        }
+
+        if (block == SIZE_MAX || !gc_free_blocks_are_free(area, block, n_run > n_blocks ? n_blocks + 1 : n_blocks)) {
+            *link = NULL;
+            continue;
+        }
+        gc_free_list_split(area, link, n_blocks, n_run);
+        *area_out = area;
+        return block;
+    }
+}
+
+// The n free blocks from the given one are about to be used by gc_realloc, so
+// if they're at the start of a run at the head of a list then take them from
+// it, so the list stays usable.
+STATIC void gc_free_list_claim(mp_state_mem_area_t *area, size_t block, size_t n) {
+    gc_free_run_t *run = (gc_free_run_t*)PTR_FROM_BLOCK(area, block);
+    for (size_t k = 0; k <= FREE_LIST_LONG; k++) {
+        if (FREE_LIST(k) == run) {
+            size_t n_run = k < FREE_LIST_LONG ? k + 1 : run->n_blocks;
+            if (n_run > n && gc_free_blocks_are_free(area, block + n, 1)) {
+                gc_free_list_split(area, &FREE_LIST(k), n, n_run);
+            } else {
+                FREE_LIST(k) = run->next;
+            }
+            return;
+        }
+    }
+}
+
+#endif // MICROPY_GC_FREE_LISTS
+
+// Account for the blocks from start_block to end_block (exclusive) having
+// been made free, and let them be allocated again.
+STATIC void gc_free_run(mp_state_mem_area_t *area, size_t start_block, size_t end_block) {
+    MP_STATE_MEM(gc_used_blocks) -= end_block - start_block;
+
+    #if MICROPY_GC_FREE_LISTS
+    if (end_block <= FREE_LIST_END_BLOCK(area)) {
+        // keep the run for a small allocation to reuse, rather than
+        // making the next search start from here
+        gc_free_list_push(area, start_block, end_block - start_block);
+    } else
+    #endif
+    // set the last_free pointer to this block if it's earlier in the heap
+    // (and not in the nursery, which has its own pointer)
+    if (start_block / BLOCKS_PER_ATB < area->gc_last_free_atb_index
+        #if MICROPY_GC_GENERATIONAL
+        && !BLOCK_IN_NURSERY(start_block)
+        #endif
+        ) {
+        area->gc_last_free_atb_index = start_block / BLOCKS_PER_ATB;
+    }
+}
+
+// Clear the caches that refer to heap memory without keeping it alive; this
+// must be done before any of it is freed.
+STATIC void gc_forget_caches(void) {
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    memset(MP_STATE_VM(str_index_cache), 0, sizeof(MP_STATE_VM(str_index_cache)));
+    #endif
+    #if MICROPY_OPT_STR_BUILDER
+    memset(MP_STATE_VM(str_builder_cache), 0, sizeof(MP_STATE_VM(str_builder_cache)));
+    #endif
+}
+
+// Free unmarked heads and their tails, and unmark the marked heads, of the
+// area from the given block up to end, or further if that is in the middle of
+// a chain.  Returns the block it stopped at.
+STATIC size_t gc_sweep(mp_state_mem_area_t *area, size_t block, size_t end) {
+    gc_forget_caches();
+    #if MICROPY_GC_INCREMENTAL
+    size_t n_free = 0;
+    #endif
+    size_t n_freed = 0;
+    int free_tail = 0;
+    for (size_t max_block = AREA_BLOCKS(area); block < max_block; block++) {
+        if (!free_tail && block % BLOCKS_PER_ATB_WORD == 0 && block + BLOCKS_PER_ATB_WORD <= end && block + BLOCKS_PER_ATB_WORD <= max_block) {
+            atb_word_t w = ATB_WORD(area, block);
+            if (ATB_WORD_HEAD(w) == 0) {
+                // nothing in this word is freed, so just unmark its heads
+                ATB_WORD(area, block) = w & ~(ATB_WORD_MARK(w) << 1);
+                #if MICROPY_GC_INCREMENTAL
+                for (atb_word_t f = ATB_WORD_FREE(w); f != 0; f &= f - 1) {
+                    n_free += 1;
+                }
+                #endif
+                block += BLOCKS_PER_ATB_WORD - 1;
+                continue;
+            }
+        }
+        size_t kind = ATB_GET_KIND(area, block);
+        if (block >= end && kind != AT_TAIL) {
+            break;
+        }
+        switch (kind) {
+            case AT_HEAD:
+#if MICROPY_ENABLE_FINALISER
+                if (FTB_GET(area, block)) {
+                    mp_obj_base_t *obj = (mp_obj_base_t*)PTR_FROM_BLOCK(area, block);
+                    if (obj->type != NULL) {
+                        // if the object has a type then see if it has a __del__ method
+                        mp_obj_t dest[2];
+                        mp_load_method_maybe(MP_OBJ_FROM_PTR(obj), MP_QSTR___del__, dest);
+                        if (dest[0] != MP_OBJ_NULL) {
+                            // load_method returned a method, execute it in a protected environment
+                            #if MICROPY_ENABLE_SCHEDULER
+                            mp_sched_lock();
+                            #endif
+                            mp_call_function_1_protected(dest[0], dest[1]);
+                            #if MICROPY_ENABLE_SCHEDULER
+                            mp_sched_unlock();
+                            #endif
+                        }
+                    }
+                    // clear finaliser flag
+                    FTB_CLEAR(area, block);
+                }
+#endif
+                free_tail = 1;
+                DEBUG_printf("gc_sweep(%p)\n", PTR_FROM_BLOCK(area, block));
+                #if MICROPY_PY_GC_COLLECT_RETVAL
+                MP_STATE_MEM(gc_collected)++;
+                #endif
+                // fall through to free the head
+
+            case AT_TAIL:
+                if (free_tail) {
+                    ATB_ANY_TO_FREE(area, block);
+                    n_freed += 1;
+                    #if CLEAR_ON_SWEEP
+                    memset((void*)PTR_FROM_BLOCK(area, block), 0, BYTES_PER_BLOCK);
+                    #endif
+                    #if MICROPY_GC_INCREMENTAL
+                    n_free += 1;
+                    #endif
+                }
+                break;
+
+            case AT_MARK:
+                ATB_MARK_TO_HEAD(area, block);
+                free_tail = 0;
+                break;
+
+            #if MICROPY_GC_INCREMENTAL
+            case AT_FREE:
+                n_free += 1;
+                break;
+            #endif
+        }
+    }
+    #if MICROPY_GC_INCREMENTAL
+    MP_STATE_MEM(gc_sweep_n_free) += n_free;
+    #endif
+    MP_STATE_MEM(gc_used_blocks) -= n_freed;
+    return block;
+}
+
+#if MICROPY_GC_INCREMENTAL
+// Sweep the next n blocks of an incremental collection.  The GC must be
+// locked so that finalisers can't allocate.
+STATIC void gc_inc_sweep(size_t n) {
+    mp_state_mem_area_t *area = FIRST_AREA();
+    size_t max_block = AREA_BLOCKS(area);
+    size_t block = MP_STATE_MEM(gc_sweep_block);
+    MP_STATE_MEM(gc_sweep_block) = gc_sweep(area, block, n < max_block - block ? block + n : max_block);
+
+    #if MICROPY_GC_FREE_LISTS
+    // make the free lists again as the sweep goes, rather than all at the end
+    if (block == 0) {
+        gc_free_list_begin();
+    }
+    gc_free_list_add(area, MP_STATE_MEM(gc_sweep_block));
+    #endif
+
+    // blocks may now be free from here on
+    if (block / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+        area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
+    }
+
+    if (MP_STATE_MEM(gc_sweep_block) >= max_block) {
+        // the collection is done; start the next one when 3/4 of the blocks
+        // that are free now have been allocated
+        size_t n_free = MP_STATE_MEM(gc_sweep_n_free);
+        MP_STATE_MEM(gc_inc_countdown) = n_free - n_free / 4;
+        MP_STATE_MEM(gc_phase) = GC_PHASE_IDLE;
+        MP_STATE_MEM(gc_inc_last_slices) = MP_STATE_MEM(gc_inc_slices);
+        MP_STATE_MEM(gc_inc_slices) = 0;
+    }
+}
+#endif
+
+// Mark the heads that the given pointers point to, and either check all their
+// children now or leave them on the gc stack for later.
+STATIC void gc_mark_ptrs(void **ptrs, size_t len, bool drain) {
+    for (size_t i = 0; i < len; i++) {
+        void *ptr = ptrs[i];
+        #if MICROPY_GC_GENERATIONAL
+        gc_gen_root(ptr);
+        #endif
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        if (area != NULL) {
+            size_t block = BLOCK_FROM_PTR(area, ptr);
+            if (ATB_GET_KIND(area, block) == AT_HEAD && BLOCK_IS_MARKABLE(block)) {
+                // An unmarked head: mark it, and mark all its children
+                TRACE_MARK(block, ptr);
+                ATB_HEAD_TO_MARK(area, block);
+                gc_mark_push(area, block);
+                if (drain) {
+                    gc_mark_drain(SIZE_MAX, false);
+                }
+                continue;
+            }
+        }
+        #if MICROPY_GC_INCREMENTAL
+        if (MP_STATE_MEM(gc_phase) == GC_PHASE_MARK) {
+            // Finishing an incremental collection: something that points to a
+            // marked block, maybe into the middle of it, may have stored into
+            // it without a write barrier (eg a running generator), so check it
+            // again.
+            gc_inc_dirty(ptr);
+        }
+        #endif
+    }
+}
+
+STATIC void gc_mark_roots(bool drain) {
+    // Trace root pointers.  This relies on the root pointers being organised
+    // correctly in the mp_state_ctx structure.  We scan nlr_top, dict_locals,
+    // dict_globals, then the root pointer section of mp_state_vm.
+    void **ptrs = (void**)(void*)&mp_state_ctx;
+    size_t root_start = offsetof(mp_state_ctx_t, thread.dict_locals);
+    size_t root_end = offsetof(mp_state_ctx_t, vm.qstr_last_chunk);
+    gc_mark_ptrs(ptrs + root_start / sizeof(void*), (root_end - root_start) / sizeof(void*), drain);
+
+    #if MICROPY_ENABLE_PYSTACK
+    // Trace root pointers from the Python stack.
+    ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
+    gc_mark_ptrs(ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void*), drain);
+    #endif
+}
+
+#if MICROPY_GC_REGIONS
+// Mark the objects that have been allocated in the active regions, and either
+// check all their children now or leave them on the gc stack for later.  They
+// aren't necessarily referred to by anything else until their region ends.
+STATIC void gc_region_mark(bool drain) {
+    for (gc_region_t *r = MP_STATE_MEM(gc_regions); r != NULL; r = r->next) {
+        for (gc_region_chunk_t *c = r->chunk; c != NULL; c = c->prev) {
+            mp_state_mem_area_t *area = c->area;
+            for (size_t block = c->start; block < c->free; block++) {
+                if (ATB_GET_KIND(area, block) == AT_HEAD) {
+                    ATB_HEAD_TO_MARK(area, block);
+                    gc_mark_push(area, block);
+                    if (drain) {
+                        gc_mark_drain(SIZE_MAX, false);
+                    }
+                }
+            }
+            // the rest of the chunk is kept, but has nothing in it to check
+            ATB_HEAD_TO_MARK(area, c->free);
+        }
+    }
+}
+#endif
+
+void gc_collect_start(void) {
+    GC_ENTER();
+    MP_STATE_MEM(gc_lock_depth)++;
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    MP_STATE_MEM(gc_alloc_amount) = 0;
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_phase) == GC_PHASE_SWEEP) {
+        // finish sweeping the previous collection
+        gc_inc_sweep(SIZE_MAX);
+    } else if (MP_STATE_MEM(gc_phase) == GC_PHASE_MARK && MP_STATE_MEM(gc_inc_finishing) == GC_INC_FINISH_NONE) {
+        // a full collection is wanted, so don't keep the marks made so far
+        // because they may be of blocks that have become unreachable since
+        gc_inc_abort();
+    }
+    if (MP_STATE_MEM(gc_phase) == GC_PHASE_IDLE) {
+        gc_mark_reset();
+    }
+    #else
+    gc_mark_reset();
+    #endif
+
+    #if MICROPY_GC_GENERATIONAL
+    if (MP_STATE_MEM(gc_minor)) {
+        // old blocks that were stored to may point to young ones
+        gc_gen_mark_dirty();
+    } else {
+        // a full collection checks the old blocks in the nursery again too
+        gc_gen_stick(false);
+        memset(MP_STATE_MEM(area).gc_dirty_table_start, 0, DTB_BYTE_LEN(FIRST_AREA()));
+    }
+    #endif
+
+    gc_mark_roots(GC_DRAIN_ROOTS);
+    #if MICROPY_GC_REGIONS
+    gc_region_mark(GC_DRAIN_ROOTS);
+    #endif
+}
+
+void gc_collect_root(void **ptrs, size_t len) {
+    gc_mark_ptrs(ptrs, len, GC_DRAIN_ROOTS);
+}
+
+void gc_collect_end(void) {
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_phase) == GC_PHASE_MARK) {
+        gc_inc_mark_dirty();
+    }
+    #endif
+    #if MICROPY_GC_PARALLEL_MARK
+    gc_par_drain();
+    #else
+    gc_mark_drain(SIZE_MAX, true);
+    #endif
+    #if MICROPY_PY_GC_COLLECT_RETVAL
+    MP_STATE_MEM(gc_collected) = 0;
+    #endif
+    #if MICROPY_GC_INCREMENTAL
+    // finishing the marking counts as one slice
+    MP_STATE_MEM(gc_inc_slices)++;
+    MP_STATE_MEM(gc_phase) = GC_PHASE_SWEEP;
+    MP_STATE_MEM(gc_sweep_block) = 0;
+    MP_STATE_MEM(gc_sweep_n_free) = 0;
+    if (MP_STATE_MEM(gc_inc_finishing) == GC_INC_FINISH_LAZY) {
+        // leave the sweep to be done a slice at a time by gc_alloc
+        MP_STATE_MEM(gc_inc_finishing) = GC_INC_FINISH_NONE;
+    } else {
+        gc_inc_sweep(SIZE_MAX);
+    }
+    #elif MICROPY_GC_GENERATIONAL
+    if (MP_STATE_MEM(gc_minor)) {
+        gc_sweep(FIRST_AREA(), MP_STATE_MEM(gc_nursery_block), SIZE_MAX);
+        MP_STATE_MEM(gc_minor) = 0;
+    } else {
+        gc_sweep(FIRST_AREA(), 0, SIZE_MAX);
+        MP_STATE_MEM(area).gc_last_free_atb_index = 0;
+        #if MICROPY_GC_FREE_LISTS
+        gc_free_list_rebuild();
+        #endif
+    }
+    // what is left in the nursery is now old
+    MP_STATE_MEM(gc_nursery_n_free) = gc_gen_stick(true);
+    MP_STATE_MEM(gc_nursery_n_alloc) = 0;
+    MP_STATE_MEM(gc_nursery_free_block) = MP_STATE_MEM(gc_nursery_block);
+    #else
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        gc_sweep(area, 0, SIZE_MAX);
+        area->gc_last_free_atb_index = 0;
+    }
+    #if MICROPY_GC_FREE_LISTS
+    gc_free_list_rebuild();
+    #endif
+    #endif
+    MP_STATE_MEM(gc_lock_depth)--;
+    GC_EXIT();
+}
+
+void gc_sweep_all(void) {
+    GC_ENTER();
+    MP_STATE_MEM(gc_lock_depth)++;
+    #if MICROPY_GC_INCREMENTAL
+    // unmark everything, so that it is all freed
+    gc_inc_abort();
+    #elif MICROPY_GC_GENERATIONAL
+    // unmark the old blocks in the nursery, so that they are freed
+    gc_gen_stick(false);
+    MP_STATE_MEM(gc_minor) = 0;
+    #endif
+    MP_STATE_MEM(gc_stack_overflow) = 0;
+    gc_collect_end();
+}
+
+#if MICROPY_GC_INCREMENTAL
+
+// Called by gc_alloc to do a slice of an incremental collection, starting one
+// if it's due.  Returns true when the marking is done, so that gc_collect()
+// should be called to finish it.
+STATIC bool gc_inc_step(void) {
+    size_t budget = MP_STATE_MEM(gc_inc_budget);
+    if (budget == 0) {
+        return false;
+    }
+    switch (MP_STATE_MEM(gc_phase)) {
+        case GC_PHASE_IDLE:
+            if (MP_STATE_MEM(gc_inc_countdown) == 0) {
+                // start a collection by marking the roots, but leave checking
+                // their children to the following slices
+                gc_mark_reset();
+                MP_STATE_MEM(gc_phase) = GC_PHASE_MARK;
+                MP_STATE_MEM(gc_inc_slices) = 1;
+                gc_mark_roots(false);
+            }
+            return false;
+
+        case GC_PHASE_MARK:
+            MP_STATE_MEM(gc_inc_slices)++;
+            return gc_mark_drain(budget, true);
+
+        default:
+            // sweeping a block is cheaper than checking its children
+            MP_STATE_MEM(gc_inc_slices)++;
+            MP_STATE_MEM(gc_lock_depth)++;
+            gc_inc_sweep(budget < SIZE_MAX / 4 ? budget * 4 : SIZE_MAX);
+            MP_STATE_MEM(gc_lock_depth)--;
+            return false;
+    }
+}
+
+void gc_incremental_set_budget(size_t budget) {
+    GC_ENTER();
+    if (budget == 0 && MP_STATE_MEM(gc_phase) != GC_PHASE_IDLE) {
+        // finish any collection in progress (without its marks, which may
+        // be out of date)
+        MP_STATE_MEM(gc_lock_depth)++;
+        if (MP_STATE_MEM(gc_phase) == GC_PHASE_MARK) {
+            gc_inc_abort();
+        } else {
+            gc_inc_sweep(SIZE_MAX);
+        }
+        MP_STATE_MEM(gc_lock_depth)--;
+    }
+    MP_STATE_MEM(gc_inc_budget) = budget;
+    GC_EXIT();
+}
+
+void gc_write_barrier_slow(const void *ptr) {
+    GC_ENTER();
+    gc_inc_dirty(ptr);
+    GC_EXIT();
+}
+
+#endif // MICROPY_GC_INCREMENTAL
+
+#if MICROPY_GC_GENERATIONAL
+
+void gc_collect_minor(void) {
+    GC_ENTER();
+    MP_STATE_MEM(gc_minor) = 1;
+    GC_EXIT();
+    gc_collect();
+}
+
+void gc_write_barrier_slow(const void *ptr) {
+    GC_ENTER();
+    mp_state_mem_area_t *area = FIRST_AREA();
+    size_t block = gc_gen_head(ptr);
+    if (block != SIZE_MAX) {
+        if (ATB_GET_KIND(area, block) == AT_HEAD && BLOCK_IN_NURSERY(block)) {
+            // a young block that is stored to this way may have been linked
+            // into an old one that isn't remembered, so make it old as well
+            ATB_HEAD_TO_MARK(area, block);
+        }
+        DTB_SET(area, block);
+    }
+    GC_EXIT();
+}
+
+#endif // MICROPY_GC_GENERATIONAL
+
+void gc_info(gc_info_t *info) {
+    GC_ENTER();
+    info->total = 0;
+    info->used = 0;
+    info->free = 0;
+    info->max_free = 0;
+    info->num_1block = 0;
+    info->num_2block = 0;
+    info->max_block = 0;
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        info->total += area->gc_pool_end - area->gc_pool_start;
+        bool finish = false;
+        for (size_t block = 0, len = 0, len_free = 0; !finish;) {
+            size_t kind = ATB_GET_KIND(area, block);
+            #if GC_KEEPS_MARKS
+            if (kind == AT_MARK) {
+                // part of an incremental collection, or an old block in the nursery
+                kind = AT_HEAD;
+            }
+            #endif
+            switch (kind) {
+                case AT_FREE:
+                    info->free += 1;
+                    len_free += 1;
+                    len = 0;
+                    break;
+
+                case AT_HEAD:
+                    info->used += 1;
+                    len = 1;
+                    break;
+
+                case AT_TAIL:
+                    info->used += 1;
+                    len += 1;
+                    break;
+
+                case AT_MARK:
+                    // shouldn't happen
+                    break;
+            }
+
+            block++;
+            finish = (block == AREA_BLOCKS(area));
+            // Get next block type if possible
+            if (!finish) {
+                kind = ATB_GET_KIND(area, block);
+                #if GC_KEEPS_MARKS
+                if (kind == AT_MARK) {
+                    kind = AT_HEAD;
+                }
+                #endif
+            }
+
+            if (finish || kind == AT_FREE || kind == AT_HEAD) {
+                if (len == 1) {
+                    info->num_1block += 1;
+                } else if (len == 2) {
+                    info->num_2block += 1;
+                }
+                if (len > info->max_block) {
+                    info->max_block = len;
+                }
+                if (finish || kind == AT_HEAD) {
+                    if (len_free > info->max_free) {
+                        info->max_free = len_free;
+                    }
+                    len_free = 0;
+                }
+            }
+        }
+    }
+
+    assert(info->used == MP_STATE_MEM(gc_used_blocks));
+
+    info->used *= BYTES_PER_BLOCK;
+    info->free *= BYTES_PER_BLOCK;
+    GC_EXIT();
+}
+
+void gc_info_quick(gc_info_t *info) {
+    GC_ENTER();
+    size_t total_blocks = 0;
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        total_blocks += AREA_BLOCKS(area);
+    }
+    info->total = total_blocks * BYTES_PER_BLOCK;
+    info->used = MP_STATE_MEM(gc_used_blocks) * BYTES_PER_BLOCK;
+    info->free = info->total - info->used;
+    #if MICROPY_GC_FREE_LISTS
+    info->max_free = MP_STATE_MEM(gc_free_list_max_run);
+    #else
+    info->max_free = 0;
+    #endif
+    info->num_1block = 0;
+    info->num_2block = 0;
+    info->max_block = 0;
+    GC_EXIT();
+}
+
+#if MICROPY_PY_UTRACEMALLOC
+// Return the STB entry for an allocation made now: the site of the instruction
+// that the running frame is at, which is added to the table of sites if it's
+// new.  If the table is too full to add it then the allocation isn't recorded.
+// Must be called with the GC lock held.
+STATIC uint16_t gc_trace_site(void) {
+    gc_trace_site_t *sites = MP_STATE_VM(trace_sites);
+    const mp_code_state_t *code_state = MP_STATE_THREAD(current_code_state);
+    if (code_state == NULL) {
+        return 1;
+    }
+    const byte *ip = code_state->ip;
+    size_t mask = MP_STATE_VM(trace_sites_alloc) - 1;
+    for (size_t i = ((uintptr_t)ip * 2654435761u >> 8) & mask;; i = (i + 1) & mask) {
+        if (i == 0) {
+            // the entry for no running bytecode
+            continue;
+        }
+        if (sites[i].ip == ip) {
+            return i + 1;
+        }
+        if (sites[i].ip == NULL) {
+            // keep the table at most 3/4 full so probes stay short
+            if (MP_STATE_VM(trace_sites_used) >= MP_STATE_VM(trace_sites_alloc) / 4 * 3) {
+                MP_STATE_VM(trace_n_dropped) += 1;
+                return 0;
+            }
+            MP_STATE_VM(trace_sites_used) += 1;
+            sites[i].ip = ip;
+            sites[i].fun_bc = code_state->fun_bc;
+            return i + 1;
+        }
+    }
+}
+
+void gc_trace_set_sites(gc_trace_site_t *sites, size_t n_sites) {
+    assert(sites == NULL || (n_sites <= 32768 && (n_sites & (n_sites - 1)) == 0));
+    GC_ENTER();
+    if (sites != NULL) {
+        // forget the sites of blocks that were allocated while tracing before
+        for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+            memset(area->gc_site_table_start, 0, AREA_BLOCKS(area) * sizeof(uint16_t));
+        }
+    }
+    MP_STATE_VM(trace_sites) = sites;
+    MP_STATE_VM(trace_sites_alloc) = n_sites;
+    MP_STATE_VM(trace_sites_used) = 1;
+    MP_STATE_VM(trace_n_dropped) = 0;
+    GC_EXIT();
+}
+
+void gc_trace_count(void) {
+    GC_ENTER();
+    gc_trace_site_t *sites = MP_STATE_VM(trace_sites);
+    for (size_t i = 0; i < MP_STATE_VM(trace_sites_alloc); ++i) {
+        sites[i].n_blocks = 0;
+        sites[i].n_allocs = 0;
+    }
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        // the site of the chain of blocks that we're in, if it was recorded
+        gc_trace_site_t *site = NULL;
+        for (size_t block = 0; block < AREA_BLOCKS(area); ++block) {
+            switch (ATB_GET_KIND(area, block)) {
+                case AT_FREE:
+                    site = NULL;
+                    break;
+
+                case AT_HEAD:
+                case AT_MARK: {
+                    size_t s = STB_GET(area, block);
+                    site = s == 0 ? NULL : &sites[s - 1];
+                    if (site != NULL) {
+                        site->n_allocs += 1;
+                        site->n_blocks += 1;
+                    }
+                    break;
+                }
+
+                case AT_TAIL:
+                    if (site != NULL) {
+                        site->n_blocks += 1;
+                    }
+                    break;
+            }
+        }
+    }
+    GC_EXIT();
+}
+#endif // MICROPY_PY_UTRACEMALLOC
+
+#if MICROPY_GC_SPLIT_HEAP_AUTO
+// Try to add an area to the heap that an allocation of n_bytes fits in, and
+// that is as big as the heap is so far, or else as near to that as the port
+// allows, so that it takes few areas to grow it a lot.  Returns whether one
+// was added.
+STATIC bool gc_try_add_heap(size_t n_bytes) {
+    if (n_bytes > SIZE_MAX / 2) {
+        return false;
+    }
+    // each ATB byte's worth of blocks needs at most 2 bytes of tables, and the
+    // area state and the alignment of both ends must fit in as well
+    size_t n_atb = (n_bytes + BYTES_PER_BLOCK * BLOCKS_PER_ATB - 1) / (BYTES_PER_BLOCK * BLOCKS_PER_ATB);
+    size_t needed = n_atb * (BYTES_PER_BLOCK * BLOCKS_PER_ATB + 2) + sizeof(mp_state_mem_area_t) + 2 * BYTES_PER_BLOCK;
+    size_t total = 0;
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        total += area->gc_pool_end - area->gc_alloc_table_start;
+    }
+    size_t len = MAX(needed, total);
+    void *ptr;
+    while ((ptr = MP_PLAT_ALLOC_HEAP(len)) == NULL) {
+        if (len == needed) {
+            return false;
         }
-
-        // pop the next block off the stack
-        block = MP_STATE_MEM(gc_stack)[--sp];
+        len = MAX(needed, len / 2);
     }
+    gc_add(ptr, (byte*)ptr + len);
+    return true;
 }
+#endif
 
-STATIC void gc_deal_with_stack_overflow(void) {
-    while (MP_STATE_MEM(gc_stack_overflow)) {
-        MP_STATE_MEM(gc_stack_overflow) = 0;
+#if MICROPY_GC_REGIONS
 
-        // scan entire memory looking for blocks which have been marked but not their children
-        for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-            // trace (again) if mark bit set
-            if (ATB_GET_KIND(block) == AT_MARK) {
-                gc_mark_subtree(block);
-            }
+// Returns the chunk of the region that the block is in, or NULL
+STATIC gc_region_chunk_t *gc_region_chunk_of(const gc_region_t *r, const mp_state_mem_area_t *area, size_t block) {
+    for (gc_region_chunk_t *c = r->chunk; c != NULL; c = c->prev) {
+        if (c->area == area && block >= c->start && block < c->end) {
+            return c;
         }
     }
+    return NULL;
 }
 
-STATIC void gc_sweep(void) {
-    #if MICROPY_PY_GC_COLLECT_RETVAL
-    MP_STATE_MEM(gc_collected) = 0;
-    #endif
-    // free unmarked heads and their tails
-    int free_tail = 0;
-    for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-        switch (ATB_GET_KIND(block)) {
-            case AT_HEAD:
-#if MICROPY_ENABLE_FINALISER
-                if (FTB_GET(block)) {
-                    mp_obj_base_t *obj = (mp_obj_base_t*)PTR_FROM_BLOCK(block);
-                    if (obj->type != NULL) {
-                        // if the object has a type then see if it has a __del__ method
-                        mp_obj_t dest[2];
-                        mp_load_method_maybe(MP_OBJ_FROM_PTR(obj), MP_QSTR___del__, dest);
-                        if (dest[0] != MP_OBJ_NULL) {
-                            // load_method returned a method, execute it in a protected environment
-                            #if MICROPY_ENABLE_SCHEDULER
-                            mp_sched_lock();
-                            #endif
-                            mp_call_function_1_protected(dest[0], dest[1]);
-                            #if MICROPY_ENABLE_SCHEDULER
-                            mp_sched_unlock();
-                            #endif
-                        }
-                    }
-                    // clear finaliser flag
-                    FTB_CLEAR(block);
-                }
-#endif
-                free_tail = 1;
-                DEBUG_printf("gc_sweep(%p)\n", PTR_FROM_BLOCK(block));
-                #if MICROPY_PY_GC_COLLECT_RETVAL
-                MP_STATE_MEM(gc_collected)++;
-                #endif
-                // fall through to free the head
-
-            case AT_TAIL:
-                if (free_tail) {
-                    ATB_ANY_TO_FREE(block);
-                    #if CLEAR_ON_SWEEP
-                    memset((void*)PTR_FROM_BLOCK(block), 0, BYTES_PER_BLOCK);
-                    #endif
-                }
-                break;
-
-            case AT_MARK:
-                ATB_MARK_TO_HEAD(block);
-                free_tail = 0;
-                break;
+// Returns whether the block is in a chunk of any active region
+STATIC bool gc_region_find(const mp_state_mem_area_t *area, size_t block) {
+    for (gc_region_t *r = MP_STATE_MEM(gc_regions); r != NULL; r = r->next) {
+        if (gc_region_chunk_of(r, area, block) != NULL) {
+            return true;
         }
     }
+    return false;
 }
 
-void gc_collect_start(void) {
-    GC_ENTER();
-    MP_STATE_MEM(gc_lock_depth)++;
-    #if MICROPY_GC_ALLOC_THRESHOLD
-    MP_STATE_MEM(gc_alloc_amount) = 0;
+// Carve n_blocks from the unused rest of the region's latest chunk, leaving
+// at least one block of it so that the last object can't be grown into what
+// follows the chunk.  Returns NULL if there isn't room.  The GC must be
+// entered.
+STATIC void *gc_region_alloc(gc_region_t *r, size_t n_blocks) {
+    gc_region_chunk_t *c = r->chunk;
+    if (n_blocks >= c->end - c->free) {
+        return NULL;
+    }
+    mp_state_mem_area_t *area = c->area;
+    size_t block = c->free;
+    c->free = block + n_blocks;
+    // the head of the rest moves past the new object, which takes over the
+    // head and tails that were there
+    ATB_ANY_TO_FREE(area, c->free);
+    ATB_FREE_TO_HEAD(area, c->free);
+    #if MICROPY_PY_UTRACEMALLOC
+    STB_SET(area, block, MP_STATE_VM(trace_sites) == NULL ? 0 : gc_trace_site());
     #endif
-    MP_STATE_MEM(gc_stack_overflow) = 0;
+    return (void*)PTR_FROM_BLOCK(area, block);
+}
 
-    // Trace root pointers.  This relies on the root pointers being organised
-    // correctly in the mp_state_ctx structure.  We scan nlr_top, dict_locals,
-    // dict_globals, then the root pointer section of mp_state_vm.
-    void **ptrs = (void**)(void*)&mp_state_ctx;
-    size_t root_start = offsetof(mp_state_ctx_t, thread.dict_locals);
-    size_t root_end = offsetof(mp_state_ctx_t, vm.qstr_last_chunk);
-    gc_collect_root(ptrs + root_start / sizeof(void*), (root_end - root_start) / sizeof(void*));
+// Give the region a new chunk to allocate from.  The GC must not be entered.
+STATIC bool gc_region_grow(gc_region_t *r) {
+    gc_region_chunk_t *c = gc_alloc(sizeof(gc_region_chunk_t), 0);
+    if (c == NULL) {
+        return false;
+    }
+    void *ptr = gc_alloc(r->chunk_bytes, 0);
+    if (ptr == NULL) {
+        gc_free(c);
+        return false;
+    }
+    GC_ENTER();
+    // the whole chunk is its unused rest to begin with
+    c->area = gc_get_ptr_area(ptr);
+    c->start = BLOCK_FROM_PTR(c->area, ptr);
+    c->free = c->start;
+    c->end = c->start + (r->chunk_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
+    c->prev = r->chunk;
+    r->chunk = c;
+    GC_EXIT();
+    return true;
+}
 
-    #if MICROPY_ENABLE_PYSTACK
-    // Trace root pointers from the Python stack.
-    ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
-    gc_collect_root(ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void*));
-    #endif
+gc_region_t *gc_region_enter(size_t n_bytes) {
+    gc_region_t *r = gc_alloc(sizeof(gc_region_t), 0);
+    if (r == NULL) {
+        return NULL;
+    }
+    r->chunk = NULL;
+    r->chunk_bytes = MAX(n_bytes, 2 * BYTES_PER_BLOCK);
+    if (!gc_region_grow(r)) {
+        gc_free(r);
+        return NULL;
+    }
+    GC_ENTER();
+    r->prev = MP_STATE_THREAD(gc_region);
+    r->next = MP_STATE_MEM(gc_regions);
+    MP_STATE_MEM(gc_regions) = r;
+    MP_STATE_THREAD(gc_region) = r;
+    GC_EXIT();
+    return r;
 }
 
-void gc_collect_root(void **ptrs, size_t len) {
+// Whether any of the pointers are to an object that was allocated in the
+// region.  Like the marking, only pointers to the start of a head count.
+STATIC bool gc_region_scan(const gc_region_t *r, void **ptrs, size_t len) {
     for (size_t i = 0; i < len; i++) {
-        void *ptr = ptrs[i];
-        if (VERIFY_PTR(ptr)) {
-            size_t block = BLOCK_FROM_PTR(ptr);
-            if (ATB_GET_KIND(block) == AT_HEAD) {
-                // An unmarked head: mark it, and mark all its children
-                TRACE_MARK(block, ptr);
-                ATB_HEAD_TO_MARK(block);
-                gc_mark_subtree(block);
+        const byte *ptr = ptrs[i];
+        if (((uintptr_t)ptr & (BYTES_PER_BLOCK - 1)) != 0) {
+            continue;
+        }
+        for (gc_region_chunk_t *c = r->chunk; c != NULL; c = c->prev) {
+            mp_state_mem_area_t *area = c->area;
+            if (ptr >= (const byte*)PTR_FROM_BLOCK(area, c->start) && ptr < (const byte*)PTR_FROM_BLOCK(area, c->free)
+                && ATB_GET_KIND(area, BLOCK_FROM_PTR(area, ptr)) == AT_HEAD) {
+                return true;
             }
         }
     }
+    return false;
 }
 
-void gc_collect_end(void) {
-    gc_deal_with_stack_overflow();
-    gc_sweep();
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
-    MP_STATE_MEM(gc_lock_depth)--;
-    GC_EXIT();
+// Whether the object that the block is part of refers to an object that was
+// allocated in the region.  Objects in the region itself and free blocks are
+// skipped.
+STATIC bool gc_region_scan_block(const gc_region_t *r, mp_state_mem_area_t *area, size_t block) {
+    if (gc_region_chunk_of(r, area, block) != NULL) {
+        return false;
+    }
+    while (ATB_GET_KIND(area, block) == AT_TAIL) {
+        block -= 1;
+    }
+    if (ATB_GET_KIND(area, block) == AT_FREE) {
+        return false;
+    }
+    size_t n_blocks = 1;
+    for (size_t max_block = AREA_BLOCKS(area); block + n_blocks < max_block
+         && ATB_GET_KIND(area, block + n_blocks) == AT_TAIL; n_blocks++) {
+    }
+    return gc_region_scan(r, (void**)PTR_FROM_BLOCK(area, block), n_blocks * WORDS_PER_BLOCK);
 }
 
-void gc_sweep_all(void) {
-    GC_ENTER();
-    MP_STATE_MEM(gc_lock_depth)++;
-    MP_STATE_MEM(gc_stack_overflow) = 0;
-    gc_collect_end();
+// Like gc_region_scan, but the heap objects that the pointers refer to are
+// scanned too.  Those of the roots and the stack may be stored to without a
+// write barrier, eg a frame on the heap, so they're treated as dirty.
+STATIC bool gc_region_scan_root(const gc_region_t *r, void **ptrs, size_t len) {
+    if (gc_region_scan(r, ptrs, len)) {
+        return true;
+    }
+    for (size_t i = 0; i < len; i++) {
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptrs[i]);
+        if (area != NULL && gc_region_scan_block(r, area, BLOCK_FROM_PTR(area, ptrs[i]))) {
+            return true;
+        }
+    }
+    return false;
 }
 
-void gc_info(gc_info_t *info) {
-    GC_ENTER();
-    info->total = MP_STATE_MEM(gc_pool_end) - MP_STATE_MEM(gc_pool_start);
-    info->used = 0;
-    info->free = 0;
-    info->max_free = 0;
-    info->num_1block = 0;
-    info->num_2block = 0;
-    info->max_block = 0;
-    bool finish = false;
-    for (size_t block = 0, len = 0, len_free = 0; !finish;) {
-        size_t kind = ATB_GET_KIND(block);
-        switch (kind) {
-            case AT_FREE:
-                info->free += 1;
-                len_free += 1;
-                len = 0;
-                break;
+// Whether any of the objects in the dirty table, apart from those in the
+// region itself, refer to an object that was allocated in it.
+STATIC bool gc_region_scan_dirty(const gc_region_t *r) {
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        byte *dtb = area->gc_dirty_table_start;
+        for (size_t i = 0, dtb_len = DTB_BYTE_LEN(area); i < dtb_len; i++) {
+            for (byte d = dtb[i]; d != 0; d &= d - 1) {
+                // the block may have been freed and reused since it was set
+                if (gc_region_scan_block(r, area, i * BLOCKS_PER_DTB + __builtin_ctz(d))) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
 
-            case AT_HEAD:
-                info->used += 1;
-                len = 1;
-                break;
+bool gc_region_exit(gc_region_t *r) {
+    assert(r == MP_STATE_THREAD(gc_region));
 
-            case AT_TAIL:
-                info->used += 1;
-                len += 1;
-                break;
+    // get the registers onto the stack, to scan them with it (and don't let
+    // whatever was there before look like a pointer)
+    nlr_buf_t regs;
+    regs.ret_val = NULL;
+    if (nlr_push(&regs) == 0) {
+        nlr_pop();
+    }
 
-            case AT_MARK:
-                // shouldn't happen
-                break;
-        }
+    GC_ENTER();
+    MP_STATE_THREAD(gc_region) = r->prev;
+    gc_region_t **rp = &MP_STATE_MEM(gc_regions);
+    while (*rp != r) {
+        rp = &(*rp)->next;
+    }
+    *rp = r->next;
 
-        block++;
-        finish = (block == MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-        // Get next block type if possible
-        if (!finish) {
-            kind = ATB_GET_KIND(block);
-        }
+    // The objects escaped if anything outside the region may still refer to
+    // them: the roots and this thread's stack and what they point to, and the
+    // objects that have been stored to or allocated since a region was
+    // entered.  Other threads are not looked at, so objects from a region
+    // mustn't be shared with them.
+    void **ptrs = (void**)(void*)&mp_state_ctx;
+    size_t root_start = offsetof(mp_state_ctx_t, thread.dict_locals);
+    size_t root_end = offsetof(mp_state_ctx_t, vm.qstr_last_chunk);
+    bool escaped = gc_region_scan_root(r, ptrs + root_start / sizeof(void*), (root_end - root_start) / sizeof(void*));
+    if (!escaped) {
+        ptrs = (void**)(void*)&regs;
+        escaped = gc_region_scan_root(r, ptrs, ((void**)(void*)MP_STATE_THREAD(stack_top) - ptrs));
+    }
+    #if MICROPY_ENABLE_PYSTACK
+    if (!escaped) {
+        ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
+        escaped = gc_region_scan_root(r, ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void*));
+    }
+    #endif
+    if (!escaped) {
+        escaped = gc_region_scan_dirty(r);
+    }
 
-        if (finish || kind == AT_FREE || kind == AT_HEAD) {
-            if (len == 1) {
-                info->num_1block += 1;
-            } else if (len == 2) {
-                info->num_2block += 1;
-            }
-            if (len > info->max_block) {
-                info->max_block = len;
-            }
-            if (finish || kind == AT_HEAD) {
-                if (len_free > info->max_free) {
-                    info->max_free = len_free;
+    // free the chunks, or if their objects escaped then just the unused rest
+    // of each, leaving the objects as ordinary ones
+    gc_forget_caches();
+    for (gc_region_chunk_t *c = r->chunk; c != NULL; c = c->prev) {
+        mp_state_mem_area_t *area = c->area;
+        if (escaped && MP_STATE_MEM(gc_regions) != NULL) {
+            // the objects that are kept may refer to those of the regions
+            // that are still active
+            for (size_t block = c->start; block < c->free; block++) {
+                if (ATB_GET_KIND(area, block) == AT_HEAD) {
+                    DTB_SET(area, block);
                 }
-                len_free = 0;
             }
         }
+        size_t start_block = escaped ? c->free : c->start;
+        for (size_t block = start_block; block < c->end; block++) {
+            ATB_ANY_TO_FREE(area, block);
+        }
+        gc_free_run(area, start_block, c->end);
+    }
+    if (MP_STATE_MEM(gc_regions) == NULL) {
+        // nothing needs the dirty table until a region is entered again
+        for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+            memset(area->gc_dirty_table_start, 0, DTB_BYTE_LEN(area));
+        }
     }
+    GC_EXIT();
 
-    info->used *= BYTES_PER_BLOCK;
-    info->free *= BYTES_PER_BLOCK;
+    for (gc_region_chunk_t *c = r->chunk; c != NULL;) {
+        gc_region_chunk_t *prev = c->prev;
+        gc_free(c);
+        c = prev;
+    }
+    gc_free(r);
+    return escaped;
+}
+
+void gc_write_barrier_slow(const void *ptr) {
+    GC_ENTER();
+    mp_state_mem_area_t *area = gc_get_ptr_area((const void*)((uintptr_t)ptr & ~(BYTES_PER_BLOCK - 1)));
+    if (area != NULL) {
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        gc_region_t *r = MP_STATE_THREAD(gc_region);
+        // objects of this thread's innermost region can refer to each other
+        // freely, because they are either all freed or all kept
+        if (r == NULL || gc_region_chunk_of(r, area, block) == NULL) {
+            while (ATB_GET_KIND(area, block) == AT_TAIL) {
+                block -= 1;
+            }
+            DTB_SET(area, block);
+        }
+    }
     GC_EXIT();
 }
 
+#endif // MICROPY_GC_REGIONS
+
 void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
     bool has_finaliser = alloc_flags & GC_ALLOC_FLAG_HAS_FINALISER;
     size_t n_blocks = ((n_bytes + BYTES_PER_BLOCK - 1) & (~(BYTES_PER_BLOCK - 1))) / BYTES_PER_BLOCK;
@@ -451,6 +2234,29 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
         return NULL;
     }
 
+    #if MICROPY_GC_REGIONS
+    gc_region_t *region = MP_STATE_THREAD(gc_region);
+    if ((alloc_flags & GC_ALLOC_FLAG_YOUNG) && region != NULL && n_blocks * 2 <= region->chunk_bytes / BYTES_PER_BLOCK) {
+        void *ret_ptr = gc_region_alloc(region, n_blocks);
+        if (ret_ptr == NULL) {
+            // the chunk is full, so get another
+            GC_EXIT();
+            bool grown = gc_region_grow(region);
+            GC_ENTER();
+            if (grown) {
+                ret_ptr = gc_region_alloc(region, n_blocks);
+            }
+        }
+        if (ret_ptr != NULL) {
+            GC_EXIT();
+            // zero out the additional bytes, as below
+            memset((byte*)ret_ptr + n_bytes, 0, n_blocks * BYTES_PER_BLOCK - n_bytes);
+            return ret_ptr;
+        }
+    }
+    #endif
+
+    mp_state_mem_area_t *area;
     size_t i;
     size_t end_block;
     size_t start_block;
@@ -466,27 +2272,155 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
     }
     #endif
 
+    #if MICROPY_GC_INCREMENTAL
+    if (!collected && gc_inc_step()) {
+        // marking is done, so finish the collection and then sweep lazily
+        MP_STATE_MEM(gc_inc_finishing) = GC_INC_FINISH_LAZY;
+        GC_EXIT();
+        gc_collect();
+        GC_ENTER();
+    }
+    #endif
+
+    size_t search_start;
+    size_t search_end;
+    #if MICROPY_GC_GENERATIONAL
+    // Small objects that are expected to die young are allocated in the
+    // nursery if there's room.  Nothing else is, so that C code can store a
+    // new block in an old one without a write barrier.
+    bool want_nursery = (alloc_flags & GC_ALLOC_FLAG_YOUNG) && n_blocks <= MICROPY_GC_NURSERY_MAX_BLOCKS;
+    bool in_nursery = want_nursery && gc_gen_use_nursery();
+    bool collected_minor = collected;
+    bool old_in_nursery = false;
+    #endif
+
     for (;;) {
 
-        // look for a run of n_blocks available blocks
-        n_free = 0;
-        for (i = MP_STATE_MEM(gc_last_free_atb_index); i < MP_STATE_MEM(gc_alloc_table_byte_len); i++) {
-            byte a = MP_STATE_MEM(gc_alloc_table_start)[i];
-            if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
-            if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
-            if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
-            if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+        #if MICROPY_GC_FREE_LISTS
+        // try the free lists before searching (the nursery isn't on them)
+        #if MICROPY_GC_GENERATIONAL
+        if (!in_nursery && !old_in_nursery)
+        #endif
+        {
+            start_block = gc_free_list_take(n_blocks, &area);
+            if (start_block != SIZE_MAX) {
+                end_block = start_block + n_blocks - 1;
+                goto found_run;
+            }
+        }
+        #endif
+
+        // look in each area for a run of n_blocks available blocks, going
+        // over whole words of the ATB that are all free or all in use at once
+        for (area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+            search_start = area->gc_last_free_atb_index;
+            search_end = area->gc_alloc_table_byte_len;
+            #if MICROPY_GC_GENERATIONAL
+            if (in_nursery || old_in_nursery) {
+                search_start = MP_STATE_MEM(gc_nursery_free_block) / BLOCKS_PER_ATB;
+            } else {
+                search_end = MP_STATE_MEM(gc_nursery_block) / BLOCKS_PER_ATB;
+            }
+            #endif
+
+            n_free = 0;
+            for (i = search_start; i < search_end; i++) {
+                if (i % sizeof(atb_word_t) == 0 && i + sizeof(atb_word_t) <= search_end) {
+                    atb_word_t w = ATB_WORD(area, i * BLOCKS_PER_ATB);
+                    if (w == 0) {
+                        if (n_free + BLOCKS_PER_ATB_WORD >= n_blocks) {
+                            i = i * BLOCKS_PER_ATB + n_blocks - n_free - 1;
+                            n_free = n_blocks;
+                            goto found;
+                        }
+                        n_free += BLOCKS_PER_ATB_WORD;
+                        i += sizeof(atb_word_t) - 1;
+                        continue;
+                    }
+                    if (ATB_WORD_FREE(w) == 0) {
+                        n_free = 0;
+                        i += sizeof(atb_word_t) - 1;
+                        continue;
+                    }
+                }
+                byte a = area->gc_alloc_table_start[i];
+                if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
+                if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
+                if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
+                if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+            }
+            #if MICROPY_GC_SPLIT_HEAP
+            if (n_blocks == 1) {
+                // this area is full, so don't search it again for single
+                // blocks until some are freed
+                area->gc_last_free_atb_index = search_end;
+            }
+            #endif
+        }
+
+        #if MICROPY_GC_INCREMENTAL
+        if (!collected && MP_STATE_MEM(gc_phase) == GC_PHASE_SWEEP) {
+            // free the rest of the garbage that has been found before trying a full collection
+            MP_STATE_MEM(gc_lock_depth)++;
+            gc_inc_sweep(SIZE_MAX);
+            MP_STATE_MEM(gc_lock_depth)--;
+            continue;
+        }
+        #endif
+
+        #if MICROPY_GC_GENERATIONAL
+        if (in_nursery) {
+            if (!collected_minor && MP_STATE_MEM(gc_nursery_n_alloc) >= MP_STATE_MEM(gc_nursery_n_free) / 2) {
+                // the nursery is full, so reclaim the young objects in it,
+                // and also the old ones if few blocks are freed
+                GC_EXIT();
+                gc_collect_minor();
+                collected_minor = 1;
+                if (!gc_gen_use_nursery()) {
+                    gc_collect();
+                    collected = 1;
+                }
+                GC_ENTER();
+                in_nursery = gc_gen_use_nursery();
+            } else {
+                // there's no room left in the nursery that's big enough
+                in_nursery = false;
+            }
+            continue;
+        }
+        if (!old_in_nursery) {
+            // the rest of the heap is full, so use what's left of the nursery
+            // before resorting to a full collection
+            if (n_blocks == 1) {
+                // and don't search it again for single blocks until then
+                MP_STATE_MEM(area).gc_last_free_atb_index = search_end;
+            }
+            old_in_nursery = true;
+            continue;
         }
+        #endif
 
         GC_EXIT();
         // nothing found!
         if (collected) {
+            #if MICROPY_GC_SPLIT_HEAP_AUTO
+            // a collection didn't free enough, so make the heap bigger
+            if (gc_try_add_heap(n_bytes)) {
+                GC_ENTER();
+                continue;
+            }
+            #endif
             return NULL;
         }
         DEBUG_printf("gc_alloc(" UINT_FMT "): no free mem, triggering GC\n", n_bytes);
         gc_collect();
         collected = 1;
         GC_ENTER();
+        #if MICROPY_GC_GENERATIONAL
+        in_nursery = want_nursery && gc_gen_use_nursery();
+        collected_minor = 1;
+        old_in_nursery = false;
+        #endif
     }
 
     // found, ending at block i inclusive
@@ -500,22 +2434,74 @@ found:
     // for a single free block, which guarantees that there are no free blocks
     // before this one.  Also, whenever we free or shink a block we must check
     // if this index needs adjusting (see gc_realloc and gc_free).
+    #if MICROPY_GC_GENERATIONAL
+    if (in_nursery || old_in_nursery) {
+        MP_STATE_MEM(gc_nursery_free_block) = i + 1;
+        if (in_nursery) {
+            MP_STATE_MEM(gc_nursery_n_alloc) += n_blocks;
+        }
+    } else
+    #endif
     if (n_free == 1) {
-        MP_STATE_MEM(gc_last_free_atb_index) = (i + 1) / BLOCKS_PER_ATB;
+        area->gc_last_free_atb_index = (i + 1) / BLOCKS_PER_ATB;
     }
 
+#if MICROPY_GC_FREE_LISTS
+found_run:
+#endif
     // mark first block as used head
-    ATB_FREE_TO_HEAD(start_block);
+    ATB_FREE_TO_HEAD(area, start_block);
+    MP_STATE_MEM(gc_used_blocks) += n_blocks;
+
+    #if MICROPY_PY_UTRACEMALLOC
+    STB_SET(area, start_block, MP_STATE_VM(trace_sites) == NULL ? 0 : gc_trace_site());
+    #endif
 
     // mark rest of blocks as used tail
     // TODO for a run of many blocks can make this more efficient
     for (size_t bl = start_block + 1; bl <= end_block; bl++) {
-        ATB_FREE_TO_TAIL(bl);
+        ATB_FREE_TO_TAIL(area, bl);
+    }
+
+    #if MICROPY_GC_INCREMENTAL
+    if (MP_STATE_MEM(gc_phase) == GC_PHASE_MARK) {
+        // the new block may be filled in and stored into marked blocks
+        // without a write barrier, so check it when the marking is finished
+        DTB_SET(area, start_block);
+    } else if (MP_STATE_MEM(gc_phase) == GC_PHASE_SWEEP && start_block >= MP_STATE_MEM(gc_sweep_block)) {
+        // the sweep hasn't got here yet, so stop it from freeing the new block
+        ATB_HEAD_TO_MARK(area, start_block);
+    }
+    if (MP_STATE_MEM(gc_inc_countdown) > n_blocks) {
+        MP_STATE_MEM(gc_inc_countdown) -= n_blocks;
+    } else {
+        MP_STATE_MEM(gc_inc_countdown) = 0;
+    }
+    #endif
+
+    #if MICROPY_GC_GENERATIONAL
+    if (!in_nursery) {
+        // the new block is old, but may be filled in with pointers to young
+        // blocks without a write barrier
+        DTB_SET(area, start_block);
+        if (BLOCK_IN_NURSERY(start_block)) {
+            // the rest of the heap is full, so it's old from the start
+            ATB_HEAD_TO_MARK(area, start_block);
+        }
     }
+    #endif
+
+    #if MICROPY_GC_REGIONS
+    if (MP_STATE_MEM(gc_regions) != NULL) {
+        // the new block may be filled in with objects from a region without a
+        // write barrier
+        DTB_SET(area, start_block);
+    }
+    #endif
 
     // get pointer to first block
     // we must create this pointer before unlocking the GC so a collection can find it
-    void *ret_ptr = (void*)(MP_STATE_MEM(gc_pool_start) + start_block * BYTES_PER_BLOCK);
+    void *ret_ptr = (void*)(area->gc_pool_start + start_block * BYTES_PER_BLOCK);
     DEBUG_printf("gc_alloc(%p)\n", ret_ptr);
 
     #if MICROPY_GC_ALLOC_THRESHOLD
@@ -542,7 +2528,7 @@ found:
         ((mp_obj_base_t*)ret_ptr)->type = NULL;
         // set mp_obj flag only if it has a finaliser
         GC_ENTER();
-        FTB_SET(start_block);
+        FTB_SET(area, start_block);
         GC_EXIT();
     }
     #else
@@ -582,24 +2568,30 @@ void gc_free(void *ptr) {
         GC_EXIT();
     } else {
         // get the GC block number corresponding to this pointer
-        assert(VERIFY_PTR(ptr));
-        size_t block = BLOCK_FROM_PTR(ptr);
-        assert(ATB_GET_KIND(block) == AT_HEAD);
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        assert(area != NULL);
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        assert(ATB_GET_KIND(area, block) == AT_HEAD || (GC_KEEPS_MARKS && ATB_GET_KIND(area, block) == AT_MARK));
+
+        #if MICROPY_GC_REGIONS
+        if (MP_STATE_MEM(gc_regions) != NULL && gc_region_find(area, block)) {
+            // it's freed with the rest of the region's chunk
+            GC_EXIT();
+            return;
+        }
+        #endif
 
         #if MICROPY_ENABLE_FINALISER
-        FTB_CLEAR(block);
+        FTB_CLEAR(area, block);
         #endif
 
-        // set the last_free pointer to this block if it's earlier in the heap
-        if (block / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = block / BLOCKS_PER_ATB;
-        }
-
         // free head and all of its tail blocks
+        size_t start_block = block;
         do {
-            ATB_ANY_TO_FREE(block);
+            ATB_ANY_TO_FREE(area, block);
             block += 1;
-        } while (ATB_GET_KIND(block) == AT_TAIL);
+        } while (ATB_GET_KIND(area, block) == AT_TAIL);
+        gc_free_run(area, start_block, block);
 
         GC_EXIT();
 
@@ -611,14 +2603,15 @@ void gc_free(void *ptr) {
 
 size_t gc_nbytes(const void *ptr) {
     GC_ENTER();
-    if (VERIFY_PTR(ptr)) {
-        size_t block = BLOCK_FROM_PTR(ptr);
-        if (ATB_GET_KIND(block) == AT_HEAD) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area != NULL) {
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        if (ATB_GET_KIND(area, block) == AT_HEAD || (GC_KEEPS_MARKS && ATB_GET_KIND(area, block) == AT_MARK)) {
             // work out number of consecutive blocks in the chain starting with this on
             size_t n_blocks = 0;
             do {
                 n_blocks += 1;
-            } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+            } while (ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
             GC_EXIT();
             return n_blocks * BYTES_PER_BLOCK;
         }
@@ -680,9 +2673,10 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     // get the GC block number corresponding to this pointer
-    assert(VERIFY_PTR(ptr));
-    size_t block = BLOCK_FROM_PTR(ptr);
-    assert(ATB_GET_KIND(block) == AT_HEAD);
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    assert(area != NULL);
+    size_t block = BLOCK_FROM_PTR(area, ptr);
+    assert(ATB_GET_KIND(area, block) == AT_HEAD || (GC_KEEPS_MARKS && ATB_GET_KIND(area, block) == AT_MARK));
 
     // compute number of new blocks that are requested
     size_t new_blocks = (n_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
@@ -695,9 +2689,15 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     // efficiently shrink it (see below for shrinking code).
     size_t n_free   = 0;
     size_t n_blocks = 1; // counting HEAD block
-    size_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    size_t max_block = AREA_BLOCKS(area);
+    #if MICROPY_GC_GENERATIONAL
+    if (!BLOCK_IN_NURSERY(block)) {
+        // don't grow into the nursery
+        max_block = MP_STATE_MEM(gc_nursery_block);
+    }
+    #endif
     for (size_t bl = block + n_blocks; bl < max_block; bl++) {
-        byte block_type = ATB_GET_KIND(bl);
+        byte block_type = ATB_GET_KIND(area, bl);
         if (block_type == AT_TAIL) {
             n_blocks++;
             continue;
@@ -721,14 +2721,32 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
 
     // check if we can shrink the allocated area
     if (new_blocks < n_blocks) {
+        #if MICROPY_GC_REGIONS
+        if (MP_STATE_MEM(gc_regions) != NULL && gc_region_find(area, block)) {
+            // the blocks are freed with the rest of the region's chunk
+            GC_EXIT();
+            return ptr_in;
+        }
+        #endif
+
         // free unneeded tail blocks
         for (size_t bl = block + new_blocks, count = n_blocks - new_blocks; count > 0; bl++, count--) {
-            ATB_ANY_TO_FREE(bl);
+            ATB_ANY_TO_FREE(area, bl);
         }
+        MP_STATE_MEM(gc_used_blocks) -= n_blocks - new_blocks;
 
+        #if MICROPY_GC_FREE_LISTS
+        if (block + n_blocks <= FREE_LIST_END_BLOCK(area)) {
+            gc_free_list_push(area, block + new_blocks, n_blocks - new_blocks);
+        } else
+        #endif
         // set the last_free pointer to end of this block if it's earlier in the heap
-        if ((block + new_blocks) / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = (block + new_blocks) / BLOCKS_PER_ATB;
+        if ((block + new_blocks) / BLOCKS_PER_ATB < area->gc_last_free_atb_index
+            #if MICROPY_GC_GENERATIONAL
+            && !BLOCK_IN_NURSERY(block)
+            #endif
+            ) {
+            area->gc_last_free_atb_index = (block + new_blocks) / BLOCKS_PER_ATB;
         }
 
         GC_EXIT();
@@ -742,11 +2760,32 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
 
     // check if we can expand in place
     if (new_blocks <= n_blocks + n_free) {
+        #if MICROPY_GC_FREE_LISTS
+        gc_free_list_claim(area, block + n_blocks, new_blocks - n_blocks);
+        #endif
+
         // mark few more blocks as used tail
         for (size_t bl = block + n_blocks; bl < block + new_blocks; bl++) {
-            assert(ATB_GET_KIND(bl) == AT_FREE);
-            ATB_FREE_TO_TAIL(bl);
+            assert(ATB_GET_KIND(area, bl) == AT_FREE);
+            ATB_FREE_TO_TAIL(area, bl);
+        }
+        MP_STATE_MEM(gc_used_blocks) += new_blocks - n_blocks;
+
+        #if MICROPY_GC_INCREMENTAL
+        if (MP_STATE_MEM(gc_phase) == GC_PHASE_MARK && ATB_GET_KIND(area, block) == AT_MARK) {
+            // the new part may be filled in without a write barrier
+            DTB_SET(area, block);
         }
+        #elif MICROPY_GC_GENERATIONAL
+        // the new part may be filled in without a write barrier
+        DTB_SET(area, block);
+        #elif MICROPY_GC_REGIONS
+        if (MP_STATE_MEM(gc_regions) != NULL) {
+            // the new part may be filled in with objects from a region
+            // without a write barrier
+            DTB_SET(area, block);
+        }
+        #endif
 
         GC_EXIT();
 
@@ -766,7 +2805,7 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     #if MICROPY_ENABLE_FINALISER
-    bool ftb_state = FTB_GET(block);
+    bool ftb_state = FTB_GET(area, block);
     #else
     bool ftb_state = false;
     #endif
@@ -805,110 +2844,112 @@ void gc_dump_info(void) {
 void gc_dump_alloc_table(void) {
     GC_ENTER();
     static const size_t DUMP_BYTES_PER_LINE = 64;
-    #if !EXTENSIVE_HEAP_PROFILING
-    // When comparing heap output we don't want to print the starting
-    // pointer of the heap because it changes from run to run.
-    mp_printf(&mp_plat_print, "GC memory layout; from %p:", MP_STATE_MEM(gc_pool_start));
-    #endif
-    for (size_t bl = 0; bl < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; bl++) {
-        if (bl % DUMP_BYTES_PER_LINE == 0) {
-            // a new line of blocks
-            {
-                // check if this line contains only free blocks
-                size_t bl2 = bl;
-                while (bl2 < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB && ATB_GET_KIND(bl2) == AT_FREE) {
-                    bl2++;
-                }
-                if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
-                    // there are at least 2 lines containing only free blocks, so abbreviate their printing
-                    mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
-                    bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
-                    if (bl >= MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB) {
-                        // got to end of heap
-                        break;
-                    }
-                }
-            }
-            // print header for new line of blocks
-            // (the cast to uint32_t is for 16-bit ports)
-            //mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(bl) & (uint32_t)0xfffff));
-            mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
-        }
-        int c = ' ';
-        switch (ATB_GET_KIND(bl)) {
-            case AT_FREE: c = '.'; break;
-            /* this prints out if the object is reachable from BSS or STACK (for unix only)
-            case AT_HEAD: {
-                c = 'h';
-                void **ptrs = (void**)(void*)&mp_state_ctx;
-                mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
-                for (mp_uint_t i = 0; i < len; i++) {
-                    mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                    if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                        c = 'B';
-                        break;
+    for (mp_state_mem_area_t *area = FIRST_AREA(); area != NULL; area = NEXT_AREA(area)) {
+        #if !EXTENSIVE_HEAP_PROFILING
+        // When comparing heap output we don't want to print the starting
+        // pointer of the heap because it changes from run to run.
+        mp_printf(&mp_plat_print, "GC memory layout; from %p:", area->gc_pool_start);
+        #endif
+        for (size_t bl = 0; bl < AREA_BLOCKS(area); bl++) {
+            if (bl % DUMP_BYTES_PER_LINE == 0) {
+                // a new line of blocks
+                {
+                    // check if this line contains only free blocks
+                    size_t bl2 = bl;
+                    while (bl2 < AREA_BLOCKS(area) && ATB_GET_KIND(area, bl2) == AT_FREE) {
+                        bl2++;
                     }
-                }
-                if (c == 'h') {
-                    ptrs = (void**)&c;
-                    len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
-                    for (mp_uint_t i = 0; i < len; i++) {
-                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                        if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                            c = 'S';
+                    if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
+                        // there are at least 2 lines containing only free blocks, so abbreviate their printing
+                        mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
+                        bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
+                        if (bl >= AREA_BLOCKS(area)) {
+                            // got to end of area
                             break;
                         }
                     }
                 }
-                break;
+                // print header for new line of blocks
+                // (the cast to uint32_t is for 16-bit ports)
+                //mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(bl) & (uint32_t)0xfffff));
+                mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
             }
-            */
-            /* this prints the uPy object type of the head block */
-            case AT_HEAD: {
-                void **ptr = (void**)(MP_STATE_MEM(gc_pool_start) + bl * BYTES_PER_BLOCK);
-                if (*ptr == &mp_type_tuple) { c = 'T'; }
-                else if (*ptr == &mp_type_list) { c = 'L'; }
-                else if (*ptr == &mp_type_dict) { c = 'D'; }
-                else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) { c = 'S'; }
-                #if MICROPY_PY_BUILTINS_BYTEARRAY
-                else if (*ptr == &mp_type_bytearray) { c = 'A'; }
-                #endif
-                #if MICROPY_PY_ARRAY
-                else if (*ptr == &mp_type_array) { c = 'A'; }
-                #endif
-                #if MICROPY_PY_BUILTINS_FLOAT
-                else if (*ptr == &mp_type_float) { c = 'F'; }
-                #endif
-                else if (*ptr == &mp_type_fun_bc) { c = 'B'; }
-                else if (*ptr == &mp_type_module) { c = 'M'; }
-                else {
+            int c = ' ';
+            switch (ATB_GET_KIND(area, bl)) {
+                case AT_FREE: c = '.'; break;
+                /* this prints out if the object is reachable from BSS or STACK (for unix only)
+                case AT_HEAD: {
                     c = 'h';
-                    #if 0
-                    // This code prints "Q" for qstr-pool data, and "q" for qstr-str
-                    // data.  It can be useful to see how qstrs are being allocated,
-                    // but is disabled by default because it is very slow.
-                    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
-                        if ((qstr_pool_t*)ptr == pool) {
-                            c = 'Q';
+                    void **ptrs = (void**)(void*)&mp_state_ctx;
+                    mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
+                    for (mp_uint_t i = 0; i < len; i++) {
+                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                        if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
+                            c = 'B';
                             break;
                         }
-                        for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
-                            if ((const byte*)ptr == *q) {
-                                c = 'q';
+                    }
+                    if (c == 'h') {
+                        ptrs = (void**)&c;
+                        len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
+                        for (mp_uint_t i = 0; i < len; i++) {
+                            mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                            if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
+                                c = 'S';
                                 break;
                             }
                         }
                     }
+                    break;
+                }
+                */
+                /* this prints the uPy object type of the head block */
+                case AT_HEAD: {
+                    void **ptr = (void**)(area->gc_pool_start + bl * BYTES_PER_BLOCK);
+                    if (*ptr == &mp_type_tuple) { c = 'T'; }
+                    else if (*ptr == &mp_type_list) { c = 'L'; }
+                    else if (*ptr == &mp_type_dict) { c = 'D'; }
+                    else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) { c = 'S'; }
+                    #if MICROPY_PY_BUILTINS_BYTEARRAY
+                    else if (*ptr == &mp_type_bytearray) { c = 'A'; }
                     #endif
+                    #if MICROPY_PY_ARRAY
+                    else if (*ptr == &mp_type_array) { c = 'A'; }
+                    #endif
+                    #if MICROPY_PY_BUILTINS_FLOAT
+                    else if (*ptr == &mp_type_float) { c = 'F'; }
+                    #endif
+                    else if (*ptr == &mp_type_fun_bc) { c = 'B'; }
+                    else if (*ptr == &mp_type_module) { c = 'M'; }
+                    else {
+                        c = 'h';
+                        #if 0
+                        // This code prints "Q" for qstr-pool data, and "q" for qstr-str
+                        // data.  It can be useful to see how qstrs are being allocated,
+                        // but is disabled by default because it is very slow.
+                        for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
+                            if ((qstr_pool_t*)ptr == pool) {
+                                c = 'Q';
+                                break;
+                            }
+                            for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
+                                if ((const byte*)ptr == *q) {
+                                    c = 'q';
+                                    break;
+                                }
+                            }
+                        }
+                        #endif
+                    }
+                    break;
                 }
-                break;
+                case AT_TAIL: c = '='; break;
+                case AT_MARK: c = 'm'; break;
             }
-            case AT_TAIL: c = '='; break;
-            case AT_MARK: c = 'm'; break;
+            mp_printf(&mp_plat_print, "%c", c);
         }
-        mp_printf(&mp_plat_print, "%c", c);
+        mp_print_str(&mp_plat_print, "\n");
     }
-    mp_print_str(&mp_plat_print, "\n");
     GC_EXIT();
 }
 
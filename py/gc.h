@@ -33,6 +33,11 @@
 
 void gc_init(void *start, void *end);
 
+#if MICROPY_GC_SPLIT_HEAP
+// Add another area of memory to the heap, after gc_init().
+void gc_add(void *start, void *end);
+#endif
+
 // These lock/unlock functions can be nested.
 // They can be used to prevent the GC from allocating/freeing.
 void gc_lock(void);
@@ -50,6 +55,9 @@ void gc_sweep_all(void);
 
 enum {
     GC_ALLOC_FLAG_HAS_FINALISER = 1,
+    // the object is expected to die young (used by MICROPY_GC_GENERATIONAL
+    // and MICROPY_GC_REGIONS)
+    GC_ALLOC_FLAG_YOUNG = 2,
 };
 
 void *gc_alloc(size_t n_bytes, unsigned int alloc_flags);
@@ -57,6 +65,102 @@ void gc_free(void *ptr); // does not call finaliser
 size_t gc_nbytes(const void *ptr);
 void *gc_realloc(void *ptr, size_t n_bytes, bool allow_move);
 
+#if MICROPY_GC_INCREMENTAL
+enum {
+    GC_PHASE_IDLE,
+    GC_PHASE_MARK,
+    GC_PHASE_SWEEP,
+};
+
+void gc_incremental_set_budget(size_t budget);
+void gc_write_barrier_slow(const void *ptr);
+
+// Must be called when a heap pointer is stored into the heap block containing
+// ptr, either just before or just after the store with no allocation between
+// them, so that an incremental collection in its mark phase rescans the block.
+// Blocks allocated during the mark phase are always rescanned at its end, so
+// filling in a newly allocated object doesn't need it.
+#define gc_write_barrier(ptr) do { \
+        if (MP_STATE_MEM(gc_phase) == GC_PHASE_MARK) { \
+            gc_write_barrier_slow(ptr); \
+        } \
+    } while (0)
+#elif MICROPY_GC_GENERATIONAL
+void gc_collect_minor(void);
+void gc_write_barrier_slow(const void *ptr);
+
+// Must be called when a heap pointer is stored into the heap block containing
+// ptr, so that the next minor collection finds it if it's to a young object.
+// Filling in a newly allocated object doesn't need it.
+#define gc_write_barrier(ptr) gc_write_barrier_slow(ptr)
+#elif MICROPY_GC_REGIONS
+// A chunk of a region: young objects are carved from the blocks start to end
+// of the heap area, up to free, and the blocks from free are its unused rest.
+typedef struct _gc_region_chunk_t {
+    struct _gc_region_chunk_t *prev; // the chunk that was used before this one
+    struct _mp_state_mem_area_t *area;
+    size_t start;
+    size_t free;
+    size_t end;
+} gc_region_chunk_t;
+
+// A region: young objects that are allocated while it's the innermost one of
+// a thread are carved from its latest chunk, and it gets another one when
+// that's full.
+typedef struct _gc_region_t {
+    struct _gc_region_t *prev; // the enclosing region of the same thread
+    struct _gc_region_t *next; // the next active region of any thread
+    gc_region_chunk_t *chunk;
+    size_t chunk_bytes;
+} gc_region_t;
+
+// Start a region with chunks of n_bytes in this thread, returning NULL if
+// there isn't enough memory.
+gc_region_t *gc_region_enter(size_t n_bytes);
+
+// End the innermost region of this thread.  Its chunks are freed if nothing
+// outside it refers to its objects; otherwise they are kept as ordinary heap
+// objects, and true is returned.
+bool gc_region_exit(gc_region_t *region);
+
+void gc_write_barrier_slow(const void *ptr);
+
+// Must be called when a heap pointer is stored into the heap block containing
+// ptr while a region is active, so that objects that escape from a region
+// are found when it ends.  Filling in a newly allocated object doesn't need
+// it.
+#define gc_write_barrier(ptr) do { \
+        if (MP_STATE_MEM(gc_regions) != NULL) { \
+            gc_write_barrier_slow(ptr); \
+        } \
+    } while (0)
+#else
+#define gc_write_barrier(ptr) (void)0
+#endif
+
+#if MICROPY_GC_PARALLEL_MARK
+void gc_parallel_set_markers(size_t n);
+#endif
+
+#if MICROPY_PY_UTRACEMALLOC
+// An entry in the hash table of allocation sites: the instruction that
+// allocated, and the function that it's in, or both NULL for the first entry,
+// which is for allocations made while no bytecode is running.
+typedef struct _gc_trace_site_t {
+    const byte *ip;
+    const void *fun_bc;
+    // filled in by gc_trace_count()
+    size_t n_blocks;
+    size_t n_allocs;
+} gc_trace_site_t;
+
+// Start recording the site of each allocation in the given zeroed table of
+// n_sites entries, a power of 2 up to 32768, or stop if sites is NULL.
+void gc_trace_set_sites(gc_trace_site_t *sites, size_t n_sites);
+// Fill in the blocks and allocations of each site that are still allocated.
+void gc_trace_count(void);
+#endif
+
 typedef struct _gc_info_t {
     size_t total;
     size_t used;
@@ -68,6 +172,10 @@ typedef struct _gc_info_t {
 } gc_info_t;
 
 void gc_info(gc_info_t *info);
+// Like gc_info, but quick because it only fills in total, used and free, and
+// max_free with the longest run of free blocks when the free lists were last
+// made (which may since have been used), or 0 if that isn't known.
+void gc_info_quick(gc_info_t *info);
 void gc_dump_info(void);
 void gc_dump_alloc_table(void);
 
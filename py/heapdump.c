@@ -0,0 +1,147 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/gc.h"
+#include "py/objmodule.h"
+#include "py/heapdump.h"
+
+#if MICROPY_PY_MICROPYTHON_HEAP_DUMP
+
+#define BYTES_PER_BLOCK (MICROPY_BYTES_PER_GC_BLOCK)
+
+#if MICROPY_GC_SPLIT_HEAP
+#define NEXT_AREA(area) ((area)->next)
+#else
+#define NEXT_AREA(area) (NULL)
+#endif
+
+STATIC void heap_dump_write(const mp_print_t *print, const void *buf, size_t len) {
+    print->print_strn(print->data, (const char*)buf, len);
+}
+
+STATIC void heap_dump_record(const mp_print_t *print, uintptr_t kind, uintptr_t a, uintptr_t b) {
+    uintptr_t rec[3] = {kind, a, b};
+    heap_dump_write(print, rec, sizeof(rec));
+}
+
+STATIC void heap_dump_roots(const mp_print_t *print, uintptr_t roots, void **ptrs, size_t len) {
+    heap_dump_record(print, MP_HEAP_DUMP_ROOTS, roots, len);
+    heap_dump_write(print, ptrs, len * sizeof(void*));
+}
+
+STATIC void heap_dump_type(const mp_print_t *print, const mp_obj_type_t *type) {
+    size_t len;
+    const byte *name = qstr_data(type->name, &len);
+    heap_dump_record(print, MP_HEAP_DUMP_TYPE, (uintptr_t)type, len);
+    heap_dump_write(print, name, len);
+}
+
+// Name the types that a module has, which are most of the ones that objects
+// on the heap can have
+STATIC void heap_dump_map_types(const mp_print_t *print, const mp_map_t *map, bool modules) {
+    for (size_t i = 0; i < map->alloc; i++) {
+        if (MP_MAP_SLOT_IS_FILLED(map, i)) {
+            mp_obj_t value = map->table[i].value;
+            if (modules) {
+                if (MP_OBJ_IS_TYPE(value, &mp_type_module)) {
+                    heap_dump_map_types(print, &mp_obj_module_get_globals(value)->map, false);
+                }
+            } else if (MP_OBJ_IS_TYPE(value, &mp_type_type)) {
+                heap_dump_type(print, MP_OBJ_TO_PTR(value));
+            }
+        }
+    }
+}
+
+STATIC void heap_dump_locked(const mp_print_t *print) {
+    byte header[8] = {'M', 'P', 'H', 'D', MP_HEAP_DUMP_VERSION, sizeof(void*), MP_ENDIANNESS_BIG, BYTES_PER_BLOCK};
+    heap_dump_write(print, header, sizeof(header));
+
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        size_t n_blocks = area->gc_alloc_table_byte_len * 4;
+        heap_dump_record(print, MP_HEAP_DUMP_AREA, (uintptr_t)area->gc_pool_start, n_blocks);
+        heap_dump_write(print, area->gc_alloc_table_start, area->gc_alloc_table_byte_len);
+        heap_dump_write(print, area->gc_pool_start, n_blocks * BYTES_PER_BLOCK);
+    }
+
+    // the same roots as gc_collect, except for registers and other threads
+    void **ptrs = (void**)(void*)&mp_state_ctx;
+    size_t root_start = offsetof(mp_state_ctx_t, thread.dict_locals);
+    size_t root_end = offsetof(mp_state_ctx_t, vm.qstr_last_chunk);
+    heap_dump_roots(print, MP_HEAP_DUMP_ROOTS_STATE, ptrs + root_start / sizeof(void*), (root_end - root_start) / sizeof(void*));
+    void *stack_dummy;
+    ptrs = &stack_dummy;
+    if ((char*)ptrs < MP_STATE_THREAD(stack_top)) {
+        heap_dump_roots(print, MP_HEAP_DUMP_ROOTS_STACK, ptrs, (MP_STATE_THREAD(stack_top) - (char*)ptrs) / sizeof(void*));
+    }
+    #if MICROPY_ENABLE_PYSTACK
+    ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
+    heap_dump_roots(print, MP_HEAP_DUMP_ROOTS_PYSTACK, ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void*));
+    #endif
+
+    // Name the types: classes on the heap, those of modules, and the ones for
+    // internal objects that aren't in a module.  Names may be repeated.
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        for (size_t block = 0; block < area->gc_alloc_table_byte_len * 4; block++) {
+            // the kind is 1 for a head and 3 for a marked head
+            if ((area->gc_alloc_table_start[block / 4] >> (2 * (block & 3))) & 1) {
+                mp_obj_base_t *o = (mp_obj_base_t*)(area->gc_pool_start + block * BYTES_PER_BLOCK);
+                if (o->type == &mp_type_type) {
+                    heap_dump_type(print, (mp_obj_type_t*)o);
+                }
+            }
+        }
+    }
+    heap_dump_map_types(print, &mp_builtin_module_map, true);
+    heap_dump_map_types(print, &MP_STATE_VM(mp_loaded_modules_dict).map, true);
+    static const mp_obj_type_t *const internal_types[] = {
+        &mp_type_type, &mp_type_fun_bc, &mp_type_closure, &mp_type_bound_meth,
+        &mp_type_gen_wrap, &mp_type_gen_instance, &mp_type_module, &mp_type_polymorph_iter,
+    };
+    for (size_t i = 0; i < MP_ARRAY_SIZE(internal_types); i++) {
+        heap_dump_type(print, internal_types[i]);
+    }
+
+    heap_dump_record(print, MP_HEAP_DUMP_END, 0, 0);
+}
+
+void mp_heap_dump(const mp_print_t *print) {
+    // Nothing may be allocated or freed while the heap is written out, so the
+    // stream must not allocate.
+    gc_lock();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        heap_dump_locked(print);
+        nlr_pop();
+        gc_unlock();
+    } else {
+        gc_unlock();
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+#endif // MICROPY_PY_MICROPYTHON_HEAP_DUMP
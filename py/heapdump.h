@@ -0,0 +1,63 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_PY_HEAPDUMP_H
+#define MICROPY_INCLUDED_PY_HEAPDUMP_H
+
+#include "py/mpprint.h"
+
+#if MICROPY_PY_MICROPYTHON_HEAP_DUMP
+
+// The dump starts with the bytes "MPHD", then bytes for the version, the size
+// of a word, whether it's big endian and the size of a GC block.  A sequence
+// of records follows, each of which starts with three words: its kind and two
+// arguments a and b.  Words are in the byte order of the machine.
+enum {
+    // the end of the dump
+    MP_HEAP_DUMP_END = 0,
+    // a = address of the pool, b = number of blocks, followed by the
+    // allocation table (b / 4 bytes) and then the pool (b * block size bytes)
+    MP_HEAP_DUMP_AREA = 1,
+    // a = one of MP_HEAP_DUMP_ROOTS_xxx, b = number of words that follow
+    MP_HEAP_DUMP_ROOTS = 2,
+    // a = address of a type, b = length of its name, which follows
+    MP_HEAP_DUMP_TYPE = 3,
+};
+
+enum {
+    MP_HEAP_DUMP_ROOTS_STATE = 0,
+    MP_HEAP_DUMP_ROOTS_STACK = 1,
+    MP_HEAP_DUMP_ROOTS_PYSTACK = 2,
+};
+
+#define MP_HEAP_DUMP_VERSION (1)
+
+// Write a dump of the heap to print, with the GC locked.  Only the roots of
+// the calling thread are included.
+void mp_heap_dump(const mp_print_t *print);
+
+#endif
+
+#endif // MICROPY_INCLUDED_PY_HEAPDUMP_H
@@ -52,10 +52,15 @@ codepoint2name[ord('|')] = 'pipe'
 codepoint2name[ord('~')] = 'tilde'
 
 # this must match the equivalent function in qstr.c
-def compute_hash(qstr, bytes_hash):
+def compute_hash_raw(qstr):
     hash = 5381
     for b in qstr:
-        hash = (hash * 33) ^ b
+        hash = ((hash * 33) ^ b) & 0xffffffff
+    return hash
+
+# this must match the equivalent function in qstr.c
+def compute_hash(qstr, bytes_hash):
+    hash = compute_hash_raw(qstr)
     # Make sure that valid hash is never zero, zero means "hash not computed"
     return (hash & ((1 << (8 * bytes_hash)) - 1)) or 1
 
@@ -161,6 +166,29 @@ def print_qstr_data(qcfgs, qstrs):
         qbytes = make_bytes(cfg_bytes_len, cfg_bytes_hash, qstr)
         print('QDEF(MP_QSTR_%s, %s)' % (ident, qbytes))
 
+    print_qstr_index(qstrs)
+
+def print_qstr_index(qstrs):
+    # build an open-addressed hash table of the qstrs above, using linear
+    # probing and a load factor of at most 3/4; the lookup in qstr.c must
+    # match this, and slots containing MP_QSTR_NULL are empty
+    sorted_qstrs = sorted(qstrs.values(), key=lambda x: x[0])
+    size = 4
+    while len(sorted_qstrs) * 4 > size * 3:
+        size *= 2
+    table = [None] * size
+    for order, ident, qstr in sorted_qstrs:
+        slot = compute_hash_raw(bytes_cons(qstr, 'utf8')) & (size - 1)
+        while table[slot] is not None:
+            slot = (slot + 1) & (size - 1)
+        table[slot] = ident
+
+    print('')
+    print('#ifdef QINDEX')
+    for ident in table:
+        print('QINDEX(MP_QSTR_%s)' % ('NULL' if ident is None else ident))
+    print('#endif')
+
 def do_work(infiles):
     qcfgs, qstrs = parse_input_headers(infiles)
     print_qstr_data(qcfgs, qstrs)
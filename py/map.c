@@ -32,6 +32,7 @@
 #include "py/mpconfig.h"
 #include "py/misc.h"
 #include "py/runtime.h"
+#include "py/gc.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -40,6 +41,33 @@
 #define DEBUG_printf(...) (void)0
 #endif
 
+#if MICROPY_OPT_MAP_LOOKUP_CACHE
+// MP_STATE_VM(map_lookup_cache) remembers, for a given key, the position it
+// was last found at in any map.  On a cache hit this skips the linear search
+// of an ordered map (ie all the ROM locals_dict and module globals tables)
+// and the hashing and probing of a hash table.  The cache is shared by all
+// maps and is only a hint, the key in the slot is always checked.
+// Pointers and qstrs are shifted down to drop the object tag bits.
+#define MAP_CACHE_ENTRY(index) (MP_STATE_VM(map_lookup_cache)[((uintptr_t)(index) >> 2) % MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE])
+#define MAP_CACHE_SET(index, pos) do { MAP_CACHE_ENTRY(index) = (pos) & 0xff; } while (0)
+#else
+#define MAP_CACHE_SET(index, pos)
+#endif
+
+// The caller of an ADD_IF_NOT_FOUND lookup stores the value into the slot
+// that is returned, so the table needs a write barrier.
+#define MAP_STORE_BARRIER(map, lookup_kind) do { \
+        if ((lookup_kind) == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) { \
+            gc_write_barrier((map)->table); \
+        } \
+    } while (0)
+
+#if MICROPY_MAP_VERSION
+#define MAP_CHANGED(map) do { if ((map)->is_versioned) { mp_map_version_changed(); } } while (0)
+#else
+#define MAP_CHANGED(map)
+#endif
+
 // Fixed empty map. Useful when need to call kw-receiving functions
 // without any keywords from C, etc.
 const mp_map_t mp_const_empty_map = {
@@ -73,21 +101,107 @@ STATIC size_t get_hash_alloc_greater_or_equal_to(size_t x) {
     return (x + x / 2) | 1;
 }
 
+#if MICROPY_MAP_COMPACT
+
+// A compact hash table keeps its entries dense and in insertion order in
+// map->table: live entries, deleted entries (key MP_OBJ_SENTINEL) and then
+// unused ones (key MP_OBJ_NULL), so loops over [0, alloc) checking
+// MP_MAP_SLOT_IS_FILLED still work.  The same heap block continues with the
+// number of entries in use (live and deleted), the number of index slots that
+// are not empty, and an index of MAP_INDEX_LEN slots that is probed by hash.
+// Each index slot is empty, the position of an entry plus one, or deleted,
+// and is 1, 2 or 4 bytes wide depending on alloc.  At most alloc index slots
+// are filled so a probe always reaches an empty one.  Maps with up to
+// MAP_LINEAR_MAX entries whose keys are all qstrs don't have the counts or
+// the index, they are searched linearly like ordered maps and removing an
+// entry moves the following ones down.  Other keys could only be told apart
+// by calling __eq__ on each one, so they always get the index.
+
+#define MAP_LINEAR_MAX (12)
+#define MAP_IS_LINEAR(map) ((map)->is_ordered || ((map)->alloc <= MAP_LINEAR_MAX && (map)->all_keys_are_qstrs))
+#define MAP_INDEX_LEN(alloc) ((alloc) + (alloc) / 2 + 1)
+#define MAP_INDEX_EMPTY (0)
+#define MAP_N_ENTRIES(map) (((size_t*)&(map)->table[(map)->alloc])[0])
+#define MAP_N_FILLED(map) (((size_t*)&(map)->table[(map)->alloc])[1])
+
+STATIC size_t map_index_width(size_t alloc) {
+    if (alloc < 0xff) {
+        return 1;
+    } else if (alloc < 0xffff) {
+        return 2;
+    } else {
+        return 4;
+    }
+}
+
+STATIC size_t map_table_bytes(const mp_map_t *map) {
+    size_t n = map->alloc * sizeof(mp_map_elem_t);
+    if (!MAP_IS_LINEAR(map)) {
+        n += 2 * sizeof(size_t) + MAP_INDEX_LEN(map->alloc) * map_index_width(map->alloc);
+    }
+    return n;
+}
+
+STATIC size_t map_index_deleted(const mp_map_t *map) {
+    return (size_t)0xffffffff >> (8 * (4 - map_index_width(map->alloc)));
+}
+
+STATIC size_t map_index_get(const mp_map_t *map, size_t pos) {
+    void *index = &MAP_N_FILLED(map) + 1;
+    if (map->alloc < 0xff) {
+        return ((uint8_t*)index)[pos];
+    } else if (map->alloc < 0xffff) {
+        return ((uint16_t*)index)[pos];
+    } else {
+        return ((uint32_t*)index)[pos];
+    }
+}
+
+STATIC void map_index_set(mp_map_t *map, size_t pos, size_t value) {
+    void *index = &MAP_N_FILLED(map) + 1;
+    if (map->alloc < 0xff) {
+        ((uint8_t*)index)[pos] = value;
+    } else if (map->alloc < 0xffff) {
+        ((uint16_t*)index)[pos] = value;
+    } else {
+        ((uint32_t*)index)[pos] = value;
+    }
+}
+
+#else
+
+#define MAP_IS_LINEAR(map) ((map)->is_ordered)
+
+STATIC size_t map_table_bytes(const mp_map_t *map) {
+    return map->alloc * sizeof(mp_map_elem_t);
+}
+
+#endif
+
+STATIC mp_uint_t map_hash(mp_obj_t index) {
+    // fast path for the common case of qstr
+    if (MP_OBJ_IS_QSTR(index)) {
+        return qstr_hash(MP_OBJ_QSTR_VALUE(index));
+    } else {
+        return MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
+    }
+}
+
 /******************************************************************************/
 /* map                                                                        */
 
 void mp_map_init(mp_map_t *map, size_t n) {
-    if (n == 0) {
-        map->alloc = 0;
-        map->table = NULL;
-    } else {
-        map->alloc = n;
-        map->table = m_new0(mp_map_elem_t, map->alloc);
-    }
+    map->alloc = n;
     map->used = 0;
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 0;
     map->is_ordered = 0;
+    map->is_versioned = 0;
+    if (n == 0) {
+        map->table = NULL;
+    } else {
+        map->table = (mp_map_elem_t*)m_new0(byte, map_table_bytes(map));
+    }
 }
 
 void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table) {
@@ -96,20 +210,88 @@ void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table) {
     map->all_keys_are_qstrs = 1;
     map->is_fixed = 1;
     map->is_ordered = 1;
+    map->is_versioned = 0;
     map->table = (mp_map_elem_t*)table;
 }
 
+// Initialise map with a copy of the entries of src, which may be fixed.
+void mp_map_init_copy(mp_map_t *map, const mp_map_t *src) {
+    size_t n_bytes = map_table_bytes(src);
+    map->alloc = src->alloc;
+    map->used = src->used;
+    map->all_keys_are_qstrs = src->all_keys_are_qstrs;
+    map->is_fixed = 0;
+    map->is_ordered = src->is_ordered;
+    map->is_versioned = 0;
+    if (n_bytes == 0) {
+        map->table = NULL;
+    } else {
+        map->table = (mp_map_elem_t*)m_new(byte, n_bytes);
+        memcpy(map->table, src->table, n_bytes);
+    }
+}
+
+// One past the last position in the table of a map that may be filled.
+size_t mp_map_top(const mp_map_t *map) {
+    if (map->is_ordered) {
+        return map->used;
+    }
+    #if MICROPY_MAP_COMPACT
+    if (!MAP_IS_LINEAR(map)) {
+        return MAP_N_ENTRIES(map);
+    }
+    return map->used;
+    #else
+    return map->alloc;
+    #endif
+}
+
+// Number of bytes used by the table of a map, for sys.getsizeof().
+size_t mp_map_table_bytes(const mp_map_t *map) {
+    return map_table_bytes(map);
+}
+
+#if MICROPY_MAP_VERSION
+// Caches may hold pointers to the entries of a versioned map, and they stay
+// valid for as long as MP_STATE_VM(map_version) doesn't change.  Marking a map
+// as versioned counts as a change because a new map (and the object owning it)
+// may reuse the memory of one that was freed.  Fixed maps never change so they
+// don't need the flag.
+void mp_map_set_versioned(mp_map_t *map) {
+    if (!map->is_fixed) {
+        map->is_versioned = 1;
+    }
+    mp_map_version_changed();
+}
+
+void mp_map_version_changed(void) {
+    if (++MP_STATE_VM(map_version) == 0) {
+        // the version wrapped around so old entries could look valid again
+        #if MICROPY_OPT_ATTR_INLINE_CACHE
+        memset(MP_STATE_VM(attr_cache), 0, sizeof(MP_STATE_VM(attr_cache)));
+        #endif
+        #if MICROPY_OPT_CLASS_LOOKUP_CACHE
+        memset(MP_STATE_VM(class_lookup_cache), 0, sizeof(MP_STATE_VM(class_lookup_cache)));
+        #endif
+        #if MICROPY_OPT_LOAD_GLOBAL_CACHE
+        memset(MP_STATE_VM(global_cache), 0, sizeof(MP_STATE_VM(global_cache)));
+        #endif
+    }
+}
+#endif
+
 // Differentiate from mp_map_clear() - semantics is different
 void mp_map_deinit(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        m_del(byte, map->table, map_table_bytes(map));
     }
     map->used = map->alloc = 0;
 }
 
 void mp_map_clear(mp_map_t *map) {
+    MAP_CHANGED(map);
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        m_del(byte, map->table, map_table_bytes(map));
     }
     map->alloc = 0;
     map->used = 0;
@@ -118,7 +300,58 @@ void mp_map_clear(mp_map_t *map) {
     map->table = NULL;
 }
 
+#if MICROPY_MAP_COMPACT
+
+// Rebuild the table with room for more entries.  new_key is the key that is
+// about to be added, if any, which the layout of the new table must allow.
+STATIC void mp_map_rehash(mp_map_t *map, mp_obj_t new_key) {
+    MAP_CHANGED(map);
+    size_t old_alloc = map->alloc;
+    size_t old_bytes = map_table_bytes(map);
+    // Leave room to append a quarter as many entries again as are live, so a
+    // table with many deleted entries is compacted instead of growing.
+    size_t new_alloc = get_hash_alloc_greater_or_equal_to(map->used + map->used / 4 + 1);
+    DEBUG_printf("mp_map_rehash(%p): " UINT_FMT " -> " UINT_FMT "\n", map, old_alloc, new_alloc);
+    mp_map_elem_t *old_table = map->table;
+    mp_map_t new_map = { .alloc = new_alloc, .all_keys_are_qstrs = new_key == MP_OBJ_NULL || MP_OBJ_IS_QSTR(new_key) };
+    for (size_t i = 0; i < old_alloc && new_map.all_keys_are_qstrs; i++) {
+        if (old_table[i].key != MP_OBJ_NULL && old_table[i].key != MP_OBJ_SENTINEL && !MP_OBJ_IS_QSTR(old_table[i].key)) {
+            new_map.all_keys_are_qstrs = 0;
+        }
+    }
+    mp_map_elem_t *new_table = (mp_map_elem_t*)m_new0(byte, map_table_bytes(&new_map));
+    // If we reach this point, table resizing succeeded, now we can edit the old map.
+    map->alloc = new_alloc;
+    map->is_ordered = 0;
+    map->all_keys_are_qstrs = new_map.all_keys_are_qstrs;
+    size_t n = 0;
+    for (size_t i = 0; i < old_alloc; i++) {
+        if (old_table[i].key != MP_OBJ_NULL && old_table[i].key != MP_OBJ_SENTINEL) {
+            new_table[n++] = old_table[i];
+        }
+    }
+    map->used = n;
+    map->table = new_table;
+    m_del(byte, old_table, old_bytes);
+    if (!MAP_IS_LINEAR(map)) {
+        // the entries are all distinct so each just goes in the first empty slot
+        MAP_N_ENTRIES(map) = n;
+        MAP_N_FILLED(map) = n;
+        size_t len = MAP_INDEX_LEN(new_alloc);
+        for (size_t i = 0; i < n; i++) {
+            size_t pos = map_hash(new_table[i].key) % len;
+            while (map_index_get(map, pos) != MAP_INDEX_EMPTY) {
+                pos = (pos + 1) % len;
+            }
+            map_index_set(map, pos, i + 1);
+        }
+    }
+}
+
+#else
+
 STATIC void mp_map_rehash(mp_map_t *map) {
+    MAP_CHANGED(map);
     size_t old_alloc = map->alloc;
     size_t new_alloc = get_hash_alloc_greater_or_equal_to(map->alloc + 1);
     DEBUG_printf("mp_map_rehash(%p): " UINT_FMT " -> " UINT_FMT "\n", map, old_alloc, new_alloc);
@@ -137,6 +370,8 @@ STATIC void mp_map_rehash(mp_map_t *map) {
     m_del(mp_map_elem_t, old_table, old_alloc);
 }
 
+#endif
+
 // MP_MAP_LOOKUP behaviour:
 //  - returns NULL if not found, else the slot it was found in with key,value non-null
 // MP_MAP_LOOKUP_ADD_IF_NOT_FOUND behaviour:
@@ -147,6 +382,18 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
     // If the map is a fixed array then we must only be called for a lookup
     assert(!map->is_fixed || lookup_kind == MP_MAP_LOOKUP);
 
+    #if MICROPY_OPT_MAP_LOOKUP_CACHE
+    // Try the position where this key was last found, which only needs an
+    // exact match of the key; equal-but-not-identical keys take the slow path.
+    if (lookup_kind != MP_MAP_LOOKUP_REMOVE_IF_FOUND && map->alloc != 0) {
+        size_t pos = MAP_CACHE_ENTRY(index) % map->alloc;
+        if ((!map->is_ordered || pos < map->used) && map->table[pos].key == index) {
+            MAP_STORE_BARRIER(map, lookup_kind);
+            return &map->table[pos];
+        }
+    }
+    #endif
+
     // Work out if we can compare just pointers
     bool compare_only_ptrs = map->all_keys_are_qstrs;
     if (compare_only_ptrs) {
@@ -167,11 +414,19 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
     }
 
     // if the map is an ordered array then we must do a brute force linear search
-    if (map->is_ordered) {
+    if (MAP_IS_LINEAR(map)) {
+        #if MICROPY_MAP_COMPACT
+        if (!map->is_ordered && !MP_OBJ_IS_QSTR(index)) {
+            // a small hash table doesn't need the hash, but the key must
+            // still be hashable
+            map_hash(index);
+        }
+        #endif
         for (mp_map_elem_t *elem = &map->table[0], *top = &map->table[map->used]; elem < top; elem++) {
             if (elem->key == index || (!compare_only_ptrs && mp_obj_equal(elem->key, index))) {
-                #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+                #if MICROPY_PY_COLLECTIONS_ORDEREDDICT || MICROPY_MAP_COMPACT
                 if (MP_UNLIKELY(lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND)) {
+                    MAP_CHANGED(map);
                     // remove the found element by moving the rest of the array down
                     mp_obj_t value = elem->value;
                     --map->used;
@@ -180,26 +435,46 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                     elem = &map->table[map->used];
                     elem->key = MP_OBJ_NULL;
                     elem->value = value;
+                    gc_write_barrier(map->table);
+                    return elem;
                 }
                 #endif
+                MAP_CACHE_SET(index, elem - map->table);
+                MAP_STORE_BARRIER(map, lookup_kind);
                 return elem;
             }
         }
-        #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+        #if MICROPY_PY_COLLECTIONS_ORDEREDDICT || MICROPY_MAP_COMPACT
         if (MP_LIKELY(lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)) {
             return NULL;
         }
+        MAP_CHANGED(map);
+        #if MICROPY_MAP_COMPACT
+        // a small hash table that gets a key which isn't a qstr needs the index
+        if (map->used == map->alloc || (!map->is_ordered && !MP_OBJ_IS_QSTR(index))) {
+            mp_map_rehash(map, index);
+            if (!MAP_IS_LINEAR(map)) {
+                return mp_map_lookup(map, index, lookup_kind);
+            }
+        }
+        #else
         if (map->used == map->alloc) {
             // TODO: Alloc policy
             map->alloc += 4;
             map->table = m_renew(mp_map_elem_t, map->table, map->used, map->alloc);
             mp_seq_clear(map->table, map->used, map->alloc, sizeof(*map->table));
         }
+        #endif
+        MAP_CACHE_SET(index, map->used);
         mp_map_elem_t *elem = map->table + map->used++;
         elem->key = index;
+        #if MICROPY_MAP_COMPACT
+        elem->value = MP_OBJ_NULL;
+        #endif
         if (!MP_OBJ_IS_QSTR(index)) {
             map->all_keys_are_qstrs = 0;
         }
+        gc_write_barrier(map->table);
         return elem;
         #else
         return NULL;
@@ -208,6 +483,78 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
 
     // map is a hash table (not an ordered array), so do a hash lookup
 
+    #if MICROPY_MAP_COMPACT
+
+    mp_uint_t hash = map_hash(index);
+    size_t len = MAP_INDEX_LEN(map->alloc);
+    size_t deleted = map_index_deleted(map);
+    size_t pos = hash % len;
+    size_t avail_pos = (size_t)-1;
+    for (;;) {
+        size_t i = map_index_get(map, pos);
+        if (i == MAP_INDEX_EMPTY) {
+            // found empty slot, so index is not in table
+            if (lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+                return NULL;
+            }
+            size_t n = MAP_N_ENTRIES(map);
+            if (n == map->alloc || (avail_pos == (size_t)-1 && MAP_N_FILLED(map) == map->alloc)) {
+                mp_map_rehash(map, index);
+                return mp_map_lookup(map, index, lookup_kind);
+            }
+            MAP_CHANGED(map);
+            if (avail_pos == (size_t)-1) {
+                avail_pos = pos;
+                MAP_N_FILLED(map) += 1;
+            }
+            map_index_set(map, avail_pos, n + 1);
+            MAP_N_ENTRIES(map) = n + 1;
+            map->used += 1;
+            mp_map_elem_t *elem = &map->table[n];
+            elem->key = index;
+            elem->value = MP_OBJ_NULL;
+            if (!MP_OBJ_IS_QSTR(index)) {
+                map->all_keys_are_qstrs = 0;
+            }
+            MAP_CACHE_SET(index, n);
+            gc_write_barrier(map->table);
+            return elem;
+        } else if (i == deleted) {
+            // found deleted slot, remember for later
+            if (avail_pos == (size_t)-1) {
+                avail_pos = pos;
+            }
+        } else {
+            mp_map_elem_t *elem = &map->table[i - 1];
+            if (elem->key == index || (!compare_only_ptrs && mp_obj_equal(elem->key, index))) {
+                // found index
+                // Note: CPython does not replace the index; try x={True:'true'};x[1]='one';x
+                if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+                    // delete the entry and mark its index slot as deleted;
+                    // deleted entries at the end (eg from popitem) are reused
+                    // straight away, others only by the next rehash
+                    MAP_CHANGED(map);
+                    map->used--;
+                    map_index_set(map, pos, deleted);
+                    elem->key = MP_OBJ_SENTINEL;
+                    size_t n = MAP_N_ENTRIES(map);
+                    while (n > 0 && map->table[n - 1].key == MP_OBJ_SENTINEL) {
+                        map->table[--n].key = MP_OBJ_NULL;
+                    }
+                    MAP_N_ENTRIES(map) = n;
+                    // keep elem->value so that caller can access it if needed
+                } else {
+                    MAP_CACHE_SET(index, i - 1);
+                    MAP_STORE_BARRIER(map, lookup_kind);
+                }
+                return elem;
+            }
+        }
+        pos = (pos + 1) % len;
+    }
+
+    #else
+
     if (map->alloc == 0) {
         if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
             mp_map_rehash(map);
@@ -216,13 +563,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         }
     }
 
-    // get hash of index, with fast path for common case of qstr
-    mp_uint_t hash;
-    if (MP_OBJ_IS_QSTR(index)) {
-        hash = qstr_hash(MP_OBJ_QSTR_VALUE(index));
-    } else {
-        hash = MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
-    }
+    mp_uint_t hash = map_hash(index);
 
     size_t pos = hash % map->alloc;
     size_t start_pos = pos;
@@ -232,6 +573,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         if (slot->key == MP_OBJ_NULL) {
             // found NULL slot, so index is not in table
             if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+                MAP_CHANGED(map);
                 map->used += 1;
                 if (avail_slot == NULL) {
                     avail_slot = slot;
@@ -241,6 +583,8 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                 if (!MP_OBJ_IS_QSTR(index)) {
                     map->all_keys_are_qstrs = 0;
                 }
+                MAP_CACHE_SET(index, avail_slot - map->table);
+                gc_write_barrier(map->table);
                 return avail_slot;
             } else {
                 return NULL;
@@ -255,6 +599,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             // Note: CPython does not replace the index; try x={True:'true'};x[1]='one';x
             if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
                 // delete element in this slot
+                MAP_CHANGED(map);
                 map->used--;
                 if (map->table[(pos + 1) % map->alloc].key == MP_OBJ_NULL) {
                     // optimisation if next slot is empty
@@ -263,6 +608,9 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                     slot->key = MP_OBJ_SENTINEL;
                 }
                 // keep slot->value so that caller can access it if needed
+            } else {
+                MAP_CACHE_SET(index, pos);
+                MAP_STORE_BARRIER(map, lookup_kind);
             }
             return slot;
         }
@@ -275,12 +623,15 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
                 if (avail_slot != NULL) {
                     // there was an available slot, so use that
+                    MAP_CHANGED(map);
                     map->used++;
                     avail_slot->key = index;
                     avail_slot->value = MP_OBJ_NULL;
                     if (!MP_OBJ_IS_QSTR(index)) {
                         map->all_keys_are_qstrs = 0;
                     }
+                    MAP_CACHE_SET(index, avail_slot - map->table);
+                    gc_write_barrier(map->table);
                     return avail_slot;
                 } else {
                     // not enough room in table, rehash it
@@ -293,6 +644,8 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             }
         }
     }
+
+    #endif
 }
 
 /******************************************************************************/
@@ -345,6 +698,7 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
                 }
                 set->used++;
                 *avail_slot = index;
+                gc_write_barrier(set->table);
                 return index;
             } else {
                 return MP_OBJ_NULL;
@@ -379,6 +733,7 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
                     // there was an available slot, so use that
                     set->used++;
                     *avail_slot = index;
+                    gc_write_barrier(set->table);
                     return index;
                 } else {
                     // not enough room in table, rehash it
@@ -71,6 +71,13 @@ typedef unsigned int uint;
 #define m_new_obj_with_finaliser(type) m_new_obj(type)
 #define m_new_obj_var_with_finaliser(type, var_type, var_num) m_new_obj_var(type, var_type, var_num)
 #endif
+#if MICROPY_GC_GENERATIONAL || MICROPY_GC_REGIONS
+#define m_new_obj_young(type) ((type*)(m_malloc_young(sizeof(type))))
+#define m_new_obj_var_young(type, var_type, var_num) ((type*)m_malloc_young(sizeof(type) + sizeof(var_type) * (var_num)))
+#else
+#define m_new_obj_young(type) m_new_obj(type)
+#define m_new_obj_var_young(type, var_type, var_num) m_new_obj_var(type, var_type, var_num)
+#endif
 #if MICROPY_MALLOC_USES_ALLOCATED_SIZE
 #define m_renew(type, ptr, old_num, new_num) ((type*)(m_realloc((ptr), sizeof(type) * (old_num), sizeof(type) * (new_num))))
 #define m_renew_maybe(type, ptr, old_num, new_num, allow_move) ((type*)(m_realloc_maybe((ptr), sizeof(type) * (old_num), sizeof(type) * (new_num), (allow_move))))
@@ -87,6 +94,7 @@ typedef unsigned int uint;
 void *m_malloc(size_t num_bytes);
 void *m_malloc_maybe(size_t num_bytes);
 void *m_malloc_with_finaliser(size_t num_bytes);
+void *m_malloc_young(size_t num_bytes);
 void *m_malloc0(size_t num_bytes);
 #if MICROPY_MALLOC_USES_ALLOCATED_SIZE
 void *m_realloc(void *ptr, size_t old_num_bytes, size_t new_num_bytes);
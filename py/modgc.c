@@ -27,19 +27,38 @@
 #include "py/mpstate.h"
 #include "py/obj.h"
 #include "py/gc.h"
+#include "py/runtime.h"
 
 #if MICROPY_PY_GC && MICROPY_ENABLE_GC
 
+#if MICROPY_GC_GENERATIONAL
+// collect([generation]): run a garbage collection, a minor one if generation is 0
+STATIC mp_obj_t py_gc_collect(size_t n_args, const mp_obj_t *args) {
+    mp_int_t generation = n_args == 0 ? 2 : mp_obj_get_int(args[0]);
+    if (generation < 0 || generation > 2) {
+        mp_raise_ValueError("invalid generation");
+    }
+    if (generation == 0) {
+        gc_collect_minor();
+    } else {
+        gc_collect();
+    }
+#else
 // collect(): run a garbage collection
 STATIC mp_obj_t py_gc_collect(void) {
     gc_collect();
+#endif
 #if MICROPY_PY_GC_COLLECT_RETVAL
     return MP_OBJ_NEW_SMALL_INT(MP_STATE_MEM(gc_collected));
 #else
     return mp_const_none;
 #endif
 }
+#if MICROPY_GC_GENERATIONAL
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_collect_obj, 0, 1, py_gc_collect);
+#else
 MP_DEFINE_CONST_FUN_OBJ_0(gc_collect_obj, py_gc_collect);
+#endif
 
 // disable(): disable the garbage collector
 STATIC mp_obj_t gc_disable(void) {
@@ -63,7 +82,7 @@ MP_DEFINE_CONST_FUN_OBJ_0(gc_isenabled_obj, gc_isenabled);
 // mem_free(): return the number of bytes of available heap RAM
 STATIC mp_obj_t gc_mem_free(void) {
     gc_info_t info;
-    gc_info(&info);
+    gc_info_quick(&info);
     return MP_OBJ_NEW_SMALL_INT(info.free);
 }
 MP_DEFINE_CONST_FUN_OBJ_0(gc_mem_free_obj, gc_mem_free);
@@ -71,7 +90,7 @@ MP_DEFINE_CONST_FUN_OBJ_0(gc_mem_free_obj, gc_mem_free);
 // mem_alloc(): return the number of bytes of heap RAM that are allocated
 STATIC mp_obj_t gc_mem_alloc(void) {
     gc_info_t info;
-    gc_info(&info);
+    gc_info_quick(&info);
     return MP_OBJ_NEW_SMALL_INT(info.used);
 }
 MP_DEFINE_CONST_FUN_OBJ_0(gc_mem_alloc_obj, gc_mem_alloc);
@@ -95,6 +114,44 @@ STATIC mp_obj_t gc_threshold(size_t n_args, const mp_obj_t *args) {
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_threshold_obj, 0, 1, gc_threshold);
 #endif
 
+#if MICROPY_GC_INCREMENTAL
+// incremental([budget]): get or set the number of blocks an incremental slice may mark
+STATIC mp_obj_t gc_incremental(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return mp_obj_new_int_from_uint(MP_STATE_MEM(gc_inc_budget));
+    }
+    mp_int_t val = mp_obj_get_int(args[0]);
+    if (val < 0) {
+        mp_raise_ValueError(NULL);
+    }
+    gc_incremental_set_budget(val);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_incremental_obj, 0, 1, gc_incremental);
+
+// slices(): return the number of slices that the last collection was done in
+STATIC mp_obj_t gc_slices(void) {
+    return mp_obj_new_int_from_uint(MP_STATE_MEM(gc_inc_last_slices));
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_slices_obj, gc_slices);
+#endif
+
+#if MICROPY_GC_PARALLEL_MARK
+// markers([n]): get or set the number of threads that mark the heap
+STATIC mp_obj_t gc_markers(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        return MP_OBJ_NEW_SMALL_INT(MP_STATE_MEM(gc_markers));
+    }
+    mp_int_t val = mp_obj_get_int(args[0]);
+    if (val < 1) {
+        mp_raise_ValueError(NULL);
+    }
+    gc_parallel_set_markers(val);
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_markers_obj, 0, 1, gc_markers);
+#endif
+
 STATIC const mp_rom_map_elem_t mp_module_gc_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_gc) },
     { MP_ROM_QSTR(MP_QSTR_collect), MP_ROM_PTR(&gc_collect_obj) },
@@ -106,6 +163,13 @@ STATIC const mp_rom_map_elem_t mp_module_gc_globals_table[] = {
     #if MICROPY_GC_ALLOC_THRESHOLD
     { MP_ROM_QSTR(MP_QSTR_threshold), MP_ROM_PTR(&gc_threshold_obj) },
     #endif
+    #if MICROPY_GC_INCREMENTAL
+    { MP_ROM_QSTR(MP_QSTR_incremental), MP_ROM_PTR(&gc_incremental_obj) },
+    { MP_ROM_QSTR(MP_QSTR_slices), MP_ROM_PTR(&gc_slices_obj) },
+    #endif
+    #if MICROPY_GC_PARALLEL_MARK
+    { MP_ROM_QSTR(MP_QSTR_markers), MP_ROM_PTR(&gc_markers_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_gc_globals, mp_module_gc_globals_table);
@@ -31,6 +31,9 @@
 #include "py/runtime.h"
 #include "py/gc.h"
 #include "py/mphal.h"
+#include "py/profile.h"
+#include "py/heapdump.h"
+#include "py/stream.h"
 
 // Various builtins specific to MicroPython runtime,
 // living in micropython module
@@ -114,6 +117,110 @@ STATIC mp_obj_t mp_micropython_stack_use(void) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_stack_use_obj, mp_micropython_stack_use);
 #endif
 
+#if MICROPY_PY_MICROPYTHON_PROFILE
+STATIC mp_obj_t mp_micropython_profile_start(size_t n_args, const mp_obj_t *args) {
+    mp_uint_t interval_us = 1000;
+    size_t buf_words = MP_PROF_DEFAULT_BUF_WORDS;
+    if (n_args >= 1) {
+        interval_us = mp_obj_get_int(args[0]);
+    }
+    if (n_args >= 2) {
+        buf_words = mp_obj_get_int(args[1]);
+    }
+    mp_prof_start(interval_us, buf_words);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_profile_start_obj, 0, 2, mp_micropython_profile_start);
+
+STATIC mp_obj_t mp_micropython_profile_stop(void) {
+    return mp_prof_stop();
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_profile_stop_obj, mp_micropython_profile_stop);
+#endif
+
+#if MICROPY_PY_MICROPYTHON_HEAP_DUMP
+STATIC mp_obj_t mp_micropython_heap_dump(mp_obj_t stream) {
+    mp_get_stream_raise(stream, MP_STREAM_OP_WRITE);
+    mp_print_t print = {MP_OBJ_TO_PTR(stream), mp_stream_write_adaptor};
+    mp_heap_dump(&print);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_heap_dump_obj, mp_micropython_heap_dump);
+#endif
+
+#if MICROPY_GC_REGIONS
+typedef struct _mp_obj_region_t {
+    mp_obj_base_t base;
+    size_t size;
+    gc_region_t *region; // while the region is active
+    bool strict;
+    int8_t escaped; // -1 until the region has ended
+} mp_obj_region_t;
+
+STATIC mp_obj_t region_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    mp_obj_region_t *self = m_new_obj(mp_obj_region_t);
+    self->base.type = type;
+    self->size = mp_obj_get_int(args[0]);
+    self->region = NULL;
+    self->strict = n_args > 1 && mp_obj_is_true(args[1]);
+    self->escaped = -1;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t region___enter__(mp_obj_t self_in) {
+    mp_obj_region_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->region != NULL) {
+        mp_raise_msg(&mp_type_RuntimeError, "region already active");
+    }
+    self->region = gc_region_enter(self->size);
+    if (self->region == NULL) {
+        m_malloc_fail(self->size);
+    }
+    self->escaped = -1;
+    return self_in;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(region___enter___obj, region___enter__);
+
+STATIC mp_obj_t region___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_region_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (self->region == NULL || self->region != MP_STATE_THREAD(gc_region)) {
+        mp_raise_msg(&mp_type_RuntimeError, "region not innermost");
+    }
+    self->escaped = gc_region_exit(self->region);
+    self->region = NULL;
+    if (self->escaped && self->strict && args[1] == mp_const_none) {
+        mp_raise_msg(&mp_type_RuntimeError, "object escaped region");
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(region___exit___obj, 4, 4, region___exit__);
+
+STATIC mp_obj_t region_escaped(mp_obj_t self_in) {
+    mp_obj_region_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->escaped < 0) {
+        return mp_const_none;
+    }
+    return mp_obj_new_bool(self->escaped);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(region_escaped_obj, region_escaped);
+
+STATIC const mp_rom_map_elem_t region_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&region___enter___obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&region___exit___obj) },
+    { MP_ROM_QSTR(MP_QSTR_escaped), MP_ROM_PTR(&region_escaped_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(region_locals_dict, region_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_region = {
+    { &mp_type_type },
+    .name = MP_QSTR_region,
+    .make_new = region_make_new,
+    .locals_dict = (mp_obj_dict_t*)&region_locals_dict,
+};
+#endif
+
 #if MICROPY_ENABLE_PYSTACK
 STATIC mp_obj_t mp_micropython_pystack_use(void) {
     return MP_OBJ_NEW_SMALL_INT(mp_pystack_usage());
@@ -178,6 +285,19 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && (MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0)
     { MP_ROM_QSTR(MP_QSTR_alloc_emergency_exception_buf), MP_ROM_PTR(&mp_alloc_emergency_exception_buf_obj) },
 #endif
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_profile_start), MP_ROM_PTR(&mp_micropython_profile_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile_stop), MP_ROM_PTR(&mp_micropython_profile_stop_obj) },
+    #endif
+    #if MICROPY_PY_MICROPYTHON_HEAP_DUMP
+    { MP_ROM_QSTR(MP_QSTR_heap_dump), MP_ROM_PTR(&mp_micropython_heap_dump_obj) },
+    #endif
+    #if MICROPY_GC_REGIONS
+    { MP_ROM_QSTR(MP_QSTR_region), MP_ROM_PTR(&mp_type_region) },
+    #endif
+    #if MICROPY_PY_MICROPYTHON_STRBUILDER
+    { MP_ROM_QSTR(MP_QSTR_strbuilder), MP_ROM_PTR(&mp_type_strbuilder) },
+    #endif
     #if MICROPY_ENABLE_PYSTACK
     { MP_ROM_QSTR(MP_QSTR_pystack_use), MP_ROM_PTR(&mp_micropython_pystack_use_obj) },
     #endif
@@ -171,6 +171,14 @@ STATIC void *thread_entry(void *args_in) {
     mp_pystack_init(mini_pystack, &mini_pystack[128]);
     #endif
 
+    #if MICROPY_STACKLESS
+    ts.stackless_gen_depth = 0;
+    #endif
+
+    #if MICROPY_TRACK_FRAMES
+    ts.current_code_state = NULL;
+    #endif
+
     // set locals and globals from the calling context
     mp_locals_set(args->dict_locals);
     mp_globals_set(args->dict_globals);
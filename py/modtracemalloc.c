@@ -0,0 +1,297 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "py/gc.h"
+#include "py/bc.h"
+
+#if MICROPY_PY_UTRACEMALLOC
+
+// Number of allocation sites that can be recorded if start isn't given one
+#define TRACEMALLOC_DEFAULT_SITES (1024)
+
+// The GC records the site of each allocation by the ip of the instruction, so
+// there are usually several sites for each source line.  A snapshot totals
+// them up by line, into a dict that maps (filename, lineno, function) to a
+// tuple of (size, count).
+
+typedef struct _mp_obj_snapshot_t {
+    mp_obj_base_t base;
+    mp_obj_t traces;
+} mp_obj_snapshot_t;
+
+STATIC const mp_obj_type_t mp_type_snapshot;
+
+// Add size and count to the totals of key in the given map
+STATIC void snapshot_add(mp_map_t *map, mp_obj_t key, mp_int_t size, mp_int_t count) {
+    mp_map_elem_t *elem = mp_map_lookup(map, key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+    if (elem->value != MP_OBJ_NULL) {
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(elem->value, 2, &items);
+        size += MP_OBJ_SMALL_INT_VALUE(items[0]);
+        count += MP_OBJ_SMALL_INT_VALUE(items[1]);
+    }
+    mp_obj_t totals[2] = {MP_OBJ_NEW_SMALL_INT(size), MP_OBJ_NEW_SMALL_INT(count)};
+    elem->value = mp_obj_new_tuple(2, totals);
+}
+
+// Return the traces of the snapshot grouped by the given key type
+STATIC mp_map_t *snapshot_group(mp_obj_t self_in, mp_obj_t key_type) {
+    if (!MP_OBJ_IS_TYPE(self_in, &mp_type_snapshot)) {
+        mp_raise_TypeError(NULL);
+    }
+    mp_obj_snapshot_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_map_t *traces = mp_obj_dict_get_map(self->traces);
+    qstr key_qst = mp_obj_str_get_qstr(key_type);
+    if (key_qst == MP_QSTR_lineno) {
+        return traces;
+    }
+    if (key_qst != MP_QSTR_filename) {
+        mp_raise_ValueError("unknown key_type");
+    }
+    mp_map_t *by_file = mp_obj_dict_get_map(mp_obj_new_dict(0));
+    for (size_t i = 0; i < traces->alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(traces, i)) {
+            mp_obj_t *key, *totals;
+            mp_obj_get_array_fixed_n(traces->table[i].key, 3, &key);
+            mp_obj_get_array_fixed_n(traces->table[i].value, 2, &totals);
+            snapshot_add(by_file, mp_obj_new_tuple(1, key), MP_OBJ_SMALL_INT_VALUE(totals[0]),
+                MP_OBJ_SMALL_INT_VALUE(totals[1]));
+        }
+    }
+    return by_file;
+}
+
+// Sort the list in place, biggest first by the given key function
+STATIC void snapshot_sort(mp_obj_t list, const mp_obj_fun_builtin_fixed_t *key) {
+    mp_map_elem_t kw[2] = {
+        {MP_OBJ_NEW_QSTR(MP_QSTR_key), MP_OBJ_FROM_PTR(key)},
+        {MP_OBJ_NEW_QSTR(MP_QSTR_reverse), mp_const_true},
+    };
+    mp_map_t kw_map;
+    mp_map_init_fixed_table(&kw_map, 2, (mp_obj_t*)kw);
+    mp_obj_list_sort(1, &list, &kw_map);
+}
+
+STATIC mp_obj_t snapshot_stat_key(mp_obj_t stat) {
+    // (key, size, count) -> (size, count)
+    mp_obj_t *items;
+    mp_obj_get_array_fixed_n(stat, 3, &items);
+    return mp_obj_new_tuple(2, items + 1);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(snapshot_stat_key_obj, snapshot_stat_key);
+
+// statistics([key_type]): return a list of (key, size, count), biggest first
+STATIC mp_obj_t snapshot_statistics(size_t n_args, const mp_obj_t *args) {
+    mp_map_t *traces = snapshot_group(args[0], n_args > 1 ? args[1] : MP_OBJ_NEW_QSTR(MP_QSTR_lineno));
+    mp_obj_t stats = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < traces->alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(traces, i)) {
+            mp_obj_t *totals;
+            mp_obj_get_array_fixed_n(traces->table[i].value, 2, &totals);
+            mp_obj_t stat[3] = {traces->table[i].key, totals[0], totals[1]};
+            mp_obj_list_append(stats, mp_obj_new_tuple(3, stat));
+        }
+    }
+    snapshot_sort(stats, &snapshot_stat_key_obj);
+    return stats;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(snapshot_statistics_obj, 1, 2, snapshot_statistics);
+
+STATIC mp_obj_t small_int_abs(mp_obj_t o) {
+    mp_int_t val = MP_OBJ_SMALL_INT_VALUE(o);
+    return MP_OBJ_NEW_SMALL_INT(val < 0 ? -val : val);
+}
+
+STATIC mp_obj_t snapshot_diff_key(mp_obj_t diff) {
+    // (key, size, size_diff, count, count_diff) -> (|size_diff|, size, |count_diff|, count)
+    mp_obj_t *items;
+    mp_obj_get_array_fixed_n(diff, 5, &items);
+    mp_obj_t key[4] = {
+        small_int_abs(items[2]), items[1], small_int_abs(items[4]), items[3],
+    };
+    return mp_obj_new_tuple(4, key);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(snapshot_diff_key_obj, snapshot_diff_key);
+
+// Append (key, size, size_diff, count, count_diff) to the list of differences
+STATIC void snapshot_append_diff(mp_obj_t diffs, mp_obj_t key, mp_obj_t new_totals, mp_obj_t old_totals) {
+    mp_int_t size = 0, count = 0, old_size = 0, old_count = 0;
+    mp_obj_t *items;
+    if (new_totals != MP_OBJ_NULL) {
+        mp_obj_get_array_fixed_n(new_totals, 2, &items);
+        size = MP_OBJ_SMALL_INT_VALUE(items[0]);
+        count = MP_OBJ_SMALL_INT_VALUE(items[1]);
+    }
+    if (old_totals != MP_OBJ_NULL) {
+        mp_obj_get_array_fixed_n(old_totals, 2, &items);
+        old_size = MP_OBJ_SMALL_INT_VALUE(items[0]);
+        old_count = MP_OBJ_SMALL_INT_VALUE(items[1]);
+    }
+    mp_obj_t diff[5] = {
+        key,
+        MP_OBJ_NEW_SMALL_INT(size), MP_OBJ_NEW_SMALL_INT(size - old_size),
+        MP_OBJ_NEW_SMALL_INT(count), MP_OBJ_NEW_SMALL_INT(count - old_count),
+    };
+    mp_obj_list_append(diffs, mp_obj_new_tuple(5, diff));
+}
+
+// compare_to(old_snapshot, [key_type]): return a list of
+// (key, size, size_diff, count, count_diff), biggest difference first
+STATIC mp_obj_t snapshot_compare_to(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t key_type = n_args > 2 ? args[2] : MP_OBJ_NEW_QSTR(MP_QSTR_lineno);
+    mp_map_t *traces = snapshot_group(args[0], key_type);
+    mp_map_t *old_traces = snapshot_group(args[1], key_type);
+    mp_obj_t diffs = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < traces->alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(traces, i)) {
+            mp_map_elem_t *old = mp_map_lookup(old_traces, traces->table[i].key, MP_MAP_LOOKUP);
+            snapshot_append_diff(diffs, traces->table[i].key, traces->table[i].value,
+                old == NULL ? MP_OBJ_NULL : old->value);
+        }
+    }
+    for (size_t i = 0; i < old_traces->alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(old_traces, i)
+            && mp_map_lookup(traces, old_traces->table[i].key, MP_MAP_LOOKUP) == NULL) {
+            snapshot_append_diff(diffs, old_traces->table[i].key, MP_OBJ_NULL, old_traces->table[i].value);
+        }
+    }
+    snapshot_sort(diffs, &snapshot_diff_key_obj);
+    return diffs;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(snapshot_compare_to_obj, 2, 3, snapshot_compare_to);
+
+STATIC const mp_rom_map_elem_t snapshot_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_statistics), MP_ROM_PTR(&snapshot_statistics_obj) },
+    { MP_ROM_QSTR(MP_QSTR_compare_to), MP_ROM_PTR(&snapshot_compare_to_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(snapshot_locals_dict, snapshot_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_snapshot = {
+    { &mp_type_type },
+    .name = MP_QSTR_Snapshot,
+    .locals_dict = (mp_obj_dict_t*)&snapshot_locals_dict,
+};
+
+// start([nsites]): start tracing, recording up to nsites allocation sites
+STATIC mp_obj_t utracemalloc_start(size_t n_args, const mp_obj_t *args) {
+    mp_int_t n = n_args == 0 ? TRACEMALLOC_DEFAULT_SITES : mp_obj_get_int(args[0]);
+    if (n < 1 || n > 16384) {
+        mp_raise_ValueError(NULL);
+    }
+    if (MP_STATE_VM(trace_sites) != NULL) {
+        return mp_const_none;
+    }
+    // the table is kept at most 3/4 full, and it has an entry for no bytecode
+    size_t n_sites = 4;
+    while (n_sites / 4 * 3 < (size_t)n + 1) {
+        n_sites *= 2;
+    }
+    gc_trace_set_sites(m_new0(gc_trace_site_t, n_sites), n_sites);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(utracemalloc_start_obj, 0, 1, utracemalloc_start);
+
+// stop(): stop tracing and forget the sites of the blocks that were traced
+STATIC mp_obj_t utracemalloc_stop(void) {
+    gc_trace_site_t *sites = MP_STATE_VM(trace_sites);
+    if (sites != NULL) {
+        size_t n_sites = MP_STATE_VM(trace_sites_alloc);
+        gc_trace_set_sites(NULL, 0);
+        m_del(gc_trace_site_t, sites, n_sites);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(utracemalloc_stop_obj, utracemalloc_stop);
+
+STATIC mp_obj_t utracemalloc_is_tracing(void) {
+    return mp_obj_new_bool(MP_STATE_VM(trace_sites) != NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(utracemalloc_is_tracing_obj, utracemalloc_is_tracing);
+
+// take_snapshot(): return a Snapshot of the blocks allocated since tracing
+// started that are still live, by the line that allocated them
+STATIC mp_obj_t utracemalloc_take_snapshot(void) {
+    gc_trace_site_t *sites = MP_STATE_VM(trace_sites);
+    if (sites == NULL) {
+        mp_raise_msg(&mp_type_RuntimeError, "not tracing");
+    }
+    if (MP_STATE_VM(trace_n_dropped) != 0) {
+        mp_warning("too many allocation sites, %u allocations not traced", (uint)MP_STATE_VM(trace_n_dropped));
+    }
+    // only count the blocks that are live
+    gc_collect();
+    gc_trace_count();
+
+    mp_obj_snapshot_t *snapshot = m_new_obj(mp_obj_snapshot_t);
+    snapshot->base.type = &mp_type_snapshot;
+    snapshot->traces = mp_obj_new_dict(0);
+    mp_map_t *traces = mp_obj_dict_get_map(snapshot->traces);
+    // the blocks allocated from here on aren't counted, and sites are only
+    // ever added to the table, so it can be read while allocating
+    for (size_t i = 0; i < MP_STATE_VM(trace_sites_alloc); ++i) {
+        gc_trace_site_t *site = &sites[i];
+        if (site->n_allocs == 0) {
+            continue;
+        }
+        mp_obj_t key[3];
+        if (site->fun_bc == NULL) {
+            // allocated while no bytecode was running
+            key[0] = MP_OBJ_NEW_QSTR(MP_QSTR__lt_unknown_gt_);
+            key[1] = MP_OBJ_NEW_SMALL_INT(0);
+            key[2] = MP_OBJ_NEW_QSTR(MP_QSTR__lt_unknown_gt_);
+        } else {
+            const mp_obj_fun_bc_t *fun = site->fun_bc;
+            qstr block_name, source_file;
+            size_t line;
+            mp_bytecode_get_source_info(fun->bytecode, site->ip, &block_name, &source_file, &line);
+            key[0] = MP_OBJ_NEW_QSTR(source_file);
+            key[1] = MP_OBJ_NEW_SMALL_INT(line);
+            key[2] = MP_OBJ_NEW_QSTR(block_name);
+        }
+        snapshot_add(traces, mp_obj_new_tuple(3, key), site->n_blocks * MICROPY_BYTES_PER_GC_BLOCK, site->n_allocs);
+    }
+    return MP_OBJ_FROM_PTR(snapshot);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(utracemalloc_take_snapshot_obj, utracemalloc_take_snapshot);
+
+STATIC const mp_rom_map_elem_t mp_module_utracemalloc_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_utracemalloc) },
+    { MP_ROM_QSTR(MP_QSTR_start), MP_ROM_PTR(&utracemalloc_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&utracemalloc_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_is_tracing), MP_ROM_PTR(&utracemalloc_is_tracing_obj) },
+    { MP_ROM_QSTR(MP_QSTR_take_snapshot), MP_ROM_PTR(&utracemalloc_take_snapshot_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_utracemalloc_globals, mp_module_utracemalloc_globals_table);
+
+const mp_obj_module_t mp_module_utracemalloc = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&mp_module_utracemalloc_globals,
+};
+
+#endif // MICROPY_PY_UTRACEMALLOC
@@ -148,6 +148,90 @@
 #define MICROPY_GC_ALLOC_THRESHOLD (1)
 #endif
 
+// Whether the GC can run a collection incrementally, doing a bounded slice
+// of marking or sweeping on each allocation instead of stopping the world
+// when the heap is full.  Stores of heap pointers into existing objects then
+// go through gc_write_barrier().  Configurable at runtime by gc.incremental().
+#ifndef MICROPY_GC_INCREMENTAL
+#define MICROPY_GC_INCREMENTAL (0)
+#endif
+
+// Default number of heap blocks that an incremental GC slice may mark (and
+// 4 times this many that it may sweep); 0 disables incremental collection
+#ifndef MICROPY_GC_INCREMENTAL_BUDGET
+#define MICROPY_GC_INCREMENTAL_BUDGET (256)
+#endif
+
+// Whether small objects are allocated in a nursery at the end of the heap,
+// which a minor collection (only tracing and sweeping the nursery) reclaims
+// when it is full.  Survivors stay in place and are only reclaimed again by
+// a full collection.  Stores of heap pointers into existing objects then go
+// through gc_write_barrier().  Can't be used with MICROPY_GC_INCREMENTAL.
+#ifndef MICROPY_GC_GENERATIONAL
+#define MICROPY_GC_GENERATIONAL (0)
+#endif
+
+// The nursery is this fraction (1/N) of the heap
+#ifndef MICROPY_GC_NURSERY_FRACTION
+#define MICROPY_GC_NURSERY_FRACTION (8)
+#endif
+
+// Allocations of up to this many blocks are made in the nursery
+#ifndef MICROPY_GC_NURSERY_MAX_BLOCKS
+#define MICROPY_GC_NURSERY_MAX_BLOCKS (8)
+#endif
+
+// Whether gc_alloc keeps lists of the runs of free blocks that a collection
+// leaves, by length, so that small allocations can take one in O(1) time
+// instead of searching the allocation table for it
+#ifndef MICROPY_GC_FREE_LISTS
+#define MICROPY_GC_FREE_LISTS (0)
+#endif
+
+// Runs of up to this many free blocks have a list for each length, and longer
+// ones share a list
+#ifndef MICROPY_GC_FREE_LIST_MAX_BLOCKS
+#define MICROPY_GC_FREE_LIST_MAX_BLOCKS (8)
+#endif
+
+// Whether the heap can be made of several areas of memory, each with its own
+// tables, with more added by gc_add() after gc_init().  Can't be used with
+// MICROPY_GC_INCREMENTAL or MICROPY_GC_GENERATIONAL.
+#ifndef MICROPY_GC_SPLIT_HEAP
+#define MICROPY_GC_SPLIT_HEAP (0)
+#endif
+
+// Whether gc_alloc adds an area to the heap when an allocation fails even
+// after a collection, with memory got from the port's MP_PLAT_ALLOC_HEAP(size)
+#ifndef MICROPY_GC_SPLIT_HEAP_AUTO
+#define MICROPY_GC_SPLIT_HEAP_AUTO (0)
+#endif
+
+// Whether a collection can mark the heap with several threads at once, run by
+// the port's mp_thread_gc_parallel().  Needs MICROPY_PY_THREAD, and can't be
+// used with MICROPY_GC_INCREMENTAL or MICROPY_GC_GENERATIONAL.
+#ifndef MICROPY_GC_PARALLEL_MARK
+#define MICROPY_GC_PARALLEL_MARK (0)
+#endif
+
+// The most threads that may mark the heap at once
+#ifndef MICROPY_GC_PARALLEL_MARK_MAX_MARKERS
+#define MICROPY_GC_PARALLEL_MARK_MAX_MARKERS (8)
+#endif
+
+// Whether micropython.region() is available: young objects that are allocated
+// in a region are bump-allocated from a chunk of the heap, which is freed all
+// at once when the region ends unless any of them are still referenced.
+// Stores of heap pointers into existing objects then go through
+// gc_write_barrier().  Can't be used with MICROPY_GC_INCREMENTAL or
+// MICROPY_GC_GENERATIONAL.
+#ifndef MICROPY_GC_REGIONS
+#define MICROPY_GC_REGIONS (0)
+#endif
+
+// Whether the GC keeps a table of blocks that were stored to (internal)
+#define MICROPY_GC_DIRTY_TABLE (MICROPY_GC_INCREMENTAL || MICROPY_GC_GENERATIONAL || MICROPY_GC_REGIONS)
+
 // Number of bytes to allocate initially when creating new chunks to store
 // interned string data.  Smaller numbers lead to more chunks being needed
 // and more wastage at the end of the chunk.  Larger numbers lead to wasted
@@ -236,12 +320,30 @@
 #define MICROPY_QSTR_BYTES_IN_HASH (2)
 #endif
 
-// Avoid using C stack when making Python function calls. C stack still
-// may be used if there's no free heap.
+// Whether to look up qstrs by their data using hash indices, instead of a
+// linear search of all qstr pools.  The index of the const pool is generated
+// at build time and stored in ROM, and the index of the remaining qstrs is
+// stored on the heap and grows as qstrs are added.
+#ifndef MICROPY_QSTR_HASH_INDEX
+#define MICROPY_QSTR_HASH_INDEX (0)
+#endif
+
+// Avoid using C stack when making Python function calls. This covers calls
+// from bytecode to bytecode functions, closures, bound methods and classes
+// with a Python __init__, and generators resumed by for loops. Frames come
+// from the pystack if MICROPY_ENABLE_PYSTACK is enabled, otherwise from the
+// heap, and C stack still may be used if there's no free heap.
 #ifndef MICROPY_STACKLESS
 #define MICROPY_STACKLESS (0)
 #endif
 
+// Maximum number of generators that the VM will resume in-line at once when
+// stackless; nested generators beyond this are resumed recursively, which
+// bounds the heap they can use through runaway recursion.
+#ifndef MICROPY_STACKLESS_MAX_GEN_DEPTH
+#define MICROPY_STACKLESS_MAX_GEN_DEPTH (32)
+#endif
+
 // Never use C stack when making Python function calls. This may break
 // testsuite as will subtly change which exception is thrown in case
 // of too deep recursion and other similar cases.
@@ -432,6 +534,132 @@
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
 #endif
 
+// Whether to keep a small global cache of the position at which each key was
+// last found in a map.  This mostly helps lookups in the fixed, ordered maps
+// used for locals_dict and module globals tables, which would otherwise need a
+// linear search.  Uses MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE bytes of RAM.
+#ifndef MICROPY_OPT_MAP_LOOKUP_CACHE
+#define MICROPY_OPT_MAP_LOOKUP_CACHE (0)
+#endif
+
+#ifndef MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE
+#define MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE (128)
+#endif
+
+// Whether hash-table maps (dicts, instance members, module globals) use a
+// compact layout: a dense array of entries kept in insertion order, followed
+// in the same allocation by a small index of 8, 16 or 32-bit entry numbers
+// that is probed by hash.  Maps of up to 12 entries have no index and are
+// searched linearly.  This makes dicts insertion ordered (so OrderedDict is
+// just a dict) and speeds up iteration and dict.copy().
+#ifndef MICROPY_MAP_COMPACT
+#define MICROPY_MAP_COMPACT (0)
+#endif
+
+// Whether list.sort() and sorted() use a stable merge sort that finds runs
+// already in the data and calls the key function once per item, instead of
+// quicksort.  Needs a temporary buffer of half the length of the list, plus
+// one of twice the length when a key function is given.
+#ifndef MICROPY_OPT_STABLE_SORT
+#define MICROPY_OPT_STABLE_SORT (0)
+#endif
+
+// Whether the substring search used by str and bytes find(), count(),
+// replace(), split(), partition() and "in" uses memchr() for the first byte of
+// the needle, and Boyer-Moore-Horspool for long haystacks, instead of
+// comparing the needle at each position in turn.  Uses 256 bytes of C stack.
+#ifndef MICROPY_OPT_FIND_SUBBYTES
+#define MICROPY_OPT_FIND_SUBBYTES (0)
+#endif
+
+// Whether "s += x" with str or bytes s copies the data into a buffer with
+// spare space, which later "+=" append to in place as long as nothing else has
+// been appended to it after s, and whether io.StringIO.getvalue() hands its
+// buffer to the result instead of copying it.  The buffers are found through a
+// small cache in MP_STATE_VM, and have up to 50% spare space.
+#ifndef MICROPY_OPT_STR_BUILDER
+#define MICROPY_OPT_STR_BUILDER (0)
+#endif
+
+// Number of buffers that the cache above holds
+#ifndef MICROPY_OPT_STR_BUILDER_CACHE_SIZE
+#define MICROPY_OPT_STR_BUILDER_CACHE_SIZE (4)
+#endif
+
+// Whether to cache the result of looking up attributes and methods in the
+// class of an instance, for each LOAD_ATTR and LOAD_METHOD bytecode.  The
+// cache is a global table indexed by the address of the opcode, with
+// MICROPY_OPT_ATTR_INLINE_CACHE_SIZE sets of 2 entries each, and entries are
+// invalidated when any class dict changes layout or a new class is created.
+#ifndef MICROPY_OPT_ATTR_INLINE_CACHE
+#define MICROPY_OPT_ATTR_INLINE_CACHE (0)
+#endif
+
+#ifndef MICROPY_OPT_ATTR_INLINE_CACHE_SIZE
+#define MICROPY_OPT_ATTR_INLINE_CACHE_SIZE (128)
+#endif
+
+// Whether to store a linearised MRO with each class, and keep a global cache
+// of the results of looking up attributes in classes (including special
+// methods used by operators), indexed by class and attribute name.  Uses
+// MICROPY_OPT_CLASS_LOOKUP_CACHE_SIZE entries of 5 words each.
+#ifndef MICROPY_OPT_CLASS_LOOKUP_CACHE
+#define MICROPY_OPT_CLASS_LOOKUP_CACHE (0)
+#endif
+
+#ifndef MICROPY_OPT_CLASS_LOOKUP_CACHE_SIZE
+#define MICROPY_OPT_CLASS_LOOKUP_CACHE_SIZE (64)
+#endif
+
+// Whether to cache the result of looking up a name in the globals and
+// builtins, for each LOAD_GLOBAL and LOAD_NAME bytecode.  The cache is a
+// global table indexed by the address of the opcode, with entries of 4 words
+// each, and entries are invalidated when any module dict changes layout.
+// Only module dicts are tracked, so code run by exec() with a custom globals
+// dict doesn't use the cache.
+#ifndef MICROPY_OPT_LOAD_GLOBAL_CACHE
+#define MICROPY_OPT_LOAD_GLOBAL_CACHE (0)
+#endif
+
+#ifndef MICROPY_OPT_LOAD_GLOBAL_CACHE_SIZE
+#define MICROPY_OPT_LOAD_GLOBAL_CACHE_SIZE (64)
+#endif
+
+// Whether maps can be marked as versioned (needed by the caches above)
+#define MICROPY_MAP_VERSION (MICROPY_OPT_ATTR_INLINE_CACHE || MICROPY_OPT_CLASS_LOOKUP_CACHE || MICROPY_OPT_LOAD_GLOBAL_CACHE)
+
+// Whether the bytecode emitter fuses common sequences of opcodes into single
+// superinstructions: LOAD_FAST a; LOAD_FAST b; BINARY_OP op and LOAD_FAST a;
+// LOAD_CONST_SMALL_INT k; BINARY_OP op, optionally followed by STORE_FAST a.
+// A VM with this option can run bytecode compiled without it, but not the
+// other way around, and .mpy files record which form they use.
+#ifndef MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+#define MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS (0)
+#endif
+
+// Whether binary operations are emitted in a form that the VM rewrites at
+// runtime ("quickens") to opcodes specialised for small int or float operands,
+// once it has seen the operand types at that site.  Binary ops take one more
+// byte of bytecode, and the bytecode must be in RAM (it is when compiled or
+// loaded from a .mpy file at runtime).
+#ifndef MICROPY_OPT_BYTECODE_QUICKENING
+#define MICROPY_OPT_BYTECODE_QUICKENING (0)
+#endif
+
+// Whether FOR_ITER steps the iterators of range, list, tuple, bytes and
+// bytearray objects directly, when they live in the iterator buffer on the
+// value stack, instead of calling their iternext slot.
+#ifndef MICROPY_OPT_FOR_ITER_INLINE
+#define MICROPY_OPT_FOR_ITER_INLINE (0)
+#endif
+
+// Whether the GC reads its allocation table a machine word at a time, instead
+// of a byte, where it can: to skip over blocks that are all free or all in use
+// when looking for free ones, and to sweep blocks that aren't freed.
+#ifndef MICROPY_OPT_GC_ATB_WORDS
+#define MICROPY_OPT_GC_ATB_WORDS (0)
+#endif
+
 // Whether to use fast versions of bitwise operations (and, or, xor) when the
 // arguments are both positive.  Increases Thumb2 code size by about 250 bytes.
 #ifndef MICROPY_OPT_MPZ_BITWISE
@@ -796,6 +1024,19 @@ typedef double mp_float_t;
 #define MICROPY_PY_BUILTINS_STR_UNICODE_CHECK (MICROPY_PY_BUILTINS_STR_UNICODE)
 #endif
 
+// Whether to cache, for a few long str objects, their length in characters
+// and the byte offset of every 32nd character (nothing if they are ASCII), so
+// that indexing and slicing don't need to scan the UTF-8 data from the start.
+// The offsets take up to 1/8 of the length of the str in bytes.
+#ifndef MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+#define MICROPY_PY_BUILTINS_STR_UNICODE_INDEX (0)
+#endif
+
+// Number of str objects that the cache above holds
+#ifndef MICROPY_PY_BUILTINS_STR_UNICODE_INDEX_CACHE_SIZE
+#define MICROPY_PY_BUILTINS_STR_UNICODE_INDEX_CACHE_SIZE (4)
+#endif
+
 // Whether str.center() method provided
 #ifndef MICROPY_PY_BUILTINS_STR_CENTER
 #define MICROPY_PY_BUILTINS_STR_CENTER (0)
@@ -991,6 +1232,38 @@ typedef double mp_float_t;
 #define MICROPY_PY_MICROPYTHON_STACK_USE (MICROPY_PY_MICROPYTHON_MEM_INFO)
 #endif
 
+// Whether to provide "micropython.profile_start" and "micropython.profile_stop",
+// a sampling profiler for bytecode that produces collapsed stacks for flame
+// graphs.  The VM then tracks the running frames of each thread, and the port
+// must provide mp_hal_profile_timer_start/stop to call mp_prof_sample().
+#ifndef MICROPY_PY_MICROPYTHON_PROFILE
+#define MICROPY_PY_MICROPYTHON_PROFILE (0)
+#endif
+
+// Whether to provide "micropython.heap_dump", which writes the heap, its
+// allocation table and the roots to a stream for tools/heapdump.py to analyse
+#ifndef MICROPY_PY_MICROPYTHON_HEAP_DUMP
+#define MICROPY_PY_MICROPYTHON_HEAP_DUMP (0)
+#endif
+
+// Whether to provide "micropython.strbuilder", a mutable str with append,
+// append_int and append_fmt methods that is turned into a str without a copy
+#ifndef MICROPY_PY_MICROPYTHON_STRBUILDER
+#define MICROPY_PY_MICROPYTHON_STRBUILDER (0)
+#endif
+
+// Whether to provide the "utracemalloc" module, which records the bytecode
+// instruction that allocated each block of the heap while it is tracing, and
+// sums up the allocated blocks by source line in snapshots.  The VM then
+// tracks the running frames of each thread, and the GC keeps a 16-bit site
+// number for each block.
+#ifndef MICROPY_PY_UTRACEMALLOC
+#define MICROPY_PY_UTRACEMALLOC (0)
+#endif
+
+// Whether the VM keeps track of the running frame of each thread (internal)
+#define MICROPY_TRACK_FRAMES (MICROPY_PY_MICROPYTHON_PROFILE || MICROPY_PY_UTRACEMALLOC)
+
 // Whether to provide "array" module. Note that large chunk of the
 // underlying code is shared with "bytearray" builtin type, so to
 // get real savings, it should be disabled too.
@@ -70,6 +70,16 @@ mp_uint_t mp_hal_ticks_us(void);
 mp_uint_t mp_hal_ticks_cpu(void);
 #endif
 
+#if MICROPY_PY_MICROPYTHON_PROFILE
+// Call mp_prof_sample() every interval_us of CPU time, until stopped
+#ifndef mp_hal_profile_timer_start
+void mp_hal_profile_timer_start(mp_uint_t interval_us);
+#endif
+#ifndef mp_hal_profile_timer_stop
+void mp_hal_profile_timer_stop(void);
+#endif
+#endif
+
 // If port HAL didn't define its own pin API, use generic
 // "virtual pin" API from the core.
 #ifndef mp_hal_pin_obj_t
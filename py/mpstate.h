@@ -35,6 +35,7 @@
 #include "py/obj.h"
 #include "py/objlist.h"
 #include "py/objexcept.h"
+#include "py/objtype.h"
 
 // This file contains structures defining the state of the MicroPython
 // memory system, runtime and virtual machine.  The state is a global
@@ -60,37 +61,157 @@ typedef struct _mp_sched_item_t {
     mp_obj_t arg;
 } mp_sched_item_t;
 
-// This structure hold information about the memory allocation system.
-typedef struct _mp_state_mem_t {
-    #if MICROPY_MEM_STATS
-    size_t total_bytes_allocated;
-    size_t current_bytes_allocated;
-    size_t peak_bytes_allocated;
+#if MICROPY_OPT_LOAD_GLOBAL_CACHE
+// The element found by looking up qst in the given globals dict (which may be
+// in the builtins instead), valid while the map version is unchanged
+typedef struct _mp_global_cache_entry_t {
+    const mp_obj_dict_t *globals;
+    qstr qst;
+    mp_uint_t version;
+    mp_map_elem_t *elem;
+} mp_global_cache_entry_t;
+#endif
+
+#if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+// The length in characters of the str with the given data, and the byte offset
+// of every 32nd character, or NULL if all characters are ASCII
+typedef struct _mp_str_index_cache_entry_t {
+    const byte *data;
+    size_t len;
+    size_t n_chars;
+    uint32_t *offsets;
+} mp_str_index_cache_entry_t;
+#endif
+
+#if MICROPY_OPT_STR_BUILDER
+// A buffer that "s += x" appends to in place: the first used bytes are the
+// data of the str/bytes objects made by the appends so far, then a null byte
+// and the free space
+typedef struct _mp_str_builder_cache_entry_t {
+    byte *buf;
+    size_t used;
+    size_t alloc;
+} mp_str_builder_cache_entry_t;
+#endif
+
+// This structure holds the tables and the pool of blocks of an area of memory
+// that makes up (part of) the GC heap.
+typedef struct _mp_state_mem_area_t {
+    #if MICROPY_GC_SPLIT_HEAP
+    struct _mp_state_mem_area_t *next;
     #endif
 
     byte *gc_alloc_table_start;
     size_t gc_alloc_table_byte_len;
+    #if MICROPY_PY_UTRACEMALLOC
+    uint16_t *gc_site_table_start;
+    #endif
     #if MICROPY_ENABLE_FINALISER
     byte *gc_finaliser_table_start;
     #endif
+    #if MICROPY_GC_DIRTY_TABLE
+    byte *gc_dirty_table_start;
+    #endif
     byte *gc_pool_start;
     byte *gc_pool_end;
 
+    size_t gc_last_free_atb_index;
+} mp_state_mem_area_t;
+
+// This structure hold information about the memory allocation system.
+typedef struct _mp_state_mem_t {
+    #if MICROPY_MEM_STATS
+    size_t total_bytes_allocated;
+    size_t current_bytes_allocated;
+    size_t peak_bytes_allocated;
+    #endif
+
+    // The first area of the heap, and the head of the list of them
+    mp_state_mem_area_t area;
+
     int gc_stack_overflow;
     MICROPY_GC_STACK_ENTRY_TYPE gc_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    size_t gc_sp;
+    size_t gc_rescan_block;
+    #if MICROPY_GC_SPLIT_HEAP
+    // The area of each block on the gc stack, and of gc_rescan_block, and
+    // the bounds of the memory that all the pools are in
+    mp_state_mem_area_t *gc_area_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    mp_state_mem_area_t *gc_rescan_area;
+    byte *gc_lowest_pool_start;
+    byte *gc_highest_pool_end;
+    #endif
+    #if MICROPY_GC_PARALLEL_MARK
+    // The number of threads that mark the heap, and while they do, how many
+    // of them are waiting for work and whether they're done
+    size_t gc_markers;
+    size_t gc_par_idle;
+    bool gc_par_done;
+    mp_thread_mutex_t gc_par_mutex;
+    #endif
     uint16_t gc_lock_depth;
 
+    // The number of blocks that are allocated, kept up to date as they are
+    // allocated and freed
+    size_t gc_used_blocks;
+
+    #if MICROPY_GC_INCREMENTAL
+    // State of an incremental collection that is in progress: the phase it
+    // is in, whether gc_collect() is being called to finish its marking, and
+    // the position that the sweep has got to.
+    uint8_t gc_phase;
+    uint8_t gc_inc_finishing;
+    size_t gc_sweep_block;
+    size_t gc_sweep_n_free;
+    // Number of blocks that an incremental slice may process (0 to disable),
+    // and the number of blocks left to allocate before the next cycle starts
+    size_t gc_inc_budget;
+    size_t gc_inc_countdown;
+    // Number of slices that the collection in progress and the last finished
+    // one have been done in
+    size_t gc_inc_slices;
+    size_t gc_inc_last_slices;
+    #endif
+
+    #if MICROPY_GC_GENERATIONAL
+    // The first block of the nursery, the block to look for free space in it
+    // from, the number of free blocks in it after the last collection and the
+    // number allocated since, and whether gc_collect() should do a minor
+    // collection.
+    size_t gc_nursery_block;
+    size_t gc_nursery_free_block;
+    size_t gc_nursery_n_free;
+    size_t gc_nursery_n_alloc;
+    uint8_t gc_minor;
+    #endif
+
     // This variable controls auto garbage collection.  If set to 0 then the
     // GC won't automatically run when gc_alloc can't find enough blocks.  But
     // you can still allocate/free memory and also explicitly call gc_collect.
     uint16_t gc_auto_collect_enabled;
 
+    #if MICROPY_GC_REGIONS
+    // The regions that are active in any thread, linked by their next field
+    struct _gc_region_t *gc_regions;
+    #endif
+
     #if MICROPY_GC_ALLOC_THRESHOLD
     size_t gc_alloc_amount;
     size_t gc_alloc_threshold;
     #endif
 
-    size_t gc_last_free_atb_index;
+    #if MICROPY_GC_FREE_LISTS
+    // Heads of the lists of free runs of 1 to N blocks, and of longer runs,
+    // linked through the first block of each run, and a bit for each list
+    // that may not be empty.  While the lists are being made again after a
+    // sweep, their last runs and the block that they have been made up to.
+    void *gc_free_list[MICROPY_GC_FREE_LIST_MAX_BLOCKS + 1];
+    void *gc_free_list_tail[MICROPY_GC_FREE_LIST_MAX_BLOCKS + 1];
+    size_t gc_free_list_block;
+    uint32_t gc_free_list_mask;
+    // The longest run put on the free lists since they were last made
+    size_t gc_free_list_max_run;
+    #endif
 
     #if MICROPY_PY_GC_COLLECT_RETVAL
     size_t gc_collected;
@@ -114,6 +235,11 @@ typedef struct _mp_state_vm_t {
 
     qstr_pool_t *last_pool;
 
+    #if MICROPY_QSTR_HASH_INDEX
+    // hash index of qstrs that are not in mp_qstr_const_pool
+    qstr *qstr_index;
+    #endif
+
     // non-heap memory for creating an exception if we can't allocate RAM
     mp_obj_exception_t mp_emergency_exception_obj;
 
@@ -182,6 +308,17 @@ typedef struct _mp_state_vm_t {
     struct _mp_vfs_mount_t *vfs_mount_table;
     #endif
 
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    // samples taken by the profiler, this keeps the functions they refer to alive
+    mp_uint_t *prof_buf;
+    #endif
+
+    #if MICROPY_PY_UTRACEMALLOC
+    // the sites that allocated blocks while tracemalloc is tracing, a hash
+    // table keyed by ip; this keeps the functions they are in alive
+    struct _gc_trace_site_t *trace_sites;
+    #endif
+
     //
     // END ROOT POINTER SECTION
     ////////////////////////////////////////////////////////////
@@ -192,6 +329,11 @@ typedef struct _mp_state_vm_t {
     size_t qstr_last_alloc;
     size_t qstr_last_used;
 
+    #if MICROPY_QSTR_HASH_INDEX
+    size_t qstr_index_alloc;
+    size_t qstr_index_top;
+    #endif
+
     #if MICROPY_PY_THREAD
     // This is a global mutex used to make qstr interning thread-safe.
     mp_thread_mutex_t qstr_mutex;
@@ -201,6 +343,58 @@ typedef struct _mp_state_vm_t {
     mp_uint_t mp_optimise_value;
     #endif
 
+    #if MICROPY_OPT_MAP_LOOKUP_CACHE
+    // See mp_map_lookup.
+    uint8_t map_lookup_cache[MICROPY_OPT_MAP_LOOKUP_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_MAP_VERSION
+    // incremented whenever a versioned map changes its layout
+    mp_uint_t map_version;
+    #endif
+
+    #if MICROPY_OPT_ATTR_INLINE_CACHE
+    // not scanned by the GC: an entry is only used while map_version is unchanged,
+    // and while that's true the class and dict it points into must still be alive
+    mp_attr_cache_entry_t attr_cache[MICROPY_OPT_ATTR_INLINE_CACHE_SIZE][MP_ATTR_CACHE_WAYS];
+    #endif
+
+    #if MICROPY_OPT_CLASS_LOOKUP_CACHE
+    // not scanned by the GC, for the same reason as attr_cache
+    mp_class_lookup_cache_entry_t class_lookup_cache[MICROPY_OPT_CLASS_LOOKUP_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_OPT_LOAD_GLOBAL_CACHE
+    // not scanned by the GC, for the same reason as attr_cache
+    mp_global_cache_entry_t global_cache[MICROPY_OPT_LOAD_GLOBAL_CACHE_SIZE];
+    #endif
+
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    // not scanned by the GC, and cleared before each sweep so that neither the
+    // offsets nor the str data they describe can be freed and reused under it
+    mp_str_index_cache_entry_t str_index_cache[MICROPY_PY_BUILTINS_STR_UNICODE_INDEX_CACHE_SIZE];
+    size_t str_index_cache_next;
+    #endif
+
+    #if MICROPY_OPT_STR_BUILDER
+    // not scanned by the GC, and cleared like str_index_cache
+    mp_str_builder_cache_entry_t str_builder_cache[MICROPY_OPT_STR_BUILDER_CACHE_SIZE];
+    size_t str_builder_cache_next;
+    #endif
+
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    size_t prof_buf_alloc;
+    size_t prof_buf_len;
+    size_t prof_last; // index of the most recent sample, to merge repeats into
+    size_t prof_n_dropped;
+    #endif
+
+    #if MICROPY_PY_UTRACEMALLOC
+    size_t trace_sites_alloc;
+    size_t trace_sites_used;
+    size_t trace_n_dropped; // allocations not recorded because trace_sites was full
+    #endif
+
     // size of the emergency exception buf, if it's dynamically allocated
     #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0
     mp_int_t mp_emergency_exception_buf_size;
@@ -233,6 +427,16 @@ typedef struct _mp_state_thread_t {
     uint8_t *pystack_cur;
     #endif
 
+    #if MICROPY_STACKLESS
+    // number of generators currently resumed in-line by the VM
+    size_t stackless_gen_depth;
+    #endif
+
+    #if MICROPY_TRACK_FRAMES
+    // the frame being run by the VM, the head of a chain linked by prev_state
+    struct _mp_code_state_t *current_code_state;
+    #endif
+
     ////////////////////////////////////////////////////////////
     // START ROOT POINTER SECTION
     // Everything that needs GC scanning must start here, and
@@ -242,6 +446,11 @@ typedef struct _mp_state_thread_t {
     mp_obj_dict_t *dict_locals;
     mp_obj_dict_t *dict_globals;
 
+    #if MICROPY_GC_REGIONS
+    // the innermost region that this thread is in, which links to the others
+    struct _gc_region_t *gc_region;
+    #endif
+
     nlr_buf_t *nlr_top;
 } mp_state_thread_t;
 
@@ -47,6 +47,16 @@ void mp_thread_mutex_init(mp_thread_mutex_t *mutex);
 int mp_thread_mutex_lock(mp_thread_mutex_t *mutex, int wait);
 void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex);
 
+#if MICROPY_GC_PARALLEL_MARK
+// Run worker(id, n) on n threads of its own, with id from 0 to n - 1 and n
+// no more than max_n, and return n once they've all returned, or 0 if no
+// threads could be run.  Used by the GC to mark the heap.
+size_t mp_thread_gc_parallel(void (*worker)(size_t id, size_t n), size_t max_n);
+// Called over and over by a marker that is waiting for work, with the number
+// of times it has been called in this wait so that it can back off
+void mp_thread_gc_parallel_idle(size_t n_waits);
+#endif
+
 #endif // MICROPY_PY_THREAD
 
 #if MICROPY_PY_THREAD && MICROPY_PY_THREAD_GIL
@@ -74,7 +74,7 @@ NORETURN void nlr_jump(void *val) {
     "ret.n                      \n" // return
     :                               // output operands
     : "r"(top)                      // input operands
-    :                               // clobbered registers
+    : "memory"                      // clobbered registers
     );
 
     for (;;); // needed to silence compiler warning
@@ -49,4 +49,13 @@ typedef struct _mp_obj_array_t {
     void *items;
 } mp_obj_array_t;
 
+typedef struct _mp_obj_array_it_t {
+    mp_obj_base_t base;
+    mp_obj_array_t *array;
+    size_t offset;
+    size_t cur;
+} mp_obj_array_it_t;
+
+extern const mp_obj_type_t mp_type_array_it;
+
 #endif // MICROPY_INCLUDED_PY_OBJARRAY_H
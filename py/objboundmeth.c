@@ -28,6 +28,7 @@
 
 #include "py/obj.h"
 #include "py/runtime.h"
+#include "py/bc.h"
 
 typedef struct _mp_obj_bound_meth_t {
     mp_obj_base_t base;
@@ -78,6 +79,13 @@ mp_obj_t mp_call_method_self_n_kw(mp_obj_t meth, mp_obj_t self, size_t n_args, s
     return res;
 }
 
+#if MICROPY_STACKLESS
+mp_code_state_t *mp_obj_bound_meth_prepare_codestate(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_obj_bound_meth_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_fun_prepare_codestate_self(self->meth, self->self, n_args, n_kw, args);
+}
+#endif
+
 STATIC mp_obj_t bound_meth_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_obj_bound_meth_t *self = MP_OBJ_TO_PTR(self_in);
     return mp_call_method_self_n_kw(self->meth, self->self, n_args, n_kw, args);
@@ -95,7 +103,7 @@ STATIC void bound_meth_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
 }
 #endif
 
-STATIC const mp_obj_type_t mp_type_bound_meth = {
+const mp_obj_type_t mp_type_bound_meth = {
     { &mp_type_type },
     .name = MP_QSTR_bound_method,
 #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_DETAILED
@@ -108,7 +116,7 @@ STATIC const mp_obj_type_t mp_type_bound_meth = {
 };
 
 mp_obj_t mp_obj_new_bound_meth(mp_obj_t meth, mp_obj_t self) {
-    mp_obj_bound_meth_t *o = m_new_obj(mp_obj_bound_meth_t);
+    mp_obj_bound_meth_t *o = m_new_obj_young(mp_obj_bound_meth_t);
     o->base.type = &mp_type_bound_meth;
     o->meth = meth;
     o->self = self;
@@ -24,7 +24,8 @@
  * THE SOFTWARE.
  */
 
-#include "py/obj.h"
+#include "py/mpstate.h"
+#include "py/gc.h"
 
 typedef struct _mp_obj_cell_t {
     mp_obj_base_t base;
@@ -39,6 +40,7 @@ mp_obj_t mp_obj_cell_get(mp_obj_t self_in) {
 void mp_obj_cell_set(mp_obj_t self_in, mp_obj_t obj) {
     mp_obj_cell_t *self = MP_OBJ_TO_PTR(self_in);
     self->obj = obj;
+    gc_write_barrier(self);
 }
 
 #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_DETAILED
@@ -28,6 +28,7 @@
 
 #include "py/obj.h"
 #include "py/runtime.h"
+#include "py/bc.h"
 
 typedef struct _mp_obj_closure_t {
     mp_obj_base_t base;
@@ -59,6 +60,29 @@ STATIC mp_obj_t closure_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const
     }
 }
 
+#if MICROPY_STACKLESS
+// Prepare a code state to run the closure in-line in the VM, with self_arg
+// (if not MP_OBJ_NULL) passed after the closed-over values.  Returns NULL if
+// the underlying function is not bytecode.
+mp_code_state_t *mp_obj_closure_prepare_codestate(mp_obj_t self_in, mp_obj_t self_arg, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_obj_closure_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!MP_OBJ_IS_TYPE(self->fun, &mp_type_fun_bc)) {
+        return NULL;
+    }
+
+    // need to concatenate closed-over-vars, self and args; the new code state
+    // takes a copy so the temporary array can live on the C stack
+    size_t n_pre = self->n_closed + (self_arg != MP_OBJ_NULL);
+    mp_obj_t *args2 = alloca(sizeof(mp_obj_t) * (n_pre + n_args + 2 * n_kw));
+    memcpy(args2, self->closed, self->n_closed * sizeof(mp_obj_t));
+    if (self_arg != MP_OBJ_NULL) {
+        args2[self->n_closed] = self_arg;
+    }
+    memcpy(args2 + n_pre, args, (n_args + 2 * n_kw) * sizeof(mp_obj_t));
+    return mp_obj_fun_bc_prepare_codestate(self->fun, n_pre + n_args, n_kw, args2);
+}
+#endif
+
 #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_DETAILED
 STATIC void closure_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t kind) {
     (void)kind;
@@ -78,7 +102,7 @@ STATIC void closure_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_
 }
 #endif
 
-const mp_obj_type_t closure_type = {
+const mp_obj_type_t mp_type_closure = {
     { &mp_type_type },
     .name = MP_QSTR_closure,
 #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_DETAILED
@@ -89,7 +113,7 @@ const mp_obj_type_t closure_type = {
 
 mp_obj_t mp_obj_new_closure(mp_obj_t fun, size_t n_closed_over, const mp_obj_t *closed) {
     mp_obj_closure_t *o = m_new_obj_var(mp_obj_closure_t, mp_obj_t, n_closed_over);
-    o->base.type = &closure_type;
+    o->base.type = &mp_type_closure;
     o->fun = fun;
     o->n_closed = n_closed_over;
     memcpy(o->closed, closed, n_closed_over * sizeof(mp_obj_t));
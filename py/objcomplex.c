@@ -156,7 +156,7 @@ const mp_obj_type_t mp_type_complex = {
 };
 
 mp_obj_t mp_obj_new_complex(mp_float_t real, mp_float_t imag) {
-    mp_obj_complex_t *o = m_new_obj(mp_obj_complex_t);
+    mp_obj_complex_t *o = m_new_obj_young(mp_obj_complex_t);
     o->base.type = &mp_type_complex;
     o->real = real;
     o->imag = imag;
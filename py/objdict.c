@@ -39,8 +39,8 @@ STATIC mp_obj_t dict_update(size_t n_args, const mp_obj_t *args, mp_map_t *kwarg
 // the iteration is held in *cur and should be initialised with zero for the
 // first call.  Will return NULL when no more elements are available.
 STATIC mp_map_elem_t *dict_iter_next(mp_obj_dict_t *dict, size_t *cur) {
-    size_t max = dict->map.alloc;
     mp_map_t *map = &dict->map;
+    size_t max = mp_map_top(map);
 
     for (size_t i = *cur; i < max; i++) {
         if (MP_MAP_SLOT_IS_FILLED(map, i)) {
@@ -83,7 +83,8 @@ STATIC mp_obj_t dict_make_new(const mp_obj_type_t *type, size_t n_args, size_t n
     mp_obj_t dict_out = mp_obj_new_dict(0);
     mp_obj_dict_t *dict = MP_OBJ_TO_PTR(dict_out);
     dict->base.type = type;
-    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+    #if MICROPY_PY_COLLECTIONS_ORDEREDDICT && !MICROPY_MAP_COMPACT
+    // compact maps keep insertion order, otherwise use an ordered array
     if (type == &mp_type_ordereddict) {
         dict->map.is_ordered = 1;
     }
@@ -104,7 +105,7 @@ STATIC mp_obj_t dict_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
         case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(self->map.used);
         #if MICROPY_PY_SYS_GETSIZEOF
         case MP_UNARY_OP_SIZEOF: {
-            size_t sz = sizeof(*self) + sizeof(*self->map.table) * self->map.alloc;
+            size_t sz = sizeof(*self) + mp_map_table_bytes(&self->map);
             return MP_OBJ_NEW_SMALL_INT(sz);
         }
         #endif
@@ -215,15 +216,10 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_clear_obj, dict_clear);
 STATIC mp_obj_t dict_copy(mp_obj_t self_in) {
     mp_check_self(MP_OBJ_IS_DICT_TYPE(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_obj_t other_out = mp_obj_new_dict(self->map.alloc);
-    mp_obj_dict_t *other = MP_OBJ_TO_PTR(other_out);
+    mp_obj_dict_t *other = m_new_obj(mp_obj_dict_t);
     other->base.type = self->base.type;
-    other->map.used = self->map.used;
-    other->map.all_keys_are_qstrs = self->map.all_keys_are_qstrs;
-    other->map.is_fixed = 0;
-    other->map.is_ordered = self->map.is_ordered;
-    memcpy(other->map.table, self->map.table, self->map.alloc * sizeof(mp_map_elem_t));
-    return other_out;
+    mp_map_init_copy(&other->map, &self->map);
+    return MP_OBJ_FROM_PTR(other);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_copy_obj, dict_copy);
 
@@ -308,18 +304,18 @@ STATIC mp_obj_t dict_popitem(mp_obj_t self_in) {
     mp_check_self(MP_OBJ_IS_DICT_TYPE(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
     mp_ensure_not_fixed(self);
-    size_t cur = 0;
-    mp_map_elem_t *next = dict_iter_next(self, &cur);
-    if (next == NULL) {
+    // pop the last item, which for a compact map is the most recently added
+    mp_map_t *map = &self->map;
+    size_t pos = mp_map_top(map);
+    while (pos > 0 && !MP_MAP_SLOT_IS_FILLED(map, pos - 1)) {
+        --pos;
+    }
+    if (pos == 0) {
         mp_raise_msg(&mp_type_KeyError, "popitem(): dictionary is empty");
     }
-    self->map.used--;
-    mp_obj_t items[] = {next->key, next->value};
-    next->key = MP_OBJ_SENTINEL; // must mark key as sentinel to indicate that it was deleted
-    next->value = MP_OBJ_NULL;
-    mp_obj_t tuple = mp_obj_new_tuple(2, items);
-
-    return tuple;
+    mp_obj_t items[] = {map->table[pos - 1].key, map->table[pos - 1].value};
+    mp_map_lookup(map, items[0], MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    return mp_obj_new_tuple(2, items);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_popitem_obj, dict_popitem);
 
@@ -36,7 +36,7 @@ typedef struct _mp_obj_filter_t {
 
 STATIC mp_obj_t filter_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 2, 2, false);
-    mp_obj_filter_t *o = m_new_obj(mp_obj_filter_t);
+    mp_obj_filter_t *o = m_new_obj_young(mp_obj_filter_t);
     o->base.type = type;
     o->fun = args[0];
     o->iter = mp_getiter(args[1], NULL);
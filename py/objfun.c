@@ -227,10 +227,13 @@ mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t self_in, size_t n_args
     // If we use m_new_obj_var(), then on no memory, MemoryError will be
     // raised. But this is not correct exception for a function call,
     // RuntimeError should be raised instead. So, we use m_new_obj_var_maybe(),
-    // return NULL, then vm.c takes the needed action (either raise
-    // RuntimeError or fallback to stack allocation).
+    // and either raise RuntimeError here or return NULL so that vm.c falls
+    // back to stack allocation.
     code_state = m_new_obj_var_maybe(mp_code_state_t, byte, state_size);
     if (!code_state) {
+        #if MICROPY_STACKLESS_STRICT
+        mp_raise_recursion_depth();
+        #endif
         return NULL;
     }
     #endif
@@ -242,6 +245,25 @@ mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t self_in, size_t n_args
 
     return code_state;
 }
+
+// Prepare a code state to call func with self inserted before the given args.
+// func may be a bytecode function or a closure over one, otherwise NULL is
+// returned and the caller must make a regular call.
+mp_code_state_t *mp_obj_fun_prepare_codestate_self(mp_obj_t func, mp_obj_t self, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    if (MP_OBJ_IS_TYPE(func, &mp_type_closure)) {
+        return mp_obj_closure_prepare_codestate(func, self, n_args, n_kw, args);
+    }
+    if (!MP_OBJ_IS_TYPE(func, &mp_type_fun_bc)) {
+        return NULL;
+    }
+    // The args are copied into the new code state, so a temporary array on
+    // the C stack is enough; it's released when this function returns.
+    size_t n_total = n_args + 2 * n_kw;
+    mp_obj_t *args2 = alloca(sizeof(mp_obj_t) * (1 + n_total));
+    args2[0] = self;
+    memcpy(args2 + 1, args, n_total * sizeof(mp_obj_t));
+    return mp_obj_fun_bc_prepare_codestate(func, n_args + 1, n_kw, args2);
+}
 #endif
 
 STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
@@ -33,6 +33,7 @@
 #include "py/objgenerator.h"
 #include "py/objfun.h"
 #include "py/stackctrl.h"
+#include "py/gc.h"
 
 /******************************************************************************/
 /* generator wrapper                                                          */
@@ -183,6 +184,8 @@ mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_value, mp_
 
     self->globals = mp_globals_get();
     mp_globals_set(self->code_state.old_globals);
+    // the frame was stored to while it ran
+    gc_write_barrier(self);
 
     switch (ret_kind) {
         case MP_VM_RETURN_NORMAL:
@@ -215,6 +218,74 @@ mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_value, mp_
     return ret_kind;
 }
 
+#if MICROPY_STACKLESS
+
+// Prepare a bytecode generator to be resumed in-line by the VM (from a for
+// loop) with None as the sent value.  Returns NULL if the generator must be
+// resumed via mp_obj_gen_resume instead, eg if it's finished, native, already
+// executing or has a pending exception.
+mp_code_state_t *mp_obj_gen_resume_stackless(mp_obj_t self_in) {
+    mp_obj_gen_instance_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->code_state.ip == 0 || self->globals == NULL
+        || MP_STATE_THREAD(stackless_gen_depth) >= MICROPY_STACKLESS_MAX_GEN_DEPTH) {
+        return NULL;
+    }
+    #if MICROPY_EMIT_NATIVE
+    if (self->code_state.exc_sp == NULL) {
+        return NULL;
+    }
+    #endif
+    if (self->code_state.sp != self->code_state.state - 1) {
+        #if MICROPY_PY_GENERATOR_PEND_THROW
+        if (*self->code_state.sp != mp_const_none) {
+            return NULL;
+        }
+        #endif
+        *self->code_state.sp = mp_const_none;
+    }
+
+    self->code_state.old_globals = mp_globals_get();
+    mp_globals_set(self->globals);
+    self->globals = NULL;
+    MP_STATE_THREAD(stackless_gen_depth) += 1;
+    return &self->code_state;
+}
+
+// Returns the generator whose in-line frame is code_state.
+mp_obj_t mp_obj_gen_of_code_state(mp_code_state_t *code_state) {
+    return MP_OBJ_FROM_PTR(((byte*)code_state - offsetof(mp_obj_gen_instance_t, code_state)));
+}
+
+// Called by the VM when a generator that was resumed in-line yields, returns
+// or raises.  Restores the state that mp_obj_gen_resume would and returns the
+// value (or exception) to pass back to the caller.
+mp_obj_t mp_obj_gen_suspend_stackless(mp_code_state_t *code_state, mp_vm_return_kind_t kind, mp_obj_t ret_val) {
+    mp_obj_gen_instance_t *self = (mp_obj_gen_instance_t*)((byte*)code_state - offsetof(mp_obj_gen_instance_t, code_state));
+    code_state->prev = NULL;
+    MP_STATE_THREAD(stackless_gen_depth) -= 1;
+    self->globals = mp_globals_get();
+    mp_globals_set(code_state->old_globals);
+    gc_write_barrier(self);
+
+    if (kind == MP_VM_RETURN_YIELD) {
+        #if MICROPY_PY_GENERATOR_PEND_THROW
+        *code_state->sp = mp_const_none;
+        #endif
+        return ret_val;
+    }
+
+    code_state->ip = 0;
+    if (kind == MP_VM_RETURN_EXCEPTION) {
+        // PEP479: if StopIteration is raised inside a generator it is replaced with RuntimeError
+        if (mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(mp_obj_get_type(ret_val)), MP_OBJ_FROM_PTR(&mp_type_StopIteration))) {
+            ret_val = mp_obj_new_exception_msg(&mp_type_RuntimeError, "generator raised StopIteration");
+        }
+    }
+    return ret_val;
+}
+
+#endif
+
 STATIC mp_obj_t gen_resume_and_raise(mp_obj_t self_in, mp_obj_t send_value, mp_obj_t throw_value) {
     mp_obj_t ret;
     switch (mp_obj_gen_resume(self_in, send_value, throw_value, &ret)) {
@@ -293,6 +364,7 @@ STATIC mp_obj_t gen_instance_pend_throw(mp_obj_t self_in, mp_obj_t exc_in) {
     }
     mp_obj_t prev = *self->code_state.sp;
     *self->code_state.sp = exc_in;
+    gc_write_barrier(self);
     return prev;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(gen_instance_pend_throw_obj, gen_instance_pend_throw);
@@ -28,7 +28,14 @@
 
 #include "py/obj.h"
 #include "py/runtime.h"
+#include "py/bc.h"
 
 mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_val, mp_obj_t throw_val, mp_obj_t *ret_val);
 
+#if MICROPY_STACKLESS
+mp_code_state_t *mp_obj_gen_resume_stackless(mp_obj_t self_in);
+mp_obj_t mp_obj_gen_suspend_stackless(mp_code_state_t *code_state, mp_vm_return_kind_t kind, mp_obj_t ret_val);
+mp_obj_t mp_obj_gen_of_code_state(mp_code_state_t *code_state);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_OBJGENERATOR_H
@@ -28,8 +28,10 @@
 #include <assert.h>
 
 #include "py/objlist.h"
+#include "py/objstr.h"
 #include "py/runtime.h"
 #include "py/stackctrl.h"
+#include "py/gc.h"
 
 STATIC mp_obj_t mp_obj_new_list_iterator(mp_obj_t list, size_t cur, mp_obj_iter_buf_t *iter_buf);
 STATIC mp_obj_list_t *list_new(size_t n);
@@ -167,6 +169,7 @@ STATIC mp_obj_t list_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
             mp_seq_replace_slice_no_grow(self->items, self->len, slice.start, slice.stop, self->items/*NULL*/, 0, sizeof(*self->items));
             // Clear "freed" elements at the end of list
             mp_seq_clear(self->items, self->len + len_adj, self->len, sizeof(*self->items));
+            gc_write_barrier(self->items);
             self->len += len_adj;
             return mp_const_none;
         }
@@ -218,6 +221,7 @@ STATIC mp_obj_t list_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
                 mp_seq_clear(self->items, self->len + len_adj, self->len, sizeof(*self->items));
                 // TODO: apply allocation policy re: alloc_size
             }
+            gc_write_barrier(self->items);
             self->len += len_adj;
             return mp_const_none;
         }
@@ -240,6 +244,7 @@ mp_obj_t mp_obj_list_append(mp_obj_t self_in, mp_obj_t arg) {
         mp_seq_clear(self->items, self->len + 1, self->alloc, sizeof(*self->items));
     }
     self->items[self->len++] = arg;
+    gc_write_barrier(self->items);
     return mp_const_none; // return None, as per CPython
 }
 
@@ -257,6 +262,7 @@ STATIC mp_obj_t list_extend(mp_obj_t self_in, mp_obj_t arg_in) {
         }
 
         memcpy(self->items + self->len, arg->items, sizeof(mp_obj_t) * arg->len);
+        gc_write_barrier(self->items);
         self->len += arg->len;
     } else {
         list_extend_from_iter(self_in, arg_in);
@@ -276,6 +282,7 @@ STATIC mp_obj_t list_pop(size_t n_args, const mp_obj_t *args) {
     memmove(self->items + index, self->items + index + 1, (self->len - index) * sizeof(mp_obj_t));
     // Clear stale pointer from slot which just got freed to prevent GC issues
     self->items[self->len] = MP_OBJ_NULL;
+    gc_write_barrier(self->items);
     if (self->alloc > LIST_MIN_ALLOC && self->alloc > 2 * self->len) {
         self->items = m_renew(mp_obj_t, self->items, self->alloc, self->alloc/2);
         self->alloc /= 2;
@@ -283,6 +290,335 @@ STATIC mp_obj_t list_pop(size_t n_args, const mp_obj_t *args) {
     return ret;
 }
 
+#if MICROPY_OPT_STABLE_SORT
+
+// A stable merge sort in the style of Timsort.  Elements are w words wide:
+// either just the item (w=1, sorted in place) or a (key, item) pair (w=2)
+// when there is a key function, so that each key is computed only once.
+// Ascending and strictly descending runs already in the data are found and
+// merged, and short runs are extended to sort_min_run() with a binary
+// insertion sort.  Merges copy the shorter run out to a temporary buffer.
+// If a comparison raises an exception the merge in progress is undone just
+// enough to leave every element in the array once.
+
+#define SORT_KIND_OBJ (0)
+#define SORT_KIND_SMALL_INT (1)
+#define SORT_KIND_STR (2)
+
+// enough for 2^64 elements, because runs on the stack grow like Fibonacci
+#define SORT_MAX_RUNS (85)
+
+typedef struct _sort_state_t {
+    mp_obj_t *base;
+    mp_obj_t *tmp;
+    size_t w;
+    size_t kind;
+    // merge in progress, used to recover when a comparison raises
+    mp_obj_t *gap;
+    mp_obj_t *rest;
+    size_t n_rest;
+    // pending runs
+    size_t n_runs;
+    size_t run_start[SORT_MAX_RUNS];
+    size_t run_len[SORT_MAX_RUNS];
+} sort_state_t;
+
+STATIC bool sort_lt(const sort_state_t *s, const mp_obj_t *a, const mp_obj_t *b) {
+    if (s->kind == SORT_KIND_SMALL_INT) {
+        return MP_OBJ_SMALL_INT_VALUE(a[0]) < MP_OBJ_SMALL_INT_VALUE(b[0]);
+    } else if (s->kind == SORT_KIND_STR) {
+        GET_STR_DATA_LEN(a[0], a_data, a_len);
+        GET_STR_DATA_LEN(b[0], b_data, b_len);
+        return mp_seq_cmp_bytes(MP_BINARY_OP_LESS, a_data, a_len, b_data, b_len);
+    } else {
+        return mp_binary_op(MP_BINARY_OP_LESS, a[0], b[0]) == mp_const_true;
+    }
+}
+
+STATIC void sort_copy(const sort_state_t *s, mp_obj_t *dest, const mp_obj_t *src, size_t n) {
+    memmove(dest, src, n * s->w * sizeof(mp_obj_t));
+}
+
+STATIC void sort_reverse(const sort_state_t *s, mp_obj_t *lo, mp_obj_t *hi) {
+    // hi is the last element, not one past it
+    while (lo < hi) {
+        for (size_t k = 0; k < s->w; k++) {
+            mp_obj_t t = lo[k];
+            lo[k] = hi[k];
+            hi[k] = t;
+        }
+        lo += s->w;
+        hi -= s->w;
+    }
+}
+
+STATIC size_t sort_min_run(size_t n) {
+    // as Timsort, so that n / min_run is a power of 2 or just below one
+    size_t r = 0;
+    while (n >= 64) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+// Length of the run starting at a, reversing it if it's descending.
+STATIC size_t sort_count_run(sort_state_t *s, mp_obj_t *a, size_t n) {
+    size_t w = s->w;
+    if (n == 1) {
+        return 1;
+    }
+    size_t i = 2;
+    if (sort_lt(s, a + w, a)) {
+        // strictly descending, so reversing it keeps the sort stable
+        while (i < n && sort_lt(s, a + i * w, a + (i - 1) * w)) {
+            ++i;
+        }
+        sort_reverse(s, a, a + (i - 1) * w);
+    } else {
+        while (i < n && !sort_lt(s, a + i * w, a + (i - 1) * w)) {
+            ++i;
+        }
+    }
+    return i;
+}
+
+// Sort a[0, n) given that a[0, sorted) is already sorted.
+STATIC void sort_binary_insertion(sort_state_t *s, mp_obj_t *a, size_t sorted, size_t n) {
+    size_t w = s->w;
+    mp_obj_t pivot[2];
+    for (size_t i = sorted; i < n; i++) {
+        // find the position after all elements equal to a[i]
+        size_t lo = 0;
+        size_t hi = i;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (sort_lt(s, a + i * w, a + mid * w)) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        if (lo < i) {
+            sort_copy(s, pivot, a + i * w, 1);
+            sort_copy(s, a + (lo + 1) * w, a + lo * w, i - lo);
+            sort_copy(s, a + lo * w, pivot, 1);
+        }
+    }
+}
+
+// Number of elements at the start of a[0, n) that are not greater than key.
+STATIC size_t sort_count_le(sort_state_t *s, const mp_obj_t *key, mp_obj_t *a, size_t n) {
+    size_t lo = 0;
+    while (lo < n) {
+        size_t mid = lo + (n - lo) / 2;
+        if (sort_lt(s, key, a + mid * s->w)) {
+            n = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// Number of elements at the start of a[0, n) that are less than key.
+STATIC size_t sort_count_lt(sort_state_t *s, const mp_obj_t *key, mp_obj_t *a, size_t n) {
+    size_t lo = 0;
+    while (lo < n) {
+        size_t mid = lo + (n - lo) / 2;
+        if (sort_lt(s, a + mid * s->w, key)) {
+            lo = mid + 1;
+        } else {
+            n = mid;
+        }
+    }
+    return lo;
+}
+
+// Merge the adjacent sorted runs a[0, na) and b[0, nb).
+STATIC void sort_merge(sort_state_t *s, mp_obj_t *a, size_t na, mp_obj_t *b, size_t nb) {
+    size_t w = s->w;
+
+    // elements of a that go before all of b, and of b that go after all of
+    // a, are already in place
+    size_t k = sort_count_le(s, b, a, na);
+    a += k * w;
+    na -= k;
+    if (na == 0) {
+        return;
+    }
+    nb = sort_count_lt(s, a + (na - 1) * w, b, nb);
+    if (nb == 0) {
+        return;
+    }
+
+    mp_obj_t *tmp = s->tmp;
+    gc_write_barrier(s->base);
+    if (na <= nb) {
+        // copy a out and merge from the front; the gap in front of b is
+        // always as long as what is left of a
+        sort_copy(s, tmp, a, na);
+        gc_write_barrier(tmp);
+        s->gap = a;
+        s->rest = tmp;
+        s->n_rest = na;
+        mp_obj_t *b_end = b + nb * w;
+        while (s->n_rest > 0 && b < b_end) {
+            if (sort_lt(s, b, s->rest)) {
+                sort_copy(s, s->gap, b, 1);
+                b += w;
+            } else {
+                sort_copy(s, s->gap, s->rest, 1);
+                s->rest += w;
+                s->n_rest -= 1;
+            }
+            s->gap += w;
+        }
+    } else {
+        // copy b out and merge from the back; the gap after a is always as
+        // long as what is left of b
+        sort_copy(s, tmp, b, nb);
+        gc_write_barrier(tmp);
+        mp_obj_t *dest = b + nb * w;
+        mp_obj_t *a_end = a + na * w;
+        s->rest = tmp;
+        s->n_rest = nb;
+        s->gap = a_end;
+        while (s->n_rest > 0 && a_end > a) {
+            dest -= w;
+            if (sort_lt(s, tmp + (s->n_rest - 1) * w, a_end - w)) {
+                a_end -= w;
+                sort_copy(s, dest, a_end, 1);
+            } else {
+                s->n_rest -= 1;
+                sort_copy(s, dest, tmp + s->n_rest * w, 1);
+            }
+            s->gap = a_end;
+        }
+    }
+    sort_copy(s, s->gap, s->rest, s->n_rest);
+    s->n_rest = 0;
+}
+
+STATIC void sort_merge_at(sort_state_t *s, size_t i) {
+    mp_obj_t *base = s->base;
+    size_t w = s->w;
+    sort_merge(s, base + s->run_start[i] * w, s->run_len[i],
+        base + s->run_start[i + 1] * w, s->run_len[i + 1]);
+    s->run_len[i] += s->run_len[i + 1];
+    if (i + 2 < s->n_runs) {
+        s->run_start[i + 1] = s->run_start[i + 2];
+        s->run_len[i + 1] = s->run_len[i + 2];
+    }
+    s->n_runs -= 1;
+}
+
+// Merge pending runs until their lengths decrease faster than Fibonacci.
+STATIC void sort_merge_collapse(sort_state_t *s, bool force) {
+    size_t *len = s->run_len;
+    while (s->n_runs > 1) {
+        size_t k = s->n_runs - 2;
+        if (force
+            || (k > 0 && len[k - 1] <= len[k] + len[k + 1])
+            || (k > 1 && len[k - 2] <= len[k - 1] + len[k])) {
+            if (k > 0 && len[k - 1] < len[k + 1]) {
+                --k;
+            }
+        } else if (len[k] > len[k + 1]) {
+            break;
+        }
+        sort_merge_at(s, k);
+    }
+}
+
+STATIC void sort_run(sort_state_t *s, size_t n) {
+    size_t w = s->w;
+    size_t min_run = sort_min_run(n);
+    size_t lo = 0;
+    while (lo < n) {
+        mp_obj_t *a = s->base + lo * w;
+        size_t len = sort_count_run(s, a, n - lo);
+        if (len < min_run) {
+            size_t forced = MIN(min_run, n - lo);
+            sort_binary_insertion(s, a, len, forced);
+            len = forced;
+        }
+        s->run_start[s->n_runs] = lo;
+        s->run_len[s->n_runs] = len;
+        s->n_runs += 1;
+        sort_merge_collapse(s, false);
+        lo += len;
+    }
+    sort_merge_collapse(s, true);
+}
+
+STATIC void mp_stable_sort(mp_obj_t *items, size_t n, mp_obj_t key_fn, bool reverse) {
+    sort_state_t s;
+    s.n_runs = 0;
+    s.n_rest = 0;
+    s.w = 1;
+    s.base = items;
+    if (key_fn != MP_OBJ_NULL) {
+        s.w = 2;
+        s.base = m_new(mp_obj_t, 2 * n);
+        for (size_t i = 0; i < n; i++) {
+            s.base[2 * i] = mp_call_function_1(key_fn, items[i]);
+            s.base[2 * i + 1] = items[i];
+        }
+    }
+    if (reverse) {
+        // sorting the reversed array and reversing the result keeps equal
+        // elements in their original order
+        sort_reverse(&s, s.base, s.base + (n - 1) * s.w);
+    }
+
+    // use a cheaper comparison if all keys are small ints, or all are str
+    s.kind = SORT_KIND_SMALL_INT;
+    for (size_t i = 0; i < n && s.kind == SORT_KIND_SMALL_INT; i++) {
+        if (!MP_OBJ_IS_SMALL_INT(s.base[i * s.w])) {
+            s.kind = SORT_KIND_OBJ;
+        }
+    }
+    if (s.kind == SORT_KIND_OBJ) {
+        s.kind = SORT_KIND_STR;
+        for (size_t i = 0; i < n && s.kind == SORT_KIND_STR; i++) {
+            if (!MP_OBJ_IS_STR(s.base[i * s.w])) {
+                s.kind = SORT_KIND_OBJ;
+            }
+        }
+    }
+
+    s.tmp = m_new(mp_obj_t, n / 2 * s.w);
+    s.gap = s.rest = s.base;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        sort_run(&s, n);
+        nlr_pop();
+    } else {
+        // put back the elements of the interrupted merge so that no item is
+        // lost; with a key function the list itself hasn't been changed
+        sort_copy(&s, s.gap, s.rest, s.n_rest);
+        m_del(mp_obj_t, s.tmp, n / 2 * s.w);
+        if (key_fn != MP_OBJ_NULL) {
+            m_del(mp_obj_t, s.base, 2 * n);
+        }
+        nlr_jump(nlr.ret_val);
+    }
+    m_del(mp_obj_t, s.tmp, n / 2 * s.w);
+
+    if (reverse) {
+        sort_reverse(&s, s.base, s.base + (n - 1) * s.w);
+    }
+    if (key_fn != MP_OBJ_NULL) {
+        for (size_t i = 0; i < n; i++) {
+            items[i] = s.base[2 * i + 1];
+        }
+        m_del(mp_obj_t, s.base, 2 * n);
+    }
+}
+
+#else
+
 STATIC void mp_quicksort(mp_obj_t *head, mp_obj_t *tail, mp_obj_t key_fn, mp_obj_t binop_less_result) {
     MP_STACK_CHECK();
     while (head < tail) {
@@ -311,7 +647,11 @@ STATIC void mp_quicksort(mp_obj_t *head, mp_obj_t *tail, mp_obj_t key_fn, mp_obj
     }
 }
 
+#endif
+
+#if !MICROPY_OPT_STABLE_SORT
 // TODO Python defines sort to be stable but ours is not
+#endif
 mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_key, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
@@ -329,9 +669,16 @@ mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_
     mp_obj_list_t *self = MP_OBJ_TO_PTR(pos_args[0]);
 
     if (self->len > 1) {
+        #if MICROPY_OPT_STABLE_SORT
+        mp_stable_sort(self->items, self->len,
+                       args.key.u_obj == mp_const_none ? MP_OBJ_NULL : args.key.u_obj,
+                       args.reverse.u_bool);
+        #else
         mp_quicksort(self->items, self->items + self->len - 1,
                      args.key.u_obj == mp_const_none ? MP_OBJ_NULL : args.key.u_obj,
                      args.reverse.u_bool ? mp_const_false : mp_const_true);
+        #endif
+        gc_write_barrier(self->items);
     }
 
     return mp_const_none;
@@ -386,6 +733,7 @@ STATIC mp_obj_t list_insert(mp_obj_t self_in, mp_obj_t idx, mp_obj_t obj) {
          self->items[i] = self->items[i-1];
     }
     self->items[index] = obj;
+    gc_write_barrier(self->items);
 
     return mp_const_none;
 }
@@ -409,6 +757,7 @@ STATIC mp_obj_t list_reverse(mp_obj_t self_in) {
          self->items[i] = self->items[len-i-1];
          self->items[len-i-1] = a;
     }
+    gc_write_barrier(self->items);
 
     return mp_const_none;
 }
@@ -494,19 +843,13 @@ void mp_obj_list_store(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
     mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
     size_t i = mp_get_index(self->base.type, self->len, index, false);
     self->items[i] = value;
+    gc_write_barrier(self->items);
 }
 
 /******************************************************************************/
 /* list iterator                                                              */
 
-typedef struct _mp_obj_list_it_t {
-    mp_obj_base_t base;
-    mp_fun_1_t iternext;
-    mp_obj_t list;
-    size_t cur;
-} mp_obj_list_it_t;
-
-STATIC mp_obj_t list_it_iternext(mp_obj_t self_in) {
+mp_obj_t mp_obj_list_it_iternext(mp_obj_t self_in) {
     mp_obj_list_it_t *self = MP_OBJ_TO_PTR(self_in);
     mp_obj_list_t *list = MP_OBJ_TO_PTR(self->list);
     if (self->cur < list->len) {
@@ -522,7 +865,7 @@ mp_obj_t mp_obj_new_list_iterator(mp_obj_t list, size_t cur, mp_obj_iter_buf_t *
     assert(sizeof(mp_obj_list_it_t) <= sizeof(mp_obj_iter_buf_t));
     mp_obj_list_it_t *o = (mp_obj_list_it_t*)iter_buf;
     o->base.type = &mp_type_polymorph_iter;
-    o->iternext = list_it_iternext;
+    o->iternext = mp_obj_list_it_iternext;
     o->list = list;
     o->cur = cur;
     return MP_OBJ_FROM_PTR(o);
@@ -35,6 +35,14 @@ typedef struct _mp_obj_list_t {
     mp_obj_t *items;
 } mp_obj_list_t;
 
+typedef struct _mp_obj_list_it_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_t list;
+    size_t cur;
+} mp_obj_list_it_t;
+
 void mp_obj_list_init(mp_obj_list_t *o, size_t n);
+mp_obj_t mp_obj_list_it_iternext(mp_obj_t self_in);
 
 #endif // MICROPY_INCLUDED_PY_OBJLIST_H
@@ -38,7 +38,7 @@ typedef struct _mp_obj_map_t {
 
 STATIC mp_obj_t map_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 2, MP_OBJ_FUN_ARGS_MAX, false);
-    mp_obj_map_t *o = m_new_obj_var(mp_obj_map_t, mp_obj_t, n_args - 1);
+    mp_obj_map_t *o = m_new_obj_var_young(mp_obj_map_t, mp_obj_t, n_args - 1);
     o->base.type = type;
     o->n_iters = n_args - 1;
     o->fun = args[0];
@@ -271,6 +271,83 @@ wrong_args:
 }
 
 // like strstr but with specified length and allows \0 bytes
+#if MICROPY_OPT_FIND_SUBBYTES
+
+// Haystacks shorter than this are searched by checking each position where
+// the first byte of the needle is found, longer ones with Boyer-Moore-Horspool
+// which first compares the byte at the far end of the needle and may then skip
+// ahead by up to the length of the needle (but at most 255).
+#define FIND_SUBBYTES_MIN_HORSPOOL (128)
+
+STATIC const byte *find_subbytes_fwd(const byte *haystack, size_t hlen, const byte *needle, size_t nlen) {
+    const byte *top = haystack + hlen - nlen + 1;
+    if (nlen == 1 || hlen < FIND_SUBBYTES_MIN_HORSPOOL) {
+        for (const byte *s = haystack; (s = memchr(s, needle[0], top - s)) != NULL; s++) {
+            if (memcmp(s + 1, needle + 1, nlen - 1) == 0) {
+                return s;
+            }
+        }
+        return NULL;
+    }
+    size_t last = nlen - 1;
+    byte shift[256];
+    memset(shift, MIN(nlen, 255), sizeof(shift));
+    for (size_t i = 0; i < last; i++) {
+        shift[needle[i]] = MIN(last - i, 255);
+    }
+    for (const byte *s = haystack; s < top; s += shift[s[last]]) {
+        if (s[last] == needle[last] && memcmp(s, needle, last) == 0) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+STATIC const byte *find_subbytes_rev(const byte *haystack, size_t hlen, const byte *needle, size_t nlen) {
+    size_t pos = hlen - nlen;
+    if (nlen == 1 || hlen < FIND_SUBBYTES_MIN_HORSPOOL) {
+        for (;;) {
+            if (haystack[pos] == needle[0] && memcmp(haystack + pos + 1, needle + 1, nlen - 1) == 0) {
+                return haystack + pos;
+            }
+            if (pos == 0) {
+                return NULL;
+            }
+            --pos;
+        }
+    }
+    // as above, but comparing the first byte of the needle and moving back
+    byte shift[256];
+    memset(shift, MIN(nlen, 255), sizeof(shift));
+    for (size_t i = nlen - 1; i > 0; i--) {
+        shift[needle[i]] = MIN(i, 255);
+    }
+    for (;;) {
+        byte c = haystack[pos];
+        if (c == needle[0] && memcmp(haystack + pos + 1, needle + 1, nlen - 1) == 0) {
+            return haystack + pos;
+        }
+        if (pos < shift[c]) {
+            return NULL;
+        }
+        pos -= shift[c];
+    }
+}
+
+const byte *find_subbytes(const byte *haystack, size_t hlen, const byte *needle, size_t nlen, int direction) {
+    if (hlen < nlen) {
+        return NULL;
+    } else if (nlen == 0) {
+        return direction > 0 ? haystack : haystack + hlen;
+    } else if (direction > 0) {
+        return find_subbytes_fwd(haystack, hlen, needle, nlen);
+    } else {
+        return find_subbytes_rev(haystack, hlen, needle, nlen);
+    }
+}
+
+#else
+
 // TODO replace with something more efficient/standard
 const byte *find_subbytes(const byte *haystack, size_t hlen, const byte *needle, size_t nlen, int direction) {
     if (hlen >= nlen) {
@@ -297,6 +374,71 @@ const byte *find_subbytes(const byte *haystack, size_t hlen, const byte *needle,
     return NULL;
 }
 
+#endif
+
+#if MICROPY_OPT_STR_BUILDER
+
+// "s += x" only makes a buffer with spare space for results at least this long
+#define STR_BUILDER_MIN_LEN (32)
+
+// Return a new str/bytes with the data lhs followed by rhs, for "+=".  If lhs
+// is the used part of one of the buffers in MP_STATE_VM(str_builder_cache)
+// then rhs is appended to it in place, if the buffer has room or can be grown
+// in place.  The objects that already use the buffer don't change because they
+// only see their own len bytes, although the one that ended at the old used
+// length is no longer null terminated.  Otherwise the data is copied to a new
+// buffer with 50% spare space, which goes in the cache.  A buffer always keeps
+// a byte after its used part for the null terminator, so the result is a
+// terminated str like any other.
+STATIC mp_obj_t str_builder_add(const mp_obj_type_t *type, const byte *lhs_data, size_t lhs_len, const byte *rhs_data, size_t rhs_len) {
+    // allocate the object first, because that may run a collection which
+    // clears the cache
+    mp_obj_str_t *o = m_new_obj(mp_obj_str_t);
+    o->base.type = type;
+    o->hash = 0; // computed when needed
+    o->len = lhs_len + rhs_len;
+
+    mp_str_builder_cache_entry_t *cache = MP_STATE_VM(str_builder_cache);
+    mp_str_builder_cache_entry_t *e = NULL;
+    for (size_t i = 0; i < MICROPY_OPT_STR_BUILDER_CACHE_SIZE; i++) {
+        if (cache[i].buf == lhs_data && cache[i].used == lhs_len) {
+            e = &cache[i];
+            break;
+        }
+    }
+
+    byte *buf = NULL;
+    size_t alloc;
+    if (e != NULL && o->len < e->alloc) {
+        buf = e->buf;
+        alloc = e->alloc;
+    } else {
+        alloc = o->len + o->len / 2 + 1;
+        if (e != NULL) {
+            buf = m_renew_maybe(byte, e->buf, e->alloc, alloc, false);
+        }
+    }
+    if (buf != NULL) {
+        // rhs can be the used part of the same buffer, which doesn't overlap
+        memcpy(buf + lhs_len, rhs_data, rhs_len);
+    } else {
+        buf = m_new(byte, alloc);
+        memcpy(buf, lhs_data, lhs_len);
+        memcpy(buf + lhs_len, rhs_data, rhs_len);
+        if (e == NULL) {
+            e = &cache[MP_STATE_VM(str_builder_cache_next)++ % MICROPY_OPT_STR_BUILDER_CACHE_SIZE];
+        }
+    }
+    buf[o->len] = '\0';
+    o->data = buf;
+    e->buf = buf;
+    e->used = o->len;
+    e->alloc = alloc;
+    return MP_OBJ_FROM_PTR(o);
+}
+
+#endif
+
 // Note: this function is used to check if an object is a str or bytes, which
 // works because both those types use it as their binary_op method.  Revisit
 // MP_OBJ_IS_STR_OR_BYTES if this fact changes.
@@ -386,6 +528,12 @@ mp_obj_t mp_obj_str_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_i
                 return lhs_in;
             }
 
+            #if MICROPY_OPT_STR_BUILDER
+            if (op == MP_BINARY_OP_INPLACE_ADD && lhs_len + rhs_len >= STR_BUILDER_MIN_LEN) {
+                return str_builder_add(lhs_type, lhs_data, lhs_len, rhs_data, rhs_len);
+            }
+            #endif
+
             vstr_t vstr;
             vstr_init_len(&vstr, lhs_len + rhs_len);
             memcpy(vstr.buf, lhs_data, lhs_len);
@@ -548,14 +696,12 @@ mp_obj_t mp_obj_str_split(size_t n_args, const mp_obj_t *args) {
 
         for (;;) {
             const byte *start = s;
-            for (;;) {
-                if (splits == 0 || s + sep_len > top) {
-                    s = top;
-                    break;
-                } else if (memcmp(s, sep_str, sep_len) == 0) {
-                    break;
-                }
-                s++;
+            s = NULL;
+            if (splits != 0) {
+                s = find_subbytes(start, top - start, (const byte*)sep_str, sep_len, 1);
+            }
+            if (s == NULL) {
+                s = top;
             }
             mp_obj_list_append(res, mp_obj_new_str_of_type(self_type, start, s - start));
             if (s >= top) {
@@ -654,16 +800,11 @@ STATIC mp_obj_t str_rsplit(size_t n_args, const mp_obj_t *args) {
         const byte *beg = s;
         const byte *last = s + len;
         for (;;) {
-            s = last - sep_len;
-            for (;;) {
-                if (splits == 0 || s < beg) {
-                    break;
-                } else if (memcmp(s, sep_str, sep_len) == 0) {
-                    break;
-                }
-                s--;
+            s = NULL;
+            if (splits != 0) {
+                s = find_subbytes(beg, last - beg, (const byte*)sep_str, sep_len, -1);
             }
-            if (s < beg || splits == 0) {
+            if (s == NULL) {
                 res->items[idx] = mp_obj_new_str_of_type(self_type, beg, last - beg);
                 break;
             }
@@ -1394,26 +1535,32 @@ MP_DEFINE_CONST_FUN_OBJ_KW(str_format_obj, 1, mp_obj_str_format);
 #if MICROPY_PY_BUILTINS_STR_OP_MODULO
 STATIC mp_obj_t str_modulo_format(mp_obj_t pattern, size_t n_args, const mp_obj_t *args, mp_obj_t dict) {
     mp_check_self(MP_OBJ_IS_STR_OR_BYTES(pattern));
+    vstr_t vstr;
+    vstr_init(&vstr, 16);
+    mp_str_format_modulo_into(&vstr, pattern, n_args, args, dict);
+    return mp_obj_new_str_from_vstr(MP_OBJ_IS_TYPE(pattern, &mp_type_bytes) ? &mp_type_bytes : &mp_type_str, &vstr);
+}
 
+// Append "pattern % args" to vstr, where pattern is a str or bytes and dict is
+// the mapping for %(name) conversions, if any.
+void mp_str_format_modulo_into(vstr_t *vstr, mp_obj_t pattern, size_t n_args, const mp_obj_t *args, mp_obj_t dict) {
     GET_STR_DATA_LEN(pattern, str, len);
     const byte *start_str = str;
     bool is_bytes = MP_OBJ_IS_TYPE(pattern, &mp_type_bytes);
     size_t arg_i = 0;
-    vstr_t vstr;
-    mp_print_t print;
-    vstr_init_print(&vstr, 16, &print);
+    mp_print_t print = {vstr, (mp_print_strn_t)vstr_add_strn};
 
     for (const byte *top = str + len; str < top; str++) {
         mp_obj_t arg = MP_OBJ_NULL;
         if (*str != '%') {
-            vstr_add_byte(&vstr, *str);
+            vstr_add_byte(vstr, *str);
             continue;
         }
         if (++str >= top) {
             goto incomplete_format;
         }
         if (*str == '%') {
-            vstr_add_byte(&vstr, '%');
+            vstr_add_byte(vstr, '%');
             continue;
         }
 
@@ -1584,8 +1731,6 @@ not_enough_args:
     if (arg_i != n_args) {
         mp_raise_TypeError("format string didn't convert all arguments");
     }
-
-    return mp_obj_new_str_from_vstr(is_bytes ? &mp_type_bytes : &mp_type_str, &vstr);
 }
 #endif
 
@@ -1726,13 +1871,11 @@ STATIC mp_obj_t str_count(size_t n_args, const mp_obj_t *args) {
 
     // count the occurrences
     mp_int_t num_occurrences = 0;
-    for (const byte *haystack_ptr = start; haystack_ptr + needle_len <= end;) {
-        if (memcmp(haystack_ptr, needle, needle_len) == 0) {
-            num_occurrences++;
-            haystack_ptr += needle_len;
-        } else {
-            haystack_ptr = utf8_next_char(haystack_ptr);
-        }
+    const byte *haystack_ptr = start;
+    while (haystack_ptr < end
+        && (haystack_ptr = find_subbytes(haystack_ptr, end - haystack_ptr, needle, needle_len, 1)) != NULL) {
+        num_occurrences++;
+        haystack_ptr += needle_len;
     }
 
     return MP_OBJ_NEW_SMALL_INT(num_occurrences);
@@ -2170,13 +2313,6 @@ const byte *mp_obj_str_get_data_no_check(mp_obj_t self_in, size_t *len) {
 /******************************************************************************/
 /* str iterator                                                               */
 
-typedef struct _mp_obj_str8_it_t {
-    mp_obj_base_t base;
-    mp_fun_1_t iternext;
-    mp_obj_t str;
-    size_t cur;
-} mp_obj_str8_it_t;
-
 #if !MICROPY_PY_BUILTINS_STR_UNICODE
 STATIC mp_obj_t str_it_iternext(mp_obj_t self_in) {
     mp_obj_str8_it_t *self = MP_OBJ_TO_PTR(self_in);
@@ -2201,7 +2337,7 @@ STATIC mp_obj_t mp_obj_new_str_iterator(mp_obj_t str, mp_obj_iter_buf_t *iter_bu
 }
 #endif
 
-STATIC mp_obj_t bytes_it_iternext(mp_obj_t self_in) {
+mp_obj_t mp_obj_bytes_it_iternext(mp_obj_t self_in) {
     mp_obj_str8_it_t *self = MP_OBJ_TO_PTR(self_in);
     GET_STR_DATA_LEN(self->str, str, len);
     if (self->cur < len) {
@@ -2217,7 +2353,7 @@ mp_obj_t mp_obj_new_bytes_iterator(mp_obj_t str, mp_obj_iter_buf_t *iter_buf) {
     assert(sizeof(mp_obj_str8_it_t) <= sizeof(mp_obj_iter_buf_t));
     mp_obj_str8_it_t *o = (mp_obj_str8_it_t*)iter_buf;
     o->base.type = &mp_type_polymorph_iter;
-    o->iternext = bytes_it_iternext;
+    o->iternext = mp_obj_bytes_it_iternext;
     o->str = str;
     o->cur = 0;
     return MP_OBJ_FROM_PTR(o);
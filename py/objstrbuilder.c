@@ -0,0 +1,133 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/objstr.h"
+#include "py/runtime.h"
+
+#if MICROPY_PY_MICROPYTHON_STRBUILDER
+
+// A mutable str that grows by appending to a vstr, and is turned into a str
+// without copying the data.
+typedef struct _mp_obj_strbuilder_t {
+    mp_obj_base_t base;
+    vstr_t vstr;
+} mp_obj_strbuilder_t;
+
+STATIC mp_obj_t strbuilder_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+    mp_obj_strbuilder_t *self = m_new_obj(mp_obj_strbuilder_t);
+    self->base.type = type;
+    vstr_init(&self->vstr, n_args > 0 ? mp_obj_get_int(args[0]) : 16);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t strbuilder_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_obj_strbuilder_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return mp_obj_new_bool(self->vstr.len != 0);
+        case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(self->vstr.len);
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t strbuilder_append(mp_obj_t self_in, mp_obj_t str_in) {
+    mp_obj_strbuilder_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!MP_OBJ_IS_STR(str_in)) {
+        mp_raise_TypeError("expected str");
+    }
+    GET_STR_DATA_LEN(str_in, str, len);
+    vstr_add_strn(&self->vstr, (const char*)str, len);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(strbuilder_append_obj, strbuilder_append);
+
+// append_int(n): append the decimal digits of the int n, without making a str
+// of them first
+STATIC mp_obj_t strbuilder_append_int(mp_obj_t self_in, mp_obj_t int_in) {
+    mp_obj_strbuilder_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!MP_OBJ_IS_INT(int_in)) {
+        mp_raise_TypeError("expected int");
+    }
+    mp_print_t print = {&self->vstr, (mp_print_strn_t)vstr_add_strn};
+    mp_obj_print_helper(&print, int_in, PRINT_STR);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(strbuilder_append_int_obj, strbuilder_append_int);
+
+#if MICROPY_PY_BUILTINS_STR_OP_MODULO
+// append_fmt(fmt, *args): append fmt % args, formatting straight into the
+// builder.  Nothing is appended if the formatting raises an exception.
+STATIC mp_obj_t strbuilder_append_fmt(size_t n_args, const mp_obj_t *args) {
+    mp_obj_strbuilder_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (!MP_OBJ_IS_STR(args[1])) {
+        mp_raise_TypeError("expected str");
+    }
+    size_t len = self->vstr.len;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_str_format_modulo_into(&self->vstr, args[1], n_args - 2, args + 2, MP_OBJ_NULL);
+        nlr_pop();
+    } else {
+        self->vstr.len = len;
+        nlr_jump(nlr.ret_val);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(strbuilder_append_fmt_obj, 2, MP_OBJ_FUN_ARGS_MAX, strbuilder_append_fmt);
+#endif
+
+// build(): return the data as a str, which takes over the buffer instead of
+// copying it, and leave the builder empty
+STATIC mp_obj_t strbuilder_build(mp_obj_t self_in) {
+    mp_obj_strbuilder_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t str = mp_obj_new_str_from_vstr(&mp_type_str, &self->vstr);
+    // the buffer is gone, so the next append allocates a new one
+    self->vstr.len = 0;
+    return str;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(strbuilder_build_obj, strbuilder_build);
+
+STATIC const mp_rom_map_elem_t strbuilder_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_append), MP_ROM_PTR(&strbuilder_append_obj) },
+    { MP_ROM_QSTR(MP_QSTR_append_int), MP_ROM_PTR(&strbuilder_append_int_obj) },
+    #if MICROPY_PY_BUILTINS_STR_OP_MODULO
+    { MP_ROM_QSTR(MP_QSTR_append_fmt), MP_ROM_PTR(&strbuilder_append_fmt_obj) },
+    #endif
+    { MP_ROM_QSTR(MP_QSTR_build), MP_ROM_PTR(&strbuilder_build_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(strbuilder_locals_dict, strbuilder_locals_dict_table);
+
+const mp_obj_type_t mp_type_strbuilder = {
+    { &mp_type_type },
+    .name = MP_QSTR_strbuilder,
+    .make_new = strbuilder_make_new,
+    .unary_op = strbuilder_unary_op,
+    .locals_dict = (mp_obj_dict_t*)&strbuilder_locals_dict,
+};
+
+#endif // MICROPY_PY_MICROPYTHON_STRBUILDER
@@ -69,7 +69,7 @@ STATIC mp_uint_t stringio_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *er
 
 STATIC void stringio_copy_on_write(mp_obj_stringio_t *o) {
     const void *buf = o->vstr->buf;
-    o->vstr->buf = m_new(char, o->vstr->len);
+    o->vstr->buf = m_new(char, o->vstr->alloc);
     memcpy(o->vstr->buf, buf, o->vstr->len);
     o->vstr->fixed_buf = false;
     o->ref_obj = MP_OBJ_NULL;
@@ -162,11 +162,40 @@ STATIC mp_uint_t stringio_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg,
 
 #define STREAM_TO_CONTENT_TYPE(o) (((o)->base.type == &mp_type_stringio) ? &mp_type_str : &mp_type_bytes)
 
+#if MICROPY_OPT_STR_BUILDER
+// Values at least this long are handed the buffer instead of a copy of it
+#define STRINGIO_GETVALUE_MIN_NOCOPY (32)
+#endif
+
 STATIC mp_obj_t stringio_getvalue(mp_obj_t self_in) {
     mp_obj_stringio_t *self = MP_OBJ_TO_PTR(self_in);
     check_stringio_is_open(self);
-    // TODO: Try to avoid copying string
-    return mp_obj_new_str_of_type(STREAM_TO_CONTENT_TYPE(self), (byte*)self->vstr->buf, self->vstr->len);
+    const mp_obj_type_t *type = STREAM_TO_CONTENT_TYPE(self);
+    #if MICROPY_OPT_STR_BUILDER
+    vstr_t *vstr = self->vstr;
+    if (vstr->fixed_buf) {
+        // nothing was written since the buffer was handed to ref_obj, or was
+        // taken from it by the constructor
+        if (self->ref_obj != MP_OBJ_NULL && MP_OBJ_IS_TYPE(self->ref_obj, type)) {
+            GET_STR_DATA_LEN(self->ref_obj, data, len);
+            if (data == (byte*)vstr->buf && len == vstr->len) {
+                return self->ref_obj;
+            }
+        }
+    } else if (vstr->len >= STRINGIO_GETVALUE_MIN_NOCOPY) {
+        // hand the buffer to the result, and copy it when it's next written to
+        mp_obj_str_t *o = MP_OBJ_TO_PTR(mp_obj_new_str_copy(type, NULL, vstr->len));
+        vstr->buf = m_renew(char, vstr->buf, vstr->alloc, vstr->len + 1);
+        vstr->buf[vstr->len] = '\0';
+        vstr->alloc = vstr->len + 1;
+        vstr->fixed_buf = true;
+        o->hash = 0; // computed when needed
+        o->data = (byte*)vstr->buf;
+        self->ref_obj = MP_OBJ_FROM_PTR(o);
+        return self->ref_obj;
+    }
+    #endif
+    return mp_obj_new_str_of_type(type, (byte*)self->vstr->buf, self->vstr->len);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(stringio_getvalue_obj, stringio_getvalue);
 
@@ -98,12 +98,69 @@ STATIC void uni_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t
     }
 }
 
+#if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+
+// Only str data at least this long is put in the index cache, shorter data is
+// quick enough to scan.
+#define STR_INDEX_MIN_LEN (64)
+
+// Number of characters between the offsets saved in the index.
+#define STR_INDEX_STRIDE (32)
+
+// Return the index of the str with the given data, making it if it isn't in
+// MP_STATE_VM(str_index_cache), or NULL if there's no memory for it.
+STATIC const mp_str_index_cache_entry_t *str_index_get(const byte *data, size_t len) {
+    mp_str_index_cache_entry_t *cache = MP_STATE_VM(str_index_cache);
+    for (size_t i = 0; i < MICROPY_PY_BUILTINS_STR_UNICODE_INDEX_CACHE_SIZE; i++) {
+        if (cache[i].data == data && cache[i].len == len) {
+            return &cache[i];
+        }
+    }
+    if (len > UINT32_MAX) {
+        return NULL;
+    }
+    size_t n_chars = utf8_charlen(data, len);
+    uint32_t *offsets = NULL;
+    if (n_chars != len) {
+        offsets = m_new_maybe(uint32_t, (n_chars + STR_INDEX_STRIDE - 1) / STR_INDEX_STRIDE);
+        if (offsets == NULL) {
+            return NULL;
+        }
+        size_t n = 0;
+        for (const byte *s = data, *top = data + len; s < top; s++) {
+            if (!UTF8_IS_CONT(*s)) {
+                if (n % STR_INDEX_STRIDE == 0) {
+                    offsets[n / STR_INDEX_STRIDE] = s - data;
+                }
+                ++n;
+            }
+        }
+    }
+    // the allocation above may have run a collection, which clears the cache
+    mp_str_index_cache_entry_t *e = &cache[MP_STATE_VM(str_index_cache_next)++ % MICROPY_PY_BUILTINS_STR_UNICODE_INDEX_CACHE_SIZE];
+    e->data = data;
+    e->len = len;
+    e->n_chars = n_chars;
+    e->offsets = offsets;
+    return e;
+}
+
+#endif
+
 STATIC mp_obj_t uni_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
     GET_STR_DATA_LEN(self_in, str_data, str_len);
     switch (op) {
         case MP_UNARY_OP_BOOL:
             return mp_obj_new_bool(str_len != 0);
         case MP_UNARY_OP_LEN:
+            #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+            if (str_len >= STR_INDEX_MIN_LEN) {
+                const mp_str_index_cache_entry_t *e = str_index_get(str_data, str_len);
+                if (e != NULL) {
+                    return MP_OBJ_NEW_SMALL_INT(e->n_chars);
+                }
+            }
+            #endif
             return MP_OBJ_NEW_SMALL_INT(utf8_charlen(str_data, str_len));
         default:
             return MP_OBJ_NULL; // op not supported
@@ -132,6 +189,35 @@ const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, s
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError, "string indices must be integers, not %s", mp_obj_get_type_str(index)));
     }
     const byte *s, *top = self_data + self_len;
+    #if MICROPY_PY_BUILTINS_STR_UNICODE_INDEX
+    if (self_len >= STR_INDEX_MIN_LEN) {
+        const mp_str_index_cache_entry_t *e = str_index_get(self_data, self_len);
+        if (e != NULL) {
+            if (i < 0) {
+                i += e->n_chars;
+            }
+            if (i < 0 || (size_t)i >= e->n_chars) {
+                if (is_slice) {
+                    return i < 0 ? self_data : top;
+                }
+                mp_raise_msg(&mp_type_IndexError, "string index out of range");
+            }
+            if (e->offsets == NULL) {
+                // all ASCII
+                return self_data + i;
+            }
+            // skip forward from the nearest saved offset
+            s = self_data + e->offsets[i / STR_INDEX_STRIDE];
+            for (i %= STR_INDEX_STRIDE; i > 0; --i) {
+                ++s;
+                while (UTF8_IS_CONT(*s)) {
+                    ++s;
+                }
+            }
+            return s;
+        }
+    }
+    #endif
     if (i < 0)
     {
         // Negative indexing is performed by counting from the end of the string.
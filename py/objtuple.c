@@ -236,7 +236,7 @@ mp_obj_t mp_obj_new_tuple(size_t n, const mp_obj_t *items) {
     if (n == 0) {
         return mp_const_empty_tuple;
     }
-    mp_obj_tuple_t *o = m_new_obj_var(mp_obj_tuple_t, mp_obj_t, n);
+    mp_obj_tuple_t *o = m_new_obj_var_young(mp_obj_tuple_t, mp_obj_t, n);
     o->base.type = &mp_type_tuple;
     o->len = n;
     if (items) {
@@ -263,14 +263,7 @@ void mp_obj_tuple_del(mp_obj_t self_in) {
 /******************************************************************************/
 /* tuple iterator                                                             */
 
-typedef struct _mp_obj_tuple_it_t {
-    mp_obj_base_t base;
-    mp_fun_1_t iternext;
-    mp_obj_tuple_t *tuple;
-    size_t cur;
-} mp_obj_tuple_it_t;
-
-STATIC mp_obj_t tuple_it_iternext(mp_obj_t self_in) {
+mp_obj_t mp_obj_tuple_it_iternext(mp_obj_t self_in) {
     mp_obj_tuple_it_t *self = MP_OBJ_TO_PTR(self_in);
     if (self->cur < self->tuple->len) {
         mp_obj_t o_out = self->tuple->items[self->cur];
@@ -285,7 +278,7 @@ mp_obj_t mp_obj_tuple_getiter(mp_obj_t o_in, mp_obj_iter_buf_t *iter_buf) {
     assert(sizeof(mp_obj_tuple_it_t) <= sizeof(mp_obj_iter_buf_t));
     mp_obj_tuple_it_t *o = (mp_obj_tuple_it_t*)iter_buf;
     o->base.type = &mp_type_polymorph_iter;
-    o->iternext = tuple_it_iternext;
+    o->iternext = mp_obj_tuple_it_iternext;
     o->tuple = MP_OBJ_TO_PTR(o_in);
     o->cur = 0;
     return MP_OBJ_FROM_PTR(o);
@@ -34,6 +34,13 @@ typedef struct _mp_obj_tuple_t {
     mp_obj_t items[];
 } mp_obj_tuple_t;
 
+typedef struct _mp_obj_tuple_it_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_tuple_t *tuple;
+    size_t cur;
+} mp_obj_tuple_it_t;
+
 typedef struct _mp_rom_obj_tuple_t {
     mp_obj_base_t base;
     size_t len;
@@ -45,6 +52,7 @@ mp_obj_t mp_obj_tuple_unary_op(mp_unary_op_t op, mp_obj_t self_in);
 mp_obj_t mp_obj_tuple_binary_op(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs);
 mp_obj_t mp_obj_tuple_subscr(mp_obj_t base, mp_obj_t index, mp_obj_t value);
 mp_obj_t mp_obj_tuple_getiter(mp_obj_t o_in, mp_obj_iter_buf_t *iter_buf);
+mp_obj_t mp_obj_tuple_it_iternext(mp_obj_t self_in);
 
 extern const mp_obj_type_t mp_type_attrtuple;
 
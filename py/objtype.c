@@ -32,6 +32,7 @@
 
 #include "py/objtype.h"
 #include "py/runtime.h"
+#include "py/bc.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -46,6 +47,7 @@
 
 #define TYPE_FLAG_IS_SUBCLASSED (0x0001)
 #define TYPE_FLAG_HAS_SPECIAL_ACCESSORS (0x0002)
+#define TYPE_FLAG_HAS_NATIVE_BASE (0x0004)
 
 STATIC mp_obj_t static_class_method_make_new(const mp_obj_type_t *self_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
 
@@ -136,68 +138,187 @@ struct class_lookup_data {
     bool is_type;
 };
 
-STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_type_t *type) {
-    assert(lookup->dest[0] == MP_OBJ_NULL);
-    assert(lookup->dest[1] == MP_OBJ_NULL);
-    for (;;) {
-        DEBUG_printf("mp_obj_class_lookup: Looking up %s in %s\n", qstr_str(lookup->attr), qstr_str(type->name));
-        // Optimize special method lookup for native types
-        // This avoids extra method_name => slot lookup. On the other hand,
-        // this should not be applied to class types, as will result in extra
-        // lookup either.
-        if (lookup->meth_offset != 0 && mp_obj_is_native_type(type)) {
-            if (*(void**)((char*)type + lookup->meth_offset) != NULL) {
-                DEBUG_printf("mp_obj_class_lookup: Matched special meth slot (off=%d) for %s\n",
-                    lookup->meth_offset, qstr_str(lookup->attr));
-                lookup->dest[0] = MP_OBJ_SENTINEL;
-                return;
-            }
+// Convert a member found in the locals_dict of type and store it in lookup->dest
+STATIC void mp_obj_class_convert_member(struct class_lookup_data *lookup, const mp_obj_type_t *type, mp_obj_t member) {
+    if (lookup->is_type) {
+        // If we look up a class method, we need to return original type for which we
+        // do a lookup, not a (base) type in which we found the class method.
+        const mp_obj_type_t *org_type = (const mp_obj_type_t*)lookup->obj;
+        mp_convert_member_lookup(MP_OBJ_NULL, org_type, member, lookup->dest);
+    } else {
+        mp_obj_instance_t *obj = lookup->obj;
+        mp_obj_t obj_obj;
+        if (obj != NULL && mp_obj_is_native_type(type) && type != &mp_type_object /* object is not a real type */) {
+            // If we're dealing with native base class, then it applies to native sub-object
+            obj_obj = obj->subobj[0];
+        } else {
+            obj_obj = MP_OBJ_FROM_PTR(obj);
         }
+        mp_convert_member_lookup(obj_obj, type, member, lookup->dest);
+    }
+#if DEBUG_PRINT
+    DEBUG_printf("mp_obj_class_lookup: Returning: ");
+    mp_obj_print_helper(MICROPY_DEBUG_PRINTER, lookup->dest[0], PRINT_REPR);
+    if (lookup->dest[1] != MP_OBJ_NULL) {
+        // Don't try to repr() lookup->dest[1], as we can be called recursively
+        DEBUG_printf(" <%s @%p>", mp_obj_get_type_str(lookup->dest[1]), MP_OBJ_TO_PTR(lookup->dest[1]));
+    }
+    DEBUG_printf("\n");
+#endif
+}
+
+#if MICROPY_OPT_CLASS_LOOKUP_CACHE
+
+#define CLASS_LOOKUP_CACHE_ENTRY(type, attr) \
+    (MP_STATE_VM(class_lookup_cache)[(((uintptr_t)(type) >> 4) ^ (attr)) % MICROPY_OPT_CLASS_LOOKUP_CACHE_SIZE])
+
+// Find the entry for attr in the locals_dict of the first type in the MRO of
+// cls that has it, which must all be classes (no native bases).  The result,
+// including when it's not found, is cached until any class changes.
+STATIC mp_map_elem_t *mp_obj_class_find_elem(const mp_obj_type_t *type_in, qstr attr, const mp_obj_type_t **found_in) {
+    const mp_obj_class_t *cls = (const mp_obj_class_t*)type_in;
+    mp_class_lookup_cache_entry_t *entry = &CLASS_LOOKUP_CACHE_ENTRY(cls, attr);
+    if (entry->type == &cls->type && entry->attr == attr && entry->version == MP_STATE_VM(map_version)) {
+        *found_in = entry->found_in;
+        return entry->elem;
+    }
 
+    mp_map_elem_t *elem = NULL;
+    *found_in = NULL;
+    for (size_t i = 0; i < cls->mro_len; ++i) {
+        const mp_obj_type_t *type = cls->mro[i];
         if (type->locals_dict != NULL) {
-            // search locals_dict (the set of methods/attributes)
-            assert(type->locals_dict->base.type == &mp_type_dict); // MicroPython restriction, for now
-            mp_map_t *locals_map = &type->locals_dict->map;
-            mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(lookup->attr), MP_MAP_LOOKUP);
+            elem = mp_map_lookup(&type->locals_dict->map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
             if (elem != NULL) {
-                if (lookup->is_type) {
-                    // If we look up a class method, we need to return original type for which we
-                    // do a lookup, not a (base) type in which we found the class method.
-                    const mp_obj_type_t *org_type = (const mp_obj_type_t*)lookup->obj;
-                    mp_convert_member_lookup(MP_OBJ_NULL, org_type, elem->value, lookup->dest);
-                } else {
-                    mp_obj_instance_t *obj = lookup->obj;
-                    mp_obj_t obj_obj;
-                    if (obj != NULL && mp_obj_is_native_type(type) && type != &mp_type_object /* object is not a real type */) {
-                        // If we're dealing with native base class, then it applies to native sub-object
-                        obj_obj = obj->subobj[0];
-                    } else {
-                        obj_obj = MP_OBJ_FROM_PTR(obj);
+                *found_in = type;
+                break;
+            }
+        }
+    }
+
+    entry->type = &cls->type;
+    entry->attr = attr;
+    entry->version = MP_STATE_VM(map_version);
+    entry->elem = elem;
+    entry->found_in = *found_in;
+    return elem;
+}
+
+// Add type, and the bases that mp_obj_class_lookup would search after it, to
+// the end of mro, skipping types that are already there (searching a type for
+// a second time can't find anything new).  If mro is NULL then just count
+// the entries needed, including duplicates.
+STATIC size_t class_mro_add(const mp_obj_type_t **mro, size_t n, const mp_obj_type_t *type) {
+    while (type != &mp_type_object) {
+        size_t n_add = 1;
+        const mp_obj_type_t *const *add = &type;
+        if (mp_obj_is_instance_type(type)) {
+            // the MRO of a class includes the class itself and all its bases
+            const mp_obj_class_t *cls = (const mp_obj_class_t*)type;
+            n_add = cls->mro_len;
+            add = cls->mro;
+        }
+        for (size_t i = 0; i < n_add; ++i) {
+            if (mro != NULL) {
+                for (size_t j = 0; j < n; ++j) {
+                    if (mro[j] == add[i]) {
+                        goto skip;
                     }
-                    mp_convert_member_lookup(obj_obj, type, elem->value, lookup->dest);
-                }
-#if DEBUG_PRINT
-                DEBUG_printf("mp_obj_class_lookup: Returning: ");
-                mp_obj_print_helper(MICROPY_DEBUG_PRINTER, lookup->dest[0], PRINT_REPR);
-                if (lookup->dest[1] != MP_OBJ_NULL) {
-                    // Don't try to repr() lookup->dest[1], as we can be called recursively
-                    DEBUG_printf(" <%s @%p>", mp_obj_get_type_str(lookup->dest[1]), MP_OBJ_TO_PTR(lookup->dest[1]));
                 }
-                DEBUG_printf("\n");
-#endif
-                return;
+                mro[n] = add[i];
             }
+            ++n;
+        skip:;
         }
+        if (mp_obj_is_instance_type(type) || type->parent == NULL) {
+            break;
+        #if MICROPY_MULTIPLE_INHERITANCE
+        } else if (((mp_obj_base_t*)type->parent)->type == &mp_type_tuple) {
+            const mp_obj_tuple_t *parent_tuple = type->parent;
+            for (size_t i = 0; i < parent_tuple->len - 1; ++i) {
+                n = class_mro_add(mro, n, MP_OBJ_TO_PTR(parent_tuple->items[i]));
+            }
+            type = MP_OBJ_TO_PTR(parent_tuple->items[parent_tuple->len - 1]);
+        #endif
+        } else {
+            type = type->parent;
+        }
+    }
+    return n;
+}
 
-        // Previous code block takes care about attributes defined in .locals_dict,
-        // but some attributes of native types may be handled using .load_attr method,
-        // so make sure we try to lookup those too.
-        if (lookup->obj != NULL && !lookup->is_type && mp_obj_is_native_type(type) && type != &mp_type_object /* object is not a real type */) {
-            mp_load_method_maybe(lookup->obj->subobj[0], lookup->attr, lookup->dest);
-            if (lookup->dest[0] != MP_OBJ_NULL) {
+#endif
+
+// Look up the attribute in a single type, not including its bases.  Returns
+// true if the search should stop, ie if lookup->dest[0] was set.
+STATIC bool mp_obj_class_lookup_in_type(struct class_lookup_data *lookup, const mp_obj_type_t *type) {
+    DEBUG_printf("mp_obj_class_lookup: Looking up %s in %s\n", qstr_str(lookup->attr), qstr_str(type->name));
+    // Optimize special method lookup for native types
+    // This avoids extra method_name => slot lookup. On the other hand,
+    // this should not be applied to class types, as will result in extra
+    // lookup either.
+    if (lookup->meth_offset != 0 && mp_obj_is_native_type(type)) {
+        if (*(void**)((char*)type + lookup->meth_offset) != NULL) {
+            DEBUG_printf("mp_obj_class_lookup: Matched special meth slot (off=%d) for %s\n",
+                lookup->meth_offset, qstr_str(lookup->attr));
+            lookup->dest[0] = MP_OBJ_SENTINEL;
+            return true;
+        }
+    }
+
+    if (type->locals_dict != NULL) {
+        // search locals_dict (the set of methods/attributes)
+        assert(type->locals_dict->base.type == &mp_type_dict); // MicroPython restriction, for now
+        mp_map_t *locals_map = &type->locals_dict->map;
+        mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(lookup->attr), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            mp_obj_class_convert_member(lookup, type, elem->value);
+            return true;
+        }
+    }
+
+    // Previous code block takes care about attributes defined in .locals_dict,
+    // but some attributes of native types may be handled using .load_attr method,
+    // so make sure we try to lookup those too.
+    if (lookup->obj != NULL && !lookup->is_type && mp_obj_is_native_type(type) && type != &mp_type_object /* object is not a real type */) {
+        mp_load_method_maybe(lookup->obj->subobj[0], lookup->attr, lookup->dest);
+        if (lookup->dest[0] != MP_OBJ_NULL) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_type_t *type) {
+    assert(lookup->dest[0] == MP_OBJ_NULL);
+    assert(lookup->dest[1] == MP_OBJ_NULL);
+
+    #if MICROPY_OPT_CLASS_LOOKUP_CACHE
+    if (mp_obj_is_instance_type(type)) {
+        const mp_obj_class_t *cls = (const mp_obj_class_t*)type;
+        if (!(type->flags & TYPE_FLAG_HAS_NATIVE_BASE)) {
+            // only classes and dicts in the MRO, so the result can be cached
+            const mp_obj_type_t *found_in;
+            mp_map_elem_t *elem = mp_obj_class_find_elem(type, lookup->attr, &found_in);
+            if (elem != NULL) {
+                mp_obj_class_convert_member(lookup, found_in, elem->value);
+            }
+            return;
+        }
+        for (size_t i = 0; i < cls->mro_len; ++i) {
+            if (mp_obj_class_lookup_in_type(lookup, cls->mro[i])) {
                 return;
             }
         }
+        return;
+    }
+    #endif
+
+    for (;;) {
+        if (mp_obj_class_lookup_in_type(lookup, type)) {
+            return;
+        }
 
         // attribute not found, keep searching base classes
 
@@ -278,6 +399,65 @@ STATIC void instance_print(const mp_print_t *print, mp_obj_t self_in, mp_print_k
     mp_printf(print, "<%s object at %p>", mp_obj_get_type_str(self_in), self);
 }
 
+void mp_obj_instance_check_init_ret(mp_obj_t init_ret) {
+    if (init_ret != mp_const_none) {
+        if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+            mp_raise_TypeError("__init__() should return None");
+        } else {
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
+                "__init__() should return None, not '%s'", mp_obj_get_type_str(init_ret)));
+        }
+    }
+}
+
+#if MICROPY_STACKLESS
+// Create a new instance of a class for a constructor call made by the VM.  If
+// __init__ can run in-line then its code state is returned, with the instance
+// passed as self and also stored in *inst_out.  Otherwise __init__ (if any) is
+// called here and NULL is returned with *inst_out set to the constructed
+// instance.  If the class has a __new__ method or a native base then NULL is
+// returned with *inst_out left untouched and mp_obj_instance_make_new must be
+// used instead.
+mp_code_state_t *mp_obj_instance_prepare_init(const mp_obj_type_t *self, size_t n_args, size_t n_kw, const mp_obj_t *args, mp_obj_t *inst_out) {
+    assert(mp_obj_is_instance_type(self));
+    if (self->flags & TYPE_FLAG_HAS_NATIVE_BASE) {
+        return NULL;
+    }
+
+    mp_obj_t init_fn[2] = {MP_OBJ_NULL};
+    struct class_lookup_data lookup = {
+        .obj = NULL,
+        .attr = MP_QSTR___new__,
+        .meth_offset = offsetof(mp_obj_type_t, make_new),
+        .dest = init_fn,
+        .is_type = false,
+    };
+    mp_obj_class_lookup(&lookup, self);
+    if (init_fn[0] != MP_OBJ_NULL) {
+        return NULL;
+    }
+
+    mp_obj_instance_t *o = mp_obj_new_instance(self, NULL);
+    *inst_out = MP_OBJ_FROM_PTR(o);
+
+    lookup.obj = o;
+    lookup.attr = MP_QSTR___init__;
+    lookup.meth_offset = 0;
+    mp_obj_class_lookup(&lookup, self);
+    if (init_fn[0] == MP_OBJ_NULL) {
+        return NULL;
+    }
+    if (init_fn[1] == MP_OBJ_FROM_PTR(o)) {
+        mp_code_state_t *code_state = mp_obj_fun_prepare_codestate_self(init_fn[0], init_fn[1], n_args, n_kw, args);
+        if (code_state != NULL) {
+            return code_state;
+        }
+    }
+    mp_obj_instance_check_init_ret(mp_call_method_self_n_kw(init_fn[0], init_fn[1], n_args, n_kw, args));
+    return NULL;
+}
+#endif
+
 mp_obj_t mp_obj_instance_make_new(const mp_obj_type_t *self, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     assert(mp_obj_is_instance_type(self));
 
@@ -350,15 +530,7 @@ mp_obj_t mp_obj_instance_make_new(const mp_obj_type_t *self, size_t n_args, size
             init_ret = mp_call_method_n_kw(n_args, n_kw, args2);
             m_del(mp_obj_t, args2, 2 + n_args + 2 * n_kw);
         }
-        if (init_ret != mp_const_none) {
-            if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-                mp_raise_TypeError("__init__() should return None");
-            } else {
-                nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
-                    "__init__() should return None, not '%s'", mp_obj_get_type_str(init_ret)));
-            }
-        }
-
+        mp_obj_instance_check_init_ret(init_ret);
     }
 
     // If the type had a native base that was not explicitly initialised
@@ -398,7 +570,7 @@ STATIC mp_obj_t instance_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
         size_t num_native_bases = instance_count_native_bases(mp_obj_get_type(self_in), &native_base);
 
         size_t sz = sizeof(*self) + sizeof(*self->subobj) * num_native_bases
-            + sizeof(*self->members.table) * self->members.alloc;
+            + mp_map_table_bytes(&self->members);
         return MP_OBJ_NEW_SMALL_INT(sz);
     }
     #endif
@@ -674,6 +846,109 @@ STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *des
     }
 }
 
+#if MICROPY_OPT_ATTR_INLINE_CACHE
+
+#if !MICROPY_OPT_CLASS_LOOKUP_CACHE
+// Find the entry for attr in the locals_dict of type or one of its bases, in
+// the same order as mp_obj_class_lookup.  The class must not have any native
+// bases, so the result is never a native slot.
+STATIC mp_map_elem_t *mp_obj_class_find_elem(const mp_obj_type_t *type, qstr attr, const mp_obj_type_t **found_in) {
+    for (;;) {
+        if (type->locals_dict != NULL) {
+            mp_map_elem_t *elem = mp_map_lookup(&type->locals_dict->map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+            if (elem != NULL) {
+                *found_in = type;
+                return elem;
+            }
+        }
+
+        if (type->parent == NULL) {
+            return NULL;
+        #if MICROPY_MULTIPLE_INHERITANCE
+        } else if (((mp_obj_base_t*)type->parent)->type == &mp_type_tuple) {
+            const mp_obj_tuple_t *parent_tuple = type->parent;
+            const mp_obj_t *item = parent_tuple->items;
+            const mp_obj_t *top = item + parent_tuple->len - 1;
+            for (; item < top; ++item) {
+                const mp_obj_type_t *bt = (const mp_obj_type_t*)MP_OBJ_TO_PTR(*item);
+                if (bt != &mp_type_object) {
+                    mp_map_elem_t *elem = mp_obj_class_find_elem(bt, attr, found_in);
+                    if (elem != NULL) {
+                        return elem;
+                    }
+                }
+            }
+            type = (const mp_obj_type_t*)MP_OBJ_TO_PTR(*item);
+        #endif
+        } else {
+            type = type->parent;
+        }
+        if (type == &mp_type_object) {
+            return NULL;
+        }
+    }
+}
+#endif
+
+// Load an attribute or method of an instance like mp_load_method_maybe, using
+// the given set of cache entries for the lookup in the class.  Returns false
+// if the lookup can't be cached (eg the class has special accessors or native
+// bases, or the attribute is not found in the class) and the caller must then
+// do a normal lookup.
+bool mp_obj_instance_load_method_cached(mp_obj_t self_in, qstr attr, mp_obj_t *dest, mp_attr_cache_entry_t *set) {
+    const mp_obj_type_t *type = mp_obj_get_type(self_in);
+    if (!mp_obj_is_instance_type(type) || (type->flags & TYPE_FLAG_HAS_SPECIAL_ACCESSORS)) {
+        return false;
+    }
+    #if MICROPY_CPYTHON_COMPAT
+    if (attr == MP_QSTR___class__ || attr == MP_QSTR___dict__) {
+        return false;
+    }
+    #endif
+
+    // object members come first, and are always treated as values
+    mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t key = MP_OBJ_NEW_QSTR(attr);
+    mp_map_elem_t *elem = mp_map_lookup(&self->members, key, MP_MAP_LOOKUP);
+    if (elem != NULL) {
+        dest[0] = elem->value;
+        dest[1] = MP_OBJ_NULL;
+        return true;
+    }
+
+    mp_uint_t version = MP_STATE_VM(map_version);
+    elem = NULL;
+    for (size_t i = 0; i < MP_ATTR_CACHE_WAYS; ++i) {
+        if (set[i].type == type && set[i].version == version && set[i].elem->key == key) {
+            elem = set[i].elem;
+            break;
+        }
+    }
+
+    if (elem == NULL) {
+        if (type->flags & TYPE_FLAG_HAS_NATIVE_BASE) {
+            return false;
+        }
+        const mp_obj_type_t *found_in;
+        elem = mp_obj_class_find_elem(type, attr, &found_in);
+        if (elem == NULL) {
+            return false;
+        }
+        // evict the least recently filled entry
+        memmove(&set[1], &set[0], (MP_ATTR_CACHE_WAYS - 1) * sizeof(*set));
+        set[0].type = type;
+        set[0].version = version;
+        set[0].elem = elem;
+    }
+
+    dest[0] = MP_OBJ_NULL;
+    dest[1] = MP_OBJ_NULL;
+    mp_convert_member_lookup(self_in, type, elem->value, dest);
+    return true;
+}
+
+#endif
+
 STATIC bool mp_obj_instance_store_attr(mp_obj_t self_in, qstr attr, mp_obj_t value) {
     mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
 
@@ -1107,7 +1382,22 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
         #endif
     }
 
+    #if MICROPY_OPT_CLASS_LOOKUP_CACHE
+    size_t mro_alloc = 1;
+    for (size_t i = 0; i < bases_len; i++) {
+        mro_alloc = class_mro_add(NULL, mro_alloc, MP_OBJ_TO_PTR(bases_items[i]));
+    }
+    mp_obj_class_t *cls = m_new_obj_var(mp_obj_class_t, const mp_obj_type_t*, mro_alloc);
+    memset(cls, 0, sizeof(mp_obj_class_t));
+    mp_obj_type_t *o = &cls->type;
+    cls->mro[0] = o;
+    cls->mro_len = 1;
+    for (size_t i = 0; i < bases_len; i++) {
+        cls->mro_len = class_mro_add(cls->mro, cls->mro_len, MP_OBJ_TO_PTR(bases_items[i]));
+    }
+    #else
     mp_obj_type_t *o = m_new0(mp_obj_type_t, 1);
+    #endif
     o->base.type = &mp_type_type;
     o->flags = base_flags;
     o->name = name;
@@ -1142,6 +1432,11 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
 
     o->locals_dict = MP_OBJ_TO_PTR(locals_dict);
 
+    #if MICROPY_MAP_VERSION
+    // Track changes to the class dict, and to which class lives at this address
+    mp_map_set_versioned(&o->locals_dict->map);
+    #endif
+
     #if ENABLE_SPECIAL_ACCESSORS
     // Check if the class has any special accessor methods
     if (!(o->flags & TYPE_FLAG_HAS_SPECIAL_ACCESSORS)) {
@@ -1162,6 +1457,9 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
     if (num_native_bases > 1) {
         mp_raise_TypeError("multiple bases have instance lay-out conflict");
     }
+    if (num_native_bases != 0) {
+        o->flags |= TYPE_FLAG_HAS_NATIVE_BASE;
+    }
 
     mp_map_t *locals_map = &o->locals_dict->map;
     mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(MP_QSTR___new__), MP_MAP_LOOKUP);
@@ -46,9 +46,48 @@ mp_obj_instance_t *mp_obj_new_instance(const mp_obj_type_t *cls, const mp_obj_ty
 bool mp_obj_instance_is_callable(mp_obj_t self_in);
 mp_obj_t mp_obj_instance_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
 
+#if MICROPY_OPT_CLASS_LOOKUP_CACHE
+// a class created at runtime (by mp_obj_new_type), with its MRO linearised:
+// the class and its bases in the order they are searched for attributes
+typedef struct _mp_obj_class_t {
+    mp_obj_type_t type;
+    size_t mro_len;
+    const mp_obj_type_t *mro[];
+} mp_obj_class_t;
+
+// an entry in the cache of lookups in classes, see mpconfig.h
+typedef struct _mp_class_lookup_cache_entry_t {
+    const mp_obj_type_t *type;
+    qstr attr;
+    mp_uint_t version;
+    mp_map_elem_t *elem;
+    const mp_obj_type_t *found_in;
+} mp_class_lookup_cache_entry_t;
+#endif
+
+#if MICROPY_OPT_ATTR_INLINE_CACHE
+// an entry in the inline cache for LOAD_ATTR/LOAD_METHOD, see mpconfig.h
+typedef struct _mp_attr_cache_entry_t {
+    const mp_obj_type_t *type;
+    mp_uint_t version;
+    mp_map_elem_t *elem;
+} mp_attr_cache_entry_t;
+
+#define MP_ATTR_CACHE_WAYS (2)
+
+bool mp_obj_instance_load_method_cached(mp_obj_t self_in, qstr attr, mp_obj_t *dest, mp_attr_cache_entry_t *set);
+#endif
+
 #define mp_obj_is_instance_type(type) ((type)->make_new == mp_obj_instance_make_new)
 #define mp_obj_is_native_type(type) ((type)->make_new != mp_obj_instance_make_new)
 // this needs to be exposed for the above macros to work correctly
 mp_obj_t mp_obj_instance_make_new(const mp_obj_type_t *self_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
 
+void mp_obj_instance_check_init_ret(mp_obj_t init_ret);
+
+#if MICROPY_STACKLESS
+struct _mp_code_state_t;
+struct _mp_code_state_t *mp_obj_instance_prepare_init(const mp_obj_type_t *self, size_t n_args, size_t n_kw, const mp_obj_t *args, mp_obj_t *inst_out);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_OBJTYPE_H
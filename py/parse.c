@@ -38,6 +38,7 @@
 #include "py/objint.h"
 #include "py/objstr.h"
 #include "py/builtin.h"
+#include "py/gc.h"
 
 #if MICROPY_ENABLE_COMPILER
 
@@ -452,6 +453,7 @@ STATIC mp_parse_node_t make_node_const_object(parser_t *parser, size_t src_line,
     pn->kind_num_nodes = RULE_const_object | (1 << 8);
     pn->nodes[0] = (uintptr_t)obj;
     #endif
+    gc_write_barrier(pn);
     return (mp_parse_node_t)pn;
 }
 
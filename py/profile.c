@@ -0,0 +1,185 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/bc.h"
+#include "py/mphal.h"
+#include "py/profile.h"
+
+#if MICROPY_PY_MICROPYTHON_PROFILE
+
+// The sample buffer holds a sequence of records, one for each run of samples
+// that had the same stack:
+//
+//  count, depth, fun_bc_0, line_0, ..., fun_bc_<depth-1>, line_<depth-1>
+//
+// with the innermost frame first.  Storing the line rather than the ip means
+// a hot loop keeps hitting the same record, so the buffer fills up slowly.
+
+// Check whether the stack starting at code_state matches the given record
+STATIC bool prof_stack_equal(const mp_code_state_t *code_state, const mp_uint_t *rec) {
+    size_t depth = rec[1];
+    rec += 2;
+    for (; code_state != NULL; code_state = code_state->prev_state) {
+        if (depth-- == 0 || (mp_obj_fun_bc_t*)rec[0] != code_state->fun_bc) {
+            return false;
+        }
+        qstr block_name, source_file;
+        size_t line;
+        mp_bytecode_get_source_info(code_state->fun_bc->bytecode, code_state->ip,
+            &block_name, &source_file, &line);
+        if (rec[1] != line) {
+            return false;
+        }
+        rec += 2;
+    }
+    return depth == 0;
+}
+
+void mp_prof_sample(void) {
+    mp_uint_t *buf = MP_STATE_VM(prof_buf);
+    if (buf == NULL) {
+        return;
+    }
+    #if MICROPY_PY_THREAD
+    mp_state_thread_t *ts = mp_thread_get_state();
+    if (ts == NULL) {
+        // a thread that MicroPython doesn't know about
+        return;
+    }
+    const mp_code_state_t *code_state = ts->current_code_state;
+    #else
+    const mp_code_state_t *code_state = MP_STATE_THREAD(current_code_state);
+    #endif
+    if (code_state == NULL) {
+        // not running any bytecode
+        return;
+    }
+
+    size_t len = MP_STATE_VM(prof_buf_len);
+    if (len > 0) {
+        mp_uint_t *last = buf + MP_STATE_VM(prof_last);
+        if (prof_stack_equal(code_state, last)) {
+            last[0] += 1;
+            return;
+        }
+    }
+
+    mp_uint_t *rec = buf + len;
+    mp_uint_t *end = buf + MP_STATE_VM(prof_buf_alloc);
+    mp_uint_t *p = rec + 2;
+    for (; code_state != NULL; code_state = code_state->prev_state) {
+        if (p + 2 > end) {
+            MP_STATE_VM(prof_n_dropped) += 1;
+            return;
+        }
+        qstr block_name, source_file;
+        size_t line;
+        mp_bytecode_get_source_info(code_state->fun_bc->bytecode, code_state->ip,
+            &block_name, &source_file, &line);
+        *p++ = (mp_uint_t)code_state->fun_bc;
+        *p++ = line;
+    }
+    rec[0] = 1;
+    rec[1] = (p - rec - 2) / 2;
+    MP_STATE_VM(prof_last) = len;
+    MP_STATE_VM(prof_buf_len) = p - buf;
+}
+
+void mp_prof_start(mp_uint_t interval_us, size_t buf_words) {
+    if (MP_STATE_VM(prof_buf) != NULL) {
+        mp_raise_msg(&mp_type_RuntimeError, "profiler already running");
+    }
+    if (interval_us == 0 || buf_words < 4) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_uint_t *buf = m_new(mp_uint_t, buf_words);
+    MP_STATE_VM(prof_buf_alloc) = buf_words;
+    MP_STATE_VM(prof_buf_len) = 0;
+    MP_STATE_VM(prof_last) = 0;
+    MP_STATE_VM(prof_n_dropped) = 0;
+    // setting the buffer enables sampling
+    MP_STATE_VM(prof_buf) = buf;
+    mp_hal_profile_timer_start(interval_us);
+}
+
+// Stop sampling and return the samples as collapsed stacks, one line per
+// distinct stack with its frames outermost first and separated by ';', then
+// a space and the number of samples:
+//
+//  <module> (main.py:10);f (main.py:3);g (main.py:6) 42
+//
+// This is the input format of flamegraph.pl and similar tools.
+mp_obj_t mp_prof_stop(void) {
+    mp_uint_t *buf = MP_STATE_VM(prof_buf);
+    if (buf == NULL) {
+        mp_raise_msg(&mp_type_RuntimeError, "profiler not running");
+    }
+    mp_hal_profile_timer_stop();
+    // the buffer stays reachable from the C stack while the result is built
+    MP_STATE_VM(prof_buf) = NULL;
+    size_t len = MP_STATE_VM(prof_buf_len);
+
+    if (MP_STATE_VM(prof_n_dropped) != 0) {
+        mp_warning("profiler buffer full, %u samples dropped", (uint)MP_STATE_VM(prof_n_dropped));
+    }
+
+    // total up the samples of each stack, which may be in many records
+    mp_obj_t counts = mp_obj_new_dict(0);
+    mp_map_t *map = mp_obj_dict_get_map(counts);
+    vstr_t vstr;
+    mp_print_t print;
+    vstr_init_print(&vstr, 64, &print);
+    for (size_t i = 0; i < len; i += 2 + 2 * buf[i + 1]) {
+        mp_uint_t *rec = buf + i;
+        vstr_reset(&vstr);
+        for (size_t j = rec[1]; j > 0; --j) {
+            const mp_obj_fun_bc_t *fun = (const mp_obj_fun_bc_t*)rec[2 * j];
+            qstr block_name, source_file;
+            mp_bytecode_get_source_info(fun->bytecode, NULL, &block_name, &source_file, NULL);
+            mp_printf(&print, j == rec[1] ? "%q (%q:%u)" : ";%q (%q:%u)",
+                block_name, source_file, (uint)rec[2 * j + 1]);
+        }
+        mp_obj_t key = mp_obj_new_str(vstr.buf, vstr.len);
+        mp_map_elem_t *elem = mp_map_lookup(map, key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+        mp_int_t n = elem->value == MP_OBJ_NULL ? 0 : MP_OBJ_SMALL_INT_VALUE(elem->value);
+        elem->value = MP_OBJ_NEW_SMALL_INT(n + rec[0]);
+    }
+    m_del(mp_uint_t, buf, MP_STATE_VM(prof_buf_alloc));
+
+    vstr_reset(&vstr);
+    for (size_t i = 0; i < map->alloc; ++i) {
+        if (MP_MAP_SLOT_IS_FILLED(map, i)) {
+            mp_printf(&print, "%s " INT_FMT "\n", mp_obj_str_get_str(map->table[i].key),
+                MP_OBJ_SMALL_INT_VALUE(map->table[i].value));
+        }
+    }
+    return mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
+}
+
+#endif // MICROPY_PY_MICROPYTHON_PROFILE
@@ -0,0 +1,46 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_PY_PROFILE_H
+#define MICROPY_INCLUDED_PY_PROFILE_H
+
+#include "py/obj.h"
+
+#if MICROPY_PY_MICROPYTHON_PROFILE
+
+// Size in words of the sample buffer if profile_start isn't given one
+#define MP_PROF_DEFAULT_BUF_WORDS (8192)
+
+void mp_prof_start(mp_uint_t interval_us, size_t buf_words);
+mp_obj_t mp_prof_stop(void);
+
+// Record the stack of the thread that is running.  Called by the port's timer,
+// eg from a signal handler, so it doesn't allocate or raise.  Calls to it must
+// not overlap each other.
+void mp_prof_sample(void);
+
+#endif
+
+#endif // MICROPY_INCLUDED_PY_PROFILE_H
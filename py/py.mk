@@ -205,6 +205,7 @@ PY_CORE_O_BASENAME = $(addprefix py/,\
 	objstr.o \
 	objstrunicode.o \
 	objstringio.o \
+	objstrbuilder.o \
 	objtuple.o \
 	objtype.o \
 	objzip.o \
@@ -227,9 +228,12 @@ PY_CORE_O_BASENAME = $(addprefix py/,\
 	modsys.o \
 	moduerrno.o \
 	modthread.o \
+	modtracemalloc.o \
 	vm.o \
 	bc.o \
 	showbc.o \
+	profile.o \
+	heapdump.o \
 	repl.o \
 	smallint.o \
 	frozenmod.o \
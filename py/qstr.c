@@ -32,8 +32,9 @@
 #include "py/qstr.h"
 #include "py/gc.h"
 
-// NOTE: we are using linear arrays to store and search for qstr's (unique strings, interned strings)
-// ultimately we will replace this with a static hash table of some kind
+// NOTE: we are using linear arrays to store qstr's (unique strings, interned strings)
+// lookup by string data is done with a linear search of the pools, or, if
+// MICROPY_QSTR_HASH_INDEX is enabled, via an open-addressed hash index
 // also probably need to include the length in the string data, to allow null bytes in the string
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
@@ -85,12 +86,17 @@
 #define MICROPY_ALLOC_QSTR_ENTRIES_INIT (10)
 
 // this must match the equivalent function in makeqstrdata.py
-mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
+// the low bits of the result do not depend on the width of mp_uint_t
+STATIC mp_uint_t qstr_compute_hash_raw(const byte *data, size_t len) {
     // djb2 algorithm; see http://www.cse.yorku.ca/~oz/hash.html
     mp_uint_t hash = 5381;
     for (const byte *top = data + len; data < top; data++) {
         hash = ((hash << 5) + hash) ^ (*data); // hash * 33 ^ data
     }
+    return hash;
+}
+
+STATIC mp_uint_t qstr_hash_from_raw(mp_uint_t hash) {
     hash &= Q_HASH_MASK;
     // Make sure that valid hash is never zero, zero means "hash not computed"
     if (hash == 0) {
@@ -99,6 +105,11 @@ mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
     return hash;
 }
 
+// this must match the equivalent function in makeqstrdata.py
+mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
+    return qstr_hash_from_raw(qstr_compute_hash_raw(data, len));
+}
+
 const qstr_pool_t mp_qstr_const_pool = {
     NULL,               // no previous pool
     0,                  // no previous pool
@@ -120,10 +131,35 @@ extern const qstr_pool_t MICROPY_QSTR_EXTRA_POOL;
 #define CONST_POOL mp_qstr_const_pool
 #endif
 
+#if MICROPY_QSTR_HASH_INDEX
+
+// Hash index of mp_qstr_const_pool, generated by makeqstrdata.py.  It's an
+// open-addressed table using linear probing, and empty slots are MP_QSTR_NULL.
+STATIC const uint16_t qstr_const_index[] = {
+#ifndef NO_QSTR
+#define QDEF(id, str)
+#define QINDEX(id) id,
+#include "genhdr/qstrdefs.generated.h"
+#undef QINDEX
+#undef QDEF
+#endif
+};
+
+// Initial number of slots in the hash index of qstrs not in mp_qstr_const_pool.
+#define MICROPY_ALLOC_QSTR_INDEX_INIT (32)
+
+#endif
+
 void qstr_init(void) {
     MP_STATE_VM(last_pool) = (qstr_pool_t*)&CONST_POOL; // we won't modify the const_pool since it has no allocated room left
     MP_STATE_VM(qstr_last_chunk) = NULL;
 
+    #if MICROPY_QSTR_HASH_INDEX
+    MP_STATE_VM(qstr_index) = NULL;
+    MP_STATE_VM(qstr_index_alloc) = 0;
+    MP_STATE_VM(qstr_index_top) = MP_QSTRnumber_of;
+    #endif
+
     #if MICROPY_PY_THREAD
     mp_thread_mutex_init(&MP_STATE_VM(qstr_mutex));
     #endif
@@ -139,6 +175,63 @@ STATIC const byte *find_qstr(qstr q) {
     return pool->qstrs[q - pool->total_prev_len];
 }
 
+STATIC inline bool qstr_matches(const byte *q_ptr, mp_uint_t hash, const char *str, size_t str_len) {
+    return Q_GET_HASH(q_ptr) == hash && Q_GET_LENGTH(q_ptr) == str_len && memcmp(Q_GET_DATA(q_ptr), str, str_len) == 0;
+}
+
+#if MICROPY_QSTR_HASH_INDEX
+
+STATIC void qstr_index_insert(qstr *index, size_t alloc, qstr q) {
+    size_t len;
+    const byte *data = qstr_data(q, &len);
+    size_t slot = qstr_compute_hash_raw(data, len) & (alloc - 1);
+    while (index[slot] != MP_QSTR_NULL) {
+        slot = (slot + 1) & (alloc - 1);
+    }
+    index[slot] = q;
+}
+
+// Bring the index of dynamic qstrs up to date after a new qstr was added.
+// The index covers qstrs from MP_QSTRnumber_of up to qstr_index_top, and
+// any qstrs beyond that are found by qstr_find_strn using a linear search,
+// so if the index can't be grown here it's not an error.
+// qstr_mutex must be taken while in this function
+STATIC void qstr_index_update(void) {
+    size_t total = QSTR_TOTAL();
+    size_t alloc = MP_STATE_VM(qstr_index_alloc);
+    if (MP_STATE_VM(qstr_index_top) + 1 == total && (total - MP_QSTRnumber_of) * 4 <= alloc * 3) {
+        // common case: there is room for the new qstr in the existing index
+        qstr_index_insert(MP_STATE_VM(qstr_index), alloc, total - 1);
+        MP_STATE_VM(qstr_index_top) = total;
+        return;
+    }
+
+    // allocate a bigger index and rebuild it from all the non-const qstrs
+    size_t new_alloc = MAX(alloc, MICROPY_ALLOC_QSTR_INDEX_INIT);
+    while ((total - MP_QSTRnumber_of) * 4 > new_alloc * 3) {
+        new_alloc *= 2;
+    }
+    qstr *new_index = m_new_maybe(qstr, new_alloc);
+    if (new_index == NULL) {
+        return;
+    }
+    memset(new_index, 0, new_alloc * sizeof(qstr));
+    for (qstr q = MP_QSTRnumber_of; q < total; ++q) {
+        qstr_index_insert(new_index, new_alloc, q);
+    }
+    #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
+    // another thread may be searching the old index, so leave it to the GC
+    #else
+    m_del(qstr, MP_STATE_VM(qstr_index), alloc);
+    #endif
+    MP_STATE_VM(qstr_index) = new_index;
+    MP_STATE_VM(qstr_index_alloc) = new_alloc;
+    MP_STATE_VM(qstr_index_top) = total;
+    DEBUG_printf("QSTR: rebuild index with %d slots\n", new_alloc);
+}
+
+#endif
+
 // qstr_mutex must be taken while in this function
 STATIC qstr qstr_add(const byte *q_ptr) {
     DEBUG_printf("QSTR: add hash=%d len=%d data=%.*s\n", Q_GET_HASH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_DATA(q_ptr));
@@ -166,23 +259,70 @@ STATIC qstr qstr_add(const byte *q_ptr) {
     // add the new qstr
     MP_STATE_VM(last_pool)->qstrs[MP_STATE_VM(last_pool)->len++] = q_ptr;
 
+    #if MICROPY_QSTR_HASH_INDEX
+    qstr_index_update();
+    #endif
+
     // return id for the newly-added qstr
     return MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
 }
 
 qstr qstr_find_strn(const char *str, size_t str_len) {
     // work out hash of str
-    mp_uint_t str_hash = qstr_compute_hash((const byte*)str, str_len);
+    mp_uint_t str_hash_raw = qstr_compute_hash_raw((const byte*)str, str_len);
+    mp_uint_t str_hash = qstr_hash_from_raw(str_hash_raw);
+
+    #if MICROPY_QSTR_HASH_INDEX
+
+    // search the index of the const pool
+    size_t mask = MP_ARRAY_SIZE(qstr_const_index) - 1;
+    for (size_t slot = str_hash_raw & mask; qstr_const_index[slot] != MP_QSTR_NULL; slot = (slot + 1) & mask) {
+        qstr q = qstr_const_index[slot];
+        if (qstr_matches(mp_qstr_const_pool.qstrs[q], str_hash, str, str_len)) {
+            return q;
+        }
+    }
+
+    // search the index of the remaining qstrs, if it exists
+    if (MP_STATE_VM(qstr_index) != NULL) {
+        mask = MP_STATE_VM(qstr_index_alloc) - 1;
+        for (size_t slot = str_hash_raw & mask; MP_STATE_VM(qstr_index)[slot] != MP_QSTR_NULL; slot = (slot + 1) & mask) {
+            qstr q = MP_STATE_VM(qstr_index)[slot];
+            if (qstr_matches(find_qstr(q), str_hash, str, str_len)) {
+                return q;
+            }
+        }
+    }
+
+    // search pools for qstrs that are not yet in any index
+    size_t top = MP_STATE_VM(qstr_index_top);
+    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); pool->total_prev_len + pool->len > top; pool = pool->prev) {
+        const byte **q = pool->qstrs;
+        if (pool->total_prev_len < top) {
+            q += top - pool->total_prev_len;
+        }
+        for (const byte **q_top = pool->qstrs + pool->len; q < q_top; q++) {
+            if (qstr_matches(*q, str_hash, str, str_len)) {
+                return pool->total_prev_len + (q - pool->qstrs);
+            }
+        }
+    }
+
+    #else
+
+    (void)str_hash_raw;
 
     // search pools for the data
     for (qstr_pool_t *pool = MP_STATE_VM(last_pool); pool != NULL; pool = pool->prev) {
         for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
-            if (Q_GET_HASH(*q) == str_hash && Q_GET_LENGTH(*q) == str_len && memcmp(Q_GET_DATA(*q), str, str_len) == 0) {
+            if (qstr_matches(*q, str_hash, str, str_len)) {
                 return pool->total_prev_len + (q - pool->qstrs);
             }
         }
     }
 
+    #endif
+
     // not found; return null qstr
     return 0;
 }
@@ -288,6 +428,9 @@ void qstr_pool_info(size_t *n_pool, size_t *n_qstr, size_t *n_str_data_bytes, si
         *n_total_bytes += sizeof(qstr_pool_t) + sizeof(qstr) * pool->alloc;
         #endif
     }
+    #if MICROPY_QSTR_HASH_INDEX
+    *n_total_bytes += sizeof(qstr) * MP_STATE_VM(qstr_index_alloc);
+    #endif
     *n_total_bytes += *n_str_data_bytes;
     QSTR_EXIT();
 }
@@ -61,3 +61,7 @@ Q(utf-8)
 #if MICROPY_ENABLE_PYSTACK
 Q(pystack exhausted)
 #endif
+
+#if MICROPY_PY_UTRACEMALLOC
+Q(<unknown>)
+#endif
@@ -40,6 +40,7 @@
 #include "py/builtin.h"
 #include "py/stackctrl.h"
 #include "py/gc.h"
+#include "py/mphal.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -60,6 +61,13 @@ void mp_init(void) {
 
     // no pending exceptions to start with
     MP_STATE_VM(mp_pending_exception) = MP_OBJ_NULL;
+
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    MP_STATE_VM(prof_buf) = NULL;
+    #endif
+    #if MICROPY_PY_UTRACEMALLOC
+    MP_STATE_VM(trace_sites) = NULL;
+    #endif
     #if MICROPY_ENABLE_SCHEDULER
     MP_STATE_VM(sched_state) = MP_SCHED_IDLE;
     MP_STATE_VM(sched_sp) = 0;
@@ -94,6 +102,9 @@ void mp_init(void) {
     // initialise the __main__ module
     mp_obj_dict_init(&MP_STATE_VM(dict_main), 1);
     mp_obj_dict_store(MP_OBJ_FROM_PTR(&MP_STATE_VM(dict_main)), MP_OBJ_NEW_QSTR(MP_QSTR___name__), MP_OBJ_NEW_QSTR(MP_QSTR___main__));
+    #if MICROPY_OPT_LOAD_GLOBAL_CACHE
+    mp_map_set_versioned(&MP_STATE_VM(dict_main).map);
+    #endif
 
     // locals = globals for outer module (see Objects/frameobject.c/PyFrame_New())
     mp_locals_set(&MP_STATE_VM(dict_main));
@@ -131,6 +142,14 @@ void mp_init(void) {
 void mp_deinit(void) {
     MP_THREAD_GIL_EXIT();
 
+    #if MICROPY_PY_MICROPYTHON_PROFILE
+    // don't leave the profiler sampling into a heap that's going away
+    if (MP_STATE_VM(prof_buf) != NULL) {
+        mp_hal_profile_timer_stop();
+        MP_STATE_VM(prof_buf) = NULL;
+    }
+    #endif
+
     //mp_obj_dict_free(&dict_main);
     //mp_map_deinit(&MP_STATE_VM(mp_loaded_modules_map));
 
@@ -180,6 +199,53 @@ mp_obj_t mp_load_global(qstr qst) {
     return elem->value;
 }
 
+#if MICROPY_OPT_LOAD_GLOBAL_CACHE
+mp_obj_t mp_load_name_cached(qstr qst, mp_global_cache_entry_t *entry) {
+    if (mp_locals_get() != mp_globals_get()) {
+        mp_map_elem_t *elem = mp_map_lookup(&mp_locals_get()->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            return elem->value;
+        }
+    }
+    return mp_load_global_cached(qst, entry);
+}
+
+// Same as mp_load_global but the map element that is found is remembered in
+// entry.  Only module dicts are versioned, so changes to other dicts used as
+// globals (eg by exec) can't be tracked and lookups in them aren't cached.
+mp_obj_t mp_load_global_cached(qstr qst, mp_global_cache_entry_t *entry) {
+    mp_obj_dict_t *globals = mp_globals_get();
+    if (entry->globals == globals && entry->qst == qst && entry->version == MP_STATE_VM(map_version)
+        && globals->map.is_versioned) {
+        return entry->elem->value;
+    }
+    if (!globals->map.is_versioned) {
+        return mp_load_global(qst);
+    }
+    mp_map_elem_t *elem = mp_map_lookup(&globals->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
+    if (elem == NULL) {
+        #if MICROPY_CAN_OVERRIDE_BUILTINS
+        if (MP_STATE_VM(mp_module_builtins_override_dict) != NULL) {
+            elem = mp_map_lookup(&MP_STATE_VM(mp_module_builtins_override_dict)->map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
+        }
+        if (elem == NULL)
+        #endif
+        {
+            elem = mp_map_lookup((mp_map_t*)&mp_module_builtins_globals.map, MP_OBJ_NEW_QSTR(qst), MP_MAP_LOOKUP);
+            if (elem == NULL) {
+                // raise the NameError
+                return mp_load_global(qst);
+            }
+        }
+    }
+    entry->globals = globals;
+    entry->qst = qst;
+    entry->version = MP_STATE_VM(map_version);
+    entry->elem = elem;
+    return elem->value;
+}
+#endif
+
 mp_obj_t mp_load_build_class(void) {
     DEBUG_OP_printf("load_build_class\n");
     #if MICROPY_CAN_OVERRIDE_BUILTINS
@@ -884,10 +950,12 @@ void mp_unpack_ex(mp_obj_t seq_in, size_t num_in, mp_obj_t *items) {
         if (seq_len < num_left + num_right) {
             goto too_short;
         }
+        // make the list before storing to items, which holds seq_in
+        mp_obj_t rest = mp_obj_new_list(seq_len - num_left - num_right, seq_items + num_left);
         for (size_t i = 0; i < num_right; i++) {
             items[i] = seq_items[seq_len - 1 - i];
         }
-        items[num_right] = mp_obj_new_list(seq_len - num_left - num_right, seq_items + num_left);
+        items[num_right] = rest;
         for (size_t i = 0; i < num_left; i++) {
             items[num_right + 1 + i] = seq_items[num_left - 1 - i];
         }
@@ -1147,7 +1215,7 @@ mp_obj_t mp_getiter(mp_obj_t o_in, mp_obj_iter_buf_t *iter_buf) {
 
     // if caller did not provide a buffer then allocate one on the heap
     if (iter_buf == NULL) {
-        iter_buf = m_new_obj(mp_obj_iter_buf_t);
+        iter_buf = m_new_obj_young(mp_obj_iter_buf_t);
     }
 
     // check for native getiter (corresponds to __iter__)
@@ -93,6 +93,10 @@ static inline void mp_globals_set(mp_obj_dict_t *d) { MP_STATE_THREAD(dict_globa
 
 mp_obj_t mp_load_name(qstr qst);
 mp_obj_t mp_load_global(qstr qst);
+#if MICROPY_OPT_LOAD_GLOBAL_CACHE
+mp_obj_t mp_load_name_cached(qstr qst, mp_global_cache_entry_t *entry);
+mp_obj_t mp_load_global_cached(qstr qst, mp_global_cache_entry_t *entry);
+#endif
 mp_obj_t mp_load_build_class(void);
 void mp_store_name(qstr qst, mp_obj_t obj);
 void mp_store_global(qstr qst, mp_obj_t obj);
@@ -77,6 +77,13 @@
 
 #endif
 
+#if MICROPY_OPT_BYTECODE_QUICKENING
+// strip the count of de-specialisations from the op byte
+#define OP_BYTE(b) ((b) & 0x3f)
+#else
+#define OP_BYTE(b) (b)
+#endif
+
 const byte *mp_showbc_code_start;
 const mp_uint_t *mp_showbc_const_table;
 
@@ -532,6 +539,57 @@ const byte *mp_bytecode_print_str(const byte *ip) {
             printf("IMPORT_STAR");
             break;
 
+        #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+        case MP_BC_BINARY_OP_FAST_FAST:
+            printf("BINARY_OP_FAST_FAST %d %s %d %d", OP_BYTE(ip[0]), qstr_str(mp_binary_op_method_name[OP_BYTE(ip[0])]), ip[1], ip[2]);
+            ip += 3;
+            break;
+
+        case MP_BC_BINARY_OP_FAST_SMALL_INT:
+            printf("BINARY_OP_FAST_SMALL_INT %d %s %d %d", OP_BYTE(ip[0]), qstr_str(mp_binary_op_method_name[OP_BYTE(ip[0])]), ip[1], ip[2] - 16);
+            ip += 3;
+            break;
+
+        case MP_BC_BINARY_OP_FAST_SMALL_INT_STORE:
+            printf("BINARY_OP_FAST_SMALL_INT_STORE %d %s %d %d", OP_BYTE(ip[0]), qstr_str(mp_binary_op_method_name[OP_BYTE(ip[0])]), ip[1], ip[2] - 16);
+            ip += 3;
+            break;
+
+        #if MICROPY_OPT_BYTECODE_QUICKENING
+        case MP_BC_BINARY_OP_FAST_FAST_SMALL_INT:
+            printf("BINARY_OP_FAST_FAST_SMALL_INT %d %s %d %d", OP_BYTE(ip[0]), qstr_str(mp_binary_op_method_name[OP_BYTE(ip[0])]), ip[1], ip[2]);
+            ip += 3;
+            break;
+
+        case MP_BC_BINARY_OP_FAST_SMALL_INT_SMALL_INT:
+            printf("BINARY_OP_FAST_SMALL_INT_SMALL_INT %d %s %d %d", OP_BYTE(ip[0]), qstr_str(mp_binary_op_method_name[OP_BYTE(ip[0])]), ip[1], ip[2] - 16);
+            ip += 3;
+            break;
+
+        case MP_BC_BINARY_OP_FAST_SMALL_INT_STORE_SMALL_INT:
+            printf("BINARY_OP_FAST_SMALL_INT_STORE_SMALL_INT %d %s %d %d", OP_BYTE(ip[0]), qstr_str(mp_binary_op_method_name[OP_BYTE(ip[0])]), ip[1], ip[2] - 16);
+            ip += 3;
+            break;
+        #endif
+        #endif
+
+        #if MICROPY_OPT_BYTECODE_QUICKENING
+        case MP_BC_BINARY_OP:
+            printf("BINARY_OP " UINT_FMT " %s", (mp_uint_t)OP_BYTE(ip[0]), qstr_str(mp_binary_op_method_name[OP_BYTE(ip[0])]));
+            ip += 1;
+            break;
+
+        case MP_BC_BINARY_OP_SMALL_INT:
+            printf("BINARY_OP_SMALL_INT " UINT_FMT " %s", (mp_uint_t)OP_BYTE(ip[0]), qstr_str(mp_binary_op_method_name[OP_BYTE(ip[0])]));
+            ip += 1;
+            break;
+
+        case MP_BC_BINARY_OP_FLOAT:
+            printf("BINARY_OP_FLOAT " UINT_FMT " %s", (mp_uint_t)OP_BYTE(ip[0]), qstr_str(mp_binary_op_method_name[OP_BYTE(ip[0])]));
+            ip += 1;
+            break;
+        #endif
+
         default:
             if (ip[-1] < MP_BC_LOAD_CONST_SMALL_INT_MULTI + 64) {
                 printf("LOAD_CONST_SMALL_INT " INT_FMT, (mp_int_t)ip[-1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - 16);
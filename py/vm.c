@@ -31,9 +31,18 @@
 
 #include "py/emitglue.h"
 #include "py/objtype.h"
+#include "py/objgenerator.h"
+#include "py/objrange.h"
+#include "py/objlist.h"
+#include "py/objtuple.h"
+#include "py/objstr.h"
+#include "py/objarray.h"
+#include "py/binary.h"
 #include "py/runtime.h"
 #include "py/bc0.h"
 #include "py/bc.h"
+#include "py/smallint.h"
+#include "py/gc.h"
 
 #if 0
 #define TRACE(ip) printf("sp=%d ", (int)(sp - &code_state->state[0] + 1)); mp_bytecode_print2(ip, 1, code_state->fun_bc->const_table);
@@ -96,6 +105,43 @@
 #define CLEAR_SYS_EXC_INFO()
 #endif
 
+#if MICROPY_TRACK_FRAMES
+// Keep MP_STATE_THREAD(current_code_state) pointing to the running frame, and
+// each frame linked to its caller, so the sampling profiler can walk the stack
+// and tracemalloc can see which instruction allocates.
+// A frame is linked to its caller before it's made the running one, with a
+// compiler fence in between because the profiler's signal handler may walk the
+// chain at any point, and the thread state is only looked up once per call of
+// mp_execute_bytecode.
+#if MICROPY_PY_THREAD
+#define FRAME_THREAD_STATE() mp_thread_get_state()
+#else
+#define FRAME_THREAD_STATE() (&mp_state_ctx.thread)
+#endif
+#define FRAME_FENCE() __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define FRAME_ENTER() do { \
+    code_state->prev_state = frame_ts->current_code_state; \
+    FRAME_FENCE(); \
+    frame_ts->current_code_state = code_state; \
+} while (0)
+#define FRAME_LEAVE() do { \
+    frame_ts->current_code_state = code_state->prev_state; \
+    FRAME_FENCE(); \
+} while (0)
+// For a stackless switch to a callee or back to a caller (in-line frames have prev set)
+#define FRAME_SWITCH() do { \
+    if (code_state->prev != NULL) { \
+        code_state->prev_state = code_state->prev; \
+    } \
+    FRAME_FENCE(); \
+    frame_ts->current_code_state = code_state; \
+} while (0)
+#else
+#define FRAME_ENTER()
+#define FRAME_LEAVE()
+#define FRAME_SWITCH()
+#endif
+
 #define PUSH_EXC_BLOCK(with_or_finally) do { \
     DECODE_ULABEL; /* except labels are always forward */ \
     ++exc_sp; \
@@ -110,6 +156,265 @@
     exc_sp--; /* pop back to previous exception handler */ \
     CLEAR_SYS_EXC_INFO() /* just clear sys.exc_info(), not compliant, but it shouldn't be used in 1st place */
 
+#if MICROPY_OPT_ATTR_INLINE_CACHE
+#define ATTR_CACHE_SET(ip) (MP_STATE_VM(attr_cache)[(uintptr_t)(ip) % MICROPY_OPT_ATTR_INLINE_CACHE_SIZE])
+
+STATIC mp_obj_t vm_load_attr(mp_obj_t base, qstr attr, const byte *ip) {
+    mp_obj_t dest[2];
+    if (!mp_obj_instance_load_method_cached(base, attr, dest, ATTR_CACHE_SET(ip))) {
+        return mp_load_attr(base, attr);
+    }
+    if (dest[1] == MP_OBJ_NULL) {
+        return dest[0];
+    } else {
+        return mp_obj_new_bound_meth(dest[0], dest[1]);
+    }
+}
+
+STATIC void vm_load_method(mp_obj_t base, qstr attr, mp_obj_t *dest, const byte *ip) {
+    if (!mp_obj_instance_load_method_cached(base, attr, dest, ATTR_CACHE_SET(ip))) {
+        mp_load_method(base, attr, dest);
+    }
+}
+#else
+#define vm_load_attr(base, attr, ip) mp_load_attr(base, attr)
+#define vm_load_method(base, attr, dest, ip) mp_load_method(base, attr, dest)
+#endif
+
+#if MICROPY_OPT_BYTECODE_QUICKENING
+// The operator in the op byte of a quickenable binary op
+#define QUICK_OP(b) ((b) & 0x3f)
+// Whether the site was de-specialised too many times to try again
+#define QUICK_GIVEN_UP(b) ((b) >= 0xc0)
+
+// Rewrite a specialised binary op at ip (pointing to the op byte) back to its
+// generic opcode, and count that this happened
+STATIC void vm_binary_op_despecialise(const byte *ip, byte opcode) {
+    ((byte*)ip)[-1] = opcode;
+    if (!QUICK_GIVEN_UP(ip[0])) {
+        ((byte*)ip)[0] += 0x40;
+    }
+}
+
+// Fast paths for binary ops on two small ints.  Returns MP_OBJ_NULL if the
+// result must be computed by mp_binary_op, eg on overflow.
+STATIC mp_obj_t vm_small_int_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    mp_int_t lhs = MP_OBJ_SMALL_INT_VALUE(lhs_in);
+    mp_int_t rhs = MP_OBJ_SMALL_INT_VALUE(rhs_in);
+    switch (op) {
+        case MP_BINARY_OP_ADD:
+        case MP_BINARY_OP_INPLACE_ADD:
+            // can't overflow a machine word because small ints are smaller
+            lhs += rhs;
+            break;
+        case MP_BINARY_OP_SUBTRACT:
+        case MP_BINARY_OP_INPLACE_SUBTRACT:
+            lhs -= rhs;
+            break;
+        case MP_BINARY_OP_MULTIPLY:
+        case MP_BINARY_OP_INPLACE_MULTIPLY:
+            if (mp_small_int_mul_overflow(lhs, rhs)) {
+                return MP_OBJ_NULL;
+            }
+            lhs *= rhs;
+            break;
+        case MP_BINARY_OP_AND:
+        case MP_BINARY_OP_INPLACE_AND:
+            return MP_OBJ_NEW_SMALL_INT(lhs & rhs);
+        case MP_BINARY_OP_OR:
+        case MP_BINARY_OP_INPLACE_OR:
+            return MP_OBJ_NEW_SMALL_INT(lhs | rhs);
+        case MP_BINARY_OP_XOR:
+        case MP_BINARY_OP_INPLACE_XOR:
+            return MP_OBJ_NEW_SMALL_INT(lhs ^ rhs);
+        case MP_BINARY_OP_LESS: return mp_obj_new_bool(lhs < rhs);
+        case MP_BINARY_OP_MORE: return mp_obj_new_bool(lhs > rhs);
+        case MP_BINARY_OP_LESS_EQUAL: return mp_obj_new_bool(lhs <= rhs);
+        case MP_BINARY_OP_MORE_EQUAL: return mp_obj_new_bool(lhs >= rhs);
+        case MP_BINARY_OP_EQUAL: return mp_obj_new_bool(lhs == rhs);
+        case MP_BINARY_OP_NOT_EQUAL: return mp_obj_new_bool(lhs != rhs);
+        default:
+            return MP_OBJ_NULL;
+    }
+    if (!MP_SMALL_INT_FITS(lhs)) {
+        return MP_OBJ_NULL;
+    }
+    return MP_OBJ_NEW_SMALL_INT(lhs);
+}
+
+#if MICROPY_PY_BUILTINS_FLOAT
+// Fast paths for binary ops on two floats, like vm_small_int_binary_op
+STATIC mp_obj_t vm_float_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    mp_float_t lhs = mp_obj_float_get(lhs_in);
+    mp_float_t rhs = mp_obj_float_get(rhs_in);
+    switch (op) {
+        case MP_BINARY_OP_ADD:
+        case MP_BINARY_OP_INPLACE_ADD:
+            return mp_obj_new_float(lhs + rhs);
+        case MP_BINARY_OP_SUBTRACT:
+        case MP_BINARY_OP_INPLACE_SUBTRACT:
+            return mp_obj_new_float(lhs - rhs);
+        case MP_BINARY_OP_MULTIPLY:
+        case MP_BINARY_OP_INPLACE_MULTIPLY:
+            return mp_obj_new_float(lhs * rhs);
+        case MP_BINARY_OP_TRUE_DIVIDE:
+        case MP_BINARY_OP_INPLACE_TRUE_DIVIDE:
+            if (rhs == 0) {
+                // let mp_binary_op raise the exception
+                return MP_OBJ_NULL;
+            }
+            return mp_obj_new_float(lhs / rhs);
+        case MP_BINARY_OP_LESS: return mp_obj_new_bool(lhs < rhs);
+        case MP_BINARY_OP_MORE: return mp_obj_new_bool(lhs > rhs);
+        case MP_BINARY_OP_LESS_EQUAL: return mp_obj_new_bool(lhs <= rhs);
+        case MP_BINARY_OP_MORE_EQUAL: return mp_obj_new_bool(lhs >= rhs);
+        // NaN compares unequal to itself in C as in Python
+        case MP_BINARY_OP_EQUAL: return mp_obj_new_bool(lhs == rhs);
+        default:
+            return MP_OBJ_NULL;
+    }
+}
+#endif
+
+// Return the specialised opcode for a binary op with the given operands, or
+// 0 if there isn't one
+STATIC byte vm_binary_op_quicken(mp_obj_t lhs, mp_obj_t rhs) {
+    if (MP_OBJ_IS_SMALL_INT(lhs) && MP_OBJ_IS_SMALL_INT(rhs)) {
+        return MP_BC_BINARY_OP_SMALL_INT;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    } else if (mp_obj_is_float(lhs) && mp_obj_is_float(rhs)) {
+        return MP_BC_BINARY_OP_FLOAT;
+    #endif
+    }
+    return 0;
+}
+#else
+#define QUICK_OP(b) (b)
+#endif
+
+#if MICROPY_STACKLESS
+// Whether a call to fun may be run in-line by vm_stackless_call
+static inline bool vm_stackless_can_call(mp_obj_t fun) {
+    const mp_obj_type_t *type = mp_obj_get_type(fun);
+    return type == &mp_type_fun_bc || type == &mp_type_bound_meth || type == &mp_type_closure
+        || (type == &mp_type_type && mp_obj_is_instance_type((mp_obj_type_t*)MP_OBJ_TO_PTR(fun)));
+}
+
+// Set up a call from bytecode so that it runs in-line in the VM instead of
+// recursing on the C stack.  fun_sp is the slot that receives the result.
+// Returns the new code state, linked to code_state, or NULL if fun must be
+// called the regular way.  If the call was instead completed here (a class
+// whose __init__ can't run in-line) then code_state itself is returned.
+STATIC mp_code_state_t *vm_stackless_call(mp_code_state_t *code_state, mp_obj_t fun, mp_obj_t *fun_sp, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    const mp_obj_type_t *type = mp_obj_get_type(fun);
+    mp_code_state_t *new_state;
+    uintptr_t tag = 0;
+    if (type == &mp_type_fun_bc) {
+        new_state = mp_obj_fun_bc_prepare_codestate(fun, n_args, n_kw, args);
+    } else if (type == &mp_type_bound_meth) {
+        new_state = mp_obj_bound_meth_prepare_codestate(fun, n_args, n_kw, args);
+    } else if (type == &mp_type_closure) {
+        new_state = mp_obj_closure_prepare_codestate(fun, MP_OBJ_NULL, n_args, n_kw, args);
+    } else if (type == &mp_type_type && mp_obj_is_instance_type((mp_obj_type_t*)MP_OBJ_TO_PTR(fun))) {
+        mp_obj_t inst = MP_OBJ_NULL;
+        new_state = mp_obj_instance_prepare_init(MP_OBJ_TO_PTR(fun), n_args, n_kw, args, &inst);
+        if (inst == MP_OBJ_NULL) {
+            // class has __new__ or a native base
+            return NULL;
+        }
+        // The instance is the result of the call; storing it now also keeps
+        // it reachable while __init__ runs.
+        *fun_sp = inst;
+        if (new_state == NULL) {
+            return code_state;
+        }
+        tag = 1;
+    } else {
+        return NULL;
+    }
+    if (new_state != NULL) {
+        new_state->prev = code_state;
+        new_state->prev_kind = tag;
+    }
+    return new_state;
+}
+
+// As vm_stackless_call but for args prepared by mp_call_prepare_args_n_kw_var.
+// The call is always either set up to run in-line or completed here.
+STATIC MP_NOINLINE mp_code_state_t *vm_stackless_call_var(mp_code_state_t *code_state, mp_obj_t *fun_sp, mp_call_args_t *out_args) {
+    // With pystack the prepared args sit on top of the frame stack, where the
+    // new frame must go, so move them to the C stack before releasing them.
+    size_t n_total = out_args->n_args + 2 * out_args->n_kw;
+    mp_obj_t *args = alloca(n_total * sizeof(mp_obj_t));
+    memcpy(args, out_args->args, n_total * sizeof(mp_obj_t));
+    mp_nonlocal_free(out_args->args, out_args->n_alloc * sizeof(mp_obj_t));
+    mp_code_state_t *new_state = vm_stackless_call(code_state, out_args->fun, fun_sp, out_args->n_args, out_args->n_kw, args);
+    if (new_state == NULL) {
+        *fun_sp = mp_call_function_n_kw(out_args->fun, out_args->n_args, out_args->n_kw, args);
+        return code_state;
+    }
+    return new_state;
+}
+#endif
+
+#if MICROPY_OPT_FOR_ITER_INLINE
+// Get the next value from an iterator stored in the iterator buffer on the
+// value stack, for the iterator types that can be stepped without a call.
+// Returns MP_OBJ_STOP_ITERATION when exhausted, or MP_OBJ_SENTINEL if the
+// iterator is of another type and mp_iternext must be used.
+static inline mp_obj_t vm_for_iter_inline(mp_obj_iter_buf_t *iter_buf) {
+    const mp_obj_type_t *type = iter_buf->base.type;
+    if (type == &mp_type_range_it) {
+        mp_obj_range_it_t *o = (mp_obj_range_it_t*)iter_buf;
+        if ((o->step > 0 && o->cur < o->stop) || (o->step < 0 && o->cur > o->stop)) {
+            mp_obj_t value = MP_OBJ_NEW_SMALL_INT(o->cur);
+            o->cur += o->step;
+            return value;
+        }
+        return MP_OBJ_STOP_ITERATION;
+    } else if (type == &mp_type_polymorph_iter) {
+        // list, tuple and bytes iterators all have the same layout
+        mp_obj_list_it_t *o = (mp_obj_list_it_t*)iter_buf;
+        if (o->iternext == mp_obj_list_it_iternext) {
+            // the list may be resized during iteration so always reload it
+            mp_obj_list_t *list = MP_OBJ_TO_PTR(o->list);
+            if (o->cur < list->len) {
+                return list->items[o->cur++];
+            }
+            return MP_OBJ_STOP_ITERATION;
+        } else if (o->iternext == mp_obj_tuple_it_iternext) {
+            mp_obj_tuple_t *tuple = ((mp_obj_tuple_it_t*)iter_buf)->tuple;
+            if (o->cur < tuple->len) {
+                return tuple->items[o->cur++];
+            }
+            return MP_OBJ_STOP_ITERATION;
+        } else if (o->iternext == mp_obj_bytes_it_iternext) {
+            // bytes objects are never interned so this is always a mp_obj_str_t
+            mp_obj_str_t *str = MP_OBJ_TO_PTR(((mp_obj_str8_it_t*)iter_buf)->str);
+            if (o->cur < str->len) {
+                return MP_OBJ_NEW_SMALL_INT(str->data[o->cur++]);
+            }
+            return MP_OBJ_STOP_ITERATION;
+        }
+    #if MICROPY_PY_BUILTINS_BYTEARRAY
+    } else if (type == &mp_type_array_it) {
+        mp_obj_array_it_t *o = (mp_obj_array_it_t*)iter_buf;
+        if (o->array->typecode == BYTEARRAY_TYPECODE) {
+            if (o->cur < o->array->len) {
+                return MP_OBJ_NEW_SMALL_INT(((byte*)o->array->items)[o->offset + o->cur++]);
+            }
+            return MP_OBJ_STOP_ITERATION;
+        }
+    #endif
+    }
+    return MP_OBJ_SENTINEL;
+}
+#endif
+
+#if MICROPY_OPT_LOAD_GLOBAL_CACHE
+#define GLOBAL_CACHE_ENTRY(ip) (&MP_STATE_VM(global_cache)[(uintptr_t)(ip) % MICROPY_OPT_LOAD_GLOBAL_CACHE_SIZE])
+#endif
+
 // fastn has items in reverse order (fastn[0] is local[0], fastn[-1] is local[1], etc)
 // sp points to bottom of stack which grows up
 // returns:
@@ -148,9 +453,6 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp
     // loop and the exception handler, leading to very obscure bugs.
     #define RAISE(o) do { nlr_pop(); nlr.ret_val = MP_OBJ_TO_PTR(o); goto exception_handler; } while (0)
 
-#if MICROPY_STACKLESS
-run_code_state: ;
-#endif
     // Pointers which are constant for particular invocation of mp_execute_bytecode()
     mp_obj_t * /*const*/ fastn;
     mp_exc_stack_t * /*const*/ exc_stack;
@@ -164,12 +466,28 @@ run_code_state: ;
     volatile bool currently_in_except_block = MP_TAGPTR_TAG0(code_state->exc_sp); // 0 or 1, to detect nested exceptions
     mp_exc_stack_t *volatile exc_sp = MP_TAGPTR_PTR(code_state->exc_sp); // stack grows up, exc_sp points to top of stack
 
+    #if MICROPY_STACKLESS
+    // Calls and returns switch code_state while the nlr buffer is pushed, so keep
+    // a copy for the exception handler (declared volatile)
+    mp_code_state_t *volatile cur_code_state = code_state;
+    // The frames entered in-line are only reachable from the current one, so
+    // keep a pointer to the start of the heap block holding it for the GC (a
+    // generator's frame is inside the generator object)
+    volatile mp_obj_t cur_frame_obj = MP_OBJ_FROM_PTR(code_state);
+    (void)cur_frame_obj;
+    #endif
+
     #if MICROPY_PY_THREAD_GIL && MICROPY_PY_THREAD_GIL_VM_DIVISOR
     // This needs to be volatile and outside the VM loop so it persists across handling
     // of any exceptions.  Otherwise it's possible that the VM never gives up the GIL.
     volatile int gil_divisor = MICROPY_PY_THREAD_GIL_VM_DIVISOR;
     #endif
 
+    #if MICROPY_TRACK_FRAMES
+    mp_state_thread_t *const frame_ts = FRAME_THREAD_STATE();
+    #endif
+    FRAME_ENTER();
+
     // outer exception handling loop
     for (;;) {
         nlr_buf_t nlr;
@@ -266,7 +584,17 @@ dispatch_loop:
                     goto load_check;
                 }
 
-                #if !MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+                #if MICROPY_OPT_LOAD_GLOBAL_CACHE
+                ENTRY(MP_BC_LOAD_NAME): {
+                    MARK_EXC_IP_SELECTIVE();
+                    DECODE_QSTR;
+                    PUSH(mp_load_name_cached(qst, GLOBAL_CACHE_ENTRY(ip)));
+                    #if MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+                    ip++;
+                    #endif
+                    DISPATCH();
+                }
+                #elif !MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
                 ENTRY(MP_BC_LOAD_NAME): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
@@ -295,7 +623,17 @@ dispatch_loop:
                 }
                 #endif
 
-                #if !MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+                #if MICROPY_OPT_LOAD_GLOBAL_CACHE
+                ENTRY(MP_BC_LOAD_GLOBAL): {
+                    MARK_EXC_IP_SELECTIVE();
+                    DECODE_QSTR;
+                    PUSH(mp_load_global_cached(qst, GLOBAL_CACHE_ENTRY(ip)));
+                    #if MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+                    ip++;
+                    #endif
+                    DISPATCH();
+                }
+                #elif !MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
                 ENTRY(MP_BC_LOAD_GLOBAL): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
@@ -328,7 +666,7 @@ dispatch_loop:
                 ENTRY(MP_BC_LOAD_ATTR): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
-                    SET_TOP(mp_load_attr(TOP(), qst));
+                    SET_TOP(vm_load_attr(TOP(), qst, ip));
                     DISPATCH();
                 }
                 #else
@@ -356,7 +694,7 @@ dispatch_loop:
                         DISPATCH();
                     }
                 load_attr_cache_fail:
-                    SET_TOP(mp_load_attr(top, qst));
+                    SET_TOP(vm_load_attr(top, qst, ip));
                     ip++;
                     DISPATCH();
                 }
@@ -365,7 +703,7 @@ dispatch_loop:
                 ENTRY(MP_BC_LOAD_METHOD): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
-                    mp_load_method(*sp, qst, sp);
+                    vm_load_method(*sp, qst, sp, ip);
                     sp += 1;
                     DISPATCH();
                 }
@@ -450,6 +788,7 @@ dispatch_loop:
                             }
                         }
                         elem->value = sp[-1];
+                        gc_write_barrier(self->members.table);
                         sp -= 2;
                         ip++;
                         DISPATCH();
@@ -744,6 +1083,19 @@ unwind_jump:;
                 ENTRY(MP_BC_FOR_ITER): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_ULABEL; // the jump offset if iteration finishes; for labels are always forward
+                    #if MICROPY_OPT_FOR_ITER_INLINE
+                    if (sp[-MP_OBJ_ITER_BUF_NSLOTS + 1] != MP_OBJ_NULL) {
+                        mp_obj_t value = vm_for_iter_inline((mp_obj_iter_buf_t*)&sp[-MP_OBJ_ITER_BUF_NSLOTS + 1]);
+                        if (value == MP_OBJ_STOP_ITERATION) {
+                            sp -= MP_OBJ_ITER_BUF_NSLOTS; // pop the exhausted iterator
+                            ip += ulab; // jump to after for-block
+                            DISPATCH();
+                        } else if (value != MP_OBJ_SENTINEL) {
+                            PUSH(value); // push the next iteration value
+                            DISPATCH();
+                        }
+                    }
+                    #endif
                     code_state->sp = sp;
                     mp_obj_t obj;
                     if (sp[-MP_OBJ_ITER_BUF_NSLOTS + 1] == MP_OBJ_NULL) {
@@ -751,6 +1103,21 @@ unwind_jump:;
                     } else {
                         obj = MP_OBJ_FROM_PTR(&sp[-MP_OBJ_ITER_BUF_NSLOTS + 1]);
                     }
+                    #if MICROPY_STACKLESS
+                    if (MP_OBJ_IS_TYPE(obj, &mp_type_gen_instance)) {
+                        // Resume the generator in-line; it returns to this FOR_ITER
+                        // when it yields or finishes, see YIELD_VALUE and RETURN_VALUE.
+                        mp_code_state_t *new_state = mp_obj_gen_resume_stackless(obj);
+                        if (new_state != NULL) {
+                            code_state->ip = ip - 3;
+                            code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, currently_in_except_block);
+                            new_state->prev = code_state;
+                            new_state->prev_kind = 2;
+                            code_state = new_state;
+                            goto switch_code_state;
+                        }
+                    }
+                    #endif
                     mp_obj_t value = mp_iternext_allow_raise(obj);
                     if (value == MP_OBJ_STOP_ITERATION) {
                         sp -= MP_OBJ_ITER_BUF_NSLOTS; // pop the exhausted iterator
@@ -903,27 +1270,15 @@ unwind_jump:;
                     // (unum >> 8) & 0xff == n_keyword
                     sp -= (unum & 0xff) + ((unum >> 7) & 0x1fe);
                     #if MICROPY_STACKLESS
-                    if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
-                        code_state->ip = ip;
-                        code_state->sp = sp;
-                        code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, currently_in_except_block);
-                        mp_code_state_t *new_state = mp_obj_fun_bc_prepare_codestate(*sp, unum & 0xff, (unum >> 8) & 0xff, sp + 1);
-                        #if !MICROPY_ENABLE_PYSTACK
-                        if (new_state == NULL) {
-                            // Couldn't allocate codestate on heap: in the strict case raise
-                            // an exception, otherwise just fall through to stack allocation.
-                            #if MICROPY_STACKLESS_STRICT
-                        deep_recursion_error:
-                            mp_raise_recursion_depth();
-                            #endif
-                        } else
-                        #endif
-                        {
-                            new_state->prev = code_state;
-                            code_state = new_state;
-                            nlr_pop();
-                            goto run_code_state;
-                        }
+                    code_state->ip = ip;
+                    code_state->sp = sp;
+                    code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, currently_in_except_block);
+                    mp_code_state_t *new_state = vm_stackless_call(code_state, *sp, sp, unum & 0xff, (unum >> 8) & 0xff, sp + 1);
+                    if (new_state == code_state) {
+                        DISPATCH();
+                    } else if (new_state != NULL) {
+                        code_state = new_state;
+                        goto switch_code_state;
                     }
                     #endif
                     SET_TOP(mp_call_function_n_kw(*sp, unum & 0xff, (unum >> 8) & 0xff, sp + 1));
@@ -939,7 +1294,7 @@ unwind_jump:;
                     // fun arg0 arg1 ... kw0 val0 kw1 val1 ... seq dict <- TOS
                     sp -= (unum & 0xff) + ((unum >> 7) & 0x1fe) + 2;
                     #if MICROPY_STACKLESS
-                    if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
+                    if (vm_stackless_can_call(*sp)) {
                         code_state->ip = ip;
                         code_state->sp = sp;
                         code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, currently_in_except_block);
@@ -947,28 +1302,12 @@ unwind_jump:;
                         mp_call_args_t out_args;
                         mp_call_prepare_args_n_kw_var(false, unum, sp, &out_args);
 
-                        mp_code_state_t *new_state = mp_obj_fun_bc_prepare_codestate(out_args.fun,
-                            out_args.n_args, out_args.n_kw, out_args.args);
-                        #if !MICROPY_ENABLE_PYSTACK
-                        // Freeing args at this point does not follow a LIFO order so only do it if
-                        // pystack is not enabled.  For pystack, they are freed when code_state is.
-                        mp_nonlocal_free(out_args.args, out_args.n_alloc * sizeof(mp_obj_t));
-                        #endif
-                        #if !MICROPY_ENABLE_PYSTACK
-                        if (new_state == NULL) {
-                            // Couldn't allocate codestate on heap: in the strict case raise
-                            // an exception, otherwise just fall through to stack allocation.
-                            #if MICROPY_STACKLESS_STRICT
-                            goto deep_recursion_error;
-                            #endif
-                        } else
-                        #endif
-                        {
-                            new_state->prev = code_state;
-                            code_state = new_state;
-                            nlr_pop();
-                            goto run_code_state;
+                        mp_code_state_t *new_state = vm_stackless_call_var(code_state, sp, &out_args);
+                        if (new_state == code_state) {
+                            DISPATCH();
                         }
+                        code_state = new_state;
+                        goto switch_code_state;
                     }
                     #endif
                     SET_TOP(mp_call_method_n_kw_var(false, unum, sp));
@@ -982,31 +1321,20 @@ unwind_jump:;
                     // (unum >> 8) & 0xff == n_keyword
                     sp -= (unum & 0xff) + ((unum >> 7) & 0x1fe) + 1;
                     #if MICROPY_STACKLESS
-                    if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
-                        code_state->ip = ip;
-                        code_state->sp = sp;
-                        code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, currently_in_except_block);
+                    code_state->ip = ip;
+                    code_state->sp = sp;
+                    code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, currently_in_except_block);
 
-                        size_t n_args = unum & 0xff;
-                        size_t n_kw = (unum >> 8) & 0xff;
-                        int adjust = (sp[1] == MP_OBJ_NULL) ? 0 : 1;
-
-                        mp_code_state_t *new_state = mp_obj_fun_bc_prepare_codestate(*sp, n_args + adjust, n_kw, sp + 2 - adjust);
-                        #if !MICROPY_ENABLE_PYSTACK
-                        if (new_state == NULL) {
-                            // Couldn't allocate codestate on heap: in the strict case raise
-                            // an exception, otherwise just fall through to stack allocation.
-                            #if MICROPY_STACKLESS_STRICT
-                            goto deep_recursion_error;
-                            #endif
-                        } else
-                        #endif
-                        {
-                            new_state->prev = code_state;
-                            code_state = new_state;
-                            nlr_pop();
-                            goto run_code_state;
-                        }
+                    size_t n_args = unum & 0xff;
+                    size_t n_kw = (unum >> 8) & 0xff;
+                    int adjust = (sp[1] == MP_OBJ_NULL) ? 0 : 1;
+
+                    mp_code_state_t *new_state = vm_stackless_call(code_state, *sp, sp, n_args + adjust, n_kw, sp + 2 - adjust);
+                    if (new_state == code_state) {
+                        DISPATCH();
+                    } else if (new_state != NULL) {
+                        code_state = new_state;
+                        goto switch_code_state;
                     }
                     #endif
                     SET_TOP(mp_call_method_n_kw(unum & 0xff, (unum >> 8) & 0xff, sp));
@@ -1022,7 +1350,7 @@ unwind_jump:;
                     // fun self arg0 arg1 ... kw0 val0 kw1 val1 ... seq dict <- TOS
                     sp -= (unum & 0xff) + ((unum >> 7) & 0x1fe) + 3;
                     #if MICROPY_STACKLESS
-                    if (mp_obj_get_type(*sp) == &mp_type_fun_bc) {
+                    if (vm_stackless_can_call(*sp)) {
                         code_state->ip = ip;
                         code_state->sp = sp;
                         code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, currently_in_except_block);
@@ -1030,28 +1358,12 @@ unwind_jump:;
                         mp_call_args_t out_args;
                         mp_call_prepare_args_n_kw_var(true, unum, sp, &out_args);
 
-                        mp_code_state_t *new_state = mp_obj_fun_bc_prepare_codestate(out_args.fun,
-                            out_args.n_args, out_args.n_kw, out_args.args);
-                        #if !MICROPY_ENABLE_PYSTACK
-                        // Freeing args at this point does not follow a LIFO order so only do it if
-                        // pystack is not enabled.  For pystack, they are freed when code_state is.
-                        mp_nonlocal_free(out_args.args, out_args.n_alloc * sizeof(mp_obj_t));
-                        #endif
-                        #if !MICROPY_ENABLE_PYSTACK
-                        if (new_state == NULL) {
-                            // Couldn't allocate codestate on heap: in the strict case raise
-                            // an exception, otherwise just fall through to stack allocation.
-                            #if MICROPY_STACKLESS_STRICT
-                            goto deep_recursion_error;
-                            #endif
-                        } else
-                        #endif
-                        {
-                            new_state->prev = code_state;
-                            code_state = new_state;
-                            nlr_pop();
-                            goto run_code_state;
+                        mp_code_state_t *new_state = vm_stackless_call_var(code_state, sp, &out_args);
+                        if (new_state == code_state) {
+                            DISPATCH();
                         }
+                        code_state = new_state;
+                        goto switch_code_state;
                     }
                     #endif
                     SET_TOP(mp_call_method_n_kw_var(true, unum, sp));
@@ -1088,27 +1400,48 @@ unwind_return:
                         }
                         POP_EXC_BLOCK();
                     }
-                    nlr_pop();
-                    code_state->sp = sp;
-                    assert(exc_sp == exc_stack - 1);
-                    MICROPY_VM_HOOK_RETURN
                     #if MICROPY_STACKLESS
                     if (code_state->prev != NULL) {
+                        // return to the caller without leaving the VM
+                        if (code_state->prev_kind & 1) {
+                            // __init__ of an in-line constructor call must return None
+                            mp_obj_instance_check_init_ret(*sp);
+                        }
+                        code_state->sp = sp;
+                        assert(exc_sp == exc_stack - 1);
+                        MICROPY_VM_HOOK_RETURN
                         mp_obj_t res = *sp;
-                        mp_globals_set(code_state->old_globals);
                         mp_code_state_t *new_code_state = code_state->prev;
-                        #if MICROPY_ENABLE_PYSTACK
-                        // Free code_state, and args allocated by mp_call_prepare_args_n_kw_var
-                        // (The latter is implicitly freed when using pystack due to its LIFO nature.)
+                        if (code_state->prev_kind & 2) {
+                            // generator resumed by FOR_ITER finished, so end the for loop
+                            mp_obj_gen_suspend_stackless(code_state, MP_VM_RETURN_NORMAL, res);
+                            code_state = new_code_state;
+                            ip = code_state->ip + 1;
+                            DECODE_ULABEL; // the jump offset if iteration finishes; for labels are always forward
+                            code_state->ip = ip + ulab; // jump to after for-block
+                            code_state->sp -= MP_OBJ_ITER_BUF_NSLOTS; // pop the exhausted iterator
+                            goto switch_code_state;
+                        }
+                        bool is_init = (code_state->prev_kind & 1);
+                        mp_globals_set(code_state->old_globals);
+                        // Free the frame straight away so a heap-allocated one can be reused by
+                        // the next call instead of waiting for a garbage collection.
                         // The sizeof in the following statement does not include the size of the variable
                         // part of the struct.  This arg is anyway not used if pystack is enabled.
                         mp_nonlocal_free(code_state, sizeof(mp_code_state_t));
-                        #endif
                         code_state = new_code_state;
-                        *code_state->sp = res;
-                        goto run_code_state;
+                        if (!is_init) {
+                            // (for a constructor the slot already holds the instance)
+                            *code_state->sp = res;
+                        }
+                        goto switch_code_state;
                     }
                     #endif
+                    nlr_pop();
+                    code_state->sp = sp;
+                    assert(exc_sp == exc_stack - 1);
+                    MICROPY_VM_HOOK_RETURN
+                    FRAME_LEAVE();
                     return MP_VM_RETURN_NORMAL;
 
                 ENTRY(MP_BC_RAISE_VARARGS): {
@@ -1142,10 +1475,26 @@ unwind_return:
 
                 ENTRY(MP_BC_YIELD_VALUE):
 yield:
-                    nlr_pop();
                     code_state->ip = ip;
                     code_state->sp = sp;
                     code_state->exc_sp = MP_TAGPTR_MAKE(exc_sp, currently_in_except_block);
+                    #if MICROPY_STACKLESS
+                    if (code_state->prev != NULL) {
+                        // generator resumed by FOR_ITER, so pass the value to the for loop
+                        assert(code_state->prev_kind & 2);
+                        mp_code_state_t *new_code_state = code_state->prev;
+                        mp_obj_t value = mp_obj_gen_suspend_stackless(code_state, MP_VM_RETURN_YIELD, *sp);
+                        code_state = new_code_state;
+                        ip = code_state->ip + 1;
+                        DECODE_ULABEL; // skip the for loop's jump offset
+                        (void)ulab;
+                        code_state->ip = ip;
+                        *++code_state->sp = value;
+                        goto switch_code_state;
+                    }
+                    #endif
+                    nlr_pop();
+                    FRAME_LEAVE();
                     return MP_VM_RETURN_YIELD;
 
                 ENTRY(MP_BC_YIELD_FROM): {
@@ -1222,6 +1571,182 @@ yield:
                     mp_import_all(POP());
                     DISPATCH();
 
+                #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+                ENTRY(MP_BC_BINARY_OP_FAST_FAST): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_obj_t lhs = fastn[-(mp_int_t)ip[1]];
+                    mp_obj_t rhs = fastn[-(mp_int_t)ip[2]];
+                    if (lhs == MP_OBJ_NULL || rhs == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    #if MICROPY_OPT_BYTECODE_QUICKENING
+                    if (!QUICK_GIVEN_UP(ip[0]) && MP_OBJ_IS_SMALL_INT(lhs) && MP_OBJ_IS_SMALL_INT(rhs)) {
+                        ((byte*)ip)[-1] = MP_BC_BINARY_OP_FAST_FAST_SMALL_INT;
+                    }
+                    #endif
+                    PUSH(mp_binary_op(QUICK_OP(ip[0]), lhs, rhs));
+                    ip += 3;
+                    DISPATCH();
+                }
+
+                ENTRY(MP_BC_BINARY_OP_FAST_SMALL_INT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_obj_t lhs = fastn[-(mp_int_t)ip[1]];
+                    if (lhs == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    #if MICROPY_OPT_BYTECODE_QUICKENING
+                    if (!QUICK_GIVEN_UP(ip[0]) && MP_OBJ_IS_SMALL_INT(lhs)) {
+                        ((byte*)ip)[-1] = MP_BC_BINARY_OP_FAST_SMALL_INT_SMALL_INT;
+                    }
+                    #endif
+                    PUSH(mp_binary_op(QUICK_OP(ip[0]), lhs, MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[2] - 16)));
+                    ip += 3;
+                    DISPATCH();
+                }
+
+                ENTRY(MP_BC_BINARY_OP_FAST_SMALL_INT_STORE): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_obj_t *local = &fastn[-(mp_int_t)ip[1]];
+                    if (*local == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    #if MICROPY_OPT_BYTECODE_QUICKENING
+                    if (!QUICK_GIVEN_UP(ip[0]) && MP_OBJ_IS_SMALL_INT(*local)) {
+                        ((byte*)ip)[-1] = MP_BC_BINARY_OP_FAST_SMALL_INT_STORE_SMALL_INT;
+                    }
+                    #endif
+                    *local = mp_binary_op(QUICK_OP(ip[0]), *local, MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[2] - 16));
+                    ip += 3;
+                    DISPATCH();
+                }
+
+                #if MICROPY_OPT_BYTECODE_QUICKENING
+                ENTRY(MP_BC_BINARY_OP_FAST_FAST_SMALL_INT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_obj_t lhs = fastn[-(mp_int_t)ip[1]];
+                    mp_obj_t rhs = fastn[-(mp_int_t)ip[2]];
+                    if (MP_OBJ_IS_SMALL_INT(lhs) && MP_OBJ_IS_SMALL_INT(rhs)) {
+                        mp_obj_t res = vm_small_int_binary_op(QUICK_OP(ip[0]), lhs, rhs);
+                        if (res != MP_OBJ_NULL) {
+                            PUSH(res);
+                            ip += 3;
+                            DISPATCH();
+                        }
+                    } else {
+                        vm_binary_op_despecialise(ip, MP_BC_BINARY_OP_FAST_FAST);
+                        if (lhs == MP_OBJ_NULL || rhs == MP_OBJ_NULL) {
+                            goto local_name_error;
+                        }
+                    }
+                    PUSH(mp_binary_op(QUICK_OP(ip[0]), lhs, rhs));
+                    ip += 3;
+                    DISPATCH();
+                }
+
+                ENTRY(MP_BC_BINARY_OP_FAST_SMALL_INT_SMALL_INT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_obj_t lhs = fastn[-(mp_int_t)ip[1]];
+                    mp_obj_t rhs = MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[2] - 16);
+                    if (MP_OBJ_IS_SMALL_INT(lhs)) {
+                        mp_obj_t res = vm_small_int_binary_op(QUICK_OP(ip[0]), lhs, rhs);
+                        if (res != MP_OBJ_NULL) {
+                            PUSH(res);
+                            ip += 3;
+                            DISPATCH();
+                        }
+                    } else {
+                        vm_binary_op_despecialise(ip, MP_BC_BINARY_OP_FAST_SMALL_INT);
+                        if (lhs == MP_OBJ_NULL) {
+                            goto local_name_error;
+                        }
+                    }
+                    PUSH(mp_binary_op(QUICK_OP(ip[0]), lhs, rhs));
+                    ip += 3;
+                    DISPATCH();
+                }
+
+                ENTRY(MP_BC_BINARY_OP_FAST_SMALL_INT_STORE_SMALL_INT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_obj_t *local = &fastn[-(mp_int_t)ip[1]];
+                    mp_obj_t rhs = MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[2] - 16);
+                    if (MP_OBJ_IS_SMALL_INT(*local)) {
+                        mp_obj_t res = vm_small_int_binary_op(QUICK_OP(ip[0]), *local, rhs);
+                        if (res != MP_OBJ_NULL) {
+                            *local = res;
+                            ip += 3;
+                            DISPATCH();
+                        }
+                    } else {
+                        vm_binary_op_despecialise(ip, MP_BC_BINARY_OP_FAST_SMALL_INT_STORE);
+                        if (*local == MP_OBJ_NULL) {
+                            goto local_name_error;
+                        }
+                    }
+                    *local = mp_binary_op(QUICK_OP(ip[0]), *local, rhs);
+                    ip += 3;
+                    DISPATCH();
+                }
+                #endif
+                #endif
+
+                #if MICROPY_OPT_BYTECODE_QUICKENING
+                ENTRY(MP_BC_BINARY_OP): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_obj_t rhs = POP();
+                    mp_obj_t lhs = TOP();
+                    if (!QUICK_GIVEN_UP(ip[0])) {
+                        byte opcode = vm_binary_op_quicken(lhs, rhs);
+                        if (opcode != 0) {
+                            ((byte*)ip)[-1] = opcode;
+                        }
+                    }
+                    SET_TOP(mp_binary_op(QUICK_OP(ip[0]), lhs, rhs));
+                    ip += 1;
+                    DISPATCH();
+                }
+
+                ENTRY(MP_BC_BINARY_OP_SMALL_INT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_obj_t rhs = POP();
+                    mp_obj_t lhs = TOP();
+                    if (MP_OBJ_IS_SMALL_INT(lhs) && MP_OBJ_IS_SMALL_INT(rhs)) {
+                        mp_obj_t res = vm_small_int_binary_op(QUICK_OP(ip[0]), lhs, rhs);
+                        if (res != MP_OBJ_NULL) {
+                            SET_TOP(res);
+                            ip += 1;
+                            DISPATCH();
+                        }
+                    } else {
+                        vm_binary_op_despecialise(ip, MP_BC_BINARY_OP);
+                    }
+                    SET_TOP(mp_binary_op(QUICK_OP(ip[0]), lhs, rhs));
+                    ip += 1;
+                    DISPATCH();
+                }
+
+                #if MICROPY_PY_BUILTINS_FLOAT
+                ENTRY(MP_BC_BINARY_OP_FLOAT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_obj_t rhs = POP();
+                    mp_obj_t lhs = TOP();
+                    if (mp_obj_is_float(lhs) && mp_obj_is_float(rhs)) {
+                        mp_obj_t res = vm_float_binary_op(QUICK_OP(ip[0]), lhs, rhs);
+                        if (res != MP_OBJ_NULL) {
+                            SET_TOP(res);
+                            ip += 1;
+                            DISPATCH();
+                        }
+                    } else {
+                        vm_binary_op_despecialise(ip, MP_BC_BINARY_OP);
+                    }
+                    SET_TOP(mp_binary_op(QUICK_OP(ip[0]), lhs, rhs));
+                    ip += 1;
+                    DISPATCH();
+                }
+                #endif
+                #endif
+
 #if MICROPY_OPT_COMPUTED_GOTO
                 ENTRY(MP_BC_LOAD_CONST_SMALL_INT_MULTI):
                     PUSH(MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[-1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - 16));
@@ -1275,6 +1800,7 @@ yield:
                     mp_obj_t obj = mp_obj_new_exception_msg(&mp_type_NotImplementedError, "byte code not implemented");
                     nlr_pop();
                     code_state->state[0] = obj;
+                    FRAME_LEAVE();
                     return MP_VM_RETURN_EXCEPTION;
                 }
 
@@ -1330,12 +1856,53 @@ pending_exception_check:
                 }
                 #endif
 
+                #if MICROPY_STACKLESS
+                continue;
+
+switch_code_state:
+                // Continue with the frame in code_state, either one just set up
+                // for a call or the caller of one that finished.  The nlr buffer
+                // stays pushed, so this is cheaper than a fresh VM invocation,
+                // but it must restore the pystack to include the new frame.
+                MP_NLR_SAVE_PYSTACK(&nlr);
+                // the frame being left is no longer seen as a root by the GC
+                gc_write_barrier(MP_OBJ_TO_PTR(cur_frame_obj));
+                cur_code_state = code_state;
+                if (code_state->prev_kind & 2) {
+                    cur_frame_obj = mp_obj_gen_of_code_state(code_state);
+                } else {
+                    cur_frame_obj = MP_OBJ_FROM_PTR(code_state);
+                }
+                FRAME_SWITCH();
+                {
+                    size_t n_state = mp_decode_uint_value(code_state->fun_bc->bytecode);
+                    fastn = &code_state->state[n_state - 1];
+                    exc_stack = (mp_exc_stack_t*)(code_state->state + n_state);
+                }
+                currently_in_except_block = MP_TAGPTR_TAG0(code_state->exc_sp);
+                exc_sp = MP_TAGPTR_PTR(code_state->exc_sp);
+                ip = code_state->ip;
+                sp = code_state->sp;
+                DISPATCH();
+                #endif
+
             } // for loop
 
         } else {
 exception_handler:
             // exception occurred
 
+            #if MICROPY_STACKLESS
+            // code_state and the pointers derived from it may be stale after a
+            // long jump, so reload them
+            code_state = cur_code_state;
+            {
+                size_t n_state = mp_decode_uint_value(code_state->fun_bc->bytecode);
+                fastn = &code_state->state[n_state - 1];
+                exc_stack = (mp_exc_stack_t*)(code_state->state + n_state);
+            }
+            #endif
+
             #if MICROPY_PY_SYS_EXC_INFO
             MP_STATE_VM(cur_exception) = nlr.ret_val;
             #endif
@@ -1372,50 +1939,10 @@ unwind_loop:
             // TODO: don't set traceback for exceptions re-raised by END_FINALLY.
             // But consider how to handle nested exceptions.
             if (nlr.ret_val != &mp_const_GeneratorExit_obj) {
-                const byte *ip = code_state->fun_bc->bytecode;
-                ip = mp_decode_uint_skip(ip); // skip n_state
-                ip = mp_decode_uint_skip(ip); // skip n_exc_stack
-                ip++; // skip scope_params
-                ip++; // skip n_pos_args
-                ip++; // skip n_kwonly_args
-                ip++; // skip n_def_pos_args
-                size_t bc = code_state->ip - ip;
-                size_t code_info_size = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip); // skip code_info_size
-                bc -= code_info_size;
-                #if MICROPY_PERSISTENT_CODE
-                qstr block_name = ip[0] | (ip[1] << 8);
-                qstr source_file = ip[2] | (ip[3] << 8);
-                ip += 4;
-                #else
-                qstr block_name = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip);
-                qstr source_file = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip);
-                #endif
-                size_t source_line = 1;
-                size_t c;
-                while ((c = *ip)) {
-                    size_t b, l;
-                    if ((c & 0x80) == 0) {
-                        // 0b0LLBBBBB encoding
-                        b = c & 0x1f;
-                        l = c >> 5;
-                        ip += 1;
-                    } else {
-                        // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
-                        b = c & 0xf;
-                        l = ((c << 4) & 0x700) | ip[1];
-                        ip += 2;
-                    }
-                    if (bc >= b) {
-                        bc -= b;
-                        source_line += l;
-                    } else {
-                        // found source line corresponding to bytecode offset
-                        break;
-                    }
-                }
+                qstr block_name, source_file;
+                size_t source_line;
+                mp_bytecode_get_source_info(code_state->fun_bc->bytecode, code_state->ip,
+                    &block_name, &source_file, &source_line);
                 mp_obj_exception_add_traceback(MP_OBJ_FROM_PTR(nlr.ret_val), source_file, source_line, block_name);
             }
 
@@ -1446,16 +1973,25 @@ unwind_loop:
 
             #if MICROPY_STACKLESS
             } else if (code_state->prev != NULL) {
-                mp_globals_set(code_state->old_globals);
                 mp_code_state_t *new_code_state = code_state->prev;
-                #if MICROPY_ENABLE_PYSTACK
-                // Free code_state, and args allocated by mp_call_prepare_args_n_kw_var
-                // (The latter is implicitly freed when using pystack due to its LIFO nature.)
-                // The sizeof in the following statement does not include the size of the variable
-                // part of the struct.  This arg is anyway not used if pystack is enabled.
-                mp_nonlocal_free(code_state, sizeof(mp_code_state_t));
-                #endif
+                if (code_state->prev_kind & 2) {
+                    // generator resumed by FOR_ITER raised, pass it on to the for loop
+                    nlr.ret_val = MP_OBJ_TO_PTR(mp_obj_gen_suspend_stackless(code_state,
+                        MP_VM_RETURN_EXCEPTION, MP_OBJ_FROM_PTR(nlr.ret_val)));
+                } else {
+                    mp_globals_set(code_state->old_globals);
+                    // The sizeof in the following statement does not include the size of the variable
+                    // part of the struct.  This arg is anyway not used if pystack is enabled.
+                    mp_nonlocal_free(code_state, sizeof(mp_code_state_t));
+                }
                 code_state = new_code_state;
+                cur_code_state = code_state;
+                if (code_state->prev_kind & 2) {
+                    cur_frame_obj = mp_obj_gen_of_code_state(code_state);
+                } else {
+                    cur_frame_obj = MP_OBJ_FROM_PTR(code_state);
+                }
+                FRAME_SWITCH();
                 size_t n_state = mp_decode_uint_value(code_state->fun_bc->bytecode);
                 fastn = &code_state->state[n_state - 1];
                 exc_stack = (mp_exc_stack_t*)(code_state->state + n_state);
@@ -1469,6 +2005,7 @@ unwind_loop:
                 // propagate exception to higher level
                 // Note: ip and sp don't have usable values at this point
                 code_state->state[0] = MP_OBJ_FROM_PTR(nlr.ret_val); // put exception here because sp is invalid
+                FRAME_LEAVE();
                 return MP_VM_RETURN_EXCEPTION;
             }
         }
@@ -75,6 +75,23 @@ static const void *const entry_table[256] = {
     [MP_BC_END_FINALLY] = &&entry_MP_BC_END_FINALLY,
     [MP_BC_GET_ITER] = &&entry_MP_BC_GET_ITER,
     [MP_BC_GET_ITER_STACK] = &&entry_MP_BC_GET_ITER_STACK,
+    #if MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS
+    [MP_BC_BINARY_OP_FAST_FAST] = &&entry_MP_BC_BINARY_OP_FAST_FAST,
+    [MP_BC_BINARY_OP_FAST_SMALL_INT] = &&entry_MP_BC_BINARY_OP_FAST_SMALL_INT,
+    [MP_BC_BINARY_OP_FAST_SMALL_INT_STORE] = &&entry_MP_BC_BINARY_OP_FAST_SMALL_INT_STORE,
+    #if MICROPY_OPT_BYTECODE_QUICKENING
+    [MP_BC_BINARY_OP_FAST_FAST_SMALL_INT] = &&entry_MP_BC_BINARY_OP_FAST_FAST_SMALL_INT,
+    [MP_BC_BINARY_OP_FAST_SMALL_INT_SMALL_INT] = &&entry_MP_BC_BINARY_OP_FAST_SMALL_INT_SMALL_INT,
+    [MP_BC_BINARY_OP_FAST_SMALL_INT_STORE_SMALL_INT] = &&entry_MP_BC_BINARY_OP_FAST_SMALL_INT_STORE_SMALL_INT,
+    #endif
+    #endif
+    #if MICROPY_OPT_BYTECODE_QUICKENING
+    [MP_BC_BINARY_OP] = &&entry_MP_BC_BINARY_OP,
+    [MP_BC_BINARY_OP_SMALL_INT] = &&entry_MP_BC_BINARY_OP_SMALL_INT,
+    #if MICROPY_PY_BUILTINS_FLOAT
+    [MP_BC_BINARY_OP_FLOAT] = &&entry_MP_BC_BINARY_OP_FLOAT,
+    #endif
+    #endif
     [MP_BC_FOR_ITER] = &&entry_MP_BC_FOR_ITER,
     [MP_BC_POP_BLOCK] = &&entry_MP_BC_POP_BLOCK,
     [MP_BC_POP_EXCEPT] = &&entry_MP_BC_POP_EXCEPT,
@@ -0,0 +1,79 @@
+# test that attribute and method lookups see changes to classes
+# (these sites may be cached by the VM)
+
+class A:
+    x = 1
+    def f(self):
+        return 'A.f'
+
+class B(A):
+    pass
+
+def get(o):
+    return o.x, o.f()
+
+a = A()
+b = B()
+for i in range(3):
+    print(get(a), get(b))
+
+# replace a method in the base class
+A.f = lambda self: 'new A.f'
+print(get(a), get(b))
+
+# shadow the base class method in the subclass
+B.f = lambda self: 'B.f'
+B.x = 2
+print(get(a), get(b))
+
+# remove the shadowing method again
+del B.f
+del B.x
+print(get(a), get(b))
+
+# instance member takes precedence
+b.f = lambda: 'b.f'
+b.x = 3
+print(get(a), get(b))
+del b.f
+del b.x
+print(get(a), get(b))
+
+# mutate a class created by type()
+C = type('C', (), {'f': lambda self: 'C.f', 'x': 4})
+c = C()
+print(get(c))
+setattr(C, 'f', lambda self: 'C.f2')
+print(get(c))
+
+# the same site seeing several classes
+class D:
+    def f(self):
+        return 'D.f'
+class E:
+    def f(self):
+        return 'E.f'
+for o in (D(), E(), A(), B(), D(), E()):
+    m = o.f
+    print(o.f(), m())
+
+# classes created in a loop
+for i in range(3):
+    class F:
+        def f(self, i=i):
+            return i
+    print(F().f())
+
+# bound methods and static/class methods
+class G:
+    @staticmethod
+    def s():
+        return 'static'
+    @classmethod
+    def c(cls):
+        return cls.__name__
+g = G()
+for i in range(2):
+    s = g.s
+    c = g.c
+    print(g.s(), g.c(), s(), c())
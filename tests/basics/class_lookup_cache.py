@@ -0,0 +1,70 @@
+# test that lookups of class members follow the MRO and see changes to classes
+
+class A:
+    def f(self):
+        return 'A.f'
+    def g(self):
+        return 'A.g'
+    def __add__(self, other):
+        return 'A.__add__'
+
+class B(A):
+    def g(self):
+        return 'B.g'
+
+class C:
+    def h(self):
+        return 'C.h'
+
+class D(B, C):
+    pass
+
+# deep and multiple inheritance
+d = D()
+for i in range(2):
+    print(d.f(), d.g(), d.h(), d + d)
+
+# operator overloading through bases
+class E(D):
+    pass
+
+e = E()
+for i in range(2):
+    print(e + 1)
+
+# adding a method to a base class is seen by subclasses
+def add(self, other):
+    return 'B.__add__'
+B.__add__ = add
+print(d + d, e + e)
+
+# removing it again
+del B.__add__
+print(d + d, e + e)
+
+# replacing a method in a base class
+C.h = lambda self: 'C.h2'
+print(d.h())
+del C.h
+A.h = lambda self: 'A.h'
+print(d.h(), e.h())
+
+# missing attributes are looked up again after a class changes
+try:
+    d.k
+except AttributeError:
+    print('AttributeError')
+C.k = 1
+print(d.k, e.k)
+
+# class attributes accessed via the class
+print(E.k, E.f(e))
+
+# the same base appearing more than once
+class F(A):
+    pass
+
+class G(F, A):
+    pass
+
+print(G().f(), G().g())
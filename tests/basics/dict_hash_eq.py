@@ -0,0 +1,28 @@
+# test dict keys that have __hash__ and __eq__
+
+# keys with different hashes are different, even if they compare equal
+class A:
+    def __init__(self, v):
+        self.v = v
+    def __hash__(self):
+        return self.v
+    def __eq__(self, other):
+        return True
+
+d = {A(3): 1, A(4): 2}
+print(len(d))
+
+# a key is only compared with those that have the same hash
+class B:
+    n_eq = 0
+    def __init__(self, v):
+        self.v = v
+    def __hash__(self):
+        return self.v
+    def __eq__(self, other):
+        B.n_eq += 1
+        return self.v == other.v
+
+d = {B(i): i for i in range(10)}
+B.n_eq = 0
+print(sum(d[B(i)] for i in range(10)), B.n_eq)
@@ -0,0 +1,69 @@
+# test for loops over the builtin sequences that FOR_ITER can step directly
+
+# range with positive, negative and empty steps
+for i in range(3):
+    print(i)
+for i in range(10, 0, -3):
+    print(i)
+for i in range(0):
+    print(i)
+for i in range(5, 0):
+    print(i)
+
+# list, including growing and shrinking it during iteration
+l = [1, 2, 3]
+for x in l:
+    print(x)
+    if x == 1:
+        l.append(4)
+l = [1, 2, 3, 4]
+for x in l:
+    print(x)
+    l.pop()
+
+# list subclass and a heap iterator object
+class L(list):
+    pass
+for x in L([5, 6]):
+    print(x)
+for x in iter([7, 8]):
+    print(x)
+
+# tuple
+for x in (1, 'a', None):
+    print(x)
+for x in ():
+    print(x)
+
+# bytes and str
+for x in b'ab\xff':
+    print(x)
+for x in 'ab':
+    print(x)
+
+# bytearray, including growing it during iteration
+b = bytearray(b'xy')
+for x in b:
+    print(x)
+    if x == 120:
+        b.append(122)
+
+# nested loops, break, and return from inside a loop
+def f(seq):
+    for x in seq:
+        for y in seq:
+            if x + y == 3:
+                return x, y
+print(f([0, 1, 2]), f((1, 2)), f(range(4)))
+for x in [1, 2, 3]:
+    if x == 2:
+        break
+    print(x)
+else:
+    print('else')
+
+# loops inside generators
+def gen(seq):
+    for x in seq:
+        yield x
+print(list(gen(range(3))), list(gen([4, 5])), list(gen(b'\x06')))
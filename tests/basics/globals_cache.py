@@ -0,0 +1,67 @@
+# test that loading globals and builtins sees changes to the module dict
+
+try:
+    import builtins
+except ImportError:
+    print('SKIP')
+    raise SystemExit
+
+def f():
+    return len('abc'), x
+
+# builtin, then a global shadowing it, then the builtin again
+x = 1
+print(f())
+for i in range(2):
+    print(f())
+len = lambda s: 'len'
+print(f())
+del len
+print(f())
+
+# storing to an existing global
+x = 2
+print(f())
+
+# deleting and recreating a global
+del x
+try:
+    f()
+except NameError:
+    print('NameError')
+x = 3
+print(f())
+
+# changing the globals dict directly
+globals()['x'] = 4
+print(f())
+globals().pop('x')
+try:
+    f()
+except NameError:
+    print('NameError')
+globals()['x'] = 5
+
+# code at module level uses LOAD_NAME
+for i in range(2):
+    print(x, len([i]))
+    x += 1
+
+# a function from another module has other globals
+g = {}
+exec('def h():\n    return x', g)
+g['x'] = 'g'
+print(f(), g['h']())
+g['x'] = 'h'
+print(f(), g['h']())
+
+# overriding a builtin in the builtins module
+def k():
+    return abs(-1)
+
+print(k())
+abs_orig = builtins.abs
+builtins.abs = lambda x: 'abs'
+print(k())
+builtins.abs = abs_orig
+print(k())
@@ -0,0 +1,32 @@
+# test io.StringIO.getvalue of long values, and writing after it
+
+try:
+    import uio as io
+except ImportError:
+    import io
+
+f = io.StringIO()
+for i in range(50):
+    f.write("line %d\n" % i)
+v = f.getvalue()
+print(len(v), v[-8:], f.getvalue() == v)
+f.write("more\n")
+v2 = f.getvalue()
+print(len(v), len(v2), v2[-10:])
+f.seek(0)
+f.write("LINE")
+print(v[:8], v2[:8], f.getvalue()[:8])
+f.close()
+print(v[:8])
+
+b = io.BytesIO(b"abc" * 20)
+w = b.getvalue()
+b.write(b"X")
+print(w[:4], b.getvalue()[:4], len(b.getvalue()))
+
+b = io.BytesIO()
+b.write(b"\x00\x01" * 40)
+w = b.getvalue()
+b.seek(1)
+b.write(b"\xff")
+print(w[:4], b.getvalue()[:4])
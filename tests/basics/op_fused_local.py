@@ -0,0 +1,53 @@
+# test binary operations on locals and small ints, which may be compiled
+# to superinstructions
+
+def f(a, b):
+    print(a + b, a - b, a * b, a < b, a == b, a is b, a in [b])
+    print(a + 1, a - 16, a * 47, a < 0, a >= -1)
+    a += 1
+    print(a)
+    a = a - 2
+    print(a)
+    a = b + 1
+    print(a, b)
+
+f(1, 2)
+f(-5, 5)
+f(1 << 40, 3)
+f(0.5, 2)
+
+# in-place operations on other types
+def g(l):
+    l += [1]
+    return l
+
+print(g([0]))
+
+# unbound locals
+def h1():
+    x + 1
+    x = 1
+
+def h2():
+    y = 1
+    x + y
+    x = 1
+
+def h3():
+    x += 1
+
+for h in (h1, h2, h3):
+    try:
+        h()
+    except NameError:
+        print('NameError')
+
+# exception from the operation
+def k(a):
+    try:
+        a += 1
+    except TypeError:
+        print('TypeError')
+    return a
+
+print(k('a'))
@@ -0,0 +1,45 @@
+# test binary operations whose operand types change between executions
+
+def add(a, b):
+    return a + b
+
+def lt(a, b):
+    return a < b
+
+def mul(a, b):
+    return a * b
+
+def div(a, b):
+    return a / b
+
+args = [
+    (1, 2), (3, 4), (1.5, 2.5), (1, 2), ('a', 'b'), ([1], [2]),
+    (1 << 29, 1 << 29), (1 << 62, 1 << 62), (-1, 1), (0.5, 2), (1, 0.5),
+    (7, 8), (True, 1),
+]
+for a, b in args:
+    print(add(a, b), lt(a, b) if type(a) == type(b) else None, mul(a, 2))
+for a, b in ((1.0, 2.0), (1.0, 0.0), (3, 2), (1.0, 0.0), (4.0, 2.0)):
+    try:
+        print(div(a, b))
+    except ZeroDivisionError:
+        print('ZeroDivisionError')
+
+# operations on locals and constants, with overflow
+def f(x, y):
+    x += 1
+    z = x * 12345
+    return x < y, z - 5, x - y, x & 7, x | 8, x ^ y, x <= y, x >= y, x == y, x != y
+
+for x, y in ((1, 2), (1 << 40, 1), (1, 2), (-1 << 62, 3), (True, 2), ((1 << 30) - 1, 1)):
+    print(f(x, y))
+
+# polymorphic site used many times
+def g(l):
+    s = l[0]
+    for x in l[1:]:
+        s = s + x
+    return s
+
+for i in range(5):
+    print(g([1, 2, 3]), g([1.5, 2]), g(['a', 'b']), g([[1], [2]]))
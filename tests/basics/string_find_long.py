@@ -0,0 +1,22 @@
+# test searching for substrings in long strings and bytes
+
+s = ("abcab" * 60) + "xyzzy" + ("abcab" * 60)
+print(s.find("xyzzy"), s.rfind("xyzzy"), s.find("abcabx"), s.rfind("yabca"))
+print(s.find("cabab"), s.rfind("cabab"), s.find("zzz"), s.rfind("zzz"))
+print(s.find("bcab", 100), s.rfind("bcab", 0, 100), s.find("xyzzy", 301), s.rfind("xyzzy", 0, 304))
+print(s.count("ab"), s.count("abcab"), s.count("xyzzy"), s.count("b", 10, -10))
+print(len(s.split("ca")), s.split("xyzzy")[1][:10], s.rsplit("ab", 2)[1:], s.split("zz", 1)[1][:6])
+print(s.replace("xyzzy", "-")[295:310], s.replace("ab", "", 3)[:20])
+print("xyzzy" in s, "xyzzz" in s)
+
+# needle longer than most shift distances, and occurrences at the ends
+n = "q" * 200
+t = n + "." * 300 + n
+print(t.find(n), t.rfind(n), t.count(n), t.find(n + "."), t.rfind("." + n))
+
+# bytes, including bytes that aren't valid utf-8
+b = b"\xc3\x80\x80" * 100
+print(b.count(b"\x80"), b.count(b"\x80\x80"), b.find(b"\x80\xc3"), b.rfind(b"\xc3\x80"))
+print(b.split(b"\x80\x80")[:3], len(b.rsplit(b"\xc3")))
+ba = bytes(bytearray(b"xyz" * 50))
+print(ba.find(b"zx", 100), ba.rfind(b"yz", 0, 100), b"zxy" in bytearray(ba), b"zz" in bytearray(ba))
@@ -0,0 +1,41 @@
+# test building up long str and bytes with +=
+
+s = ""
+prefixes = []
+for i in range(300):
+    s += "piece%d," % i
+    if i % 37 == 0:
+        prefixes.append(s)
+print(len(s), s[:30], s[-20:], hash(s) == hash("".join(["piece%d," % i for i in range(300)])))
+print([len(p) for p in prefixes], [p[-8:] for p in prefixes])
+
+# appending to an earlier value doesn't change the later one, or itself
+base = "x" * 40
+base += "y"
+a = base
+a += "A" * 10
+b = base
+b += "B" * 10
+print(base, a, b)
+
+# appending a str to itself
+t = "z" * 40
+t += "q"
+t += t
+print(t, len(t))
+d = {t: 1}
+print(d["z" * 40 + "q" + "z" * 40 + "q"], t in d)
+
+# an earlier value still works as a str after later appends
+u = "u" * 50
+u += "1"
+u1 = u
+u += "2"
+print(u1 == "u" * 50 + "1", u1.encode()[-3:], u1.split("u")[-1], int(u1[-1:]))
+
+# bytes, with bytes and bytearray
+bb = b""
+for i in range(100):
+    bb += bytes([i, 255 - i])
+bb += bytearray(b"end")
+print(len(bb), bb[:6], bb[-5:], bb.count(b"\x00"))
@@ -0,0 +1,11 @@
+import bench
+
+def test(num):
+    a = 3
+    b = 7
+    i = 0
+    while i < num:
+        x = (a * b + i) - (a - b)
+        i += 1
+
+bench.run(test)
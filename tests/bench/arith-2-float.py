@@ -0,0 +1,11 @@
+import bench
+
+def test(num):
+    a = 0.5
+    b = 1.25
+    x = 0.0
+    for i in range(num // 10):
+        x = a * b + x - (a - b) * b
+        x = x / b + a
+
+bench.run(test)
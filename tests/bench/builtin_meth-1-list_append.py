@@ -0,0 +1,9 @@
+import bench
+
+def test(num):
+    l = []
+    for i in iter(range(num // 10)):
+        l.append(i)
+        l.pop()
+
+bench.run(test)
@@ -0,0 +1,8 @@
+import bench
+
+def test(num):
+    s = 'abc'
+    for i in iter(range(num // 10)):
+        s.endswith('c')
+
+bench.run(test)
@@ -0,0 +1,9 @@
+import bench
+import sys
+
+def test(num):
+    for i in iter(range(num // 10)):
+        sys.stdout
+        sys.version
+
+bench.run(test)
@@ -0,0 +1,12 @@
+import bench
+
+def test(num):
+    d = {}
+    for i in range(200):
+        d["key%d" % i] = i
+    keys = list(d)[::20]
+    for i in range(num // 10):
+        for k in keys:
+            d[k]
+
+bench.run(test)
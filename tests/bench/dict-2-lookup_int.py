@@ -0,0 +1,11 @@
+import bench
+
+def test(num):
+    d = {}
+    for i in range(200):
+        d[i * 7] = i
+    for i in range(num // 20):
+        for k in range(0, 1400, 140):
+            d[k]
+
+bench.run(test)
@@ -0,0 +1,15 @@
+import bench
+
+def test(num):
+    d = {}
+    for i in range(1000):
+        d[i] = i
+    for i in range(0, 1000, 2):
+        del d[i]
+    for i in range(num // 2000):
+        for k in d:
+            pass
+        for kv in d.items():
+            pass
+
+bench.run(test)
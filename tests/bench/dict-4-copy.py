@@ -0,0 +1,10 @@
+import bench
+
+def test(num):
+    d = {}
+    for i in range(100):
+        d[str(i)] = i
+    for i in range(num // 40):
+        d.copy()
+
+bench.run(test)
@@ -0,0 +1,19 @@
+import bench
+
+class Point:
+    def __init__(self, x, y, z):
+        self.x = x
+        self.y = y
+        self.z = z
+        self.w = 0
+        self.tag = None
+
+def test(num):
+    # many small instance dicts and one large dict kept alive, so the heap
+    # usage of the map tables shows up as time spent collecting
+    for i in range(num // 40000):
+        keep = {}
+        for j in range(2000):
+            keep[j] = Point(j, j, j)
+
+bench.run(test)
@@ -0,0 +1,10 @@
+# Iterate over a range object with a for loop
+import bench
+
+def test(num):
+    r = range(1000)
+    for i in iter(range(num // 1000)):
+        for x in r:
+            pass
+
+bench.run(test)
@@ -0,0 +1,14 @@
+# Function call overhead test
+# Perform the same trivial operation as a method call
+import bench
+
+class A:
+    def f(self, x):
+        return x + 1
+
+def test(num):
+    a_ = A()
+    for i in iter(range(num)):
+        a = a_.f(i)
+
+bench.run(test)
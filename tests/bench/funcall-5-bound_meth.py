@@ -0,0 +1,15 @@
+# Function call overhead test
+# Perform the same trivial operation as calling a bound method object,
+# cached in a local variable
+import bench
+
+class A:
+    def f(self, x):
+        return x + 1
+
+def test(num):
+    f_ = A().f
+    for i in iter(range(num)):
+        a = f_(i)
+
+bench.run(test)
@@ -0,0 +1,12 @@
+# Function call overhead test
+# Perform the same trivial operation as calling a closure
+import bench
+
+def test(num):
+    one = 1
+    def f(x):
+        return x + one
+    for i in iter(range(num)):
+        a = f(i)
+
+bench.run(test)
@@ -0,0 +1,13 @@
+# Function call overhead test
+# Instantiate a class with a trivial __init__
+import bench
+
+class A:
+    def __init__(self, x):
+        self.x = x
+
+def test(num):
+    for i in iter(range(num // 4)):
+        a = A(i)
+
+bench.run(test)
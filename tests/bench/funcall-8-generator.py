@@ -0,0 +1,13 @@
+# Function call overhead test
+# Perform the same trivial operation in a generator consumed by a for loop
+import bench
+
+def gen(num):
+    for i in range(num):
+        yield i + 1
+
+def test(num):
+    for a in gen(num):
+        pass
+
+bench.run(test)
@@ -0,0 +1,14 @@
+# Function call overhead test
+# Deep chains of calls, each returning through all the frames
+import bench
+
+def f(n):
+    if n == 0:
+        return 0
+    return f(n - 1) + 1
+
+def test(num):
+    for i in iter(range(num // 50)):
+        a = f(50)
+
+bench.run(test)
@@ -0,0 +1,9 @@
+import bench
+
+def test(num):
+    # keep a lot of small objects alive, so the heap is part full
+    keep = [[i] for i in range(num // 2000)]
+    for i in iter(range(num // 20)):
+        x = [i, i]
+
+bench.run(test)
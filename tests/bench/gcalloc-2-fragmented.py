@@ -0,0 +1,11 @@
+import bench
+
+def test(num):
+    # objects of 1 to 4 blocks, every other one replaced as it goes, so the
+    # free space is in small holes all over the heap
+    objs = [bytes(i % 50) for i in range(num // 1000)]
+    n = len(objs)
+    for i in iter(range(num // 20)):
+        objs[(i * 2) % n] = bytes(i % 50)
+
+bench.run(test)
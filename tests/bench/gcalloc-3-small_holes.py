@@ -0,0 +1,13 @@
+import bench
+
+def test(num):
+    # floats kept alive between ones that die leave a lot of 1 block holes, that
+    # are too small for the 2 block tuples allocated after them
+    keep = []
+    for i in iter(range(num // 2000)):
+        keep.append(1.0 * i)
+        junk = 1.0 * i
+    for i in iter(range(num // 200)):
+        x = (i, i, i)
+
+bench.run(test)
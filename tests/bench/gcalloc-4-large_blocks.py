@@ -0,0 +1,10 @@
+import bench
+
+def test(num):
+    # large buffers fill the rest of a heap that has a lot of small live
+    # objects in it, and are swept again
+    keep = [[i] for i in range(num // 2000)]
+    for i in iter(range(num // 200)):
+        x = bytearray(1000)
+
+bench.run(test)
@@ -0,0 +1,10 @@
+import bench
+import gc
+
+def test(num):
+    # collections of a heap that is partly full of small live objects
+    keep = [[i] for i in range(num // 2000)]
+    for i in iter(range(num // 100000)):
+        gc.collect()
+
+bench.run(test)
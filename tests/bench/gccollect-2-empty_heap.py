@@ -0,0 +1,10 @@
+import bench
+import gc
+
+def test(num):
+    # collections of a heap with hardly anything in it, so the time goes on
+    # sweeping the free blocks
+    for i in iter(range(num // 20000)):
+        gc.collect()
+
+bench.run(test)
@@ -0,0 +1,12 @@
+import bench
+import gc
+
+def test(num):
+    # collections of a big heap of small live objects, marked by one thread
+    if hasattr(gc, 'markers'):
+        gc.markers(1)
+    keep = [[i] for i in range(num // 1000)]
+    for i in iter(range(num // 200000)):
+        gc.collect()
+
+bench.run(test)
@@ -0,0 +1,11 @@
+import bench
+import gc
+
+def test(num):
+    # collections of a big heap of small live objects, marked by as many
+    # threads as the port uses by default
+    keep = [[i] for i in range(num // 1000)]
+    for i in iter(range(num // 200000)):
+        gc.collect()
+
+bench.run(test)
@@ -0,0 +1,16 @@
+import bench
+
+def work(n):
+    # short-lived floats and tuples, allocated with gc_alloc as usual
+    s = 0.0
+    for i in range(n):
+        p = (i * 0.5, i * 0.25)
+        s += p[0] * p[1]
+    return s
+
+def test(num):
+    keep = [[i] for i in range(num // 2000)]
+    for i in range(num // 2000):
+        work(100)
+
+bench.run(test)
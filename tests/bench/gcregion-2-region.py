@@ -0,0 +1,18 @@
+import bench
+import micropython
+
+def work(n):
+    # short-lived floats and tuples, bump-allocated and freed in bulk
+    s = 0.0
+    for i in range(n):
+        p = (i * 0.5, i * 0.25)
+        s += p[0] * p[1]
+    return s
+
+def test(num):
+    keep = [[i] for i in range(num // 2000)]
+    for i in range(num // 2000):
+        with micropython.region(16000):
+            work(100)
+
+bench.run(test)
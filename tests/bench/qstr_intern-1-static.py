@@ -0,0 +1,10 @@
+import bench
+
+# create strs whose data is already in the const qstr pool
+def test(num):
+    names = ('append', 'extend', 'index', 'remove', 'reverse', 'sort', 'copy', 'pop')
+    for i in iter(range(num // 80)):
+        for n in names:
+            '%s' % n
+
+bench.run(test)
@@ -0,0 +1,8 @@
+import bench
+
+# create strs that don't match any existing qstr
+def test(num):
+    for i in iter(range(num // 10)):
+        'k%d' % i
+
+bench.run(test)
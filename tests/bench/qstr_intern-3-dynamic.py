@@ -0,0 +1,12 @@
+import bench
+
+# intern many new names, then create strs that match them
+def test(num):
+    names = ['attr_%d' % i for i in range(2000)]
+    for n in names:
+        hasattr(names, n)
+    for i in iter(range(num // 20000)):
+        for n in names:
+            '%s' % n
+
+bench.run(test)
@@ -0,0 +1,10 @@
+import bench
+
+def test(num):
+    l = list(range(1000))
+    r = list(range(1000, 0, -1))
+    for i in range(num // 40000):
+        sorted(l)
+        sorted(r)
+
+bench.run(test)
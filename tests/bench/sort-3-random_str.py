@@ -0,0 +1,12 @@
+import bench
+
+def test(num):
+    x = 1
+    l = []
+    for i in range(1000):
+        x = (x * 1103515245 + 12345) & 0x3FFFFFFF
+        l.append(str(x))
+    for i in range(num // 8000):
+        sorted(l)
+
+bench.run(test)
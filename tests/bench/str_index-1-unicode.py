@@ -0,0 +1,10 @@
+import bench
+
+def test(num):
+    s = "aé€😀" * 1000
+    n = len(s)
+    for k in range(num // 40000):
+        for i in range(n):
+            s[i]
+
+bench.run(test)
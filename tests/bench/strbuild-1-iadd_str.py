@@ -0,0 +1,10 @@
+import bench
+
+def test(num):
+    for i in range(num // 200000):
+        s = ""
+        for j in range(2000):
+            s += "item, "
+        len(s)
+
+bench.run(test)
@@ -0,0 +1,11 @@
+import bench
+
+def test(num):
+    chunk = b"\x00\x01\x02\x03\x04\x05\x06\x07"
+    for i in range(num // 200000):
+        b = b""
+        for j in range(2000):
+            b += chunk
+        len(b)
+
+bench.run(test)
@@ -0,0 +1,11 @@
+import bench
+from uio import StringIO
+
+def test(num):
+    f = StringIO()
+    for j in range(2000):
+        f.write("line of text\n")
+    for i in range(num // 200):
+        f.getvalue()
+
+bench.run(test)
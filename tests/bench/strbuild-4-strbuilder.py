@@ -0,0 +1,11 @@
+import bench
+import micropython
+
+def test(num):
+    for i in range(num // 200000):
+        b = micropython.strbuilder()
+        for j in range(2000):
+            b.append("item, ")
+        len(b.build())
+
+bench.run(test)
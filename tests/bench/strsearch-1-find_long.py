@@ -0,0 +1,10 @@
+import bench
+
+def test(num):
+    line = "2024-01-01 12:00:00 INFO worker[17]: request handled in 12ms\n"
+    s = line * 200 + "ERROR: disk quota exceeded"
+    for i in range(num // 4000):
+        s.find("ERROR: disk")
+        s.find("quota exceeded")
+
+bench.run(test)
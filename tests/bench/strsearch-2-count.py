@@ -0,0 +1,8 @@
+import bench
+
+def test(num):
+    s = "GET /index.html HTTP/1.1 200 OK " * 400
+    for i in range(num // 4000):
+        s.count("HTTP/1.1 200")
+
+bench.run(test)
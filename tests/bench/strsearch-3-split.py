@@ -0,0 +1,8 @@
+import bench
+
+def test(num):
+    s = "key=value; " * 100 + "x" * 2000 + "; tail"
+    for i in range(num // 4000):
+        s.split("; ")
+
+bench.run(test)
@@ -0,0 +1,9 @@
+import bench
+
+def test(num):
+    b = bytes(range(32, 127)) * 50
+    for i in range(num // 4000):
+        b"~~~" in b
+        b.rfind(b" !\"#$")
+
+bench.run(test)
@@ -0,0 +1,9 @@
+import bench
+
+def test(num):
+    l = [1, 2, 3]
+    i = 0
+    while i < num:
+        i += len(l) - 2
+
+bench.run(test)
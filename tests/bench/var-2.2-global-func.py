@@ -0,0 +1,11 @@
+import bench
+
+def step():
+    return 1
+
+def test(num):
+    i = 0
+    while i < num:
+        i += step()
+
+bench.run(test)
@@ -0,0 +1,22 @@
+import bench
+
+class Base:
+
+    def num(self):
+        return self._num
+
+class Mid(Base):
+    pass
+
+class Foo(Mid):
+
+    def __init__(self):
+        self._num = 20000000
+
+def test(num):
+    o = Foo()
+    i = 0
+    while i < o.num():
+        i += 1
+
+bench.run(test)
@@ -0,0 +1,34 @@
+import bench
+
+class Base:
+
+    def __init__(self, n):
+        self.n = n
+
+    def __lt__(self, other):
+        return self.n < other
+
+    def __add__(self, other):
+        return self.__class__(self.n + other)
+
+class L1(Base):
+    pass
+
+class L2(L1):
+    pass
+
+class Mixin:
+    pass
+
+class L3(Mixin, L2):
+    pass
+
+class Foo(L3):
+    pass
+
+def test(num):
+    i = Foo(0)
+    while i < num:
+        i = i + 1
+
+bench.run(test)
@@ -0,0 +1,3 @@
+# cmdline: -X heapmax=0
+# check if the heap can grow, with -X heapmax
+print('heapmax')
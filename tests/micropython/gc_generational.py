@@ -0,0 +1,63 @@
+# tests the generational garbage collector
+import gc
+
+try:
+    gc.collect(0)
+except TypeError:
+    print('SKIP')
+    raise SystemExit
+
+try:
+    import utime
+except ImportError:
+    print('SKIP')
+    raise SystemExit
+
+try:
+    gc.collect(3)
+except ValueError:
+    print('ValueError')
+
+# young objects are stored into old ones, with minor collections in between
+class Box:
+    def __init__(self, x):
+        self.x = x
+
+    def get(self):
+        return self.x
+
+def mutate(n):
+    lists = [[] for j in range(n)]
+    dicts = [{} for j in range(n)]
+    boxes = [Box(j) for j in range(n)]
+    gc.collect()
+    for i in range(5000):
+        a = i % n
+        lists[a].append((i, i * 0.5))
+        dicts[a][i % 7] = boxes[(i * 3) % n].get
+        boxes[a].x = (i, i + 0.25)
+        if i % 97 == 0:
+            gc.collect(0)
+    ok = True
+    for j in range(n):
+        ok = ok and all(t[1] == t[0] * 0.5 for t in lists[j])
+        ok = ok and all(isinstance(m(), tuple) or isinstance(m(), int) for m in dicts[j].values())
+        ok = ok and boxes[j].x[1] == boxes[j].x[0] + 0.25
+    return ok
+
+print(mutate(50))
+
+# A minor collection only looks at the young objects (and the old ones that
+# were stored to), so with a lot of old data it should be much faster than a
+# full collection.
+def collect_time(generation):
+    t = utime.ticks_us()
+    for i in range(10):
+        gc.collect(generation)
+    return utime.ticks_diff(utime.ticks_us(), t)
+
+live = [[j, j] for j in range(4000)]
+gc.collect()
+t_full = min(collect_time(2) for _ in range(3))
+t_minor = min(collect_time(0) for _ in range(3))
+print(t_minor * 4 < t_full)
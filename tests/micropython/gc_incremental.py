@@ -0,0 +1,72 @@
+# tests the incremental garbage collector
+import gc
+
+if not hasattr(gc, 'incremental'):
+    print('SKIP')
+    raise SystemExit
+
+try:
+    gc.incremental(-1)
+except ValueError:
+    print('ValueError')
+
+budget = gc.incremental()
+print(budget > 0)
+
+# pointers are moved between old objects while a collection is in progress,
+# using a small budget so that each collection takes many slices
+class Box:
+    pass
+
+def mk(i):
+    return [i, str(i), (i, i * 2)]
+
+def check(v):
+    return v[1] == str(v[0]) and v[2] == (v[0], v[0] * 2)
+
+def mutate(n):
+    lists = [[mk(j)] for j in range(n)]
+    dicts = [{'k': mk(j)} for j in range(n)]
+    boxes = [Box() for j in range(n)]
+    for j in range(n):
+        boxes[j].a = mk(j)
+    for i in range(20000):
+        a = i % n
+        b = i * 7 % n
+        x = lists[a].pop()
+        junk = [str(i), str(i + 1)]
+        lists[b].append(x)
+        x = dicts[a]['k']
+        dicts[a]['k'] = boxes[b].a
+        boxes[b].a = x
+        if i % 3 == 0:
+            lists[a].reverse()
+    ok = True
+    for j in range(n):
+        ok = ok and all(check(v) for v in lists[j])
+        ok = ok and check(dicts[j]['k']) and check(boxes[j].a)
+    return ok
+
+gc.incremental(4)
+print(mutate(100))
+
+# A collection of a heap with a lot of live data in it should be spread over
+# many slices, each marking at most the budget, rather than done all at once.
+def slices():
+    gc.collect()
+    for i in range(200000):
+        junk = [i, i, i, i]
+        if gc.slices() != 1:
+            break
+    return gc.slices()
+
+live = [[j, j] for j in range(20000)]
+gc.incremental(0)
+print(slices())
+gc.incremental(256)
+print(slices() > len(live) // 256)
+gc.collect()
+print(gc.slices())
+
+gc.incremental(budget)
+print(gc.incremental() == budget)
@@ -0,0 +1,35 @@
+# tests that gc.mem_alloc and gc.mem_free follow allocations and frees
+import gc
+
+try:
+    gc.mem_alloc
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+gc.collect()
+total = gc.mem_free() + gc.mem_alloc()
+
+# allocating counts the whole block(s)
+a0 = gc.mem_alloc()
+b = bytearray(1000)
+a1 = gc.mem_alloc()
+print(1000 <= a1 - a0 < 1200)
+
+# growing and shrinking in place
+l = [1]
+for i in range(200):
+    l.append(i)
+a2 = gc.mem_alloc()
+print(a2 > a1)
+
+# freeing by a collection (a stray pointer may keep one or two alive)
+l = [bytearray(1000) for i in range(100)]
+a3 = gc.mem_alloc()
+for i in range(100):
+    l[i] = None
+gc.collect()
+print(a3 - gc.mem_alloc() > 90 * 1000)
+
+# the total stays the same throughout, or grows with the heap
+print(gc.mem_free() + gc.mem_alloc() >= total)
@@ -0,0 +1,63 @@
+# cmdline: -X heapmax=64M
+# tests marking the heap with several threads
+import gc
+
+try:
+    gc.markers
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+# the markers are only used on a big heap
+try:
+    ballast = bytearray(3 * 1024 * 1024)
+except MemoryError:
+    print('SKIP')
+    raise SystemExit
+
+try:
+    gc.markers(0)
+except ValueError:
+    print('ValueError')
+gc.markers(1000)
+print(gc.markers() > 1)
+gc.markers(4)
+
+# a long chain of objects, one big object pointing to lots of small ones, and
+# lots of small objects each pointing to a few more, which overflow the stacks
+def make():
+    chain = None
+    for i in range(2000):
+        chain = (i, chain)
+    big = [[i] for i in range(5000)]
+    wide = [{i: str(i), -i: [i, i + 1]} for i in range(1000)]
+    return chain, big, wide
+
+def check(chain, big, wide):
+    ok = True
+    i = 1999
+    while chain is not None:
+        ok = ok and chain[0] == i
+        chain = chain[1]
+        i -= 1
+    ok = ok and i == -1
+    ok = ok and all(big[i] == [i] for i in range(5000))
+    ok = ok and all(wide[i][i] == str(i) and wide[i][-i] == [i, i + 1] for i in range(1, 1000))
+    return ok
+
+data = make()
+for n in range(5):
+    gc.collect()
+    # reuse what was freed, so that anything that wasn't marked is clobbered
+    garbage = [bytearray(b'x' * 24) for i in range(2000)]
+    garbage = None
+print(check(*data))
+
+# all the garbage is freed
+data = None
+gc.collect()
+before = gc.mem_alloc()
+data = make()
+data = None
+gc.collect()
+print(gc.mem_alloc() - before < 1024)
@@ -0,0 +1,33 @@
+# cmdline: -X heapmax=16M
+# tests that the heap grows when it's full, on ports that support that
+import gc
+
+gc.collect()
+total = gc.mem_free() + gc.mem_alloc()
+
+# hold on to twice as much memory as the heap had to start with
+data = []
+try:
+    for i in range(2 * total // 1024):
+        data.append(bytearray(1000))
+except MemoryError:
+    print('SKIP')
+    raise SystemExit
+
+print(gc.mem_free() + gc.mem_alloc() > 2 * total)
+
+# all the data, in the old and new areas, survives a collection
+for i, b in enumerate(data):
+    b[0] = i & 0xff
+gc.collect()
+print(all(b[0] == i & 0xff and len(b) == 1000 for i, b in enumerate(data)))
+
+# a big object needs an area of its own
+big = bytearray(total)
+print(len(big) == total)
+
+# and freed memory in the new areas is reused
+data = None
+big = None
+gc.collect()
+print(gc.mem_free() > total)
@@ -0,0 +1,57 @@
+# test micropython.heap_dump, by reading back the dump
+try:
+    import micropython, uos, ustruct
+    micropython.heap_dump
+except (ImportError, AttributeError):
+    print('SKIP')
+    raise SystemExit
+
+FILE = 'heap_dump.bin'
+
+class Foo:
+    pass
+
+b = bytearray(b'marker')
+objs = [Foo() for i in range(10)]
+
+with open(FILE, 'wb') as f:
+    micropython.heap_dump(f)
+
+W = ustruct.calcsize('P')
+with open(FILE, 'rb') as f:
+    hdr = f.read(8)
+    print(hdr[:4], hdr[4], hdr[5] == W)
+    block = hdr[7]
+    kinds = set()
+    types = {}
+    while True:
+        kind, a, n = ustruct.unpack('3P', f.read(3 * W))
+        kinds.add(kind)
+        if kind == 0:
+            break
+        elif kind == 1:
+            # area: check the kind and first word of the bytearray's head block
+            atb = f.read(n // 4)
+            if a <= id(b) < a + n * block:
+                bl = (id(b) - a) // block
+                print('head', (atb[bl // 4] >> (2 * (bl % 4))) & 1)
+                f.seek(bl * block, 1)
+                print('type', ustruct.unpack('P', f.read(W))[0] == id(bytearray))
+                f.seek(n * block - bl * block - W, 1)
+            else:
+                f.seek(n * block, 1)
+        elif kind == 2:
+            f.seek(n * W, 1)
+        elif kind == 3:
+            types[a] = f.read(n)
+print(sorted(kinds))
+print(types.get(id(bytearray)), types.get(id(Foo)), types.get(id(type)))
+uos.remove(FILE)
+
+# the heap is usable again
+print(len([Foo() for i in range(10)]))
+
+try:
+    micropython.heap_dump(1)
+except OSError:
+    print('OSError')
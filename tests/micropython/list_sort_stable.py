@@ -0,0 +1,57 @@
+# test the stable merge sort used by list.sort() and sorted()
+
+n_calls = 0
+
+
+def key(x):
+    global n_calls
+    n_calls += 1
+    return x[0]
+
+
+sorted([(i,) for i in range(50)], key=key)
+if n_calls != 50:
+    print("SKIP")
+    raise SystemExit
+
+# pseudo-random data, without needing a random module
+def lcg(n, bits):
+    x = 1
+    l = []
+    for i in range(n):
+        x = (x * 1103515245 + 12345) & 0x7FFFFFFF
+        l.append(x >> (31 - bits))
+    return l
+
+
+# equal keys keep their order, also when reversed
+for n in (2, 5, 63, 64, 65, 300, 2000):
+    l = [(k, i) for i, k in enumerate(lcg(n, 4))]
+    for rev in (False, True):
+        n_calls = 0
+        s = sorted(l, key=key, reverse=rev)
+        exp = sorted(l, reverse=rev)
+        if rev:
+            # equal keys stay in order, so sort the indices ascending
+            exp = sorted(l, key=lambda t: (-t[0], t[1]))
+        print(n, rev, s == exp, n_calls == n)
+
+# runs already in the data, and the small int and str fast paths
+l = list(range(100)) + list(range(200, 100, -1)) + list(range(100, 200))
+print(sorted(l)[:3], sorted(l)[98:104], sorted(l)[-3:])
+print(sorted(str(x) for x in lcg(20, 10))[:4])
+print(sorted([3, 1.5, -2, 2**70, 0.25]))
+print(sorted(["b", "a", "ab", "", "ba"], reverse=True))
+
+# a failing comparison raises and leaves all the items in the list
+l = list(range(300, 0, -1)) + ["x"] + list(range(100))
+try:
+    l.sort()
+except TypeError:
+    print("TypeError")
+print(len(l), sorted(x for x in l if x != "x") == sorted(list(range(1, 301)) + list(range(100))))
+l = [3, 2, 1]
+try:
+    l.sort(key=lambda x: 1 // (x - 2))
+except ZeroDivisionError:
+    print("ZeroDivisionError", l)
@@ -0,0 +1,63 @@
+# test the compact layout of maps, which keeps dicts in insertion order
+
+d = {}
+for i in range(20, 0, -1):
+    d[str(i)] = i
+if list(d)[:3] != ["20", "19", "18"]:
+    print("SKIP")
+    raise SystemExit
+
+# order is kept through growth, deletes and reinserts
+d = {}
+for i in range(100):
+    d[i * 37 % 101] = i
+for i in range(0, 100, 3):
+    del d[i * 37 % 101]
+d[200] = "new"
+d[-1] = "last"
+print(list(d)[:8], list(d)[-3:], len(d))
+print(all(d[i * 37 % 101] == i for i in range(100) if i % 3))
+
+# many deletes compact the table instead of growing it
+d = {"a": 1}
+for i in range(5000):
+    d[i] = i
+    del d[i]
+print(d)
+
+# popitem returns the most recently added item
+d = {"x": 1, "y": 2, "z": 3}
+for i in range(20):
+    d[i] = i
+print(d.popitem(), d.popitem(), len(d))
+while len(d) > 1:
+    d.popitem()
+print(d)
+
+# small maps search linearly but still need hashable keys
+try:
+    {[]: 1}
+except TypeError:
+    print("TypeError")
+try:
+    [] in {1: 2}
+except TypeError:
+    print("TypeError")
+
+# copy keeps the order, and is independent of the original
+d = {str(i): i for i in range(30)}
+c = d.copy()
+del d["0"]
+c["new"] = 1
+print(list(c)[:3], list(c)[-2:], len(d), len(c))
+
+# instance members and globals use the same layout
+class A:
+    pass
+a = A()
+for i in range(12):
+    setattr(a, "b%d" % (11 - i), i)
+print(list(a.__dict__)[:4])
+delattr(a, "b11")
+a.b11 = 0
+print(list(a.__dict__)[-2:])
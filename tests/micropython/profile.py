@@ -0,0 +1,52 @@
+# tests the sampling profiler in the micropython module
+import micropython
+
+if not hasattr(micropython, 'profile_start'):
+    print('SKIP')
+    raise SystemExit
+
+try:
+    micropython.profile_stop()
+except RuntimeError:
+    print('RuntimeError')
+
+def work():
+    s = 0
+    for i in range(500000):
+        s += i * i
+    return s
+
+def outer():
+    micropython.profile_start(1000)
+    work()
+    try:
+        micropython.profile_start()
+    except RuntimeError:
+        print('RuntimeError')
+    return micropython.profile_stop()
+
+out = outer()
+print(type(out))
+# each line is a stack of frames, outermost first, then the sample count;
+# the number of samples varies so just check the format
+for line in out.splitlines():
+    stack, count = line.rsplit(' ', 1)
+    frames = stack.split(';')
+    if int(count) <= 0 or not frames[0].startswith('<module> ('):
+        print('bad line', line)
+    for f in frames:
+        name, loc = f[:-1].split(' (')
+        file, lineno = loc.rsplit(':', 1)
+        int(lineno)
+print('work (' in out)
+
+# stopped, so profile_stop raises again
+try:
+    micropython.profile_stop()
+except RuntimeError:
+    print('RuntimeError')
+
+try:
+    micropython.profile_start(0)
+except ValueError:
+    print('ValueError')
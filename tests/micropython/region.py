@@ -0,0 +1,85 @@
+# test micropython.region
+
+import micropython
+
+try:
+    micropython.region
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+def work(n):
+    s = 0.0
+    for i in range(n):
+        p = (i * 0.5, i * 0.25)
+        s += p[0] * p[1]
+    return s
+
+# nothing escapes, so the region's objects are freed
+r = micropython.region(4096)
+print(r.escaped())
+with r:
+    x = int(work(50))
+print(x, r.escaped())
+
+# an object stored into a container from outside escapes, and is kept
+keep = []
+with micropython.region(4096) as r:
+    keep.append((1, work(3)))
+print(keep, r.escaped())
+
+# so does one stored into a global
+def store():
+    global g
+    with micropython.region(4096) as r:
+        g = 1.25 * 3
+    return r.escaped()
+print(store(), g)
+
+# strict regions raise an exception if anything escapes
+try:
+    with micropython.region(4096, True):
+        g = 2.5 * 3
+except RuntimeError:
+    print('RuntimeError')
+print(g)
+
+# nested regions, where an object escapes from the inner one
+with micropython.region(4096) as a:
+    with micropython.region(4096) as b:
+        t = (1.5 + 2,)
+    print(b.escaped())
+print(a.escaped(), t)
+
+# more than fits in a chunk is allocated in more chunks
+with micropython.region(64):
+    x = int(work(100))
+print(x)
+
+# collections keep the objects in an active region
+import gc
+with micropython.region(16384):
+    t = tuple(i * 0.5 for i in range(100))
+    gc.collect()
+    print(sum(t))
+print(sum(t))
+
+# a region can't be entered twice at once
+r = micropython.region(4096)
+with r:
+    try:
+        r.__enter__()
+    except RuntimeError:
+        print('RuntimeError')
+
+# an object pended to a generator escapes
+def gen():
+    yield 1
+def pend(a):
+    g = gen()
+    next(g)
+    with micropython.region(4096) as r:
+        g.pend_throw((a * 1.5, a * 2.5))
+    [(n * 1.0, n * 2.0) for n in range(2000)]
+    return r.escaped(), g.pend_throw(None)
+print(pend(1))
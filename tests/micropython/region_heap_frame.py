@@ -0,0 +1,20 @@
+# test that a local assigned in a region is kept when the frame is on the heap
+
+import micropython
+
+try:
+    micropython.region
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+# enough locals for the frame to be allocated on the heap
+def f(y):
+    a = b = c = d = e = g = h = i = j = k = l = m = 0
+    with micropython.region(4096) as r:
+        x = (y * 1.5, y * 2.5)
+    [(n * 1.0, n * 2.0) for n in range(2000)]
+    return r.escaped(), x
+
+for y in range(1, 4):
+    print(f(y))
@@ -0,0 +1,48 @@
+# test micropython.strbuilder
+
+import micropython
+
+try:
+    micropython.strbuilder
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+b = micropython.strbuilder()
+print(len(b), bool(b))
+b.append('abc')
+b.append_int(-42)
+b.append_int(12345678901234567890)
+b.append_fmt('|%s=%d|', 'x', 7)
+b.append_fmt('end')
+print(len(b), bool(b))
+s = b.build()
+print(type(s), repr(s))
+
+# build leaves it empty, and it can be used again
+print(len(b), repr(b.build()))
+b.append('again')
+print(b.build())
+
+# with an initial size, and non-ASCII data
+b = micropython.strbuilder(4)
+for i in range(100):
+    b.append('é')
+s = b.build()
+print(len(s), s == 'é' * 100, s.encode()[:4])
+
+# nothing is appended when the format fails
+b = micropython.strbuilder()
+b.append('a')
+try:
+    b.append_fmt('%d %d', 1)
+except TypeError:
+    print('TypeError')
+print(b.build())
+
+# wrong types
+for meth, arg in (('append', 1), ('append', b'x'), ('append_int', 'x'), ('append_int', 1.5), ('append_fmt', b'x')):
+    try:
+        getattr(b, meth)(arg)
+    except TypeError:
+        print(meth, 'TypeError')
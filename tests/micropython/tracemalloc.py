@@ -0,0 +1,56 @@
+# test utracemalloc, which records the lines that allocate heap blocks
+try:
+    import utracemalloc
+except ImportError:
+    print('SKIP')
+    raise SystemExit
+
+print(utracemalloc.is_tracing())
+try:
+    utracemalloc.take_snapshot()
+except RuntimeError:
+    print('RuntimeError')
+
+def alloc(n):
+    return [bytearray(100) for i in range(n)]
+
+def find(stats, line):
+    for key, size, count in stats:
+        if key[1] == line:
+            return key[2], size, count
+    return None
+
+utracemalloc.start()
+print(utracemalloc.is_tracing())
+old = alloc(5)
+s1 = utracemalloc.take_snapshot()
+live = alloc(10)
+del old
+s2 = utracemalloc.take_snapshot()
+
+# the bytearrays still live that were allocated by line 15, each of which
+# is an object and a buffer
+func, size, count = find(s2.statistics(), 15)
+print(func, count >= 20, size >= 10 * 100)
+
+# biggest first
+stats = s2.statistics()
+print(all(stats[i][1] >= stats[i + 1][1] for i in range(len(stats) - 1)))
+
+# the differences are by line too
+for key, size, size_diff, count, count_diff in s2.compare_to(s1):
+    if key == ('<unknown>', 0, '<unknown>'):
+        continue
+    if key[2] == '<listcomp>':
+        print(key[1], count >= 20, count_diff >= 10, size_diff > 0)
+
+# grouped by file
+stats = s2.statistics('filename')
+print(len(stats[0][0]), sum(s[1] for s in stats) == sum(s[1] for s in s2.statistics()))
+try:
+    s2.statistics('traceback')
+except ValueError:
+    print('ValueError')
+
+utracemalloc.stop()
+print(utracemalloc.is_tracing())
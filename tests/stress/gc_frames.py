@@ -0,0 +1,34 @@
+# test that frames of running functions, constructors and generators survive a
+# collection (with stackless calls these frames are only referenced by the VM)
+
+import gc
+
+class C:
+    def __init__(self):
+        gc.collect()
+        self.l = [[i] * 7 for i in range(1000)]
+
+def f(n):
+    a = [n, n + 1]
+    b = 'x' * n
+    C()
+    return a, len(b)
+
+for i in range(10):
+    print(f(i))
+
+def g():
+    for i in range(3):
+        gc.collect()
+        l = [[j] * 7 for j in range(1000)]
+        yield i
+
+def h(n):
+    a = [n]
+    s = 0
+    for x in g():
+        s += x
+    return a, s
+
+for i in range(10):
+    print(h(i))
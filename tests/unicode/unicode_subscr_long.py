@@ -0,0 +1,26 @@
+# indexing and slicing long str, which may use a cached index of the characters
+
+s = "aé€😀" * 100 + "x" * 50
+n = len(s)
+print(n, len(s.encode()))
+print("".join(s[i] for i in range(n)) == s)
+print("".join(s[i - n] for i in range(n)) == s)
+print(s[0], s[1], s[2], s[3], s[31], s[32], s[33], s[399], s[400], s[-1], s[-51], s[-450])
+print(s[10:20], s[-60:-45], s[395:405], s[-1000:3], s[448:1000], repr(s[500:600]))
+for i in (n, -n - 1):
+    try:
+        s[i]
+    except IndexError:
+        print("IndexError")
+
+# ASCII only
+a = "abc" * 40
+print(len(a), a[100], a[-1], a[50:55], a[-200:2])
+
+# many long str of the same length, some freed and their memory reused
+for k in range(20):
+    t = (chr(0x100 + k) + "b") * 40 + "c" * (k % 3)
+    if t[k] != (chr(0x100 + k) if k % 2 == 0 else "b") or len(t) != 80 + k % 3:
+        print("wrong", k)
+    l = [str(i) * 30 for i in range(50)]
+print(t[-1], t[60:63])
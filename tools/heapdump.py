@@ -0,0 +1,481 @@
+#!/usr/bin/env python3
+#
+# This file is part of the MicroPython project, http://micropython.org/
+#
+# The MIT License (MIT)
+#
+# Copyright (c) 2026 agent
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Analyse a MicroPython heap: a dump written by micropython.heap_dump(), or
+the GC area(s) of a RAM image captured from a device.
+
+It reports the size of the objects of each type and how much of the heap they
+keep alive (their retained size, computed with a dominator tree: an object
+dominates another if every path from the roots to the other goes through it),
+the objects that retain the most, and how fragmented the free memory is.
+"""
+
+from __future__ import print_function
+import array
+import re
+import struct
+import sys
+
+DUMP_END = 0
+DUMP_AREA = 1
+DUMP_ROOTS = 2
+DUMP_TYPE = 3
+
+ROOT_NAMES = {0: 'state', 1: 'stack', 2: 'pystack'}
+
+AT_FREE = 0
+AT_HEAD = 1
+AT_TAIL = 2
+AT_MARK = 3
+
+
+class HeapError(Exception):
+    pass
+
+
+class Area:
+    def __init__(self, pool_start, n_blocks, atb, pool):
+        self.pool_start = pool_start
+        self.n_blocks = n_blocks
+        self.atb = atb
+        self.pool = pool  # an array of words
+
+    def kind(self, block):
+        return (self.atb[block >> 2] >> (2 * (block & 3))) & 3
+
+
+class Heap:
+    def __init__(self, word_size, big_endian, block_size):
+        self.word_size = word_size
+        self.big_endian = big_endian
+        self.block_size = block_size
+        self.areas = []
+        self.roots = []  # list of (name, words)
+        self.type_names = {}
+
+    def words(self, data):
+        code = {4: 'I', 8: 'Q'}[self.word_size]
+        if array.array(code).itemsize != self.word_size:
+            code = 'L'
+        a = array.array(code)
+        a.frombytes(bytes(data)) if hasattr(a, 'frombytes') else a.fromstring(bytes(data))
+        if self.big_endian != (sys.byteorder == 'big'):
+            a.byteswap()
+        return a
+
+    def add_area(self, pool_start, n_blocks, atb, pool):
+        if len(atb) * 4 < n_blocks or len(pool) < n_blocks * self.block_size:
+            raise HeapError('area at 0x%x is truncated' % pool_start)
+        self.areas.append(Area(pool_start, n_blocks, bytearray(atb),
+            self.words(pool[:n_blocks * self.block_size])))
+
+
+def load_dump(filename):
+    with open(filename, 'rb') as f:
+        data = f.read()
+    if data[:4] != b'MPHD':
+        raise HeapError('%s is not a heap dump' % filename)
+    version, word_size, big_endian, block_size = struct.unpack_from('4B', data, 4)
+    if version != 1:
+        raise HeapError('unsupported heap dump version %d' % version)
+    heap = Heap(word_size, big_endian, block_size)
+    rec_fmt = ('>' if big_endian else '<') + ('I' if word_size == 4 else 'Q') * 3
+    pos = 8
+    while True:
+        if pos + 3 * word_size > len(data):
+            raise HeapError('heap dump is truncated')
+        kind, a, b = struct.unpack_from(rec_fmt, data, pos)
+        pos += 3 * word_size
+        if kind == DUMP_END:
+            break
+        elif kind == DUMP_AREA:
+            atb = data[pos:pos + b // 4]
+            pos += b // 4
+            heap.add_area(a, b, atb, data[pos:pos + b * block_size])
+            pos += b * block_size
+        elif kind == DUMP_ROOTS:
+            heap.roots.append((ROOT_NAMES.get(a, 'roots %d' % a), heap.words(data[pos:pos + b * word_size])))
+            pos += b * word_size
+        elif kind == DUMP_TYPE:
+            heap.type_names.setdefault(a, data[pos:pos + b].decode('utf-8', 'replace'))
+            pos += b
+        else:
+            raise HeapError('unknown record %d in heap dump' % kind)
+    return heap
+
+
+def parse_int_list(arg, n):
+    try:
+        vals = [int(x, 0) for x in arg.split(':')]
+    except ValueError:
+        vals = []
+    if len(vals) != n:
+        raise HeapError('expected %d numbers separated by ":", got %r' % (n, arg))
+    return vals
+
+
+def load_ram_image(args):
+    with open(args.ram, 'rb') as f:
+        data = f.read()
+    base = args.ram_base
+
+    def read(addr, length, what):
+        if addr < base or addr + length > base + len(data):
+            raise HeapError('%s at 0x%x..0x%x is not in the RAM image' % (what, addr, addr + length))
+        return data[addr - base:addr - base + length]
+
+    heap = Heap(args.word_size, args.big_endian, args.block_size)
+    if not args.area:
+        raise HeapError('give the heap areas in the RAM image with --area')
+    for area in args.area:
+        atb, pool, n_blocks = parse_int_list(area, 3)
+        heap.add_area(pool, n_blocks, read(atb, n_blocks // 4, 'allocation table'),
+            read(pool, n_blocks * args.block_size, 'pool'))
+    for roots in args.roots or []:
+        addr, n_words = parse_int_list(roots, 2)
+        heap.roots.append(('0x%x' % addr, heap.words(read(addr, n_words * args.word_size, 'roots'))))
+    return heap
+
+
+def load_map(heap, filename):
+    # Take the addresses of the mp_type_xxx structures from a GNU ld map file,
+    # where they are either listed as symbols or (with -fdata-sections) as
+    # sections whose address may be on the next line, or from the output of nm.
+    sym_re = re.compile(r'^\s*(?:\.\w+\.)?(mp_type_\w+)?\s*(?:0x)?([0-9a-fA-F]{6,})\s+(?:[0-9a-fA-FxX]+\s+\S+|[a-zA-Z]\s+(mp_type_\w+)|(mp_type_\w+))?\s*$')
+    pending = None
+    with open(filename) as f:
+        for line in f:
+            m = sym_re.match(line)
+            if m:
+                name = m.group(1) or pending or m.group(3) or m.group(4)
+                if name is not None:
+                    heap.type_names.setdefault(int(m.group(2), 16), name[len('mp_type_'):])
+                pending = None
+            else:
+                m = re.match(r'^\s*\.\w+\.(mp_type_\w+)\s*$', line)
+                pending = m.group(1) if m else None
+
+
+class Graph:
+    """The objects on the heap and the pointers between them."""
+
+    def __init__(self, heap):
+        self.heap = heap
+        self.addr = []  # address of each object
+        self.size = []  # size of each object in bytes
+        self.type = []  # name of the type of each object
+        self.edges = []  # objects that each object points to
+        index = {}  # address of the head block of an object -> its number
+        bs = heap.block_size
+        blocks_per_word = bs // heap.word_size
+        self.free_runs = []  # for each area, a list of the lengths of runs of free blocks
+        spans = []
+        for area in heap.areas:
+            runs = []
+            free = 0
+            block = 0
+            n = area.n_blocks
+            while block < n:
+                kind = area.kind(block)
+                if kind == AT_FREE:
+                    free += 1
+                    block += 1
+                    continue
+                if free:
+                    runs.append(free)
+                    free = 0
+                if kind == AT_TAIL:
+                    # a tail without a head can only be from a damaged heap
+                    block += 1
+                    continue
+                start = block
+                block += 1
+                while block < n and area.kind(block) == AT_TAIL:
+                    block += 1
+                index[area.pool_start + start * bs] = len(self.addr)
+                self.addr.append(area.pool_start + start * bs)
+                self.size.append((block - start) * bs)
+                spans.append((area.pool, start * blocks_per_word, block * blocks_per_word))
+            if free:
+                runs.append(free)
+            self.free_runs.append((area, runs))
+        self.index = index
+        mask = bs - 1
+        get = index.get
+        for pool, start, end in spans:
+            out = []
+            for w in pool[start:end]:
+                if not w & mask:
+                    i = get(w)
+                    if i is not None:
+                        out.append(i)
+            self.edges.append(out)
+        names = heap.type_names
+        for pool, start, end in spans:
+            self.type.append(names.get(pool[start], '<data>'))
+        self.n = len(self.addr)
+
+    def root_objects(self):
+        """Return the objects that the roots point to, and a name for where
+        each is pointed to from."""
+        mask = self.heap.block_size - 1
+        roots = {}
+        for name, words in self.heap.roots:
+            for w in words:
+                if not w & mask:
+                    i = self.index.get(w)
+                    if i is not None:
+                        roots.setdefault(i, name)
+        return roots
+
+
+def dfs_postorder(n_nodes, succ, start):
+    """Return the nodes reachable from start in depth-first postorder."""
+    seen = bytearray(n_nodes)
+    seen[start] = 1
+    order = []
+    stack = [(start, iter(succ[start]))]
+    while stack:
+        node, it = stack[-1]
+        for s in it:
+            if not seen[s]:
+                seen[s] = 1
+                stack.append((s, iter(succ[s])))
+                break
+        else:
+            stack.pop()
+            order.append(node)
+    return order
+
+
+def dominators(n_nodes, succ, root):
+    """Return the immediate dominator of each node reachable from root, or
+    None for the others, using the algorithm of Cooper, Harvey and Kennedy."""
+    post = dfs_postorder(n_nodes, succ, root)
+    post_num = [-1] * n_nodes
+    for i, node in enumerate(post):
+        post_num[node] = i
+    preds = [[] for _ in range(n_nodes)]
+    for node in post:
+        for s in succ[node]:
+            preds[s].append(node)
+    idom = [None] * n_nodes
+    idom[root] = root
+    changed = True
+    while changed:
+        changed = False
+        for node in reversed(post):
+            if node == root:
+                continue
+            new = None
+            for p in preds[node]:
+                if idom[p] is None:
+                    continue
+                if new is None:
+                    new = p
+                    continue
+                # intersect
+                a, b = p, new
+                while a != b:
+                    while post_num[a] < post_num[b]:
+                        a = idom[a]
+                    while post_num[b] < post_num[a]:
+                        b = idom[b]
+                new = a
+            if idom[node] != new:
+                idom[node] = new
+                changed = True
+    return idom, post
+
+
+def fmt_size(n):
+    if n >= 10 * 1024 * 1024:
+        return '%dM' % (n // (1024 * 1024))
+    if n >= 10 * 1024:
+        return '%dk' % (n // 1024)
+    return '%d' % n
+
+
+def analyse(heap, args, out=sys.stdout):
+    g = Graph(heap)
+    n = g.n
+    bs = heap.block_size
+    total = sum(area.n_blocks for area in heap.areas) * bs
+    used = sum(g.size)
+    print('heap: %d bytes in %d area(s), %d used by %d objects (%d%%), %d free'
+        % (total, len(heap.areas), used, n, 100 * used // max(total, 1), total - used), file=out)
+
+    # A virtual root node, number n, points to the objects that the roots do.
+    # Without roots (for a RAM image) it points to the objects that nothing
+    # else does, and to one object of each cycle that is left over.
+    succ = g.edges + [[]]
+    root = n
+    root_from = g.root_objects()
+    if root_from:
+        succ[root] = sorted(root_from)
+        print('roots: %s' % ', '.join('%s (%d words)' % (name, len(words)) for name, words in heap.roots), file=out)
+    else:
+        indeg = bytearray(n)
+        for out_edges in g.edges:
+            for s in out_edges:
+                indeg[s] = 1
+        succ[root] = [i for i in range(n) if not indeg[i]]
+        reached = bytearray(n + 1)
+        for node in dfs_postorder(n + 1, succ, root):
+            reached[node] = 1
+        for i in range(n):
+            if not reached[i]:
+                succ[root].append(i)
+                for node in dfs_postorder(n + 1, succ, i):
+                    reached[node] = 1
+        print('roots: none given, so taking the objects that nothing points to', file=out)
+
+    idom, post = dominators(n + 1, succ, root)
+
+    # retained size: the object and all that it dominates
+    retained = g.size + [0]
+    for node in post:
+        if node != root:
+            retained[idom[node]] += retained[node]
+    unreachable = [i for i in range(n) if idom[i] is None]
+    if unreachable:
+        print('unreachable: %d bytes in %d objects (freed by the next collection)'
+            % (sum(g.size[i] for i in unreachable), len(unreachable)), file=out)
+
+    # children in the dominator tree
+    dom_children = [[] for _ in range(n + 1)]
+    for node in post:
+        if node != root:
+            dom_children[idom[node]].append(node)
+
+    # Per type: the objects, and what they retain without counting an object
+    # that's dominated by another of the same type twice.
+    by_type = {}
+    on_path = {}
+    stack = [(root, False)]
+    while stack:
+        node, leaving = stack.pop()
+        t = g.type[node] if node != root else None
+        if leaving:
+            on_path[t] -= 1
+            continue
+        if node != root:
+            entry = by_type.setdefault(t, [0, 0, 0])
+            entry[0] += 1
+            entry[1] += g.size[node]
+            if not on_path.get(t):
+                entry[2] += retained[node]
+            on_path[t] = on_path.get(t, 0) + 1
+            stack.append((node, True))
+        for c in dom_children[node]:
+            stack.append((c, False))
+    print(file=out)
+    print('%-32s %8s %10s %10s' % ('type', 'count', 'size', 'retained'), file=out)
+    for t, (count, size, ret) in sorted(by_type.items(), key=lambda x: (-x[1][2], -x[1][1], x[0]))[:args.top]:
+        print('%-32s %8d %10d %10d' % (t, count, size, ret), file=out)
+    if len(by_type) > args.top:
+        print('(%d more types)' % (len(by_type) - args.top), file=out)
+
+    # the dominator tree, down to objects retaining a given part of the heap
+    limit = max(used * args.min_percent / 100, 1)
+    print(file=out)
+    print('dominator tree, objects retaining at least %s bytes:' % fmt_size(int(limit)), file=out)
+    stack = [(c, 0) for c in sorted(dom_children[root], key=lambda c: retained[c])]
+    shown = 0
+    while stack:
+        node, depth = stack.pop()
+        if retained[node] < limit:
+            continue
+        where = ''
+        if depth == 0 and node in root_from:
+            where = ' from %s' % root_from[node]
+        what = g.type[node]
+        if g.addr[node] in heap.type_names:
+            # a class
+            what += ' ' + heap.type_names[g.addr[node]]
+        print('%s%8s %s @0x%x (%d bytes)%s' % ('  ' * depth, fmt_size(retained[node]), what,
+            g.addr[node], g.size[node], where), file=out)
+        shown += 1
+        if depth + 1 < args.depth:
+            stack.extend((c, depth + 1) for c in sorted(dom_children[node], key=lambda c: retained[c]))
+    if not shown:
+        print('  (none)', file=out)
+
+    # fragmentation of the free memory
+    print(file=out)
+    print('free memory:', file=out)
+    hist = {}
+    for area, runs in g.free_runs:
+        free = sum(runs) * bs
+        largest = max(runs) * bs if runs else 0
+        print('  area 0x%x: %d bytes free in %d runs, largest %d bytes, fragmentation %d%%'
+            % (area.pool_start, free, len(runs), largest, 100 - 100 * largest // free if free else 0), file=out)
+        for r in runs:
+            b = r.bit_length() - 1
+            hist[b] = hist.get(b, 0) + r
+    print('  free bytes by the length of their run:', file=out)
+    for b in sorted(hist):
+        print('  %8s - %-8s %10d' % (fmt_size(bs << b), fmt_size((bs << (b + 1)) - bs), hist[b] * bs), file=out)
+
+
+def main():
+    import argparse
+    cmd_parser = argparse.ArgumentParser(description='Analyse a MicroPython heap dump or RAM image.')
+    cmd_parser.add_argument('dump', nargs='?', help='heap dump written by micropython.heap_dump()')
+    cmd_parser.add_argument('--top', type=int, default=20, help='number of types to list')
+    cmd_parser.add_argument('--depth', type=int, default=4, help='depth of the dominator tree to show')
+    cmd_parser.add_argument('--min-percent', type=float, default=1.0,
+        help='show objects in the dominator tree that retain this percentage of the used heap')
+    cmd_parser.add_argument('--map', help='GNU ld map file or nm output to name the types with')
+    group = cmd_parser.add_argument_group('RAM images')
+    group.add_argument('--ram', help='RAM image to analyse instead of a dump')
+    group.add_argument('--ram-base', type=lambda x: int(x, 0), default=0, help='address of the RAM image')
+    group.add_argument('--area', action='append', metavar='ATB:POOL:BLOCKS',
+        help='addresses of the allocation table and pool of a heap area, and its number of blocks')
+    group.add_argument('--roots', action='append', metavar='ADDR:WORDS',
+        help='words to take as roots, eg the root pointers of mp_state_ctx')
+    group.add_argument('--word-size', type=int, default=4, choices=(4, 8))
+    group.add_argument('--block-size', type=int, default=16, help='MICROPY_BYTES_PER_GC_BLOCK')
+    group.add_argument('--big-endian', action='store_true')
+    args = cmd_parser.parse_args()
+
+    try:
+        if args.ram:
+            heap = load_ram_image(args)
+        elif args.dump:
+            heap = load_dump(args.dump)
+        else:
+            cmd_parser.error('give a heap dump or a RAM image')
+        if args.map:
+            load_map(heap, args.map)
+        analyse(heap, args)
+    except HeapError as er:
+        print('error:', er, file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
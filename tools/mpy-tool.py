@@ -72,6 +72,14 @@ MP_OPCODE_OFFSET = 3
 MP_BC_MAKE_CLOSURE = 0x62
 MP_BC_MAKE_CLOSURE_DEFARGS = 0x63
 MP_BC_RAISE_VARARGS = 0x5c
+# superinstructions, 3 extra bytes:
+MP_BC_BINARY_OP_FAST_FAST = 0x48
+MP_BC_BINARY_OP_FAST_SMALL_INT_STORE = 0x4a
+MP_BC_BINARY_OP_FAST_FAST_SMALL_INT = 0x2c
+MP_BC_BINARY_OP_FAST_SMALL_INT_STORE_SMALL_INT = 0x2e
+# quickenable binary ops, 1 extra byte:
+MP_BC_BINARY_OP = 0x4b
+MP_BC_BINARY_OP_FLOAT = 0x4d
 # extra byte if caching enabled:
 MP_BC_LOAD_NAME = 0x1b
 MP_BC_LOAD_GLOBAL = 0x1c
@@ -99,15 +107,15 @@ def make_opcode_format():
     OC4(B, B, V, V), # 0x20-0x23
     OC4(Q, Q, Q, B), # 0x24-0x27
     OC4(V, V, Q, Q), # 0x28-0x2b
-    OC4(U, U, U, U), # 0x2c-0x2f
+    OC4(B, B, B, U), # 0x2c-0x2f
     OC4(B, B, B, B), # 0x30-0x33
     OC4(B, O, O, O), # 0x34-0x37
     OC4(O, O, U, U), # 0x38-0x3b
     OC4(U, O, B, O), # 0x3c-0x3f
     OC4(O, B, B, O), # 0x40-0x43
     OC4(B, B, O, B), # 0x44-0x47
-    OC4(U, U, U, U), # 0x48-0x4b
-    OC4(U, U, U, U), # 0x4c-0x4f
+    OC4(B, B, B, B), # 0x48-0x4b
+    OC4(B, B, U, U), # 0x4c-0x4f
     OC4(V, V, U, V), # 0x50-0x53
     OC4(B, U, V, V), # 0x54-0x57
     OC4(V, V, V, B), # 0x58-0x5b
@@ -179,6 +187,11 @@ def mp_opcode_format(bytecode, ip, opcode_format=make_opcode_format()):
             or opcode == MP_BC_MAKE_CLOSURE
             or opcode == MP_BC_MAKE_CLOSURE_DEFARGS
         )
+        if (MP_BC_BINARY_OP_FAST_FAST <= opcode <= MP_BC_BINARY_OP_FAST_SMALL_INT_STORE
+            or MP_BC_BINARY_OP_FAST_FAST_SMALL_INT <= opcode <= MP_BC_BINARY_OP_FAST_SMALL_INT_STORE_SMALL_INT):
+            extra_byte = 3
+        elif MP_BC_BINARY_OP <= opcode <= MP_BC_BINARY_OP_FLOAT:
+            extra_byte = 1
         ip += 1
         if f == MP_OPCODE_VAR_UINT:
             while bytecode[ip] & 0x80 != 0:
@@ -259,9 +272,18 @@ class RawCode:
         # generate bytecode data
         print()
         print('// frozen bytecode for file %s, scope %s%s' % (self.source_file.str, parent_name, self.simple_name.str))
-        print('STATIC ', end='')
-        if not config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE:
-            print('const ', end='')
+        if (config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
+            or config.MICROPY_OPT_BYTECODE_QUICKENING):
+            print('STATIC ', end='')
+        elif config.MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS:
+            # a VM with quickening rewrites superinstructions in place, even
+            # if they come from an .mpy file made without it
+            print('STATIC')
+            print('#if !MICROPY_OPT_BYTECODE_QUICKENING')
+            print('const')
+            print('#endif')
+        else:
+            print('STATIC const ', end='')
         print('byte bytecode_data_%s[%u] = {' % (self.escaped_name, len(self.bytecode)))
         print('   ', end='')
         for i in range(self.ip2):
@@ -453,6 +475,8 @@ def read_mpy(filename):
         feature_flags = header[2]
         config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE = (feature_flags & 1) != 0
         config.MICROPY_PY_BUILTINS_STR_UNICODE = (feature_flags & 2) != 0
+        config.MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS = (feature_flags & 4) != 0
+        config.MICROPY_OPT_BYTECODE_QUICKENING = (feature_flags & 8) != 0
         config.mp_small_int_bits = header[3]
         return read_raw_code(f)
 
@@ -481,6 +505,18 @@ def freeze_mpy(base_qstrs, raw_codes):
     print('#endif')
     print()
 
+    if config.MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS:
+        print('#if !MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS')
+        print('#error "incompatible MICROPY_OPT_BYTECODE_SUPERINSTRUCTIONS"')
+        print('#endif')
+        print()
+
+    if config.MICROPY_OPT_BYTECODE_QUICKENING:
+        print('#if !MICROPY_OPT_BYTECODE_QUICKENING')
+        print('#error "incompatible MICROPY_OPT_BYTECODE_QUICKENING"')
+        print('#endif')
+        print()
+
     print('#if MICROPY_LONGINT_IMPL != %u' % config.MICROPY_LONGINT_IMPL)
     print('#error "incompatible MICROPY_LONGINT_IMPL"')
     print('#endif')